@@ -27,7 +27,7 @@
  * @{
  */
 
-#define LTO_API_VERSION 4
+#define LTO_API_VERSION 6
 
 typedef enum {
     LTO_SYMBOL_ALIGNMENT_MASK              = 0x0000001F, /* log2 of alignment */
@@ -236,6 +236,24 @@ extern void
 lto_codegen_set_cpu(lto_code_gen_t cg, const char *cpu);
 
 
+/**
+ * Sets the number of threads lto_codegen_compile_to_files() may use for code
+ * generation.  The optimized module is split into at most that many
+ * partitions, each producing its own object file.  The default is 1.
+ */
+extern void
+lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned threads);
+
+/**
+ * Sets a directory in which lto_codegen_compile_to_files() caches the object
+ * files it generates.  The optimized module is then split into partitions by
+ * symbol name, and a partition whose contents and code generation options
+ * match an earlier link is copied from the cache rather than compiled again.
+ * The directory is created if needed.  Passing NULL turns caching off.
+ */
+extern void
+lto_codegen_set_cache_dir(lto_code_gen_t cg, const char *path);
+
 /**
  * Sets the location of the assembler tool to run. If not set, libLTO
  * will use gcc to invoke the assembler.
@@ -284,6 +302,16 @@ lto_codegen_compile(lto_code_gen_t cg, size_t* length);
 extern bool
 lto_codegen_compile_to_file(lto_code_gen_t cg, const char** name);
 
+/**
+ * Generates code for all added modules into one or more native object files,
+ * as requested by lto_codegen_set_parallelism().  On success the file names
+ * are written to names and their number to count; both are owned by the
+ * lto_code_gen_t.  Returns true on error.
+ */
+extern bool
+lto_codegen_compile_to_files(lto_code_gen_t cg, const char*** names,
+                             unsigned* count);
+
 
 /**
  * Sets options to help debug codegen bugs.
@@ -10,7 +10,8 @@
 // This file defines the 'Statistic' class, which is designed to be an easy way
 // to expose various metrics from passes.  These statistics are printed at the
 // end of a run (from llvm_shutdown), when the -stats command line option is
-// passed on the command line.
+// passed on the command line.  They can also be read, and reset, at any time
+// with GetStatistics.
 //
 // This is useful for reporting information like the number of instructions
 // simplified, optimized or removed by various transformations, like this:
@@ -27,7 +28,9 @@
 #define LLVM_ADT_STATISTIC_H
 
 #include "llvm/Support/Atomic.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/Valgrind.h"
+#include <vector>
 
 namespace llvm {
 class raw_ostream;
@@ -38,74 +41,85 @@ public:
   const char *Desc;
   volatile llvm::sys::cas_flag Value;
   bool Initialized;
-
-  llvm::sys::cas_flag getValue() const { return Value; }
+  unsigned Index;
+
+  /// ShardChunkSize, MaxShardedStatistics - The counters of a shard are
+  /// allocated in chunks of ShardChunkSize.  Statistics registered after the
+  /// first MaxShardedStatistics only use Value.
+  enum {
+    ShardChunkSize = 256,
+    MaxShardedStatistics = 64 * ShardChunkSize
+  };
+
+  /// getValue - Return the current value of the statistic, merging the counts
+  /// of all threads.
+  unsigned getValue() const;
   const char *getName() const { return Name; }
   const char *getDesc() const { return Desc; }
 
-  /// construct - This should only be called for non-global statistics.
+  /// construct - This should only be called for non-global statistics.  Once
+  /// updated, the statistic is registered and must outlive all readers of the
+  /// statistics.
   void construct(const char *name, const char *desc) {
     Name = name; Desc = desc;
-    Value = 0; Initialized = 0;
+    Value = 0; Initialized = 0; Index = 0;
   }
 
   // Allow use of this class as the value itself.
-  operator unsigned() const { return Value; }
+  operator unsigned() const { return getValue(); }
 
 #if !defined(NDEBUG) || defined(LLVM_ENABLE_STATS)
-   const Statistic &operator=(unsigned Val) {
-    Value = Val;
-    return init();
+  // Updates go to one of several shards of counters, picked by the updating
+  // thread, so that threads compiling concurrently do not fight over one
+  // cache line.  Readers add the shards up.  Updates that are not plain
+  // additions (assignment, multiplication, division) read the merged value
+  // first and are not atomic with respect to concurrent updates.
+  const Statistic &operator=(unsigned Val) {
+    init().set(Val);
+    return *this;
   }
 
   const Statistic &operator++() {
-    // FIXME: This function and all those that follow carefully use an
-    // atomic operation to update the value safely in the presence of
-    // concurrent accesses, but not to read the return value, so the
-    // return value is not thread safe.
-    sys::AtomicIncrement(&Value);
-    return init();
+    init().add(1);
+    return *this;
   }
 
+  // The postfix operators only see the updates of the threads sharing the
+  // calling thread's shard in the value they return; adding up all shards
+  // would make every update touch the cache lines of other threads.
   unsigned operator++(int) {
-    init();
-    unsigned OldValue = Value;
-    sys::AtomicIncrement(&Value);
-    return OldValue;
+    return init().add(1) - 1;
   }
 
   const Statistic &operator--() {
-    sys::AtomicDecrement(&Value);
-    return init();
+    init().add(-1);
+    return *this;
   }
 
   unsigned operator--(int) {
-    init();
-    unsigned OldValue = Value;
-    sys::AtomicDecrement(&Value);
-    return OldValue;
+    return init().add(-1) + 1;
   }
 
   const Statistic &operator+=(const unsigned &V) {
     if (!V) return *this;
-    sys::AtomicAdd(&Value, V);
-    return init();
+    init().add(V);
+    return *this;
   }
 
   const Statistic &operator-=(const unsigned &V) {
     if (!V) return *this;
-    sys::AtomicAdd(&Value, -V);
-    return init();
+    init().add(-V);
+    return *this;
   }
 
   const Statistic &operator*=(const unsigned &V) {
-    sys::AtomicMul(&Value, V);
-    return init();
+    init().set(getValue() * V);
+    return *this;
   }
 
   const Statistic &operator/=(const unsigned &V) {
-    sys::AtomicDiv(&Value, V);
-    return init();
+    init().set(getValue() / V);
+    return *this;
   }
 
 #else  // Statistics are disabled in release builds.
@@ -157,12 +171,40 @@ protected:
     return *this;
   }
   void RegisterStatistic();
+
+#ifdef LLVM_THREAD_LOCAL
+  /// ThreadChunks - The counter chunks of the calling thread's shard, or null
+  /// until the thread first updates a statistic.
+  static LLVM_THREAD_LOCAL volatile sys::cas_flag **ThreadChunks;
+#endif
+
+  /// add - Add \p Delta to the calling thread's shard of the statistic, and
+  /// return the new value of the shard plus the unsharded part.
+  unsigned add(sys::cas_flag Delta) {
+#ifdef LLVM_THREAD_LOCAL
+    // Once the thread has a shard and the chunk holding this statistic's
+    // counter exists, this is a single atomic add.
+    if (volatile sys::cas_flag **Chunks = ThreadChunks)
+      if (Index < MaxShardedStatistics)
+        if (volatile sys::cas_flag *Chunk = Chunks[Index / ShardChunkSize])
+          return sys::AtomicAdd(&Chunk[Index % ShardChunkSize], Delta) +
+                 Value;
+#endif
+    return addSlow(Delta);
+  }
+
+  /// addSlow - Implement add when the calling thread's counter may not exist
+  /// yet.
+  unsigned addSlow(sys::cas_flag Delta);
+
+  /// set - Make the merged value of the statistic \p Val.
+  void set(unsigned Val);
 };
 
 // STATISTIC - A macro to make definition of statistics really simple.  This
 // automatically passes the DEBUG_TYPE of the file into the statistic.
 #define STATISTIC(VARNAME, DESC) \
-  static llvm::Statistic VARNAME = { DEBUG_TYPE, DESC, 0, 0 }
+  static llvm::Statistic VARNAME = { DEBUG_TYPE, DESC, 0, 0, 0 }
 
 /// \brief Enable the collection and printing of statistics.
 void EnableStatistics();
@@ -176,6 +218,26 @@ void PrintStatistics();
 /// \brief Print statistics to the given output stream.
 void PrintStatistics(raw_ostream &OS);
 
+/// \brief The value of one statistic at the time it was read.
+struct StatisticValue {
+  const char *Name;
+  const char *Desc;
+  unsigned Value;
+};
+
+/// \brief Read every statistic that has been updated so far, sorted by name
+/// and description.  This works whether or not statistics are being printed.
+/// If \p Reset is true, what was read is also subtracted from the statistics,
+/// so that updates made while they are read count toward the next read.
+void GetStatistics(std::vector<StatisticValue> &Values, bool Reset = false);
+
+/// \brief Set all statistics back to zero.
+void ResetStatistics();
+
+/// \brief Print all statistics to \p OS as a JSON array of objects with
+/// "name", "desc" and "value" members.
+void PrintStatisticsJSON(raw_ostream &OS);
+
 } // End llvm namespace
 
 #endif
@@ -97,6 +97,9 @@ public:
     return (StringMapEntryBase*)-1;
   }
 
+  /// hash - Return the full hash value that the map stores for \p Key.
+  static unsigned hash(StringRef Key);
+
   unsigned getNumBuckets() const { return NumBuckets; }
   unsigned getNumItems() const { return NumItems; }
 
@@ -197,6 +197,7 @@ namespace llvm {
   // Minor pass prototypes, allowing us to expose them through bugpoint and
   // analyze.
   FunctionPass *createInstCountPass();
+  ModulePass *createUseListStatsPass();
 
   //===--------------------------------------------------------------------===//
   //
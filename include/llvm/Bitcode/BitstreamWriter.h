@@ -18,6 +18,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Bitcode/BitCodes.h"
+#include "llvm/Support/raw_ostream.h"
 #include <vector>
 
 namespace llvm {
@@ -60,13 +61,34 @@ class BitstreamWriter {
   };
   std::vector<BlockInfo> BlockInfoRecords;
 
+  /// PinnedBytes - When the stream is flushed to a file, the number of bytes
+  /// at the start of Out that were emitted before the first flush.  They stay
+  /// in memory, so the blocks open at that point can still be backpatched.
+  unsigned PinnedBytes;
+
+  /// FlushedBytes - The number of bytes following the pinned ones that were
+  /// written to the file and dropped from Out.
+  unsigned FlushedBytes;
+
+  /// FileStart - The position in the file of the start of the stream.
+  uint64_t FileStart;
+
+  /// getByte - Return the byte at \p ByteNo in the stream, which must not
+  /// have been dropped by FlushToFile.
+  char &getByte(unsigned ByteNo) {
+    if (ByteNo < PinnedBytes)
+      return Out[ByteNo];
+    assert(ByteNo >= PinnedBytes + FlushedBytes && "Byte already flushed!");
+    return Out[ByteNo - FlushedBytes];
+  }
+
   // BackpatchWord - Backpatch a 32-bit word in the output with the specified
   // value.
   void BackpatchWord(unsigned ByteNo, unsigned NewWord) {
-    Out[ByteNo++] = (unsigned char)(NewWord >>  0);
-    Out[ByteNo++] = (unsigned char)(NewWord >>  8);
-    Out[ByteNo++] = (unsigned char)(NewWord >> 16);
-    Out[ByteNo  ] = (unsigned char)(NewWord >> 24);
+    getByte(ByteNo++) = (unsigned char)(NewWord >>  0);
+    getByte(ByteNo++) = (unsigned char)(NewWord >>  8);
+    getByte(ByteNo++) = (unsigned char)(NewWord >> 16);
+    getByte(ByteNo  ) = (unsigned char)(NewWord >> 24);
   }
 
   void WriteByte(unsigned char Value) {
@@ -83,7 +105,7 @@ class BitstreamWriter {
   }
 
   unsigned GetBufferOffset() const {
-    return Out.size();
+    return Out.size() + FlushedBytes;
   }
 
   unsigned GetWordIndex() const {
@@ -94,7 +116,8 @@ class BitstreamWriter {
 
 public:
   explicit BitstreamWriter(SmallVectorImpl<char> &O)
-    : Out(O), CurBit(0), CurValue(0), CurCodeSize(2) {}
+    : Out(O), CurBit(0), CurValue(0), CurCodeSize(2), PinnedBytes(0),
+      FlushedBytes(0), FileStart(0) {}
 
   ~BitstreamWriter() {
     assert(CurBit == 0 && "Unflused data remaining");
@@ -114,6 +137,65 @@ public:
   /// \brief Retrieve the current position in the stream, in bits.
   uint64_t GetCurrentBitNo() const { return GetBufferOffset() * 8 + CurBit; }
 
+  /// \brief Retrieve the width of abbreviation IDs in the current block.
+  unsigned GetAbbrevIDWidth() const { return CurCodeSize; }
+
+  /// \brief Overwrite the 32 bits already emitted at bit \p BitNo, which need
+  /// not be aligned, with \p NewWord.
+  void BackpatchBits(uint64_t BitNo, uint32_t NewWord) {
+    assert(BitNo + 32 <= GetBufferOffset() * 8 && "Bits not flushed yet!");
+    unsigned ByteNo = unsigned(BitNo / 8);
+    unsigned StartBit = unsigned(BitNo & 7);
+    if (StartBit == 0)
+      return BackpatchWord(ByteNo, NewWord);
+
+    // The word straddles five bytes; keep the bits around it.
+    uint64_t Bits = 0;
+    for (unsigned i = 0; i != 5; ++i)
+      Bits |= uint64_t((unsigned char)getByte(ByteNo + i)) << (i * 8);
+    Bits &= ~(uint64_t(~0U) << StartBit);
+    Bits |= uint64_t(NewWord) << StartBit;
+    for (unsigned i = 0; i != 5; ++i)
+      getByte(ByteNo + i) = (unsigned char)(Bits >> (i * 8));
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Streaming to a file
+  //===--------------------------------------------------------------------===//
+
+  /// FlushToFile - Write the stream emitted so far to \p FS, which must
+  /// support seeking, and drop it from the buffer.  The bytes emitted before
+  /// the first flush are kept in memory instead, so that the blocks open at
+  /// that point can be backpatched; blocks entered after it must be exited
+  /// before the next flush.  The stream must be 32-bit aligned.
+  void FlushToFile(raw_fd_ostream &FS) {
+    assert(CurBit == 0 && "Flushing the stream in the middle of a word!");
+    if (!PinnedBytes) {
+      FileStart = FS.tell();
+      PinnedBytes = Out.size();
+      FS.write(Out.data(), Out.size());
+      return;
+    }
+    assert((BlockScope.empty() ||
+            BlockScope.back().StartSizeWord * 4 < PinnedBytes) &&
+           "Flushing a block that still needs to be backpatched!");
+    FS.write(Out.data() + PinnedBytes, Out.size() - PinnedBytes);
+    FlushedBytes += Out.size() - PinnedBytes;
+    Out.resize(PinnedBytes);
+  }
+
+  /// FinishFlushingToFile - Write the rest of the stream to \p FS, and the
+  /// final, backpatched contents of the bytes kept by FlushToFile over the
+  /// ones written first.  All blocks must have been exited.
+  void FinishFlushingToFile(raw_fd_ostream &FS) {
+    assert(BlockScope.empty() && "Block still open!");
+    FlushToFile(FS);
+    uint64_t End = FS.tell();
+    FS.seek(FileStart);
+    FS.write(Out.data(), PinnedBytes);
+    FS.seek(End);
+  }
+
   //===--------------------------------------------------------------------===//
   // Basic Primitives for emitting bits to the stream.
   //===--------------------------------------------------------------------===//
@@ -214,7 +296,16 @@ public:
     EmitVBR(BlockID, bitc::BlockIDWidth);
     EmitVBR(CodeLen, bitc::CodeLenWidth);
     FlushToWord();
+    EnterDetachedSubblock(BlockID, CodeLen);
+  }
 
+  /// EnterDetachedSubblock - Start a block without emitting the part of its
+  /// header that comes before the block length: what follows, up to the
+  /// matching ExitBlock, only depends on the block info of this stream and
+  /// not on where it goes in the stream it ends up in.  This lets blocks be
+  /// encoded separately, and then emitted with EmitDetachedSubblock.
+  void EnterDetachedSubblock(unsigned BlockID, unsigned CodeLen) {
+    assert(CurBit == 0 && "Detached block not 32-bit aligned!");
     unsigned BlockSizeWordIndex = GetWordIndex();
     unsigned OldCodeSize = CurCodeSize;
 
@@ -267,6 +358,19 @@ public:
     BlockScope.pop_back();
   }
 
+  /// EmitDetachedSubblock - Emit a complete block that was encoded between
+  /// EnterDetachedSubblock and ExitBlock, from the block length on, by a
+  /// stream with the same block info as this one.
+  void EmitDetachedSubblock(unsigned BlockID, unsigned CodeLen,
+                            StringRef Contents) {
+    assert(Contents.size() % 4 == 0 && "Detached block not 32-bit aligned!");
+    EmitCode(bitc::ENTER_SUBBLOCK);
+    EmitVBR(BlockID, bitc::BlockIDWidth);
+    EmitVBR(CodeLen, bitc::CodeLenWidth);
+    FlushToWord();
+    Out.append(Contents.begin(), Contents.end());
+  }
+
   //===--------------------------------------------------------------------===//
   // Record Emission
   //===--------------------------------------------------------------------===//
@@ -42,7 +42,11 @@ namespace bitc {
 
     TYPE_BLOCK_ID_NEW,
 
-    USELIST_BLOCK_ID
+    USELIST_BLOCK_ID,
+
+    FUNCTION_INDEX_BLOCK_ID,
+
+    CONTENT_HASH_BLOCK_ID
   };
 
 
@@ -71,7 +75,12 @@ namespace bitc {
     // MODULE_CODE_PURGEVALS: [numvals]
     MODULE_CODE_PURGEVALS   = 10,
 
-    MODULE_CODE_GCNAME      = 11   // GCNAME: [strchr x N]
+    MODULE_CODE_GCNAME      = 11,  // GCNAME: [strchr x N]
+
+    // FNINDEXOFFSET: [offset]
+    // Offset in 32-bit words from the start of the module block's contents to
+    // its FUNCTION_INDEX block.
+    MODULE_CODE_FNINDEXOFFSET = 12
   };
 
   /// PARAMATTR blocks have code for defining a parameter attribute set.
@@ -330,6 +339,24 @@ namespace bitc {
   enum UseListCodes {
     USELIST_CODE_ENTRY = 1   // USELIST_CODE_ENTRY: TBD.
   };
+
+  /// The function index (FUNCTION_INDEX_BLOCK_ID) is the last block of a
+  /// module and tells a lazy reader where each function body starts, so that
+  /// it does not have to skip over all of them to find out.
+  enum FunctionIndexCodes {
+    // ENTRY: [valueid, offset]
+    // Offset in bits from the start of the module block's contents to the
+    // function's FUNCTION_BLOCK, just past its block ID.
+    FNINDEX_CODE_ENTRY = 1
+  };
+
+  /// The content hashes (CONTENT_HASH_BLOCK_ID) of a module and its functions,
+  /// as computed by hashModuleContent and hashFunctionContent.  Each hash is
+  /// stored as four 32-bit words, least significant byte first.
+  enum ContentHashCodes {
+    CONTENT_HASH_CODE_MODULE   = 1, // MODULE:   [hash x 4]
+    CONTENT_HASH_CODE_FUNCTION = 2  // FUNCTION: [valueid, hash x 4]
+  };
 } // End bitc namespace
 } // End llvm namespace
 
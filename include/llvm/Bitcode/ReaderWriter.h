@@ -15,14 +15,18 @@
 #define LLVM_BITCODE_READERWRITER_H
 
 #include <string>
+#include <vector>
 
 namespace llvm {
   class BitstreamWriter;
+  class ContentHash;
   class MemoryBuffer;
   class DataStreamer;
+  class Function;
   class LLVMContext;
   class Module;
   class ModulePass;
+  class raw_fd_ostream;
   class raw_ostream;
 
   /// getLazyBitcodeModule - Read the header of the specified bitcode buffer
@@ -43,6 +47,37 @@ namespace llvm {
                                    LLVMContext &Context,
                                    std::string *ErrMsg = 0);
 
+  /// BitcodeFunctionConsumer - Receives the functions of a module read by
+  /// streamBitcodeFunctions, one body at a time.
+  class BitcodeFunctionConsumer {
+  public:
+    virtual ~BitcodeFunctionConsumer();
+
+    /// beginModule - Called once the module-level contents of \p M have been
+    /// read, before any function body.
+    virtual void beginModule(Module &M) {}
+
+    /// processFunction - Called with the body of \p F read in.  The body is
+    /// freed again when this returns.  No other function has its body in
+    /// memory at this point, so isDeclaration() is true for every callee of
+    /// \p F, even those the module defines.
+    virtual void processFunction(Function &F) = 0;
+
+    /// endModule - Called once every function body has been processed.
+    virtual void endModule(Module &M) {}
+  };
+
+  /// streamBitcodeFunctions - Read the module in the specified stream, and
+  /// hand its function bodies to \p Consumer in order, each one freed again
+  /// before the next one is read, so that only one body is in memory at a
+  /// time.  On success, this returns the module, with its function bodies
+  /// left to be materialized again.  On error, this returns null, and fills
+  /// in *ErrMsg with an error description if ErrMsg is non-null.
+  Module *streamBitcodeFunctions(const std::string &Name,
+                                 DataStreamer *Streamer, LLVMContext &Context,
+                                 BitcodeFunctionConsumer &Consumer,
+                                 std::string *ErrMsg = 0);
+
   /// getBitcodeTargetTriple - Read the header of the specified bitcode
   /// buffer and extract just the triple information. If successful,
   /// this returns a string and *does not* take ownership
@@ -52,6 +87,20 @@ namespace llvm {
                                      LLVMContext &Context,
                                      std::string *ErrMsg = 0);
 
+  /// getBitcodeContentHashes - Read the content hashes that were written into
+  /// the specified bitcode buffer with -enable-bc-content-hash, without
+  /// reading any function bodies, and *does not* take ownership of 'buffer'.
+  /// FunctionHashes gets the name and hash of every function with a body.  If
+  /// the buffer has no hashes, ModuleHash is left zero and FunctionHashes
+  /// empty.  On error, this returns true and fills in *ErrMsg if ErrMsg is
+  /// non-null.
+  bool getBitcodeContentHashes(MemoryBuffer *Buffer, LLVMContext &Context,
+                               ContentHash &ModuleHash,
+                               std::vector<std::pair<std::string,
+                                                     ContentHash> >
+                                 &FunctionHashes,
+                               std::string *ErrMsg = 0);
+
   /// ParseBitcodeFile - Read the specified bitcode file, returning the module.
   /// If an error occurs, this returns null and fills in *ErrMsg if it is
   /// non-null.  This method *never* takes ownership of Buffer.
@@ -63,6 +112,11 @@ namespace llvm {
   /// should be in "binary" mode.
   void WriteBitcodeToFile(const Module *M, raw_ostream &Out);
 
+  /// WriteBitcodeToFile - Write the specified module to the specified file.
+  /// If the file supports seeking, function bodies are written out as they
+  /// are encoded, instead of after the whole module.
+  void WriteBitcodeToFile(const Module *M, raw_fd_ostream &Out);
+
   /// createBitcodeWriterPass - Create and return a pass that writes the module
   /// to the specified ostream.
   ModulePass *createBitcodeWriterPass(raw_ostream &Str);
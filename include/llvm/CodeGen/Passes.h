@@ -418,6 +418,12 @@ namespace llvm {
   ///
   FunctionPass *createBasicRegisterAllocator();
 
+  /// LinearScanRegisterAllocation Pass - This pass implements a global register
+  /// allocator that assigns live ranges in program order and never splits
+  /// them. It is meant for JIT compilers that want reasonable code quickly.
+  ///
+  FunctionPass *createLinearScanRegisterAllocator();
+
   /// Greedy register allocation pass - This pass implements a global register
   /// allocator for optimized builds.
   ///
@@ -20,6 +20,7 @@
 #include "llvm/ADT/ilist.h"
 #include "llvm/CodeGen/DAGCombine.h"
 #include "llvm/CodeGen/SelectionDAGNodes.h"
+#include "llvm/Support/ArrayRecycler.h"
 #include "llvm/Support/RecyclingAllocator.h"
 #include "llvm/Target/TargetMachine.h"
 #include <cassert>
@@ -157,7 +158,14 @@ class SelectionDAG {
   /// CSE with existing nodes when a duplicate is requested.
   FoldingSet<SDNode> CSEMap;
 
-  /// OperandAllocator - Pool allocation for machine-opcode SDNode operands.
+  /// OperandRecycler - Recycling for the operand lists of nodes that have
+  /// more operands than they have room for.  The lists come from
+  /// OperandAllocator.
+  ArrayRecycler<SDUse> OperandRecycler;
+
+  /// OperandAllocator - Pool allocation for SDNode operands.  Its slabs come
+  /// from a cache shared by all SelectionDAGs, so the memory released when
+  /// the DAG is cleared is reused for the next block instead of being freed.
   BumpPtrAllocator OperandAllocator;
 
   /// Allocator - Pool allocation for misc. objects that are created once per
@@ -1081,6 +1089,14 @@ private:
   void DeleteNodeNotInCSEMaps(SDNode *N);
   void DeallocateNode(SDNode *N);
 
+  /// createOperands - Give Node, which has no operands yet, the NumOps
+  /// operands in Ops, in a list from OperandRecycler.
+  void createOperands(SDNode *Node, const SDValue *Ops, unsigned NumOps);
+
+  /// removeOperands - Give the operand list of Node back to OperandRecycler
+  /// if it came from there, leaving Node without operands.
+  void removeOperands(SDNode *Node);
+
   unsigned getEVTAlignment(EVT MemoryVT) const;
 
   void allnodes_clear();
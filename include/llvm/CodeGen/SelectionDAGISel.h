@@ -15,6 +15,7 @@
 #ifndef LLVM_CODEGEN_SELECTIONDAGISEL_H
 #define LLVM_CODEGEN_SELECTIONDAGISEL_H
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/SelectionDAG.h"
 #include "llvm/IR/BasicBlock.h"
@@ -66,6 +67,9 @@ public:
 
   virtual bool runOnMachineFunction(MachineFunction &MF);
 
+  /// doFinalization - Write out the -fast-isel-report records of the module.
+  virtual bool doFinalization(Module &M);
+
   virtual void EmitFunctionEntryCode() {}
 
   /// PreprocessISelDAG - This hook allows targets to hack on the graph before
@@ -250,6 +254,31 @@ private:
 
   void PrepareEHLandingPad();
 
+  /// FastISelFallbacks - For -fast-isel-report, the number of times each kind
+  /// of instruction made fast isel fall back to SelectionDAG in the current
+  /// module, and the number of instructions SelectionDAG selected as a result.
+  StringMap<std::pair<unsigned, unsigned> > FastISelFallbacks;
+
+  void recordFastISelFallback(StringRef Reason, unsigned NumInstrs);
+  void recordFastISelFallback(const Instruction *I, unsigned NumInstrs);
+
+  /// ISelPhase - The phases of building and selecting a DAG that
+  /// -isel-phase-times reports the time of.
+  enum ISelPhase {
+    PhaseBuild,
+    PhaseCombine,
+    PhaseLegalize,
+    PhaseSelect,
+    PhaseSchedule,
+    NumISelPhases
+  };
+
+  /// PhaseTimes - For -isel-phase-times, the wall time in seconds spent in
+  /// each phase for the current function.
+  double PhaseTimes[NumISelPhases];
+
+  void printPhaseTimes(const Function &Fn);
+
   /// \brief Perform instruction selection on all basic blocks in the function.
   void SelectAllBasicBlocks(const Function &Fn);
 
@@ -309,8 +309,9 @@ private:
   ///
   int16_t NodeType;
 
-  /// OperandsNeedDelete - This is true if OperandList was new[]'d.  If true,
-  /// then they will be delete[]'d when the node is destroyed.
+  /// OperandsNeedDelete - This is true if OperandList came from the operand
+  /// recycler of the SelectionDAG.  If true, it is given back to the recycler
+  /// when the node is deleted or morphed.
   uint16_t OperandsNeedDelete : 1;
 
   /// HasDebugValue - This tracks whether this node has one or more dbg_value
@@ -327,6 +328,10 @@ private:
   /// NodeId - Unique id per SDNode in the DAG.
   int NodeId;
 
+  /// CombinerWorkListIndex - The position of this node in the worklist of
+  /// the DAG combiner, or -1 if it is not on the worklist.
+  int CombinerWorkListIndex;
+
   /// OperandList - The values that are used by this operation.
   ///
   SDUse *OperandList;
@@ -419,6 +424,14 @@ public:
   /// setNodeId - Set unique node id.
   void setNodeId(int Id) { NodeId = Id; }
 
+  /// getCombinerWorkListIndex - Return the position of this node in the
+  /// worklist of the DAG combiner, or -1 if it is not on the worklist.
+  int getCombinerWorkListIndex() const { return CombinerWorkListIndex; }
+
+  /// setCombinerWorkListIndex - Set the position of this node in the
+  /// worklist of the DAG combiner.
+  void setCombinerWorkListIndex(int Index) { CombinerWorkListIndex = Index; }
+
   /// getIROrder - Return the node ordering.
   ///
   unsigned getIROrder() const { return IROrder; }
@@ -696,26 +709,11 @@ protected:
     return Ret;
   }
 
-  SDNode(unsigned Opc, unsigned Order, const DebugLoc dl, SDVTList VTs,
-         const SDValue *Ops, unsigned NumOps)
-    : NodeType(Opc), OperandsNeedDelete(true), HasDebugValue(false),
-      SubclassData(0), NodeId(-1),
-      OperandList(NumOps ? new SDUse[NumOps] : 0),
-      ValueList(VTs.VTs), UseList(NULL),
-      NumOperands(NumOps), NumValues(VTs.NumVTs),
-      debugLoc(dl), IROrder(Order) {
-    for (unsigned i = 0; i != NumOps; ++i) {
-      OperandList[i].setUser(this);
-      OperandList[i].setInitial(Ops[i]);
-    }
-    checkForCycles(this);
-  }
-
   /// This constructor adds no operands itself; operands can be
-  /// set later with InitOperands.
+  /// set later with InitOperands, or by SelectionDAG::createOperands.
   SDNode(unsigned Opc, unsigned Order, const DebugLoc dl, SDVTList VTs)
     : NodeType(Opc), OperandsNeedDelete(false), HasDebugValue(false),
-      SubclassData(0), NodeId(-1), OperandList(0),
+      SubclassData(0), NodeId(-1), CombinerWorkListIndex(-1), OperandList(0),
       ValueList(VTs.VTs), UseList(NULL), NumOperands(0), NumValues(VTs.NumVTs),
       debugLoc(dl), IROrder(Order) {}
 
@@ -966,9 +964,6 @@ public:
   MemSDNode(unsigned Opc, unsigned Order, DebugLoc dl, SDVTList VTs,
             EVT MemoryVT, MachineMemOperand *MMO);
 
-  MemSDNode(unsigned Opc, unsigned Order, DebugLoc dl, SDVTList VTs, const SDValue *Ops,
-            unsigned NumOps, EVT MemoryVT, MachineMemOperand *MMO);
-
   bool readMem() const { return MMO->isLoad(); }
   bool writeMem() const { return MMO->isStore(); }
 
@@ -1149,9 +1144,8 @@ public:
 class MemIntrinsicSDNode : public MemSDNode {
 public:
   MemIntrinsicSDNode(unsigned Opc, unsigned Order, DebugLoc dl, SDVTList VTs,
-                     const SDValue *Ops, unsigned NumOps,
                      EVT MemoryVT, MachineMemOperand *MMO)
-    : MemSDNode(Opc, Order, dl, VTs, Ops, NumOps, MemoryVT, MMO) {
+    : MemSDNode(Opc, Order, dl, VTs, MemoryVT, MMO) {
   }
 
   // Methods to support isa and dyn_cast
@@ -1605,11 +1599,9 @@ public:
 class CvtRndSatSDNode : public SDNode {
   ISD::CvtCode CvtCode;
   friend class SelectionDAG;
-  explicit CvtRndSatSDNode(EVT VT, unsigned Order, DebugLoc dl, const SDValue *Ops,
-                           unsigned NumOps, ISD::CvtCode Code)
-    : SDNode(ISD::CONVERT_RNDSAT, Order, dl, getSDVTList(VT), Ops, NumOps),
-      CvtCode(Code) {
-    assert(NumOps == 5 && "wrong number of operations");
+  explicit CvtRndSatSDNode(EVT VT, unsigned Order, DebugLoc dl,
+                           ISD::CvtCode Code)
+    : SDNode(ISD::CONVERT_RNDSAT, Order, dl, getSDVTList(VT)), CvtCode(Code) {
   }
 public:
   ISD::CvtCode getCvtCode() const { return CvtCode; }
@@ -15,6 +15,7 @@
 #ifndef LLVM_DEBUGINFO_DICONTEXT_H
 #define LLVM_DEBUGINFO_DICONTEXT_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
@@ -22,6 +23,7 @@
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Object/RelocVisitor.h"
 #include "llvm/Support/DataTypes.h"
+#include <vector>
 
 namespace llvm {
 
@@ -94,6 +96,14 @@ public:
   }
 };
 
+/// DIAddressRange - A range [LowPC, HighPC) of code addresses together with
+/// the offset of the compile unit that describes it.
+struct DIAddressRange {
+  uint64_t LowPC;
+  uint64_t HighPC;
+  uint32_t CUOffset;
+};
+
 /// Selects which debug sections get dumped.
 enum DIDumpType {
   DIDT_Null,
@@ -135,6 +145,22 @@ public:
       uint64_t Size, DILineInfoSpecifier Specifier = DILineInfoSpecifier()) = 0;
   virtual DIInliningInfo getInliningInfoForAddress(uint64_t Address,
       DILineInfoSpecifier Specifier = DILineInfoSpecifier()) = 0;
+
+  /// getAddressIndex - Fill \p Ranges with the index used to find the compile
+  /// unit covering an address, sorted by address.  Building the index is the
+  /// expensive part of the first lookup in a large binary, so clients that
+  /// see the same binary repeatedly may save it and pass it to
+  /// setAddressIndex later.  Returns false if there is no such index.
+  virtual bool getAddressIndex(std::vector<DIAddressRange> &Ranges) {
+    return false;
+  }
+
+  /// setAddressIndex - Use \p Ranges, previously returned by getAddressIndex
+  /// for the same debug info, instead of building the index.  Returns false
+  /// if the context does not support this.
+  virtual bool setAddressIndex(ArrayRef<DIAddressRange> Ranges) {
+    return false;
+  }
 };
 
 }
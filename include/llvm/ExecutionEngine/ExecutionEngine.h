@@ -222,6 +222,12 @@ public:
   /// M is found.
   virtual bool removeModule(Module *M);
 
+  /// unloadModule - Remove a Module like removeModule, and free the machine
+  /// code and data generated for it.  Pointers into the module's code and
+  /// globals become invalid, so nothing may call or refer to them any more.
+  /// Returns true if M is found.
+  virtual bool unloadModule(Module *M);
+
   /// FindFunctionNamed - Search all of the active modules to find the one that
   /// defines FnName.  This is very slow operation and shouldn't be used for
   /// general code.
@@ -383,6 +389,24 @@ public:
     llvm_unreachable("No support for an object cache");
   }
 
+  /// enableTieredCompilation - Instrument the code generated from now on so
+  /// that every function counts its calls.  A function called
+  /// \p HotCallThreshold times is compiled again at \p OptLevel on a
+  /// background thread, and calls to it are redirected to the optimized code
+  /// once that is loaded.  The engine's own TargetMachine is meant to use a
+  /// cheap optimization level in this mode.  The optimized code always uses
+  /// the greedy register allocator, even if the engine uses linear scan.  Since compilation then happens on
+  /// several threads, llvm_start_multithreaded() must have been called.
+  /// Supported by MCJIT but not JIT.
+  virtual void enableTieredCompilation(CodeGenOpt::Level OptLevel,
+                                       unsigned HotCallThreshold) {
+    llvm_unreachable("No support for tiered compilation");
+  }
+
+  /// waitForTieredCompilation - Block until every function that became hot
+  /// so far has been recompiled and patched in.
+  virtual void waitForTieredCompilation() {}
+
   /// DisableLazyCompilation - When lazy compilation is off (the default), the
   /// JIT will eagerly compile every function reachable from the argument to
   /// getPointerToFunction.  If lazy compilation is turned on, the JIT will only
@@ -573,7 +597,9 @@ public:
   }
 
   /// setOptLevel - Set the optimization level for the JIT.  This option
-  /// defaults to CodeGenOpt::Default.
+  /// defaults to CodeGenOpt::Default.  A first tier that wants reasonable
+  /// code quickly can also select the linear scan register allocator, by
+  /// setting TargetOptions::EnableLinearScanRegAlloc in setTargetOptions.
   EngineBuilder &setOptLevel(CodeGenOpt::Level l) {
     OptLevel = l;
     return *this;
@@ -0,0 +1,107 @@
+//===- FileObjectCache.h - Disk backed object cache for MCJIT ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares an ObjectCache that keeps the objects MCJIT compiles in a
+// directory on disk, so that a later process running the same module can load
+// the object instead of compiling it again.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/DataTypes.h"
+#include <string>
+
+namespace llvm {
+
+class TargetMachine;
+
+/// This is an ObjectCache which stores compiled objects as files in a cache
+/// directory.
+///
+/// Objects are keyed by an MD5 hash of the module's bitcode together with a
+/// target key string describing everything else that affects code generation
+/// (see getTargetKey).  Cached objects are memory mapped when they are read
+/// back.  The directory may be shared by several processes: objects are
+/// written to a temporary file and renamed into place, and a LockFileManager
+/// lock on the object's path keeps two processes from compiling the same
+/// module at the same time.
+///
+/// When a size budget is given, the least recently used objects are removed
+/// after every insertion until the directory fits the budget again.  A hit
+/// refreshes the modification time of the object, which is what recency is
+/// measured by.
+class FileObjectCache : public ObjectCache {
+  FileObjectCache(const FileObjectCache&) LLVM_DELETED_FUNCTION;
+  void operator=(const FileObjectCache&) LLVM_DELETED_FUNCTION;
+
+public:
+  /// Create a cache storing objects in \p CacheDir, which is created if it
+  /// does not exist.  \p TargetKey must identify the target configuration
+  /// objects are compiled for.  If \p MaxSize is not zero, the directory is
+  /// kept below \p MaxSize bytes.
+  FileObjectCache(StringRef CacheDir, StringRef TargetKey, uint64_t MaxSize = 0);
+  virtual ~FileObjectCache();
+
+  /// notifyObjectCompiled - Write the object compiled for \p M to the cache
+  /// directory.
+  virtual void notifyObjectCompiled(const Module *M, const MemoryBuffer *Obj);
+
+  /// getTargetKey - Return a string describing the target triple, CPU,
+  /// features and code generation options of \p TM, suitable for use as the
+  /// target key of a cache holding objects compiled by \p TM.
+  static std::string getTargetKey(const TargetMachine &TM);
+
+  /// prune - Remove the least recently used objects until the cache directory
+  /// is at most MaxSize bytes large.  Does nothing if there is no budget.
+  void prune();
+
+  /// getNumHits - Return how many lookups were satisfied from the cache.
+  unsigned getNumHits() const { return NumHits; }
+
+  /// getNumMisses - Return how many lookups found no cached object.
+  unsigned getNumMisses() const { return NumMisses; }
+
+protected:
+  virtual const MemoryBuffer *getObject(const Module *M);
+
+private:
+  struct Entry;
+
+  /// createEntry - Hash \p M and return a new entry for it, replacing any
+  /// entry \p M already has.  MCJIT modifies the module while it compiles it,
+  /// so the hash is computed when the module is looked up and the entry is
+  /// kept until the object is stored.
+  Entry &createEntry(const Module *M);
+
+  /// eraseEntry - Drop the entry for \p M, if any, and the lock it holds.
+  void eraseEntry(const Module *M);
+
+  std::string CacheDir;
+  std::string TargetKey;
+  uint64_t MaxSize;
+  unsigned NumHits;
+  unsigned NumMisses;
+  /// Entries - The modules that were looked up and missed, until their
+  /// objects are stored.
+  DenseMap<const Module *, Entry *> Entries;
+
+  /// LastObject - The object most recently returned by getObject.  MCJIT
+  /// copies it right away, so only one cached object is kept mapped.
+  OwningPtr<MemoryBuffer> LastObject;
+};
+
+} // end namespace llvm
+
+#endif
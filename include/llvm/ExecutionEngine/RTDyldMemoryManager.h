@@ -21,6 +21,9 @@
 
 namespace llvm {
 
+class ExecutionEngine;
+class ObjectImage;
+
 // RuntimeDyld clients often want to handle the memory management of
 // what gets placed where. For JIT clients, this is the subset of
 // JITMemoryManager required for dynamic loading of binaries.
@@ -50,6 +53,10 @@ public:
   /// Register the EH frames with the runtime so that c++ exceptions work.
   virtual void registerEHFrames(StringRef SectionData);
 
+  /// Deregister EH frames that were registered with registerEHFrames, before
+  /// the memory holding them is freed or reused.
+  virtual void deregisterEHFrames(StringRef SectionData);
+
   /// This method returns the address of the specified function. As such it is
   /// only useful for resolving library symbols, not code generated symbols.
   ///
@@ -69,6 +76,16 @@ public:
   ///
   /// Returns true if an error occurred, false otherwise.
   virtual bool finalizeMemory(std::string *ErrMsg = 0) = 0;
+
+  /// This method is called after an object has been loaded into memory but
+  /// before relocations are applied to the loaded sections.  The sections
+  /// allocated since the previous call belong to \p Obj.
+  virtual void notifyObjectLoaded(ExecutionEngine *EE,
+                                  const ObjectImage *Obj) {}
+
+  /// This method is called when the code of \p Obj is no longer needed.  The
+  /// memory manager may reuse the memory of its sections from then on.
+  virtual void notifyFreeingObject(const ObjectImage *Obj) {}
 };
 
 // Create wrappers for C Binding types (see CBindingWrapping.h).
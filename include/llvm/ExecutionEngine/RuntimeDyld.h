@@ -46,6 +46,12 @@ public:
   /// failure, the input buffer will be deleted.
   ObjectImage *loadObject(ObjectBuffer *InputBuffer);
 
+  /// Forget the symbols, sections and pending relocations of \p Obj, which
+  /// must have been returned by loadObject.  The memory manager is not told;
+  /// the caller frees the object's memory with it, and deletes \p Obj.
+  /// Objects loaded later must not refer to \p Obj any more.
+  void unloadObject(const ObjectImage *Obj);
+
   /// Get the address of our local copy of the symbol. This may or may not
   /// be the address used for relocation (clients can copy the data around
   /// and resolve relocatons based on where they put it).
@@ -67,6 +73,10 @@ public:
   StringRef getErrorString();
 
   StringRef getEHFrameSection();
+
+  /// Register the EH frames of every object loaded since the last call with
+  /// the memory manager.
+  void registerEHFrames();
 };
 
 } // end namespace llvm
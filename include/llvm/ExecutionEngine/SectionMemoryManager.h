@@ -15,6 +15,7 @@
 #ifndef LLVM_EXECUTIONENGINE_SECTIONMEMORYMANAGER_H
 #define LLVM_EXECUTIONENGINE_SECTIONMEMORYMANAGER_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -35,12 +36,23 @@ namespace llvm {
 /// in the JITed object.  Permissions can be applied either by calling
 /// MCJIT::finalizeObject or by calling SectionMemoryManager::finalizeMemory
 /// directly.  Clients of MCJIT should call MCJIT::finalizeObject.
+///
+/// Memory is mapped in slabs that sections are carved from.  Only the pages
+/// of sections allocated since the last finalizeMemory call have their
+/// permissions changed, one request per contiguous run of pages.  Once an
+/// object is freed (see notifyFreeingObject), its data memory can be reused
+/// right away, and a code or read-only page as soon as no live section is
+/// left on it.  Slabs that become completely free are unmapped, except for
+/// one per kind of memory which is kept for the next object.
 class SectionMemoryManager : public RTDyldMemoryManager {
   SectionMemoryManager(const SectionMemoryManager&) LLVM_DELETED_FUNCTION;
   void operator=(const SectionMemoryManager&) LLVM_DELETED_FUNCTION;
 
 public:
-  SectionMemoryManager() { }
+  /// Create a memory manager that maps memory in slabs of \p SlabSize bytes,
+  /// rounded up to whole pages.  Sections that do not fit a slab get a
+  /// mapping of their own.
+  explicit SectionMemoryManager(uintptr_t SlabSize = 64 * 1024);
   virtual ~SectionMemoryManager();
 
   /// \brief Allocates a memory block of (at least) the given size suitable for
@@ -82,11 +94,69 @@ public:
   /// This method is called from finalizeMemory.
   virtual void invalidateInstructionCache();
 
+  /// \brief Assign the sections allocated since the previous call to \p Obj.
+  virtual void notifyObjectLoaded(ExecutionEngine *EE, const ObjectImage *Obj);
+
+  /// \brief Make the memory of the sections of \p Obj available for reuse.
+  /// The EH frames registered from its sections are deregistered first.
+  virtual void notifyFreeingObject(const ObjectImage *Obj);
+
+  /// \brief Register \p SectionData with the runtime, and remember it so that
+  /// it can be deregistered when its object is freed.
+  virtual void registerEHFrames(StringRef SectionData);
+
+  /// MemoryStats - How much memory the manager holds and how well it is used.
+  struct MemoryStats {
+    /// MappedBytes - The size of all slabs.
+    uint64_t MappedBytes;
+    /// AllocatedBytes - The size of all sections that were not freed.
+    uint64_t AllocatedBytes;
+    /// FreeBytes - The memory available for new sections.
+    uint64_t FreeBytes;
+    /// LargestFreeBlock - The largest section that fits without mapping more
+    /// memory.  The smaller it is compared to FreeBytes, the more fragmented
+    /// the free memory is.
+    uint64_t LargestFreeBlock;
+    /// NumSlabs - The number of slabs currently mapped.
+    unsigned NumSlabs;
+    /// NumPermissionChanges - How many times page permissions were changed.
+    unsigned NumPermissionChanges;
+  };
+
+  /// \brief Return statistics about the memory held by this manager.
+  MemoryStats getMemoryStats() const;
+
 private:
+  /// PageState - The use of one page of a code or read-only data slab.
+  struct PageState {
+    /// NumSections - The number of live sections on the page.
+    unsigned NumSections;
+    /// Finalized - Whether the page has its final permissions and may not be
+    /// written any more.
+    bool Finalized;
+  };
+
   struct MemoryGroup {
+      /// AllocatedMem - The slabs mapped for this group.
       SmallVector<sys::MemoryBlock, 16> AllocatedMem;
+      /// FreeMem - Writable memory not used by any section, sorted by
+      /// address and with adjacent blocks merged.
       SmallVector<sys::MemoryBlock, 16> FreeMem;
+      /// PendingMem - Sections allocated since the last finalizeMemory call.
+      SmallVector<sys::MemoryBlock, 16> PendingMem;
+      /// Pages - The pages holding sections, for groups whose permissions
+      /// change on finalization.
+      DenseMap<uintptr_t, PageState> Pages;
       sys::MemoryBlock Near;
+      /// Permissions - The permissions finalizeMemory gives to the group, or
+      /// zero if they stay read-write.
+      unsigned Permissions;
+  };
+
+  /// Allocation - A section, as remembered for freeing it.
+  struct Allocation {
+    MemoryGroup *Group;
+    sys::MemoryBlock Block;
   };
 
   uint8_t *allocateSection(MemoryGroup &MemGroup, uintptr_t Size,
@@ -95,9 +165,35 @@ private:
   error_code applyMemoryGroupPermissions(MemoryGroup &MemGroup,
                                          unsigned Permissions);
 
+  void freeSection(const Allocation &A);
+
+  void releaseFreeSlabs(MemoryGroup &MemGroup);
+
+  error_code protectPages(uintptr_t Start, uintptr_t End,
+                          unsigned Permissions);
+
+  static void addFreeMemory(MemoryGroup &MemGroup, uintptr_t Start,
+                            uintptr_t End);
+
+  static void removeFreeMemory(MemoryGroup &MemGroup, uintptr_t Start,
+                               uintptr_t End);
+
+  uintptr_t SlabSize;
+  uintptr_t PageSize;
+  unsigned NumPermissionChanges;
+
   MemoryGroup CodeMem;
   MemoryGroup RWDataMem;
   MemoryGroup RODataMem;
+
+  /// UnclaimedSections - Sections allocated since the last object was loaded.
+  SmallVector<Allocation, 8> UnclaimedSections;
+
+  /// ObjectSections - The sections of every loaded object.
+  DenseMap<const ObjectImage *, SmallVector<Allocation, 4> > ObjectSections;
+
+  /// RegisteredEHFrames - The EH frame sections registered with the runtime.
+  SmallVector<StringRef, 4> RegisteredEHFrames;
 };
 
 }
@@ -0,0 +1,102 @@
+//===-- llvm/IR/ContentHash.h - Hash the contents of IR ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares functions that compute a stable hash of a function or a
+// module, for build caches that want to know whether some IR changed.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_CONTENTHASH_H
+#define LLVM_IR_CONTENTHASH_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/MD5.h"
+#include <cassert>
+#include <cstring>
+#include <string>
+
+namespace llvm {
+
+class Function;
+class GlobalValue;
+class Module;
+
+/// ContentHash - The MD5 digest of the contents of a function or module.
+class ContentHash {
+  uint8_t Bytes[16];
+
+public:
+  ContentHash() { std::memset(Bytes, 0, sizeof(Bytes)); }
+  explicit ContentHash(const MD5::MD5Result &Result) {
+    std::memcpy(Bytes, Result, sizeof(Bytes));
+  }
+
+  /// getWord - Return one of the four 32-bit little-endian words of the
+  /// digest, which is how bitcode stores it.
+  uint32_t getWord(unsigned i) const {
+    assert(i < 4 && "Word index out of range!");
+    return uint32_t(Bytes[i*4]) | uint32_t(Bytes[i*4+1]) << 8 |
+           uint32_t(Bytes[i*4+2]) << 16 | uint32_t(Bytes[i*4+3]) << 24;
+  }
+  static ContentHash fromWords(uint32_t W0, uint32_t W1, uint32_t W2,
+                               uint32_t W3) {
+    ContentHash H;
+    uint32_t Words[4] = { W0, W1, W2, W3 };
+    for (unsigned i = 0; i != 16; ++i)
+      H.Bytes[i] = uint8_t(Words[i/4] >> (i%4*8));
+    return H;
+  }
+
+  /// isZero - Return true for a default-constructed hash, which stands for
+  /// "no hash available".
+  bool isZero() const {
+    for (unsigned i = 0; i != 16; ++i)
+      if (Bytes[i])
+        return false;
+    return true;
+  }
+
+  /// str - Return the digest as 32 lowercase hex digits.
+  std::string str() const;
+
+  bool operator==(const ContentHash &RHS) const {
+    return std::memcmp(Bytes, RHS.Bytes, sizeof(Bytes)) == 0;
+  }
+  bool operator!=(const ContentHash &RHS) const { return !(*this == RHS); }
+};
+
+/// hashFunctionContent - Compute a hash of everything about \p F that its
+/// generated code depends on: its signature, linkage and attributes, and the
+/// instructions, constants and metadata of its body.  The hash does not
+/// depend on the names of the arguments, blocks and instructions, or on how
+/// values are numbered, so it is the same in every module that contains the
+/// same function.  Values outside of F are identified by their name and the
+/// properties that affect how F refers to them, which for a constant with a
+/// definitive initializer includes that initializer.
+ContentHash hashFunctionContent(const Function &F);
+
+/// hashModuleContent - Compute a hash of the whole module: its target
+/// description, global variables, aliases and named metadata, and the
+/// hashFunctionContent of every function.  If \p FunctionHashes is not null,
+/// the hash of every function with a body is stored into it as well, which is
+/// cheaper than hashing those functions again.
+ContentHash
+hashModuleContent(const Module &M,
+                  DenseMap<const Function*, ContentHash> *FunctionHashes = 0);
+
+/// hashGlobalContent - Compute a hash of the definition of \p GV: the
+/// hashFunctionContent of a function, the properties and initializer of a
+/// variable, or the aliasee of an alias.  Like hashFunctionContent, it does
+/// not depend on how unnamed values are numbered.
+ContentHash hashGlobalContent(const GlobalValue &GV);
+
+} // End llvm namespace
+
+#endif
@@ -33,7 +33,8 @@ template <typename T> class SmallVectorImpl;
 /// (opaquely) owns and manages the core "global" data of LLVM's core
 /// infrastructure, including the type and constant uniquing tables.
 /// LLVMContext itself provides no locking guarantees, so you should be careful
-/// to have one context per thread.
+/// to have one context per thread.  Once llvm_start_multithreaded() has been
+/// called, distinct contexts may be used concurrently from different threads.
 class LLVMContext {
 public:
   LLVMContextImpl *const pImpl;
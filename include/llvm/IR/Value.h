@@ -181,6 +181,13 @@ public:
   ///
   void addUse(Use &U) { U.addToList(&UseList); }
 
+  /// sortUseList - Reorder the use-list of this value with a stable merge
+  /// sort, so that it follows the order given by Cmp, a strict weak ordering
+  /// on Use references.  This takes no extra memory, and leaves the Uses
+  /// where they are in memory.
+  template<class Compare>
+  void sortUseList(Compare Cmp);
+
   /// An enumeration for keeping track of the concrete subclass of Value that
   /// is actually instantiated. Values of this enumeration are kept in the 
   /// Value classes SubclassID field. They are used for concrete type
@@ -327,8 +334,76 @@ public:
 protected:
   unsigned short getSubclassDataFromValue() const { return SubclassData; }
   void setValueSubclassData(unsigned short D) { SubclassData = D; }
+
+private:
+  /// mergeUseLists - Merge the null-terminated, sorted lists L and R linked
+  /// through their Next pointers, taking from L on ties.
+  template<class Compare>
+  static Use *mergeUseLists(Use *L, Use *R, Compare Cmp);
 };
 
+template<class Compare>
+Use *Value::mergeUseLists(Use *L, Use *R, Compare Cmp) {
+  Use *Merged;
+  Use **Next = &Merged;
+  while (L && R) {
+    if (Cmp(*R, *L)) {
+      *Next = R;
+      Next = &R->Next;
+      R = R->Next;
+    } else {
+      *Next = L;
+      Next = &L->Next;
+      L = L->Next;
+    }
+  }
+  *Next = L ? L : R;
+  return Merged;
+}
+
+template<class Compare>
+void Value::sortUseList(Compare Cmp) {
+  if (!UseList || !UseList->Next)
+    return;
+
+  // Bottom-up merge sort.  Slots[i] is either empty or holds a sorted run of
+  // 2^i Uses, all of which precede the Uses in lower slots.
+  const unsigned MaxSlots = 32;
+  Use *Slots[MaxSlots];
+  unsigned NumSlots = 0;
+
+  Use *Next = UseList;
+  while (Next) {
+    Use *Current = Next;
+    Next = Current->Next;
+    Current->Next = 0;
+
+    unsigned i = 0;
+    for (; i != NumSlots && Slots[i]; ++i) {
+      Current = mergeUseLists(Slots[i], Current, Cmp);
+      Slots[i] = 0;
+    }
+    if (i == NumSlots) {
+      assert(NumSlots != MaxSlots && "Use-list too long to sort!");
+      ++NumSlots;
+    }
+    Slots[i] = Current;
+  }
+
+  // Merge the runs, from the latest to the earliest.
+  UseList = 0;
+  for (unsigned i = 0; i != NumSlots; ++i)
+    if (Slots[i])
+      UseList = UseList ? mergeUseLists(Slots[i], UseList, Cmp) : Slots[i];
+
+  // Fix up the Prev pointers.
+  Use **Prev = &UseList;
+  for (Use *U = UseList; U; U = U->Next) {
+    U->setPrev(Prev);
+    Prev = &U->Next;
+  }
+}
+
 inline raw_ostream &operator<<(raw_ostream &OS, const Value &V) {
   V.print(OS);
   return OS;
@@ -19,6 +19,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/TimeValue.h"
 #include <map>
 #include <vector>
 
@@ -465,6 +466,41 @@ public:
 
 Timer *getPassTimer(Pass *);
 
+//===----------------------------------------------------------------------===//
+/// PassProfileRegion - Measures one run of a pass over a function, loop or
+/// module for the -pass-profile file: its wall time, the number of IR
+/// instructions before and after, and how much the malloc heap grew.  Does
+/// nothing if no profile is being written, or if the pass is a pass manager,
+/// whose contained passes are recorded on their own.
+class PassProfileRegion {
+  Pass *P;
+  Module *M;
+  Function *F;
+  sys::TimeValue Start;
+  size_t HeapBefore;
+  unsigned InstrsBefore;
+  unsigned InstrsAfter;
+  bool IsLoop;
+
+  PassProfileRegion(const PassProfileRegion &) LLVM_DELETED_FUNCTION;
+  void operator=(const PassProfileRegion &) LLVM_DELETED_FUNCTION;
+
+public:
+  PassProfileRegion(Pass *P, Function &F);
+  PassProfileRegion(Pass *P, Module &M);
+
+  /// Measure a pass run on the loop made of \p LoopBlocks in \p F.  Only the
+  /// loop is counted: counting all of \p F for every loop and loop pass would
+  /// make profiling quadratic.
+  PassProfileRegion(Pass *P, Function &F, ArrayRef<BasicBlock *> LoopBlocks);
+
+  /// setLoopBlocksAfter - Give the blocks of the loop after the pass ran, for
+  /// the instruction count after.  Passes that delete the loop give none.
+  void setLoopBlocksAfter(ArrayRef<BasicBlock *> LoopBlocks);
+
+  ~PassProfileRegion();
+};
+
 }
 
 #endif
@@ -29,9 +29,10 @@ struct PassRegistrationListener;
 /// PassRegistry - This class manages the registration and intitialization of
 /// the pass subsystem as application startup, and assists the PassManager
 /// in resolving pass dependencies.
-/// NOTE: PassRegistry is NOT thread-safe.  If you want to use LLVM on multiple
-/// threads simultaneously, you will need to use a separate PassRegistry on
-/// each thread.
+/// NOTE: Once llvm_start_multithreaded() has been called, lookups through the
+/// PassRegistry may happen concurrently from any number of threads; they only
+/// take a shared lock.  Registering and unregistering passes takes an exclusive
+/// lock, so it is best done up front, before threads are started.
 class PassRegistry {
   mutable void *pImpl;
   void *getImpl() const;
@@ -7,7 +7,9 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This file defines the MallocAllocator and BumpPtrAllocator interfaces.
+// This file defines the MallocAllocator and BumpPtrAllocator interfaces, the
+// slab allocators that BumpPtrAllocator can get its memory from, and
+// ConcurrentBumpPtrAllocator.
 //
 //===----------------------------------------------------------------------===//
 
@@ -17,10 +19,13 @@
 #include "llvm/Support/AlignOf.h"
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocal.h"
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstdlib>
+#include <vector>
 
 namespace llvm {
 template <typename T> struct ReferenceAdder { typedef T& result; };
@@ -83,6 +88,81 @@ public:
   virtual void Deallocate(MemSlab *Slab) LLVM_OVERRIDE;
 };
 
+/// MappedSlabAllocator - A slab allocator that maps every slab from the
+/// system with sys::Memory, and can ask for the slabs to be backed by huge
+/// pages where the system supports it.  Mapping is much slower than malloc,
+/// and huge pages only back whole aligned huge pages of a slab, so this is
+/// meant for bump allocators with slabs of several megabytes.
+class MappedSlabAllocator : public SlabAllocator {
+  /// HugePages - Whether to ask for huge pages.
+  bool HugePages;
+
+public:
+  explicit MappedSlabAllocator(bool hugePages = true) : HugePages(hugePages) {}
+  virtual ~MappedSlabAllocator();
+  virtual MemSlab *Allocate(size_t Size) LLVM_OVERRIDE;
+  virtual void Deallocate(MemSlab *Slab) LLVM_OVERRIDE;
+};
+
+/// CachingSlabAllocator - A slab allocator that keeps the slabs it is given
+/// back and hands them out again, so that short-lived bump allocators sharing
+/// it stop going to the underlying allocator for every slab.  Only slabs with
+/// a power of two size between MinCachedSize and MaxCachedSize are kept, which
+/// includes those BumpPtrAllocator makes by default.
+///
+/// Every thread first uses a cache of its own, without locking, and falls
+/// back to a pool shared by all threads when its cache is full or has no slab
+/// of the right size.  When a thread exits, the slabs in its cache move to the
+/// shared pool as far as it has room, and the rest are freed.  Platforms that
+/// cannot tell when a thread exits only use the shared pool, which then also
+/// gets the room of one thread cache.
+class CachingSlabAllocator : public SlabAllocator {
+public:
+  static const size_t MinCachedSize = 4096;
+  static const size_t MaxCachedSize = 1 << 20;
+
+private:
+  struct SlabCache;
+
+  /// Underlying - The allocator that makes and frees the slabs.
+  SlabAllocator &Underlying;
+
+  /// MaxThreadBytes, MaxSharedBytes - How many bytes of slabs each thread
+  /// cache and the shared pool may hold.
+  size_t MaxThreadBytes;
+  size_t MaxSharedBytes;
+
+  /// ThreadCache - The cache of the calling thread.
+  sys::ThreadLocal<const SlabCache> ThreadCache;
+
+  /// Lock - Guards the shared pool and the list of thread caches.
+  sys::Mutex Lock;
+
+  /// Shared - The shared pool.
+  SlabCache *Shared;
+
+  /// ThreadCaches - The caches of all threads that have used this allocator.
+  std::vector<SlabCache*> ThreadCaches;
+
+  SlabCache *getThreadCache();
+  static void releaseThreadCache(void *Cache);
+
+  CachingSlabAllocator(const CachingSlabAllocator &) LLVM_DELETED_FUNCTION;
+  void operator=(const CachingSlabAllocator &) LLVM_DELETED_FUNCTION;
+
+public:
+  explicit CachingSlabAllocator(SlabAllocator &underlying,
+                                size_t maxThreadBytes = 1 << 20,
+                                size_t maxSharedBytes = 4 << 20);
+  virtual ~CachingSlabAllocator();
+  virtual MemSlab *Allocate(size_t Size) LLVM_OVERRIDE;
+  virtual void Deallocate(MemSlab *Slab) LLVM_OVERRIDE;
+
+  /// getCachedBytes - Return the size of all slabs that are cached.  Only call
+  /// this when no other thread uses the allocator.
+  size_t getCachedBytes() const;
+};
+
 /// BumpPtrAllocator - This allocator is useful for containers that need
 /// very simple memory allocation strategies.  In particular, this just keeps
 /// allocating memory, and never deletes it until the entire block is dead. This
@@ -120,6 +200,10 @@ class BumpPtrAllocator {
   /// that we can compute how much space was wasted.
   size_t BytesAllocated;
 
+  /// BytesLeftInSlabs - The number of bytes left unused at the end of the
+  /// slabs that we stopped allocating into.
+  size_t BytesLeftInSlabs;
+
   /// AlignPtr - Align Ptr to Alignment bytes, rounding up.  Alignment should
   /// be a power of two.  This method rounds up, so AlignPtr(7, 4) == 8 and
   /// AlignPtr(8, 4) == 8.
@@ -136,6 +220,7 @@ class BumpPtrAllocator {
   static MallocSlabAllocator DefaultSlabAllocator;
 
   template<typename T> friend class SpecificBumpPtrAllocator;
+  friend class ConcurrentBumpPtrAllocator;
 public:
   BumpPtrAllocator(size_t size = 4096, size_t threshold = 4096,
                    SlabAllocator &allocator = DefaultSlabAllocator);
@@ -180,6 +265,80 @@ public:
   
   /// Compute the total physical memory allocated by this allocator.
   size_t getTotalMemory() const;
+
+  /// Return the number of bytes handed out since the last Reset.
+  size_t getBytesAllocated() const { return BytesAllocated; }
+
+  /// Return the number of bytes left unused at the end of slabs, because an
+  /// allocation did not fit and a new slab was started.
+  size_t getBytesLeftInSlabs() const { return BytesLeftInSlabs; }
+};
+
+/// ConcurrentBumpPtrAllocator - A bump allocator that several threads can
+/// allocate from at the same time.  Every thread bumps through slabs of its
+/// own, so allocating takes no lock once the thread has made its first
+/// allocation.  The memory may be used by any thread.  It is all freed when
+/// the allocator is reset or destroyed, which must not happen while other
+/// threads are allocating.  The slab allocator must be thread safe, as the
+/// default one and CachingSlabAllocator are.
+class ConcurrentBumpPtrAllocator {
+  ConcurrentBumpPtrAllocator(const ConcurrentBumpPtrAllocator &)
+    LLVM_DELETED_FUNCTION;
+  void operator=(const ConcurrentBumpPtrAllocator &) LLVM_DELETED_FUNCTION;
+
+  size_t SlabSize;
+  size_t SizeThreshold;
+  SlabAllocator &Allocator;
+
+  /// ThreadAllocator - The allocator of the calling thread.
+  sys::ThreadLocal<const BumpPtrAllocator> ThreadAllocator;
+
+  /// Lock - Guards ThreadAllocators.
+  mutable sys::Mutex Lock;
+
+  /// ThreadAllocators - The allocators of all threads that have allocated.
+  std::vector<BumpPtrAllocator*> ThreadAllocators;
+
+  BumpPtrAllocator &createThreadAllocator();
+
+public:
+  ConcurrentBumpPtrAllocator(size_t size = 4096, size_t threshold = 4096,
+              SlabAllocator &allocator = BumpPtrAllocator::DefaultSlabAllocator)
+    : SlabSize(size), SizeThreshold(threshold), Allocator(allocator) {}
+  ~ConcurrentBumpPtrAllocator();
+
+  /// Reset - Free all memory allocated so far, keeping one slab per thread.
+  void Reset();
+
+  /// Allocate - Allocate space at the specified alignment.
+  void *Allocate(size_t Size, size_t Alignment) {
+    const BumpPtrAllocator *A = ThreadAllocator.get();
+    if (!A)
+      A = &createThreadAllocator();
+    return const_cast<BumpPtrAllocator*>(A)->Allocate(Size, Alignment);
+  }
+
+  /// Allocate space, but do not construct, one object.
+  template <typename T>
+  T *Allocate() {
+    return static_cast<T*>(Allocate(sizeof(T), AlignOf<T>::Alignment));
+  }
+
+  /// Allocate space for an array of objects.  This does not construct the
+  /// objects though.
+  template <typename T>
+  T *Allocate(size_t Num) {
+    return static_cast<T*>(Allocate(Num * sizeof(T), AlignOf<T>::Alignment));
+  }
+
+  void Deallocate(const void * /*Ptr*/) {}
+
+  unsigned GetNumSlabs() const;
+
+  void PrintStats() const;
+
+  /// Compute the total physical memory allocated by this allocator.
+  size_t getTotalMemory() const;
 };
 
 /// SpecificBumpPtrAllocator - Same as BumpPtrAllocator but allows only
@@ -361,4 +361,13 @@
 # define LLVM_STATIC_ASSERT(expr, msg)
 #endif
 
+/// \macro LLVM_THREAD_LOCAL
+/// \brief A thread-local storage specifier for globals and static data members
+/// of POD type.  It is not defined on compilers that do not have one.
+#if defined(_MSC_VER)
+# define LLVM_THREAD_LOCAL __declspec(thread)
+#elif __has_feature(tls) || (defined(__GNUC__) && !defined(__APPLE__))
+# define LLVM_THREAD_LOCAL __thread
+#endif
+
 #endif
@@ -531,6 +531,14 @@ error_code permissions(const Twine &path, perms prms);
 
 error_code setLastModificationAndAccessTime(int FD, TimeValue Time);
 
+/// @brief Set the modification and access time of the file at \a Path.
+///
+/// @param Path Input path.
+/// @param Time The new modification and access time.
+/// @returns errc::success if the times have been set, otherwise a platform
+///          specific error_code.
+error_code setLastModificationAndAccessTime(const Twine &Path, TimeValue Time);
+
 /// @brief Is status available?
 ///
 /// @param s Input file status.
@@ -108,6 +108,17 @@ namespace sys {
     static error_code protectMappedMemory(const MemoryBlock &Block,
                                           unsigned Flags);
 
+    /// This method asks the system to back a block of memory allocated with
+    /// the allocateMappedMemory method with huge pages, which reduces TLB
+    /// misses when the block is big.  It is only a hint; only whole, aligned
+    /// huge pages within the block can be backed this way.
+    ///
+    /// \r true if the system took the hint, false if it does not support huge
+    /// pages or refused.
+    ///
+    /// @brief Advise huge pages for mapped memory.
+    static bool adviseHugePages(const MemoryBlock &Block);
+
     /// This method allocates a block of Read/Write/Execute memory that is
     /// suitable for executing dynamically generated code (e.g. JIT). An
     /// attempt to allocate \p NumBytes bytes of virtual memory is made.
@@ -493,6 +493,10 @@ namespace llvm {
   };
 
   /// TargetRegistry - Generic interface to target specific features.
+  ///
+  /// Registration is not thread-safe, but once all targets have been
+  /// registered lookups only read the registry and may be performed
+  /// concurrently from any number of threads.
   struct TargetRegistry {
     class iterator {
       const Target *Current;
@@ -33,11 +33,15 @@ namespace llvm {
         ThreadLocalDataTy align_data;
       };
     public:
-      ThreadLocalImpl();
+      explicit ThreadLocalImpl(void (*Destructor)(void*) = 0);
       virtual ~ThreadLocalImpl();
       void setInstance(const void* d);
       const void* getInstance();
       void removeInstance();
+
+      /// hasThreadExitDestructors - Return true if the destructor given to the
+      /// constructor is called when a thread exits, on this platform.
+      static bool hasThreadExitDestructors();
     };
 
     /// ThreadLocal - A class used to abstract thread-local storage.  It holds,
@@ -47,6 +51,12 @@ namespace llvm {
     public:
       ThreadLocal() : ThreadLocalImpl() { }
 
+      /// ThreadLocal - When a thread exits with a non-null pointer, call
+      /// \p Destructor with it, if the platform supports it; see
+      /// hasThreadExitDestructors.
+      explicit ThreadLocal(void (*Destructor)(void*))
+        : ThreadLocalImpl(Destructor) { }
+
       /// get - Fetches a pointer to the object associated with the current
       /// thread.  If no object has yet been associated, it returns NULL;
       T* get() { return static_cast<T*>(getInstance()); }
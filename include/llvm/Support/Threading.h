@@ -21,6 +21,10 @@ namespace llvm {
   /// on "failed" return, and will still be safe for hosting threading
   /// applications in the JIT, but will not be safe for concurrent calls to the
   /// LLVM APIs.
+  ///
+  /// On success, independent LLVMContexts, and the Modules, PassManagers and
+  /// TargetMachines created with them, may be used from different threads
+  /// concurrently, as long as all targets and passes were initialized first.
   /// THIS MUST EXECUTE IN ISOLATION FROM ALL OTHER LLVM API CALLS.
   bool llvm_start_multithreaded();
 
@@ -54,6 +58,42 @@ namespace llvm {
   /// the thread stack.
   void llvm_execute_on_thread(void (*UserFn)(void*), void *UserData,
                               unsigned RequestedStackSize = 0);
+
+  /// llvm_execute_on_threads - Invoke \p UserFn once for every task index in
+  /// [0, \p NumTasks), spreading the calls over at most \p NumThreads
+  /// threads.  Idle threads pick up the next unclaimed index, so tasks of
+  /// uneven size still balance.  Returns once every task has completed.
+  ///
+  /// Where threads are unavailable the tasks are executed in order on the
+  /// calling thread.  Callers that touch LLVM global state from \p UserFn
+  /// are responsible for calling llvm_start_multithreaded() first.
+  ///
+  /// \param UserFn - The callback to execute, given \p UserData and the
+  /// index of the task to perform.
+  /// \param UserData - An argument to pass to every callback invocation.
+  /// \param NumTasks - The number of task indices to hand out.
+  /// \param NumThreads - The maximum number of threads to run concurrently.
+  /// \param RequestedStackSize - If non-zero, a requested size (in bytes) for
+  /// each thread stack.
+  void llvm_execute_on_threads(void (*UserFn)(void*, unsigned), void *UserData,
+                               unsigned NumTasks, unsigned NumThreads,
+                               unsigned RequestedStackSize = 0);
+
+  /// llvm_thread - The handle of a thread started by llvm_start_thread.
+  struct llvm_thread;
+
+  /// llvm_start_thread - Start executing \p UserFn on a separate thread,
+  /// passing it the provided \p UserData, without waiting for it to finish.
+  /// The returned handle must be passed to llvm_join_thread exactly once.
+  ///
+  /// Where threads are unavailable \p UserFn is executed on the calling
+  /// thread before this returns.
+  llvm_thread *llvm_start_thread(void (*UserFn)(void*), void *UserData,
+                                 unsigned RequestedStackSize = 0);
+
+  /// llvm_join_thread - Wait for a thread started by llvm_start_thread to
+  /// finish and release its handle.
+  void llvm_join_thread(llvm_thread *Thread);
 }
 
 #endif
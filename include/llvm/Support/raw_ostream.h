@@ -198,6 +198,10 @@ public:
   /// anything that doesn't satisfy std::isprint into an escape sequence.
   raw_ostream &write_escaped(StringRef Str, bool UseHexEscapes = false);
 
+  /// write_json_string - Output \p Str as a double-quoted JSON string,
+  /// escaping '"', '\\' and control characters.
+  raw_ostream &write_json_string(StringRef Str);
+
   raw_ostream &write(unsigned char C);
   raw_ostream &write(const char *Ptr, size_t Size);
 
@@ -318,6 +322,10 @@ class raw_fd_ostream : public raw_ostream {
   /// possible.
   bool UseAtomicWrites;
 
+  /// SupportsSeeking - True if seek() can be used to overwrite what was
+  /// written before.
+  bool SupportsSeeking;
+
   uint64_t pos;
 
   /// write_impl - See raw_ostream::write_impl.
@@ -378,6 +386,11 @@ public:
   /// position to the offset specified from the beginning of the file.
   uint64_t seek(uint64_t off);
 
+  /// supportsSeeking - Return true if the stream writes to a file that seek()
+  /// can reposition, rather than to a pipe or to the end of a file opened for
+  /// appending.
+  bool supportsSeeking() const { return SupportsSeeking; }
+
   /// SetUseAtomicWrite - Set the stream to attempt to use atomic writes for
   /// individual output routines where possible.
   ///
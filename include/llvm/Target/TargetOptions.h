@@ -49,7 +49,8 @@ namespace llvm {
           JITEmitDebugInfo(false), JITEmitDebugInfoToDisk(false),
           GuaranteedTailCallOpt(false), DisableTailCalls(false),
           StackAlignmentOverride(0), RealignStack(true), SSPBufferSize(0),
-          EnableFastISel(false), PositionIndependentExecutable(false),
+          EnableFastISel(false), EnableLinearScanRegAlloc(false),
+          PositionIndependentExecutable(false),
           EnableSegmentedStacks(false), UseInitArray(false), TrapFuncName(""),
           FloatABIType(FloatABI::Default), AllowFPOpFusion(FPOpFusion::Standard)
     {}
@@ -160,6 +161,12 @@ namespace llvm {
     /// compile time.
     unsigned EnableFastISel : 1;
 
+    /// EnableLinearScanRegAlloc - This flag makes optimized code generation
+    /// use the linear scan register allocator instead of the greedy one, which
+    /// also trades away code quality for compile time.  -regalloc=... still
+    /// takes precedence.
+    unsigned EnableLinearScanRegAlloc : 1;
+
     /// PositionIndependentExecutable - This flag indicates whether the code
     /// will eventually be linked into a single executable, despite the PIC
     /// relocation model being in use. It's value is undefined (and irrelevant)
@@ -226,6 +233,7 @@ inline bool operator==(const TargetOptions &LHS,
     ARE_EQUAL(RealignStack) &&
     ARE_EQUAL(SSPBufferSize) &&
     ARE_EQUAL(EnableFastISel) &&
+    ARE_EQUAL(EnableLinearScanRegAlloc) &&
     ARE_EQUAL(PositionIndependentExecutable) &&
     ARE_EQUAL(EnableSegmentedStacks) &&
     ARE_EQUAL(UseInitArray) &&
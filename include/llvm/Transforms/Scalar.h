@@ -20,6 +20,7 @@ namespace llvm {
 class FunctionPass;
 class Pass;
 class GetElementPtrInst;
+class ModulePass;
 class PassInfo;
 class TerminatorInst;
 class TargetLowering;
@@ -273,6 +274,13 @@ FunctionPass *createBlockPlacementPass();
 Pass *createLCSSAPass();
 extern char &LCSSAID;
 
+//===----------------------------------------------------------------------===//
+//
+// OrderUseLists - This pass sorts the use-lists of the values used by
+// instructions in the order of the module.
+//
+ModulePass *createOrderUseListsPass();
+
 //===----------------------------------------------------------------------===//
 //
 // EarlyCSE - This pass performs a simple and fast CSE pass over the dominator
@@ -0,0 +1,83 @@
+//===-- SplitModule.h - Divide a Module into partitions ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This family of functions divides the global definitions of a Module between
+// a number of partitions which can then be processed independently, e.g. on
+// different threads, each loading the module into its own LLVMContext.
+//
+// Every global definition is owned by exactly one partition and is turned into
+// an external declaration in all the others, except that constants loads can
+// be folded from keep their initializer as available_externally copies.
+// Symbols with local linkage are promoted to hidden external ones first, so
+// that they can be referenced from whichever partition ends up using them.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+#define LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/GlobalValue.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+class Module;
+
+/// PromotedSymbol - Records how promoteLocalSymbols changed one symbol, so
+/// that the change can be undone once the partitions are linked back.
+struct PromotedSymbol {
+  std::string Name;
+  std::string OriginalName;
+  GlobalValue::LinkageTypes Linkage;
+  GlobalValue::VisibilityTypes Visibility;
+};
+
+/// Give every defined global value with local linkage a unique name and
+/// hidden external linkage.  If Promoted is non-null, the original name,
+/// linkage and visibility of each promoted symbol are appended to it.
+void promoteLocalSymbols(Module &M, std::vector<PromotedSymbol> *Promoted = 0);
+
+/// Undo promoteLocalSymbols on a module containing the promoted symbols.
+void restorePromotedSymbols(Module &M,
+                            const std::vector<PromotedSymbol> &Promoted);
+
+/// Assign every named global definition in M to one of NumPartitions
+/// partitions, balancing the number of instructions in each.  Module level
+/// llvm.* globals, aliases and their aliasees all go to partition 0.  The
+/// assignment only depends on the contents of M.
+void partitionModule(Module &M, unsigned NumPartitions,
+                     StringMap<unsigned> &Owner);
+
+/// Like partitionModule, but assign every definition by a hash of its name
+/// instead of balancing the partitions.  Adding, removing or changing one
+/// definition then leaves the others where they were, so partitions that do
+/// not contain the change come out the same as before.
+void partitionModuleByName(Module &M, unsigned NumPartitions,
+                           StringMap<unsigned> &Owner);
+
+/// Strip M down to the definitions that Owner assigns to partition Part,
+/// turning everything else into external declarations.  Constants with a
+/// definitive initializer are kept as available_externally copies instead, so
+/// that passes can still fold loads from them.  If M is being lazily loaded,
+/// function bodies not owned by Part are never materialized.  Returns true and
+/// fills in ErrMsg if materialization fails.
+bool extractPartition(Module &M, const StringMap<unsigned> &Owner,
+                      unsigned Part, std::string &ErrMsg);
+
+/// Turn the copies of other partitions' constants that extractPartition kept
+/// in partition Part back into declarations, before the partitions are linked
+/// back into one module.
+void dropPartitionCopies(Module &M, const StringMap<unsigned> &Owner,
+                         unsigned Part);
+
+} // End llvm namespace
+
+#endif // LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
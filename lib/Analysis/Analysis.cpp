@@ -73,6 +73,7 @@ void llvm::initializeAnalysis(PassRegistry &Registry) {
   initializeScalarEvolutionAliasAnalysisPass(Registry);
   initializeTargetTransformInfoAnalysisGroup(Registry);
   initializeTypeBasedAliasAnalysisPass(Registry);
+  initializeUseListStatsPass(Registry);
 }
 
 void LLVMInitializeAnalysis(LLVMPassRegistryRef R) {
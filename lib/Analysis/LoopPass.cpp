@@ -224,8 +224,11 @@ bool LPPassManager::runOnFunction(Function &F) {
       {
         PassManagerPrettyStackEntry X(P, *CurrentLoop->getHeader());
         TimeRegion PassTimer(getPassTimer(P));
+        PassProfileRegion Profile(P, F, CurrentLoop->getBlocks());
 
         Changed |= P->runOnLoop(CurrentLoop, *this);
+        if (!skipThisLoop)
+          Profile.setLoopBlocksAfter(CurrentLoop->getBlocks());
       }
 
       if (Changed)
@@ -0,0 +1,120 @@
+//===-- UseListStats.cpp - Report the shape of use-lists ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass reports a histogram of the lengths of the use-lists of the values
+// used by the instructions of a module, and how many of them already list
+// their instruction users in the order of the module.  Long use-lists out of
+// order are the ones that make walking the users of a value jump around the
+// heap; see -order-use-lists.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "use-list-stats"
+#include "llvm/Analysis/Passes.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace llvm;
+
+STATISTIC(NumValues, "Number of values used by instructions");
+STATISTIC(NumUses, "Number of uses of those values");
+STATISTIC(NumOutOfOrder, "Number of use-lists not in module order");
+
+namespace {
+  class UseListStats : public ModulePass {
+    /// Buckets - Buckets[i] counts the use-lists whose length is in
+    /// [2^i, 2^(i+1)), and OutOfOrder[i] how many of those are not in module
+    /// order.
+    unsigned Buckets[32], OutOfOrder[32];
+    unsigned NumBuckets, LongestUseList;
+
+  public:
+    static char ID; // Pass identification, replacement for typeid
+    UseListStats() : ModulePass(ID) {
+      initializeUseListStatsPass(*PassRegistry::getPassRegistry());
+    }
+
+    virtual bool runOnModule(Module &M);
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      AU.setPreservesAll();
+    }
+    virtual void print(raw_ostream &O, const Module *M) const;
+  };
+}
+
+char UseListStats::ID = 0;
+INITIALIZE_PASS(UseListStats, "use-list-stats",
+                "Use-list length histogram", false, true)
+
+ModulePass *llvm::createUseListStatsPass() { return new UseListStats(); }
+
+bool UseListStats::runOnModule(Module &M) {
+  std::fill(Buckets, Buckets + 32, 0);
+  std::fill(OutOfOrder, OutOfOrder + 32, 0);
+  NumBuckets = 0;
+  LongestUseList = 0;
+
+  DenseMap<const User*, unsigned> Positions;
+  for (Module::iterator F = M.begin(), FE = M.end(); F != FE; ++F)
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I)
+        Positions.insert(std::make_pair(&*I, Positions.size()));
+
+  SmallPtrSet<const Value*, 64> Visited;
+  for (Module::iterator F = M.begin(), FE = M.end(); F != FE; ++F)
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I)
+        for (User::op_iterator OI = I->op_begin(), OE = I->op_end();
+             OI != OE; ++OI) {
+          const Value *V = *OI;
+          if (!V || !Visited.insert(V))
+            continue;
+
+          // Users that are not instructions, such as constant expressions,
+          // are ordered after all the instructions.
+          unsigned Length = 0, Last = 0;
+          bool InOrder = true;
+          for (Value::const_use_iterator UI = V->use_begin(),
+               UE = V->use_end(); UI != UE; ++UI, ++Length) {
+            DenseMap<const User*, unsigned>::const_iterator P =
+              Positions.find(*UI);
+            unsigned Position = P == Positions.end() ? ~0U : P->second;
+            if (Position < Last)
+              InOrder = false;
+            Last = Position;
+          }
+
+          unsigned Bucket = Log2_32(Length);
+          ++Buckets[Bucket];
+          NumBuckets = std::max(NumBuckets, Bucket + 1);
+          LongestUseList = std::max(LongestUseList, Length);
+          ++NumValues;
+          NumUses += Length;
+          if (!InOrder) {
+            ++OutOfOrder[Bucket];
+            ++NumOutOfOrder;
+          }
+        }
+  return false;
+}
+
+void UseListStats::print(raw_ostream &O, const Module *M) const {
+  O << "Use-list lengths (longest: " << LongestUseList << "):\n";
+  O << "       Length     Count  Out of order\n";
+  for (unsigned i = 0; i != NumBuckets; ++i) {
+    unsigned Low = 1U << i, High = (i == 31 ? ~0U : (2U << i) - 1);
+    O << format("  %5u-%-5u %9u %13u\n", Low, High, Buckets[i], OutOfOrder[i]);
+  }
+}
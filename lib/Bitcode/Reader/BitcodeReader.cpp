@@ -1469,6 +1469,114 @@ bool BitcodeReader::RememberAndSkipFunctionBody() {
   return false;
 }
 
+/// ParseFunctionIndex - Find out where every function body starts from the
+/// function index of the module, rather than by skipping over the bodies one
+/// by one.  The index is the last block of the module, so the stream is left
+/// right before the end of the module block.
+bool BitcodeReader::ParseFunctionIndex() {
+  if (!Stream.canSkipToPos(FunctionIndexBit / 8))
+    return Error("Invalid function index offset");
+  Stream.JumpToBit(FunctionIndexBit);
+
+  BitstreamEntry Entry = Stream.advance();
+  if (Entry.Kind != BitstreamEntry::SubBlock ||
+      Entry.ID != bitc::FUNCTION_INDEX_BLOCK_ID ||
+      Stream.EnterSubBlock(bitc::FUNCTION_INDEX_BLOCK_ID))
+    return Error("Malformed function index");
+
+  // Every function with a body must be named exactly once.  Bodies that have
+  // not been located yet are at bit 0, which is never a valid location.
+  for (unsigned i = 0, e = FunctionsWithBodies.size(); i != e; ++i)
+    DeferredFunctionInfo[FunctionsWithBodies[i]] = 0;
+
+  SmallVector<uint64_t, 2> Record;
+  unsigned NumLocated = 0;
+  while (1) {
+    Entry = Stream.advanceSkippingSubblocks();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return Error("Malformed function index");
+    case BitstreamEntry::EndBlock:
+      if (NumLocated != FunctionsWithBodies.size())
+        return Error("Function index does not cover all function bodies");
+      FunctionsWithBodies.clear();
+      return false;
+    case BitstreamEntry::Record:
+      // The interesting case.
+      break;
+    }
+
+    // Read a record.
+    Record.clear();
+    switch (Stream.readRecord(Entry.ID, Record)) {
+    default:  // Default behavior: ignore.
+      break;
+    case bitc::FNINDEX_CODE_ENTRY: {  // ENTRY: [valueid, offset]
+      if (Record.size() < 2 || Record[0] >= ValueList.size())
+        return Error("Invalid FNINDEX_CODE_ENTRY record");
+      Function *F = dyn_cast_or_null<Function>(ValueList[Record[0]]);
+      DenseMap<Function*, uint64_t>::iterator DFII =
+        F ? DeferredFunctionInfo.find(F) : DeferredFunctionInfo.end();
+      uint64_t BodyBit = ModuleBit + Record[1];
+      if (DFII == DeferredFunctionInfo.end() || DFII->second != 0 ||
+          !Stream.canSkipToPos(BodyBit / 8))
+        return Error("Invalid FNINDEX_CODE_ENTRY record");
+      DFII->second = BodyBit;
+      ++NumLocated;
+      break;
+    }
+    }
+  }
+}
+
+/// ParseContentHashes - Read the hashes of the module and its functions.
+bool BitcodeReader::ParseContentHashes() {
+  if (Stream.EnterSubBlock(bitc::CONTENT_HASH_BLOCK_ID))
+    return Error("Malformed block record");
+
+  SmallVector<uint64_t, 5> Record;
+  while (1) {
+    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return Error("Malformed content hash block");
+    case BitstreamEntry::EndBlock:
+      return false;
+    case BitstreamEntry::Record:
+      // The interesting case.
+      break;
+    }
+
+    // Read a record.
+    Record.clear();
+    switch (Stream.readRecord(Entry.ID, Record)) {
+    default:  // Default behavior: ignore.
+      break;
+    case bitc::CONTENT_HASH_CODE_MODULE:  // MODULE: [hash x 4]
+      if (Record.size() < 4)
+        return Error("Invalid CONTENT_HASH_CODE_MODULE record");
+      ModuleHash = ContentHash::fromWords(Record[0], Record[1], Record[2],
+                                          Record[3]);
+      break;
+    case bitc::CONTENT_HASH_CODE_FUNCTION: {  // FUNCTION: [valueid, hash x 4]
+      if (Record.size() < 5 || Record[0] >= ValueList.size())
+        return Error("Invalid CONTENT_HASH_CODE_FUNCTION record");
+      Function *F = dyn_cast_or_null<Function>(ValueList[Record[0]]);
+      if (!F)
+        return Error("Invalid CONTENT_HASH_CODE_FUNCTION record");
+      FunctionHashes.push_back(
+        std::make_pair(F, ContentHash::fromWords(Record[1], Record[2],
+                                                 Record[3], Record[4])));
+      break;
+    }
+    }
+  }
+}
+
 bool BitcodeReader::GlobalCleanup() {
   // Patch the initializers for globals and aliases up.
   ResolveGlobalAndAliasInits();
@@ -1500,6 +1608,8 @@ bool BitcodeReader::ParseModule(bool Resume) {
     Stream.JumpToBit(NextUnreadBit);
   else if (Stream.EnterSubBlock(bitc::MODULE_BLOCK_ID))
     return Error("Malformed block record");
+  else
+    ModuleBit = Stream.GetCurrentBitNo();
 
   SmallVector<uint64_t, 64> Record;
   std::vector<std::string> SectionTable;
@@ -1561,6 +1671,14 @@ bool BitcodeReader::ParseModule(bool Resume) {
           SeenFirstFunctionBody = true;
         }
 
+        // With an index, all bodies are located at once and none of them
+        // needs to be visited.
+        if (FunctionIndexBit) {
+          if (ParseFunctionIndex())
+            return true;
+          break;
+        }
+
         if (RememberAndSkipFunctionBody())
           return true;
         // For streaming bitcode, suspend parsing when we reach the function
@@ -1578,6 +1696,10 @@ bool BitcodeReader::ParseModule(bool Resume) {
         if (ParseUseLists())
           return true;
         break;
+      case bitc::CONTENT_HASH_BLOCK_ID:
+        if (ParseContentHashes())
+          return true;
+        break;
       }
       continue;
 
@@ -1770,6 +1892,14 @@ bool BitcodeReader::ParseModule(bool Resume) {
       AliasInits.push_back(std::make_pair(NewGA, Record[1]));
       break;
     }
+    // FNINDEXOFFSET: [offset]
+    case bitc::MODULE_CODE_FNINDEXOFFSET:
+      if (Record.size() < 1)
+        return Error("Invalid MODULE_CODE_FNINDEXOFFSET record");
+      // A streamer may not have the index yet, so it keeps skipping bodies.
+      if (!LazyStreamer)
+        FunctionIndexBit = ModuleBit + Record[0] * 32;
+      break;
     /// MODULE_CODE_PURGEVALS: [numvals]
     case bitc::MODULE_CODE_PURGEVALS:
       // Trim down the value list to the specified size.
@@ -3071,6 +3201,36 @@ Module *llvm::getStreamedBitcodeModule(const std::string &name,
   return M;
 }
 
+BitcodeFunctionConsumer::~BitcodeFunctionConsumer() {}
+
+Module *llvm::streamBitcodeFunctions(const std::string &Name,
+                                     DataStreamer *Streamer,
+                                     LLVMContext &Context,
+                                     BitcodeFunctionConsumer &Consumer,
+                                     std::string *ErrMsg) {
+  OwningPtr<Module> M(getStreamedBitcodeModule(Name, Streamer, Context,
+                                               ErrMsg));
+  if (!M)
+    return 0;
+
+  Consumer.beginModule(*M);
+  for (Module::iterator F = M->begin(), E = M->end(); F != E; ++F) {
+    if (!F->isMaterializable())
+      continue;
+    if (F->Materialize(ErrMsg))
+      return 0;
+    Consumer.processFunction(*F);
+
+    // Dropping the body makes the function external; it is not a declaration
+    // though, it can still be materialized.
+    GlobalValue::LinkageTypes Linkage = F->getLinkage();
+    F->Dematerialize();
+    F->setLinkage(Linkage);
+  }
+  Consumer.endModule(*M);
+  return M.take();
+}
+
 /// ParseBitcodeFile - Read the specified bitcode file, returning the module.
 /// If an error occurs, return null and fill in *ErrMsg if non-null.
 Module *llvm::ParseBitcodeFile(MemoryBuffer *Buffer, LLVMContext& Context,
@@ -3094,6 +3254,34 @@ Module *llvm::ParseBitcodeFile(MemoryBuffer *Buffer, LLVMContext& Context,
   return M;
 }
 
+bool llvm::getBitcodeContentHashes(MemoryBuffer *Buffer, LLVMContext &Context,
+                                   ContentHash &ModuleHash,
+                                   std::vector<std::pair<std::string,
+                                                         ContentHash> >
+                                     &FunctionHashes,
+                                   std::string *ErrMsg) {
+  // The hashes come before the function bodies, so a lazy parse of the
+  // module finds them.
+  Module M(Buffer->getBufferIdentifier(), Context);
+  BitcodeReader *R = new BitcodeReader(Buffer, Context);
+  // Don't let the BitcodeReader dtor delete 'Buffer'.
+  R->setBufferOwned(false);
+  M.setMaterializer(R);  // M deletes R.
+  if (R->ParseBitcodeInto(&M)) {
+    if (ErrMsg)
+      *ErrMsg = R->getErrorString();
+    return true;
+  }
+
+  ModuleHash = R->getModuleHash();
+  const std::vector<std::pair<Function*, ContentHash> > &Hashes =
+    R->getFunctionHashes();
+  for (unsigned i = 0, e = Hashes.size(); i != e; ++i)
+    FunctionHashes.push_back(std::make_pair(Hashes[i].first->getName().str(),
+                                            Hashes[i].second));
+  return false;
+}
+
 std::string llvm::getBitcodeTargetTriple(MemoryBuffer *Buffer,
                                          LLVMContext& Context,
                                          std::string *ErrMsg) {
@@ -19,6 +19,7 @@
 #include "llvm/Bitcode/LLVMBitCodes.h"
 #include "llvm/GVMaterializer.h"
 #include "llvm/IR/Attributes.h"
+#include "llvm/IR/ContentHash.h"
 #include "llvm/IR/OperandTraits.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Support/ValueHandle.h"
@@ -177,6 +178,19 @@ class BitcodeReader : public GVMaterializer {
   /// stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
 
+  /// ModuleBit - The start of the module block's contents, which the offsets
+  /// in the function index are relative to.
+  uint64_t ModuleBit;
+
+  /// FunctionIndexBit - Where the function index of the module starts, or 0
+  /// if it has none.
+  uint64_t FunctionIndexBit;
+
+  /// ModuleHash, FunctionHashes - The contents of the module's CONTENT_HASH
+  /// block, if it has one.
+  ContentHash ModuleHash;
+  std::vector<std::pair<Function*, ContentHash> > FunctionHashes;
+
   /// BlockAddrFwdRefs - These are blockaddr references to basic blocks.  These
   /// are resolved lazily when functions are loaded.
   typedef std::pair<unsigned, GlobalVariable*> BlockAddrRefTy;
@@ -196,13 +210,15 @@ public:
     : Context(C), TheModule(0), Buffer(buffer), BufferOwned(false),
       LazyStreamer(0), NextUnreadBit(0), SeenValueSymbolTable(false),
       ErrorString(0), ValueList(C), MDValueList(C),
-      SeenFirstFunctionBody(false), UseRelativeIDs(false) {
+      SeenFirstFunctionBody(false), ModuleBit(0), FunctionIndexBit(0),
+      UseRelativeIDs(false) {
   }
   explicit BitcodeReader(DataStreamer *streamer, LLVMContext &C)
     : Context(C), TheModule(0), Buffer(0), BufferOwned(false),
       LazyStreamer(streamer), NextUnreadBit(0), SeenValueSymbolTable(false),
       ErrorString(0), ValueList(C), MDValueList(C),
-      SeenFirstFunctionBody(false), UseRelativeIDs(false) {
+      SeenFirstFunctionBody(false), ModuleBit(0), FunctionIndexBit(0),
+      UseRelativeIDs(false) {
   }
   ~BitcodeReader() {
     FreeState();
@@ -238,6 +254,12 @@ public:
 
   static uint64_t decodeSignRotatedValue(uint64_t V);
 
+  /// getModuleHash, getFunctionHashes - Return the content hashes read from
+  /// the module, which are only available if the module had them.
+  const ContentHash &getModuleHash() const { return ModuleHash; }
+  const std::vector<std::pair<Function*, ContentHash> > &
+  getFunctionHashes() const { return FunctionHashes; }
+
 private:
   Type *getTypeByID(unsigned ID);
   Value *getFnValueByID(unsigned ID, Type *Ty) {
@@ -330,6 +352,8 @@ private:
   bool ParseValueSymbolTable();
   bool ParseConstants();
   bool RememberAndSkipFunctionBody();
+  bool ParseFunctionIndex();
+  bool ParseContentHashes();
   bool ParseFunctionBody(Function *F);
   bool GlobalCleanup();
   bool ResolveGlobalAndAliasInits();
@@ -17,6 +17,7 @@
 #include "llvm/Bitcode/BitstreamWriter.h"
 #include "llvm/Bitcode/LLVMBitCodes.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/ContentHash.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Instructions.h"
@@ -26,7 +27,10 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/MutexGuard.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cctype>
 #include <map>
@@ -38,6 +42,23 @@ EnablePreserveUseListOrdering("enable-bc-uselist-preserve",
                                        "use-list order preservation."),
                               cl::init(false), cl::Hidden);
 
+static cl::opt<bool>
+EnableFunctionIndex("enable-bc-function-index",
+                    cl::desc("Emit an index of the function bodies, which "
+                             "lets lazy readers find them without a scan"),
+                    cl::init(false), cl::Hidden);
+
+static cl::opt<unsigned>
+WriterThreads("bitcode-writer-threads",
+              cl::desc("Number of threads to encode function bodies on"),
+              cl::init(1), cl::Hidden);
+
+static cl::opt<bool>
+EnableContentHash("enable-bc-content-hash",
+                  cl::desc("Emit content hashes of the module and its "
+                           "functions, for build caches"),
+                  cl::init(false), cl::Hidden);
+
 /// These are manifest constants used by the bitcode writer. They do not need to
 /// be kept in sync with the reader, but need to be consistent within this file.
 enum {
@@ -1531,8 +1552,11 @@ static void WriteValueSymbolTable(const ValueSymbolTable &VST,
 
 /// WriteFunction - Emit a function body to the module stream.
 static void WriteFunction(const Function &F, ValueEnumerator &VE,
-                          BitstreamWriter &Stream) {
-  Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+                          BitstreamWriter &Stream, bool Detached = false) {
+  if (Detached)
+    Stream.EnterDetachedSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+  else
+    Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
   VE.incorporateFunction(F);
 
   SmallVector<unsigned, 64> Vals;
@@ -1859,15 +1883,222 @@ static void WriteModuleUseLists(const Module *M, ValueEnumerator &VE,
   Stream.ExitBlock();
 }
 
-/// WriteModule - Emit the specified module to the bitstream.
-static void WriteModule(const Module *M, BitstreamWriter &Stream) {
+/// WriteFunctionIndexOffset - Emit a placeholder for the offset of the
+/// function index, which can only be written after the function bodies.
+/// Returns the bit position of the placeholder.
+static uint64_t WriteFunctionIndexOffset(BitstreamWriter &Stream) {
+  // The offset is patched in later, so it needs a fixed width field.
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::MODULE_CODE_FNINDEXOFFSET));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  unsigned Abbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<unsigned, 1> Vals;
+  Vals.push_back(0);
+  Stream.EmitRecord(bitc::MODULE_CODE_FNINDEXOFFSET, Vals, Abbrev);
+  return Stream.GetCurrentBitNo() - 32;
+}
+
+/// WriteFunctionIndex - Emit the FUNCTION_INDEX block and patch its offset
+/// into the FNINDEXOFFSET record at \p OffsetBit.  \p FunctionBits holds the
+/// value ID and start of each function body, relative to \p ModuleBit.
+static void
+WriteFunctionIndex(const std::vector<std::pair<unsigned, uint64_t> >
+                     &FunctionBits,
+                   uint64_t ModuleBit, uint64_t OffsetBit,
+                   BitstreamWriter &Stream) {
+  // The index follows the END_BLOCK of a function body, so it is aligned.
+  uint64_t IndexWord = (Stream.GetCurrentBitNo() - ModuleBit) / 32;
+  assert((Stream.GetCurrentBitNo() - ModuleBit) % 32 == 0 &&
+         IndexWord == uint32_t(IndexWord) && "Unencodable index offset!");
+  Stream.BackpatchBits(OffsetBit, uint32_t(IndexWord));
+
+  Stream.EnterSubblock(bitc::FUNCTION_INDEX_BLOCK_ID, 3);
+
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::FNINDEX_CODE_ENTRY));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 16));
+  unsigned Abbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<uint64_t, 2> Vals;
+  for (unsigned i = 0, e = FunctionBits.size(); i != e; ++i) {
+    Vals.push_back(FunctionBits[i].first);
+    Vals.push_back(FunctionBits[i].second);
+    Stream.EmitRecord(bitc::FNINDEX_CODE_ENTRY, Vals, Abbrev);
+    Vals.clear();
+  }
+
+  Stream.ExitBlock();
+}
+
+namespace {
+/// FunctionBatch - A batch of function bodies being encoded on several
+/// threads.  Every function block only depends on the numbering of the module,
+/// so each thread incorporates functions into its own copy of the module's
+/// ValueEnumerator, and encodes them into their own buffers.
+struct FunctionBatch {
+  const ValueEnumerator &ModuleVE;
+  std::vector<const Function*> Functions;
+  std::vector<SmallVector<char, 0> > Bodies;
+
+  /// FreeVEs - Copies of ModuleVE that no thread is using.
+  std::vector<ValueEnumerator*> FreeVEs;
+  sys::Mutex Lock;
+
+  explicit FunctionBatch(const ValueEnumerator &VE) : ModuleVE(VE) {}
+  ~FunctionBatch() {
+    for (unsigned i = 0, e = FreeVEs.size(); i != e; ++i)
+      delete FreeVEs[i];
+  }
+
+  ValueEnumerator *acquireEnumerator() {
+    {
+      MutexGuard Guard(Lock);
+      if (!FreeVEs.empty()) {
+        ValueEnumerator *VE = FreeVEs.back();
+        FreeVEs.pop_back();
+        return VE;
+      }
+    }
+    return new ValueEnumerator(ModuleVE);
+  }
+
+  void releaseEnumerator(ValueEnumerator *VE) {
+    MutexGuard Guard(Lock);
+    FreeVEs.push_back(VE);
+  }
+};
+}
+
+/// EncodeFunction - Encode the body of function \p Index of a FunctionBatch
+/// as a detached FUNCTION_BLOCK.
+static void EncodeFunction(void *Data, unsigned Index) {
+  FunctionBatch &Batch = *static_cast<FunctionBatch*>(Data);
+  ValueEnumerator *VE = Batch.acquireEnumerator();
+  SmallVectorImpl<char> &Buffer = Batch.Bodies[Index];
+  {
+    BitstreamWriter Stream(Buffer);
+
+    // The abbreviations of the function block come from the block info,
+    // which the stream needs a copy of, but which goes out with the module.
+    WriteBlockInfo(*VE, Stream);
+    Buffer.clear();
+
+    WriteFunction(*Batch.Functions[Index], *VE, Stream, /*Detached=*/true);
+  }
+  Batch.releaseEnumerator(VE);
+}
+
+/// GetFunctionBodyBit - Return where the reader picks up the function body
+/// about to be emitted, relative to \p ModuleBit: just past the
+/// ENTER_SUBBLOCK code and the (single VBR chunk) block ID.
+static uint64_t GetFunctionBodyBit(const BitstreamWriter &Stream,
+                                   uint64_t ModuleBit) {
+  assert(bitc::FUNCTION_BLOCK_ID < (1U << (bitc::BlockIDWidth - 1)) &&
+         "Function block ID takes more than one VBR chunk");
+  return Stream.GetCurrentBitNo() - ModuleBit + Stream.GetAbbrevIDWidth() +
+         bitc::BlockIDWidth;
+}
+
+/// WriteContentHashes - Emit the CONTENT_HASH block, with the hash of the
+/// module and of each function body.
+static void WriteContentHashes(const Module *M, const ValueEnumerator &VE,
+                               BitstreamWriter &Stream) {
+  DenseMap<const Function*, ContentHash> FunctionHashes;
+  ContentHash ModuleHash = hashModuleContent(*M, &FunctionHashes);
+
+  Stream.EnterSubblock(bitc::CONTENT_HASH_BLOCK_ID, 3);
+
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::CONTENT_HASH_CODE_FUNCTION));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  for (unsigned i = 0; i != 4; ++i)
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  unsigned FunctionAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<uint32_t, 5> Vals;
+  for (unsigned i = 0; i != 4; ++i)
+    Vals.push_back(ModuleHash.getWord(i));
+  Stream.EmitRecord(bitc::CONTENT_HASH_CODE_MODULE, Vals);
+  Vals.clear();
+
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F) {
+    if (F->isDeclaration())
+      continue;
+    const ContentHash &FH = FunctionHashes[F];
+    Vals.push_back(VE.getValueID(F));
+    for (unsigned i = 0; i != 4; ++i)
+      Vals.push_back(FH.getWord(i));
+    Stream.EmitRecord(bitc::CONTENT_HASH_CODE_FUNCTION, Vals, FunctionAbbrev);
+    Vals.clear();
+  }
+
+  Stream.ExitBlock();
+}
+
+/// WriteFunctionsInParallel - Emit the function bodies of the module, encoding
+/// them on \p NumThreads threads, a batch at a time, so that only the bodies
+/// of one batch are held in memory on top of the stream.
+static void
+WriteFunctionsInParallel(const Module *M, const ValueEnumerator &VE,
+                         unsigned NumThreads, uint64_t ModuleBit,
+                         std::vector<std::pair<unsigned, uint64_t> >
+                           &FunctionBits,
+                         BitstreamWriter &Stream, raw_fd_ostream *FS) {
+  const unsigned BatchSize = NumThreads * 16;
+  FunctionBatch Batch(VE);
+  Module::const_iterator F = M->begin(), E = M->end();
+  while (F != E) {
+    Batch.Functions.clear();
+    for (; F != E && Batch.Functions.size() != BatchSize; ++F)
+      if (!F->isDeclaration())
+        Batch.Functions.push_back(F);
+
+    unsigned NumFunctions = Batch.Functions.size();
+    Batch.Bodies.clear();
+    Batch.Bodies.resize(NumFunctions);
+    llvm_execute_on_threads(EncodeFunction, &Batch, NumFunctions, NumThreads);
+
+    for (unsigned i = 0; i != NumFunctions; ++i) {
+      FunctionBits.push_back(std::make_pair(VE.getValueID(Batch.Functions[i]),
+                                            GetFunctionBodyBit(Stream,
+                                                               ModuleBit)));
+      const SmallVectorImpl<char> &Body = Batch.Bodies[i];
+      Stream.EmitDetachedSubblock(bitc::FUNCTION_BLOCK_ID, 4,
+                                  StringRef(Body.data(), Body.size()));
+      if (FS)
+        Stream.FlushToFile(*FS);
+    }
+  }
+}
+
+/// WriteModule - Emit the specified module to the bitstream.  Unless it has
+/// no function bodies, the module block ends with the function index, which
+/// the FNINDEXOFFSET record near its start points to.  If \p FS is not null,
+/// function bodies are flushed to it as they are emitted, and the stream must
+/// be finished with FinishFlushingToFile.
+static void WriteModule(const Module *M, BitstreamWriter &Stream,
+                        raw_fd_ostream *FS) {
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
+  uint64_t ModuleBit = Stream.GetCurrentBitNo();
 
   SmallVector<unsigned, 1> Vals;
   unsigned CurVersion = 1;
   Vals.push_back(CurVersion);
   Stream.EmitRecord(bitc::MODULE_CODE_VERSION, Vals);
 
+  // Only modules with function bodies get an index.
+  bool HasBodies = false;
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
+    if (!F->isDeclaration()) {
+      HasBodies = true;
+      break;
+    }
+  uint64_t IndexOffsetBit = 0;
+  if (EnableFunctionIndex && HasBodies)
+    IndexOffsetBit = WriteFunctionIndexOffset(Stream);
+
   // Analyze the module, enumerating globals, functions, etc.
   ValueEnumerator VE(M);
 
@@ -1903,10 +2134,28 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   if (EnablePreserveUseListOrdering)
     WriteModuleUseLists(M, VE, Stream);
 
-  // Emit function bodies.
-  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
-    if (!F->isDeclaration())
-      WriteFunction(*F, VE, Stream);
+  // Emit content hashes where lazy readers see them.
+  if (EnableContentHash)
+    WriteContentHashes(M, VE, Stream);
+
+  // Emit function bodies, remembering where the reader picks each of them up.
+  std::vector<std::pair<unsigned, uint64_t> > FunctionBits;
+  if (WriterThreads > 1)
+    WriteFunctionsInParallel(M, VE, WriterThreads, ModuleBit, FunctionBits,
+                             Stream, FS);
+  else
+    for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
+      if (!F->isDeclaration()) {
+        FunctionBits.push_back(std::make_pair(VE.getValueID(F),
+                                              GetFunctionBodyBit(Stream,
+                                                                 ModuleBit)));
+        WriteFunction(*F, VE, Stream);
+        if (FS)
+          Stream.FlushToFile(*FS);
+      }
+
+  if (IndexOffsetBit)
+    WriteFunctionIndex(FunctionBits, ModuleBit, IndexOffsetBit, Stream);
 
   Stream.ExitBlock();
 }
@@ -1984,6 +2233,16 @@ static void EmitDarwinBCHeaderAndTrailer(SmallVectorImpl<char> &Buffer,
     Buffer.push_back(0);
 }
 
+/// WriteBitcodeHeader - Emit the magic number of bitcode files.
+static void WriteBitcodeHeader(BitstreamWriter &Stream) {
+  Stream.Emit((unsigned)'B', 8);
+  Stream.Emit((unsigned)'C', 8);
+  Stream.Emit(0x0, 4);
+  Stream.Emit(0xC, 4);
+  Stream.Emit(0xE, 4);
+  Stream.Emit(0xD, 4);
+}
+
 /// WriteBitcodeToFile - Write the specified module to the specified output
 /// stream.
 void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
@@ -2001,15 +2260,10 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
     BitstreamWriter Stream(Buffer);
 
     // Emit the file header.
-    Stream.Emit((unsigned)'B', 8);
-    Stream.Emit((unsigned)'C', 8);
-    Stream.Emit(0x0, 4);
-    Stream.Emit(0xC, 4);
-    Stream.Emit(0xE, 4);
-    Stream.Emit(0xD, 4);
+    WriteBitcodeHeader(Stream);
 
     // Emit the module.
-    WriteModule(M, Stream);
+    WriteModule(M, Stream, 0);
   }
 
   if (TT.isOSDarwin())
@@ -2018,3 +2272,20 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
   // Write the generated bitstream to "Out".
   Out.write((char*)&Buffer.front(), Buffer.size());
 }
+
+/// WriteBitcodeToFile - Write the specified module to the specified file,
+/// streaming function bodies out as they are emitted rather than building the
+/// whole file in memory first, if the file can be seeked.
+void llvm::WriteBitcodeToFile(const Module *M, raw_fd_ostream &Out) {
+  // The darwin wrapper records the size of the bitcode up front.
+  if (!Out.supportsSeeking() || Triple(M->getTargetTriple()).isOSDarwin())
+    return WriteBitcodeToFile(M, static_cast<raw_ostream&>(Out));
+
+  SmallVector<char, 0> Buffer;
+  Buffer.reserve(256*1024);
+
+  BitstreamWriter Stream(Buffer);
+  WriteBitcodeHeader(Stream);
+  WriteModule(M, Stream, &Out);
+  Stream.FinishFlushingToFile(Out);
+}
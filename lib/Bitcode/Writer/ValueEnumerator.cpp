@@ -109,6 +109,18 @@ ValueEnumerator::ValueEnumerator(const Module *M) {
   OptimizeConstants(FirstConstant, Values.size());
 }
 
+ValueEnumerator::ValueEnumerator(const ValueEnumerator &VE)
+  : TypeMap(VE.TypeMap), Types(VE.Types), ValueMap(VE.ValueMap),
+    Values(VE.Values), MDValues(VE.MDValues), MDValueMap(VE.MDValueMap),
+    AttributeGroupMap(VE.AttributeGroupMap),
+    AttributeGroups(VE.AttributeGroups), AttributeMap(VE.AttributeMap),
+    Attribute(VE.Attribute), InstructionMap(VE.InstructionMap),
+    InstructionCount(0), NumModuleValues(0), NumModuleMDValues(0),
+    FirstFuncConstantID(0), FirstInstID(0) {
+  assert(VE.BasicBlocks.empty() && VE.FunctionLocalMDs.empty() &&
+         "Copying the numbering of a function!");
+}
+
 unsigned ValueEnumerator::getInstructionID(const Instruction *Inst) const {
   InstructionMapType::const_iterator I = InstructionMap.find(Inst);
   assert(I != InstructionMap.end() && "Instruction is not mapped!");
@@ -2198,6 +2198,31 @@ void DwarfDebug::emitAccelTypes() {
   AT.Emit(Asm, SectionBegin, &InfoHolder);
 }
 
+namespace {
+/// DIEOffsetOrder - Order global names by the offset of their DIE, then by
+/// name.
+struct DIEOffsetOrder {
+  bool operator()(const StringMapEntry<DIE*> *L,
+                  const StringMapEntry<DIE*> *R) const {
+    unsigned LOffset = L->getValue()->getOffset();
+    unsigned ROffset = R->getValue()->getOffset();
+    if (LOffset != ROffset)
+      return LOffset < ROffset;
+    return L->getKey() < R->getKey();
+  }
+};
+}
+
+/// sortGlobals - Fill \p Sorted with the entries of \p Globals in the order of
+/// their DIEs, so that the output does not depend on how the names hash.
+static void sortGlobals(const StringMap<DIE*> &Globals,
+                        SmallVectorImpl<const StringMapEntry<DIE*>*> &Sorted) {
+  for (StringMap<DIE*>::const_iterator
+         GI = Globals.begin(), GE = Globals.end(); GI != GE; ++GI)
+    Sorted.push_back(&*GI);
+  std::sort(Sorted.begin(), Sorted.end(), DIEOffsetOrder());
+}
+
 /// emitDebugPubnames - Emit visible names into a debug pubnames section.
 ///
 void DwarfDebug::emitDebugPubnames() {
@@ -2233,11 +2258,12 @@ void DwarfDebug::emitDebugPubnames() {
                              Asm->GetTempSymbol(ISec->getLabelBeginName(), ID),
                              4);
 
-    const StringMap<DIE*> &Globals = TheCU->getGlobalNames();
-    for (StringMap<DIE*>::const_iterator
-           GI = Globals.begin(), GE = Globals.end(); GI != GE; ++GI) {
+    SmallVector<const StringMapEntry<DIE*>*, 64> Globals;
+    sortGlobals(TheCU->getGlobalNames(), Globals);
+    for (unsigned i = 0, e = Globals.size(); i != e; ++i) {
+      const StringMapEntry<DIE*> *GI = Globals[i];
       const char *Name = GI->getKeyData();
-      const DIE *Entity = GI->second;
+      const DIE *Entity = GI->getValue();
 
       Asm->OutStreamer.AddComment("DIE offset");
       Asm->EmitInt32(Entity->getOffset());
@@ -2284,11 +2310,12 @@ void DwarfDebug::emitDebugPubTypes() {
                                                 TheCU->getUniqueID()),
                              4);
 
-    const StringMap<DIE*> &Globals = TheCU->getGlobalTypes();
-    for (StringMap<DIE*>::const_iterator
-           GI = Globals.begin(), GE = Globals.end(); GI != GE; ++GI) {
+    SmallVector<const StringMapEntry<DIE*>*, 64> Globals;
+    sortGlobals(TheCU->getGlobalTypes(), Globals);
+    for (unsigned i = 0, e = Globals.size(); i != e; ++i) {
+      const StringMapEntry<DIE*> *GI = Globals[i];
       const char *Name = GI->getKeyData();
-      DIE *Entity = GI->second;
+      DIE *Entity = GI->getValue();
 
       if (Asm->isVerbose()) Asm->OutStreamer.AddComment("DIE offset");
       Asm->EmitInt32(Entity->getOffset());
@@ -618,11 +618,16 @@ RegAlloc("regalloc",
 /// A target that uses the standard regalloc pass order for fast or optimized
 /// allocation may still override this for per-target regalloc
 /// selection. But -regalloc=... always takes precedence.
+///
+/// TargetOptions::EnableLinearScanRegAlloc selects the linear scan allocator
+/// for optimized allocation, so that a JIT can use it for one TargetMachine
+/// without changing the default for the whole process.
 FunctionPass *TargetPassConfig::createTargetRegisterAllocator(bool Optimized) {
-  if (Optimized)
-    return createGreedyRegisterAllocator();
-  else
+  if (!Optimized)
     return createFastRegisterAllocator();
+  if (TM->Options.EnableLinearScanRegAlloc)
+    return createLinearScanRegisterAllocator();
+  return createGreedyRegisterAllocator();
 }
 
 /// Find and instantiate the register allocation pass requested by this target
@@ -49,6 +49,12 @@ using namespace llvm;
 STATISTIC(NumGlobalSplits, "Number of split global live ranges");
 STATISTIC(NumLocalSplits,  "Number of split local live ranges");
 STATISTIC(NumEvicted,      "Number of interferences evicted");
+STATISTIC(NumOverBudget,   "Number of functions that exceeded the work budget");
+STATISTIC(NumBudgetSpills, "Number of cold live ranges spilled over budget");
+STATISTIC(NumBudgetSkippedRegion,
+          "Number of region splits skipped over budget");
+STATISTIC(NumBudgetDeniedEvictions,
+          "Number of evictions denied over budget");
 
 static cl::opt<SplitEditor::ComplementSpillMode>
 SplitSpillMode("split-spill-mode", cl::Hidden,
@@ -59,6 +65,15 @@ SplitSpillMode("split-spill-mode", cl::Hidden,
              clEnumValEnd),
   cl::init(SplitEditor::SM_Partition));
 
+// Work units are roughly the number of interference checks and splitting
+// steps. Typical functions use a handful per instruction; functions that go
+// super-linear in the allocator use orders of magnitude more.
+static cl::opt<unsigned>
+WorkBudget("greedy-work-budget", cl::Hidden,
+  cl::desc("Work units per instruction that the greedy register allocator "
+           "may spend before it degrades to cheaper heuristics (0 = no limit)"),
+  cl::init(0));
+
 static RegisterRegAlloc greedyRegAlloc("greedy", "greedy register allocator",
                                        createGreedyRegisterAllocator);
 
@@ -84,6 +99,11 @@ class RAGreedy : public MachineFunctionPass,
   std::priority_queue<std::pair<unsigned, unsigned> > Queue;
   unsigned NextCascade;
 
+  // Compile time budget for the current function, see chargeWork().
+  uint64_t WorkDone;
+  uint64_t WorkLimit;
+  bool OverBudget;
+
   // Live ranges pass through a number of stages as we try to allocate them.
   // Some of the stages may also create new live ranges:
   //
@@ -251,6 +271,8 @@ private:
   void LRE_WillShrinkVirtReg(unsigned);
   void LRE_DidCloneVirtReg(unsigned, unsigned);
 
+  void chargeWork(unsigned Units);
+  bool isColdRange(const LiveInterval&);
   float calcSpillCost();
   bool addSplitConstraints(InterferenceCache::Cursor, float&);
   void addThroughConstraints(InterferenceCache::Cursor, ArrayRef<unsigned>);
@@ -535,7 +557,9 @@ bool RAGreedy::canEvictInterference(LiveInterval &VirtReg, unsigned PhysReg,
   for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
     LiveIntervalUnion::Query &Q = Matrix->query(VirtReg, *Units);
     // If there is 10 or more interferences, chances are one is heavier.
-    if (Q.collectInterferingVRegs(10) >= 10)
+    unsigned NumIntf = Q.collectInterferingVRegs(10);
+    chargeWork(NumIntf + 1);
+    if (NumIntf >= 10)
       return false;
 
     // Check if any interfering live range is heavier than MaxWeight.
@@ -564,6 +588,11 @@ bool RAGreedy::canEvictInterference(LiveInterval &VirtReg, unsigned PhysReg,
         // We permit breaking cascades for urgent evictions. It should be the
         // last resort, though, so make it really expensive.
         Cost.BrokenHints += 10;
+      } else if (OverBudget && IntfCascade && !Urgent) {
+        // Over budget, don't evict live ranges that were already involved in
+        // an eviction. This keeps eviction chains short.
+        ++NumBudgetDeniedEvictions;
+        return false;
       }
       // Would this break a satisfied hint?
       bool BreaksHint = VRM->hasPreferredPhys(Intf->reg);
@@ -1159,6 +1188,7 @@ unsigned RAGreedy::tryRegionSplit(LiveInterval &VirtReg, AllocationOrder &Order,
       GlobalCand.resize(NumCands+1);
     GlobalSplitCandidate &Cand = GlobalCand[NumCands];
     Cand.reset(IntfCache, PhysReg);
+    chargeWork(SA->getUseBlocks().size() + 1);
 
     SpillPlacer->prepare(Cand.LiveBundles);
     float Cost;
@@ -1178,6 +1208,7 @@ unsigned RAGreedy::tryRegionSplit(LiveInterval &VirtReg, AllocationOrder &Order,
       continue;
     }
     growRegion(Cand);
+    chargeWork(Cand.ActiveBlocks.size());
 
     SpillPlacer->finish();
 
@@ -1258,6 +1289,7 @@ unsigned RAGreedy::tryBlockSplit(LiveInterval &VirtReg, AllocationOrder &Order,
   LiveRangeEdit LREdit(&VirtReg, NewVRegs, *MF, *LIS, VRM, this);
   SE->reset(LREdit, SplitSpillMode);
   ArrayRef<SplitAnalysis::BlockInfo> UseBlocks = SA->getUseBlocks();
+  chargeWork(UseBlocks.size());
   for (unsigned i = 0; i != UseBlocks.size(); ++i) {
     const SplitAnalysis::BlockInfo &BI = UseBlocks[i];
     if (SA->shouldSplitSingleBlock(BI, SingleInstrs))
@@ -1316,6 +1348,7 @@ RAGreedy::tryInstructionSplit(LiveInterval &VirtReg, AllocationOrder &Order,
   ArrayRef<SlotIndex> Uses = SA->getUseSlots();
   if (Uses.size() <= 1)
     return 0;
+  chargeWork(Uses.size());
 
   DEBUG(dbgs() << "Split around " << Uses.size() << " individual instrs.\n");
 
@@ -1520,6 +1553,7 @@ unsigned RAGreedy::tryLocalSplit(LiveInterval &VirtReg, AllocationOrder &Order,
 
   Order.rewind();
   while (unsigned PhysReg = Order.next()) {
+    chargeWork(NumGaps);
     // Keep track of the largest spill weight that would need to be evicted in
     // order to make use of PhysReg between UseSlots[i] and UseSlots[i+1].
     calcGapWeights(PhysReg, GapWeight);
@@ -1692,8 +1726,11 @@ unsigned RAGreedy::trySplit(LiveInterval &VirtReg, AllocationOrder &Order,
 
   // First try to split around a region spanning multiple blocks. RS_Split2
   // ranges already made dubious progress with region splitting, so they go
-  // straight to single block splitting.
-  if (getStage(VirtReg) < RS_Split2) {
+  // straight to single block splitting. Region splitting is also the most
+  // expensive step, so it is skipped when the function is over budget.
+  if (OverBudget && getStage(VirtReg) < RS_Split2)
+    ++NumBudgetSkippedRegion;
+  else if (getStage(VirtReg) < RS_Split2) {
     unsigned PhysReg = tryRegionSplit(VirtReg, Order, NewVRegs);
     if (PhysReg || !NewVRegs.empty())
       return PhysReg;
@@ -1708,8 +1745,34 @@ unsigned RAGreedy::trySplit(LiveInterval &VirtReg, AllocationOrder &Order,
 //                            Main Entry Point
 //===----------------------------------------------------------------------===//
 
+/// chargeWork - Account for Units of work spent allocating the current
+/// function. Once the budget is used up, the rest of the function is allocated
+/// with cheaper heuristics: no region splitting, short eviction chains, and
+/// cold live ranges are spilled instead of split.
+void RAGreedy::chargeWork(unsigned Units) {
+  WorkDone += Units;
+  if (OverBudget || !WorkLimit || WorkDone <= WorkLimit)
+    return;
+  OverBudget = true;
+  ++NumOverBudget;
+  DEBUG(dbgs() << "Work budget of " << WorkLimit << " exceeded in "
+               << MF->getName() << ", using cheaper heuristics\n");
+}
+
+/// isColdRange - Return true if VirtReg has no uses or defs inside a loop.
+bool RAGreedy::isColdRange(const LiveInterval &VirtReg) {
+  for (MachineRegisterInfo::reg_nodbg_iterator
+       I = MRI->reg_nodbg_begin(VirtReg.reg), E = MRI->reg_nodbg_end();
+       I != E; ++I)
+    if (Loops->getLoopFor(I->getParent()))
+      return false;
+  return true;
+}
+
 unsigned RAGreedy::selectOrSplit(LiveInterval &VirtReg,
                                  SmallVectorImpl<LiveInterval*> &NewVRegs) {
+  chargeWork(1);
+
   // First try assigning a free register.
   AllocationOrder Order(VirtReg.reg, *VRM, RegClassInfo);
   if (unsigned PhysReg = tryAssign(VirtReg, Order, NewVRegs))
@@ -1728,10 +1791,15 @@ unsigned RAGreedy::selectOrSplit(LiveInterval &VirtReg,
 
   assert(NewVRegs.empty() && "Cannot append to existing NewVRegs");
 
+  // Over budget, live ranges outside loops are spilled right away like a
+  // linear scan allocator would, instead of being requeued and split.
+  bool SpillCold = OverBudget && Stage < RS_Spill && VirtReg.isSpillable() &&
+                   isColdRange(VirtReg);
+
   // The first time we see a live range, don't try to split or spill.
   // Wait until the second time, when all smaller ranges have been allocated.
   // This gives a better picture of the interference to split around.
-  if (Stage < RS_Split) {
+  if (Stage < RS_Split && !SpillCold) {
     setStage(VirtReg, RS_Split);
     DEBUG(dbgs() << "wait for second round\n");
     NewVRegs.push_back(&VirtReg);
@@ -1743,10 +1811,15 @@ unsigned RAGreedy::selectOrSplit(LiveInterval &VirtReg,
   if (Stage >= RS_Done || !VirtReg.isSpillable())
     return ~0u;
 
-  // Try splitting VirtReg or interferences.
-  unsigned PhysReg = trySplit(VirtReg, Order, NewVRegs);
-  if (PhysReg || !NewVRegs.empty())
-    return PhysReg;
+  if (SpillCold) {
+    DEBUG(dbgs() << "over budget, spilling cold range\n");
+    ++NumBudgetSpills;
+  } else {
+    // Try splitting VirtReg or interferences.
+    unsigned PhysReg = trySplit(VirtReg, Order, NewVRegs);
+    if (PhysReg || !NewVRegs.empty())
+      return PhysReg;
+  }
 
   // Finally spill VirtReg itself.
   NamedRegionTimer T("Spiller", TimerGroupName, TimePassesIsEnabled);
@@ -1787,10 +1860,21 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   ExtraRegInfo.clear();
   ExtraRegInfo.resize(MRI->getNumVirtRegs());
   NextCascade = 1;
+  WorkDone = 0;
+  WorkLimit = 0;
+  OverBudget = false;
+  if (WorkBudget) {
+    unsigned NumInstrs = 0;
+    for (MachineFunction::const_iterator I = MF->begin(), E = MF->end();
+         I != E; ++I)
+      NumInstrs += I->size();
+    WorkLimit = uint64_t(WorkBudget) * std::max(NumInstrs, 1u);
+  }
   IntfCache.init(MF, Matrix->getLiveUnions(), Indexes, LIS, TRI);
   GlobalCand.resize(32);  // This will grow as needed.
 
   allocatePhysRegs();
+  DEBUG(dbgs() << "Allocation work: " << WorkDone << " units\n");
   releaseMemory();
   return true;
 }
@@ -0,0 +1,283 @@
+//===-- RegAllocLinearScan.cpp - Linear scan register allocator -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the RALinearScan function pass, a global register
+// allocator for clients like JIT compilers that want better code than the fast
+// allocator produces, without paying for live range splitting.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "regalloc"
+#include "llvm/CodeGen/Passes.h"
+#include "AllocationOrder.h"
+#include "LiveDebugVariables.h"
+#include "RegAllocBase.h"
+#include "Spiller.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/CodeGen/CalcSpillWeights.h"
+#include "llvm/CodeGen/LiveIntervalAnalysis.h"
+#include "llvm/CodeGen/LiveRangeEdit.h"
+#include "llvm/CodeGen/LiveRegMatrix.h"
+#include "llvm/CodeGen/LiveStackAnalysis.h"
+#include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/CodeGen/RegAllocRegistry.h"
+#include "llvm/CodeGen/VirtRegMap.h"
+#include "llvm/PassAnalysisSupport.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetRegisterInfo.h"
+#include <functional>
+#include <queue>
+
+using namespace llvm;
+
+STATISTIC(NumSpilled,  "Number of live ranges spilled");
+STATISTIC(NumEvicted,  "Number of assigned live ranges spilled to make room");
+
+static RegisterRegAlloc linearRegAlloc("linear", "linear scan register allocator",
+                                       createLinearScanRegisterAllocator);
+
+namespace {
+/// RALinearScan assigns live virtual registers in the order they start, like a
+/// classic linear scan allocator. Every live range is looked at once: it gets
+/// a free register, or it takes a register from assigned live ranges with
+/// smaller spill weights, which are spilled, or it is spilled itself. Live
+/// ranges are never split or requeued, so the work done is close to linear in
+/// the number of live ranges times the number of registers in their class.
+class RALinearScan : public MachineFunctionPass, public RegAllocBase {
+  // context
+  MachineFunction *MF;
+
+  // state
+  OwningPtr<Spiller> SpillerInstance;
+
+  // Unassigned live ranges keyed by start index, earliest first. The virtual
+  // register number breaks ties so the order is deterministic.
+  typedef std::pair<SlotIndex, unsigned> QueueEntry;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                      std::greater<QueueEntry> > Queue;
+
+public:
+  RALinearScan();
+
+  /// Return the pass name.
+  virtual const char* getPassName() const {
+    return "Linear Scan Register Allocator";
+  }
+
+  /// RALinearScan analysis usage.
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const;
+  virtual void releaseMemory();
+  virtual Spiller &spiller() { return *SpillerInstance; }
+  virtual void enqueue(LiveInterval *LI);
+  virtual LiveInterval *dequeue();
+  virtual unsigned selectOrSplit(LiveInterval &VirtReg,
+                                 SmallVectorImpl<LiveInterval*> &NewVRegs);
+
+  /// Perform register allocation.
+  virtual bool runOnMachineFunction(MachineFunction &mf);
+
+  static char ID;
+
+private:
+  bool canSpillInterference(LiveInterval &VirtReg, unsigned PhysReg,
+                            float &MaxWeight);
+  void spillInterference(LiveInterval &VirtReg, unsigned PhysReg,
+                         SmallVectorImpl<LiveInterval*> &NewVRegs);
+};
+
+char RALinearScan::ID = 0;
+
+} // end anonymous namespace
+
+RALinearScan::RALinearScan(): MachineFunctionPass(ID) {
+  initializeLiveDebugVariablesPass(*PassRegistry::getPassRegistry());
+  initializeLiveIntervalsPass(*PassRegistry::getPassRegistry());
+  initializeSlotIndexesPass(*PassRegistry::getPassRegistry());
+  initializeRegisterCoalescerPass(*PassRegistry::getPassRegistry());
+  initializeMachineSchedulerPass(*PassRegistry::getPassRegistry());
+  initializeCalculateSpillWeightsPass(*PassRegistry::getPassRegistry());
+  initializeLiveStacksPass(*PassRegistry::getPassRegistry());
+  initializeMachineDominatorTreePass(*PassRegistry::getPassRegistry());
+  initializeMachineLoopInfoPass(*PassRegistry::getPassRegistry());
+  initializeVirtRegMapPass(*PassRegistry::getPassRegistry());
+  initializeLiveRegMatrixPass(*PassRegistry::getPassRegistry());
+}
+
+void RALinearScan::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesCFG();
+  AU.addRequired<AliasAnalysis>();
+  AU.addPreserved<AliasAnalysis>();
+  AU.addRequired<LiveIntervals>();
+  AU.addPreserved<LiveIntervals>();
+  AU.addPreserved<SlotIndexes>();
+  AU.addRequired<LiveDebugVariables>();
+  AU.addPreserved<LiveDebugVariables>();
+  AU.addRequired<CalculateSpillWeights>();
+  AU.addRequired<LiveStacks>();
+  AU.addPreserved<LiveStacks>();
+  AU.addRequired<MachineBlockFrequencyInfo>();
+  AU.addPreserved<MachineBlockFrequencyInfo>();
+  AU.addRequiredID(MachineDominatorsID);
+  AU.addPreservedID(MachineDominatorsID);
+  AU.addRequired<MachineLoopInfo>();
+  AU.addPreserved<MachineLoopInfo>();
+  AU.addRequired<VirtRegMap>();
+  AU.addPreserved<VirtRegMap>();
+  AU.addRequired<LiveRegMatrix>();
+  AU.addPreserved<LiveRegMatrix>();
+  MachineFunctionPass::getAnalysisUsage(AU);
+}
+
+void RALinearScan::releaseMemory() {
+  SpillerInstance.reset(0);
+}
+
+void RALinearScan::enqueue(LiveInterval *LI) {
+  // Empty live ranges are dropped or trivially assigned, do them first.
+  SlotIndex Start = LI->empty() ? LIS->getSlotIndexes()->getZeroIndex()
+                                : LI->beginIndex();
+  Queue.push(std::make_pair(Start, LI->reg));
+}
+
+LiveInterval *RALinearScan::dequeue() {
+  if (Queue.empty())
+    return 0;
+  LiveInterval *LI = &LIS->getInterval(Queue.top().second);
+  Queue.pop();
+  return LI;
+}
+
+/// canSpillInterference - Return true if all the live ranges assigned to
+/// PhysReg that interfere with VirtReg may be spilled, and return the largest
+/// of their spill weights in MaxWeight.
+bool RALinearScan::canSpillInterference(LiveInterval &VirtReg,
+                                        unsigned PhysReg, float &MaxWeight) {
+  MaxWeight = 0;
+  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
+    LiveIntervalUnion::Query &Q = Matrix->query(VirtReg, *Units);
+    // Don't bother looking for the lightest of many interferences, spilling
+    // them all would cost more than spilling VirtReg.
+    if (Q.collectInterferingVRegs(8) >= 8)
+      return false;
+    for (unsigned i = Q.interferingVRegs().size(); i; --i) {
+      LiveInterval *Intf = Q.interferingVRegs()[i - 1];
+      if (!Intf->isSpillable())
+        return false;
+      MaxWeight = std::max(MaxWeight, Intf->weight);
+    }
+  }
+  return true;
+}
+
+/// spillInterference - Unassign and spill every live range assigned to PhysReg
+/// that interferes with VirtReg. canSpillInterference must have returned true.
+void RALinearScan::spillInterference(LiveInterval &VirtReg, unsigned PhysReg,
+                                     SmallVectorImpl<LiveInterval*> &NewVRegs) {
+  // Collect all interfering virtregs first, spilling invalidates the queries.
+  SmallVector<LiveInterval*, 8> Intfs;
+  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
+    LiveIntervalUnion::Query &Q = Matrix->query(VirtReg, *Units);
+    assert(Q.seenAllInterferences() && "Didn't check all interfererences.");
+    ArrayRef<LiveInterval*> IVR = Q.interferingVRegs();
+    Intfs.append(IVR.begin(), IVR.end());
+  }
+
+  for (unsigned i = 0, e = Intfs.size(); i != e; ++i) {
+    LiveInterval &Spill = *Intfs[i];
+    // The same VirtReg may be present in multiple RegUnits. Skip duplicates.
+    if (!VRM->hasPhys(Spill.reg))
+      continue;
+    DEBUG(dbgs() << "spilling " << Spill << " for " << PrintReg(PhysReg, TRI)
+                 << '\n');
+    Matrix->unassign(Spill);
+    ++NumEvicted;
+    LiveRangeEdit LRE(&Spill, NewVRegs, *MF, *LIS, VRM);
+    spiller().spill(LRE);
+  }
+}
+
+unsigned RALinearScan::selectOrSplit(LiveInterval &VirtReg,
+                                     SmallVectorImpl<LiveInterval*> &NewVRegs) {
+  // Take the first free register in allocation order, hints first. Remember
+  // the register with the cheapest interference in case there is none.
+  unsigned BestPhys = 0;
+  float BestWeight = VirtReg.weight;
+  AllocationOrder Order(VirtReg.reg, *VRM, RegClassInfo);
+  while (unsigned PhysReg = Order.next()) {
+    switch (Matrix->checkInterference(VirtReg, PhysReg)) {
+    case LiveRegMatrix::IK_Free:
+      return PhysReg;
+
+    case LiveRegMatrix::IK_VirtReg: {
+      float Weight;
+      if (canSpillInterference(VirtReg, PhysReg, Weight) &&
+          Weight < BestWeight) {
+        BestPhys = PhysReg;
+        BestWeight = Weight;
+      }
+      continue;
+    }
+
+    default:
+      // RegMask or RegUnit interference.
+      continue;
+    }
+  }
+
+  // Spill whichever side is cheaper. Spill products are unspillable, so they
+  // always get to spill lighter live ranges.
+  if (BestPhys) {
+    spillInterference(VirtReg, BestPhys, NewVRegs);
+    assert(!Matrix->checkInterference(VirtReg, BestPhys) &&
+           "Interference after spill.");
+    return BestPhys;
+  }
+
+  // If we couldn't allocate a register from spilling, there is probably some
+  // invalid inline assembly. The base class will report it.
+  if (!VirtReg.isSpillable())
+    return ~0u;
+
+  DEBUG(dbgs() << "spilling: " << VirtReg << '\n');
+  ++NumSpilled;
+  LiveRangeEdit LRE(&VirtReg, NewVRegs, *MF, *LIS, VRM);
+  spiller().spill(LRE);
+
+  // The live virtual register requesting allocation was spilled, so tell
+  // the caller not to allocate anything during this round.
+  return 0;
+}
+
+bool RALinearScan::runOnMachineFunction(MachineFunction &mf) {
+  DEBUG(dbgs() << "********** LINEAR SCAN REGISTER ALLOCATION **********\n"
+               << "********** Function: " << mf.getName() << '\n');
+
+  MF = &mf;
+  RegAllocBase::init(getAnalysis<VirtRegMap>(),
+                     getAnalysis<LiveIntervals>(),
+                     getAnalysis<LiveRegMatrix>());
+  SpillerInstance.reset(createInlineSpiller(*this, *MF, *VRM));
+
+  allocatePhysRegs();
+
+  // Diagnostic output before rewriting
+  DEBUG(dbgs() << "Post alloc VirtRegMap:\n" << *VRM << "\n");
+
+  releaseMemory();
+  return true;
+}
+
+FunctionPass *llvm::createLinearScanRegisterAllocator() {
+  return new RALinearScan();
+}
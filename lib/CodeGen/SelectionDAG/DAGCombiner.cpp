@@ -67,21 +67,15 @@ namespace {
     //
     // This has the semantics that when adding to the worklist,
     // the item added must be next to be processed. It should
-    // also only appear once. The naive approach to this takes
-    // linear time.
+    // also only appear once.
     //
-    // To reduce the insert/remove time to logarithmic, we use
-    // a set and a vector to maintain our worklist.
-    //
-    // The set contains the items on the worklist, but does not
-    // maintain the order they should be visited.
-    //
-    // The vector maintains the order nodes should be visited, but may
-    // contain duplicate or removed nodes. When choosing a node to
-    // visit, we pop off the order stack until we find an item that is
-    // also in the contents set. All operations are O(log N).
-    SmallPtrSet<SDNode*, 64> WorkListContents;
-    SmallVector<SDNode*, 64> WorkListOrder;
+    // Every node on the worklist records its position in WorkList in its
+    // CombinerWorkListIndex, so adding, removing and popping a node are all
+    // O(1).  Removing a node, or moving it to the back, leaves a null entry
+    // behind, which popping skips.  WorkListSize is the number of nodes on
+    // the worklist, not counting the null entries.
+    SmallVector<SDNode*, 64> WorkList;
+    unsigned WorkListSize;
 
     // AA - Used for DAG load/store alias analysis.
     AliasAnalysis &AA;
@@ -104,14 +98,56 @@ namespace {
     /// AddToWorkList - Add to the work list making sure its instance is at the
     /// back (next to be processed.)
     void AddToWorkList(SDNode *N) {
-      WorkListContents.insert(N);
-      WorkListOrder.push_back(N);
+      int Index = N->getCombinerWorkListIndex();
+      if (Index < 0)
+        ++WorkListSize;
+      else if (unsigned(Index) + 1 == WorkList.size())
+        return;
+      else
+        WorkList[Index] = 0;
+      N->setCombinerWorkListIndex(WorkList.size());
+      WorkList.push_back(N);
+
+      // Don't let null entries pile up when nodes keep moving to the back.
+      if (WorkList.size() > 2 * WorkListSize + 64)
+        compactWorkList();
     }
 
-    /// removeFromWorkList - remove all instances of N from the worklist.
+    /// removeFromWorkList - remove N from the worklist.
     ///
     void removeFromWorkList(SDNode *N) {
-      WorkListContents.erase(N);
+      int Index = N->getCombinerWorkListIndex();
+      if (Index < 0)
+        return;
+      WorkList[Index] = 0;
+      N->setCombinerWorkListIndex(-1);
+      --WorkListSize;
+    }
+
+    /// compactWorkList - Remove the null entries from the worklist.
+    void compactWorkList() {
+      unsigned j = 0;
+      for (unsigned i = 0, e = WorkList.size(); i != e; ++i)
+        if (SDNode *N = WorkList[i]) {
+          N->setCombinerWorkListIndex(j);
+          WorkList[j++] = N;
+        }
+      WorkList.resize(j);
+    }
+
+    /// getNextWorkListEntry - Take the node at the back of the worklist off
+    /// it, or return null if the worklist is empty.
+    SDNode *getNextWorkListEntry() {
+      while (!WorkList.empty()) {
+        SDNode *N = WorkList.pop_back_val();
+        if (!N)
+          continue;
+        N->setCombinerWorkListIndex(-1);
+        --WorkListSize;
+        return N;
+      }
+      assert(!WorkListSize && "Nodes are missing from the worklist!");
+      return 0;
     }
 
     SDValue CombineTo(SDNode *N, const SDValue *To, unsigned NumTo,
@@ -316,7 +352,8 @@ namespace {
   public:
     DAGCombiner(SelectionDAG &D, AliasAnalysis &A, CodeGenOpt::Level OL)
       : DAG(D), TLI(D.getTargetLoweringInfo()), Level(BeforeLegalizeTypes),
-        OptLevel(OL), LegalOperations(false), LegalTypes(false), AA(A) {}
+        OptLevel(OL), LegalOperations(false), LegalTypes(false),
+        WorkListSize(0), AA(A) {}
 
     /// Run - runs the dag combiner on all nodes in the work list
     void Run(CombineLevel AtLevel);
@@ -1015,16 +1052,7 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
 
   // while the worklist isn't empty, find a node and
   // try and combine it.
-  while (!WorkListContents.empty()) {
-    SDNode *N;
-    // The WorkListOrder holds the SDNodes in order, but it may contain duplicates.
-    // In order to avoid a linear scan, we use a set (O(log N)) to hold what the
-    // worklist *should* contain, and check the node we want to visit is should
-    // actually be visited.
-    do {
-      N = WorkListOrder.pop_back_val();
-    } while (!WorkListContents.erase(N));
-
+  while (SDNode *N = getNextWorkListEntry()) {
     // If N has no uses, it is dead.  Make sure to revisit all N's operands once
     // N is deleted from the DAG, since they too may now be dead or may have a
     // reduced number of uses, allowing other xforms.
@@ -625,9 +625,38 @@ void SelectionDAG::DeleteNodeNotInCSEMaps(SDNode *N) {
   DeallocateNode(N);
 }
 
+/// hasSameOperandCapacity - Return true if operand lists for NumOps1 and
+/// NumOps2 operands come from the same bucket of the operand recycler.
+static bool hasSameOperandCapacity(unsigned NumOps1, unsigned NumOps2) {
+  typedef ArrayRecycler<SDUse>::Capacity Capacity;
+  return Capacity::get(NumOps1).getBucket() ==
+         Capacity::get(NumOps2).getBucket();
+}
+
+void SelectionDAG::createOperands(SDNode *Node, const SDValue *Ops,
+                                  unsigned NumOps) {
+  assert(!Node->OperandList && "Node already has operands!");
+  if (!NumOps)
+    return;
+  SDUse *OpList =
+    OperandRecycler.allocate(ArrayRecycler<SDUse>::Capacity::get(NumOps),
+                             OperandAllocator);
+  Node->InitOperands(OpList, Ops, NumOps);
+  Node->OperandsNeedDelete = true;
+}
+
+void SelectionDAG::removeOperands(SDNode *Node) {
+  if (Node->OperandsNeedDelete)
+    OperandRecycler.deallocate(
+      ArrayRecycler<SDUse>::Capacity::get(Node->NumOperands),
+      Node->OperandList);
+  Node->OperandList = 0;
+  Node->NumOperands = 0;
+  Node->OperandsNeedDelete = false;
+}
+
 void SelectionDAG::DeallocateNode(SDNode *N) {
-  if (N->OperandsNeedDelete)
-    delete[] N->OperandList;
+  removeOperands(N);
 
   // Set the opcode to DELETED_NODE to help catch bugs when node
   // memory is reallocated.
@@ -867,11 +896,24 @@ unsigned SelectionDAG::getEVTAlignment(EVT VT) const {
   return TM.getTargetLowering()->getDataLayout()->getABITypeAlignment(Ty);
 }
 
+namespace {
+/// DAGSlabCache - The slabs that the operand allocators of SelectionDAGs
+/// release when they are cleared after every block, kept for the next block.
+struct DAGSlabCache {
+  MallocSlabAllocator Malloc;
+  CachingSlabAllocator Cache;
+  DAGSlabCache() : Cache(Malloc) {}
+};
+}
+
+static ManagedStatic<DAGSlabCache> DAGSlabs;
+
 // EntryNode could meaningfully have debug info if we can find it...
 SelectionDAG::SelectionDAG(const TargetMachine &tm, CodeGenOpt::Level OL)
   : TM(tm), TSI(*tm.getSelectionDAGInfo()), TTI(0), OptLevel(OL),
     EntryNode(ISD::EntryToken, 0, DebugLoc(), getVTList(MVT::Other)),
-    Root(getEntryNode()), UpdateListeners(0) {
+    Root(getEntryNode()), OperandAllocator(4096, 4096, DAGSlabs->Cache),
+    UpdateListeners(0) {
   AllNodes.push_back(&EntryNode);
   DbgInfo = new SDDbgInfo();
 }
@@ -885,6 +927,7 @@ void SelectionDAG::init(MachineFunction &mf, const TargetTransformInfo *tti) {
 SelectionDAG::~SelectionDAG() {
   assert(!UpdateListeners && "Dangling registered DAGUpdateListeners");
   allnodes_clear();
+  OperandRecycler.clear(OperandAllocator);
   delete DbgInfo;
 }
 
@@ -897,6 +940,7 @@ void SelectionDAG::allnodes_clear() {
 
 void SelectionDAG::clear() {
   allnodes_clear();
+  OperandRecycler.clear(OperandAllocator);
   OperandAllocator.Reset();
   CSEMap.clear();
 
@@ -1403,8 +1447,10 @@ SDValue SelectionDAG::getConvertRndSat(EVT VT, SDLoc dl,
   if (SDNode *E = CSEMap.FindNodeOrInsertPos(ID, IP))
     return SDValue(E, 0);
 
-  CvtRndSatSDNode *N = new (NodeAllocator) CvtRndSatSDNode(VT, dl.getIROrder(), dl.getDebugLoc(), Ops, 5,
+  CvtRndSatSDNode *N = new (NodeAllocator) CvtRndSatSDNode(VT, dl.getIROrder(),
+                                                           dl.getDebugLoc(),
                                                            Code);
+  createOperands(N, Ops, 5);
   CSEMap.InsertNode(N, IP);
   AllNodes.push_back(N);
   return SDValue(N, 0);
@@ -4339,12 +4385,14 @@ SelectionDAG::getMemIntrinsicNode(unsigned Opcode, SDLoc dl, SDVTList VTList,
       return SDValue(E, 0);
     }
 
-    N = new (NodeAllocator) MemIntrinsicSDNode(Opcode, dl.getIROrder(), dl.getDebugLoc(), VTList, Ops, NumOps,
+    N = new (NodeAllocator) MemIntrinsicSDNode(Opcode, dl.getIROrder(), dl.getDebugLoc(), VTList,
                                                MemVT, MMO);
+    createOperands(N, Ops, NumOps);
     CSEMap.InsertNode(N, IP);
   } else {
-    N = new (NodeAllocator) MemIntrinsicSDNode(Opcode, dl.getIROrder(), dl.getDebugLoc(), VTList, Ops, NumOps,
+    N = new (NodeAllocator) MemIntrinsicSDNode(Opcode, dl.getIROrder(), dl.getDebugLoc(), VTList,
                                                MemVT, MMO);
+    createOperands(N, Ops, NumOps);
   }
   AllNodes.push_back(N);
   return SDValue(N, 0);
@@ -4715,10 +4763,12 @@ SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL, EVT VT,
     if (SDNode *E = CSEMap.FindNodeOrInsertPos(ID, IP))
       return SDValue(E, 0);
 
-    N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(), VTs, Ops, NumOps);
+    N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(), VTs);
+    createOperands(N, Ops, NumOps);
     CSEMap.InsertNode(N, IP);
   } else {
-    N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(), VTs, Ops, NumOps);
+    N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(), VTs);
+    createOperands(N, Ops, NumOps);
   }
 
   AllNodes.push_back(N);
@@ -4788,7 +4838,8 @@ SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL, SDVTList VTList,
       N = new (NodeAllocator) TernarySDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(), VTList, Ops[0], Ops[1],
                                             Ops[2]);
     } else {
-      N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(), VTList, Ops, NumOps);
+      N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(), VTList);
+      createOperands(N, Ops, NumOps);
     }
     CSEMap.InsertNode(N, IP);
   } else {
@@ -4800,7 +4851,8 @@ SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL, SDVTList VTList,
       N = new (NodeAllocator) TernarySDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(), VTList, Ops[0], Ops[1],
                                             Ops[2]);
     } else {
-      N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(), VTList, Ops, NumOps);
+      N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(), VTList);
+      createOperands(N, Ops, NumOps);
     }
   }
   AllNodes.push_back(N);
@@ -5225,9 +5277,9 @@ SDNode *SelectionDAG::MorphNodeTo(SDNode *N, unsigned Opc,
     MN->setMemRefs(0, 0);
     // If NumOps is larger than the # of operands we can have in a
     // MachineSDNode, reallocate the operand list.
-    if (NumOps > MN->NumOperands || !MN->OperandsNeedDelete) {
-      if (MN->OperandsNeedDelete)
-        delete[] MN->OperandList;
+    if (NumOps > MN->NumOperands || !MN->OperandsNeedDelete ||
+        !hasSameOperandCapacity(NumOps, MN->NumOperands)) {
+      removeOperands(MN);
       if (NumOps > array_lengthof(MN->LocalOperands))
         // We're creating a final node that will live unmorphed for the
         // remainder of the current SelectionDAG iteration, so we can allocate
@@ -5236,17 +5288,17 @@ SDNode *SelectionDAG::MorphNodeTo(SDNode *N, unsigned Opc,
                          Ops, NumOps);
       else
         MN->InitOperands(MN->LocalOperands, Ops, NumOps);
-      MN->OperandsNeedDelete = false;
     } else
       MN->InitOperands(MN->OperandList, Ops, NumOps);
   } else {
     // If NumOps is larger than the # of operands we currently have, reallocate
-    // the operand list.
-    if (NumOps > N->NumOperands) {
-      if (N->OperandsNeedDelete)
-        delete[] N->OperandList;
-      N->InitOperands(new SDUse[NumOps], Ops, NumOps);
-      N->OperandsNeedDelete = true;
+    // the operand list.  A recycled list is also replaced when NumOps would
+    // give it back to the wrong bucket of the recycler later.
+    if (NumOps > N->NumOperands ||
+        (N->OperandsNeedDelete &&
+         !hasSameOperandCapacity(NumOps, N->NumOperands))) {
+      removeOperands(N);
+      createOperands(N, Ops, NumOps);
     } else
       N->InitOperands(N->OperandList, Ops, NumOps);
   }
@@ -5927,17 +5979,6 @@ MemSDNode::MemSDNode(unsigned Opc, unsigned Order, DebugLoc dl, SDVTList VTs,
   assert(memvt.getStoreSize() == MMO->getSize() && "Size mismatch!");
 }
 
-MemSDNode::MemSDNode(unsigned Opc, unsigned Order, DebugLoc dl, SDVTList VTs,
-                     const SDValue *Ops, unsigned NumOps, EVT memvt,
-                     MachineMemOperand *mmo)
-   : SDNode(Opc, Order, dl, VTs, Ops, NumOps),
-     MemoryVT(memvt), MMO(mmo) {
-  SubclassData = encodeMemSDNodeFlags(0, ISD::UNINDEXED, MMO->isVolatile(),
-                                      MMO->isNonTemporal(), MMO->isInvariant());
-  assert(isVolatile() == MMO->isVolatile() && "Volatile encoding error!");
-  assert(memvt.getStoreSize() == MMO->getSize() && "Size mismatch!");
-}
-
 /// Profile - Gather unique data for the node.
 ///
 void SDNode::Profile(FoldingSetNodeID &ID) const {
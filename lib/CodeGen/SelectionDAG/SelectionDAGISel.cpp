@@ -15,6 +15,7 @@
 #include "llvm/CodeGen/SelectionDAGISel.h"
 #include "ScheduleDAGSDNodes.h"
 #include "SelectionDAGBuilder.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
@@ -44,6 +45,10 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/MutexGuard.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetInstrInfo.h"
@@ -154,6 +159,34 @@ static cl::opt<bool>
 EnableFastISelAbortArgs("fast-isel-abort-args", cl::Hidden,
           cl::desc("Enable abort calls when \"fast\" instruction selection "
                    "fails to lower a formal argument"));
+static cl::opt<std::string>
+FastISelReport("fast-isel-report", cl::Hidden, cl::value_desc("filename"),
+          cl::desc("Append how often each kind of instruction made \"fast\" "
+                   "instruction selection fall back to SelectionDAG to this "
+                   "file"));
+static cl::opt<bool>
+ISelPhaseTimes("isel-phase-times", cl::Hidden,
+          cl::desc("Print the time spent building, combining, legalizing, "
+                   "selecting and scheduling DAGs for every function"));
+
+namespace llvm { extern raw_ostream *CreateInfoOutputFile(); }
+
+namespace {
+/// PhaseTimeRegion - Add the wall time from construction to destruction to a
+/// phase of SelectionDAGISel::PhaseTimes, when -isel-phase-times is given.
+class PhaseTimeRegion {
+  double *Total;
+  double Start;
+public:
+  explicit PhaseTimeRegion(double &T)
+    : Total(ISelPhaseTimes ? &T : 0),
+      Start(Total ? TimeRecord::getCurrentTime().getWallTime() : 0) {}
+  ~PhaseTimeRegion() {
+    if (Total)
+      *Total += TimeRecord::getCurrentTime(false).getWallTime() - Start;
+  }
+};
+}
 
 static cl::opt<bool>
 UseMBPI("use-mbpi",
@@ -296,6 +329,71 @@ SelectionDAGISel::~SelectionDAGISel() {
   delete FuncInfo;
 }
 
+static ManagedStatic<sys::Mutex> FastISelReportMutex;
+
+/// doFinalization - Append one JSON object per fallback reason to the
+/// -fast-isel-report file.  Several code generators may share the file, so
+/// records are appended under a lock.
+bool SelectionDAGISel::doFinalization(Module &M) {
+  if (FastISelFallbacks.empty())
+    return false;
+
+  // Sort by reason, so that reports are reproducible.
+  std::vector<StringRef> Reasons;
+  for (StringMap<std::pair<unsigned, unsigned> >::iterator
+       I = FastISelFallbacks.begin(), E = FastISelFallbacks.end(); I != E; ++I)
+    Reasons.push_back(I->getKey());
+  std::sort(Reasons.begin(), Reasons.end());
+
+  MutexGuard Lock(*FastISelReportMutex);
+  std::string Error;
+  raw_fd_ostream OS(FastISelReport.c_str(), Error, raw_fd_ostream::F_Append);
+  if (!Error.empty()) {
+    errs() << "Error opening fast isel report '" << FastISelReport << "': "
+           << Error << '\n';
+  } else {
+    for (unsigned i = 0, e = Reasons.size(); i != e; ++i) {
+      const std::pair<unsigned, unsigned> &Counts =
+        FastISelFallbacks[Reasons[i]];
+      OS << "{\"module\":";
+      OS.write_json_string(M.getModuleIdentifier());
+      OS << ",\"reason\":";
+      OS.write_json_string(Reasons[i]);
+      OS << ",\"fallbacks\":" << Counts.first
+         << ",\"instrs\":" << Counts.second << "}\n";
+    }
+  }
+  FastISelFallbacks.clear();
+  return false;
+}
+
+void SelectionDAGISel::recordFastISelFallback(StringRef Reason,
+                                              unsigned NumInstrs) {
+  std::pair<unsigned, unsigned> &Counts = FastISelFallbacks[Reason];
+  ++Counts.first;
+  Counts.second += NumInstrs;
+}
+
+/// recordFastISelFallback - Record that fast isel gave I and NumInstrs-1 other
+/// instructions to SelectionDAG.  The reason is the opcode, qualified by the
+/// intrinsic for calls, and by "vector" for vector operations.
+void SelectionDAGISel::recordFastISelFallback(const Instruction *I,
+                                              unsigned NumInstrs) {
+  if (FastISelReport.empty())
+    return;
+
+  std::string Reason = I->getOpcodeName();
+  if (const IntrinsicInst *II = dyn_cast<IntrinsicInst>(I))
+    Reason += " " + Intrinsic::getName(II->getIntrinsicID());
+  else if (const CallInst *CI = dyn_cast<CallInst>(I)) {
+    if (isa<InlineAsm>(CI->getCalledValue()))
+      Reason += " asm";
+  } else if (I->getType()->isVectorTy() ||
+             (I->getNumOperands() && I->getOperand(0)->getType()->isVectorTy()))
+    Reason += " vector";
+  recordFastISelFallback(Reason, NumInstrs);
+}
+
 void SelectionDAGISel::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<AliasAnalysis>();
   AU.addPreserved<AliasAnalysis>();
@@ -370,6 +468,8 @@ bool SelectionDAGISel::runOnMachineFunction(MachineFunction &mf) {
 
   DEBUG(dbgs() << "\n\n\n=== " << Fn.getName() << "\n");
 
+  std::fill(PhaseTimes, PhaseTimes + NumISelPhases, 0.0);
+
   SplitCriticalSideEffectEdges(const_cast<Function&>(Fn), this);
 
   CurDAG->init(*MF, TTI);
@@ -507,17 +607,39 @@ bool SelectionDAGISel::runOnMachineFunction(MachineFunction &mf) {
   // at this point.
   FuncInfo->clear();
 
+  if (ISelPhaseTimes)
+    printPhaseTimes(Fn);
+
   return true;
 }
 
+/// printPhaseTimes - Print the PhaseTimes of Fn on one line, to the same file
+/// as the -time-passes report.
+void SelectionDAGISel::printPhaseTimes(const Function &Fn) {
+  static const char *const PhaseNames[NumISelPhases] = {
+    "build", "combine", "legalize", "select", "schedule"
+  };
+  OwningPtr<raw_ostream> OS(CreateInfoOutputFile());
+  *OS << "isel phase times for '" << Fn.getName() << "':";
+  for (unsigned i = 0; i != NumISelPhases; ++i)
+    *OS << ' ' << PhaseNames[i] << ' ' << format("%.6f", PhaseTimes[i]);
+  *OS << '\n';
+}
+
 void SelectionDAGISel::SelectBasicBlock(BasicBlock::const_iterator Begin,
                                         BasicBlock::const_iterator End,
                                         bool &HadTailCall) {
   // Lower all of the non-terminator instructions. If a call is emitted
   // as a tail call, cease emitting nodes for this block. Terminators
   // are handled below.
-  for (BasicBlock::const_iterator I = Begin; I != End && !SDB->HasTailCall; ++I)
-    SDB->visit(*I);
+  {
+    NamedRegionTimer T("DAG Building", "Instruction Selection and Scheduling",
+                       TimePassesIsEnabled);
+    PhaseTimeRegion P(PhaseTimes[PhaseBuild]);
+    for (BasicBlock::const_iterator I = Begin;
+         I != End && !SDB->HasTailCall; ++I)
+      SDB->visit(*I);
+  }
 
   // Make sure the root of the DAG is up-to-date.
   CurDAG->setRoot(SDB->getControlRoot());
@@ -594,6 +716,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   // Run the DAG combiner in pre-legalize mode.
   {
     NamedRegionTimer T("DAG Combining 1", GroupName, TimePassesIsEnabled);
+    PhaseTimeRegion P(PhaseTimes[PhaseCombine]);
     CurDAG->Combine(BeforeLegalizeTypes, *AA, OptLevel);
   }
 
@@ -608,6 +731,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   bool Changed;
   {
     NamedRegionTimer T("Type Legalization", GroupName, TimePassesIsEnabled);
+    PhaseTimeRegion P(PhaseTimes[PhaseLegalize]);
     Changed = CurDAG->LegalizeTypes();
   }
 
@@ -622,6 +746,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
     {
       NamedRegionTimer T("DAG Combining after legalize types", GroupName,
                          TimePassesIsEnabled);
+      PhaseTimeRegion P(PhaseTimes[PhaseCombine]);
       CurDAG->Combine(AfterLegalizeTypes, *AA, OptLevel);
     }
 
@@ -632,12 +757,14 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
 
   {
     NamedRegionTimer T("Vector Legalization", GroupName, TimePassesIsEnabled);
+    PhaseTimeRegion P(PhaseTimes[PhaseLegalize]);
     Changed = CurDAG->LegalizeVectors();
   }
 
   if (Changed) {
     {
       NamedRegionTimer T("Type Legalization 2", GroupName, TimePassesIsEnabled);
+      PhaseTimeRegion P(PhaseTimes[PhaseLegalize]);
       CurDAG->LegalizeTypes();
     }
 
@@ -648,6 +775,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
     {
       NamedRegionTimer T("DAG Combining after legalize vectors", GroupName,
                          TimePassesIsEnabled);
+      PhaseTimeRegion P(PhaseTimes[PhaseCombine]);
       CurDAG->Combine(AfterLegalizeVectorOps, *AA, OptLevel);
     }
 
@@ -659,6 +787,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
 
   {
     NamedRegionTimer T("DAG Legalization", GroupName, TimePassesIsEnabled);
+    PhaseTimeRegion P(PhaseTimes[PhaseLegalize]);
     CurDAG->Legalize();
   }
 
@@ -670,6 +799,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   // Run the DAG combiner in post-legalize mode.
   {
     NamedRegionTimer T("DAG Combining 2", GroupName, TimePassesIsEnabled);
+    PhaseTimeRegion P(PhaseTimes[PhaseCombine]);
     CurDAG->Combine(AfterLegalizeDAG, *AA, OptLevel);
   }
 
@@ -685,6 +815,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   // code to the MachineBasicBlock.
   {
     NamedRegionTimer T("Instruction Selection", GroupName, TimePassesIsEnabled);
+    PhaseTimeRegion P(PhaseTimes[PhaseSelect]);
     DoInstructionSelection();
   }
 
@@ -698,6 +829,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   {
     NamedRegionTimer T("Instruction Scheduling", GroupName,
                        TimePassesIsEnabled);
+    PhaseTimeRegion P(PhaseTimes[PhaseSchedule]);
     Scheduler->Run(CurDAG, FuncInfo->MBB);
   }
 
@@ -708,6 +840,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   MachineBasicBlock *FirstMBB = FuncInfo->MBB, *LastMBB;
   {
     NamedRegionTimer T("Instruction Creation", GroupName, TimePassesIsEnabled);
+    PhaseTimeRegion P(PhaseTimes[PhaseSchedule]);
 
     // FuncInfo->InsertPt is passed by reference and set to the end of the
     // scheduled instructions.
@@ -723,6 +856,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   {
     NamedRegionTimer T("Instruction Scheduling Cleanup", GroupName,
                        TimePassesIsEnabled);
+    PhaseTimeRegion P(PhaseTimes[PhaseSchedule]);
     delete Scheduler;
   }
 
@@ -988,6 +1122,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
         if (!FastIS->LowerArguments()) {
           // Fast isel failed to lower these arguments
           ++NumFastIselFailLowerArguments;
+          if (!FastISelReport.empty())
+            recordFastISelFallback("arguments", 0);
           if (EnableFastISelAbortArgs)
             llvm_unreachable("FastISel didn't lower all arguments");
 
@@ -1081,10 +1217,12 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
           // selection may have handled the call, input args, etc.
           unsigned RemainingNow = std::distance(Begin, BI);
           NumFastIselFailures += NumFastIselRemaining - RemainingNow;
+          recordFastISelFallback(Inst, 1);
           NumFastIselRemaining = RemainingNow;
           continue;
         }
 
+        recordFastISelFallback(Inst, NumFastIselRemaining);
         if (isa<TerminatorInst>(Inst) && !isa<BranchInst>(Inst)) {
           // Don't abort, and use a different message for terminator misses.
           NumFastIselFailures += NumFastIselRemaining;
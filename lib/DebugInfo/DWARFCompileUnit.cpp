@@ -233,15 +233,47 @@ void DWARFCompileUnit::clearDIEs(bool keep_compile_unit_die) {
   }
 }
 
+bool
+DWARFCompileUnit::appendCompileUnitRanges(DWARFDebugAranges *debug_aranges) {
+  const DWARFDebugInfoEntryMinimal *CUDie = getCompileUnitDIE();
+  if (CUDie == 0)
+    return false;
+
+  uint64_t LowPC, HighPC;
+  if (CUDie->getLowAndHighPC(this, LowPC, HighPC)) {
+    if (LowPC >= HighPC)
+      return false;
+    debug_aranges->appendRange(getOffset(), LowPC, HighPC);
+    return true;
+  }
+
+  uint32_t RangesOffset =
+    CUDie->getAttributeValueAsReference(this, DW_AT_ranges, -1U);
+  DWARFDebugRangeList RangeList;
+  if (RangesOffset == -1U || !extractRangeList(RangesOffset, RangeList))
+    return false;
+  std::vector<std::pair<uint64_t, uint64_t> > Ranges;
+  RangeList.getAbsoluteRanges(getBaseAddress(), Ranges);
+  for (size_t i = 0, e = Ranges.size(); i != e; ++i)
+    debug_aranges->appendRange(getOffset(), Ranges[i].first, Ranges[i].second);
+  return !Ranges.empty();
+}
+
 void
 DWARFCompileUnit::buildAddressRangeTable(DWARFDebugAranges *debug_aranges,
                                          bool clear_dies_if_already_not_parsed){
   // This function is usually called if there in no .debug_aranges section
   // in order to produce a compile unit level set of address ranges that
-  // is accurate. If the DIEs weren't parsed, then we don't want all dies for
-  // all compile units to stay loaded when they weren't needed. So we can end
-  // up parsing the DWARF and then throwing them all away to keep memory usage
-  // down.
+  // is accurate. Most compile unit DIEs describe the code of the whole unit
+  // with DW_AT_low_pc/DW_AT_high_pc or DW_AT_ranges, which only needs the
+  // compile unit DIE to be parsed.
+  if (appendCompileUnitRanges(debug_aranges))
+    return;
+
+  // Otherwise collect the ranges of all subprograms. If the DIEs weren't
+  // parsed, then we don't want all dies for all compile units to stay loaded
+  // when they weren't needed. So we can end up parsing the DWARF and then
+  // throwing them all away to keep memory usage down.
   const bool clear_dies = extractDIEsIfNeeded(false) > 1 &&
                           clear_dies_if_already_not_parsed;
   DieArray[0].buildAddressRangeTable(this, debug_aranges);
@@ -132,6 +132,11 @@ public:
   void buildAddressRangeTable(DWARFDebugAranges *debug_aranges,
                               bool clear_dies_if_already_not_parsed);
 
+  /// appendCompileUnitRanges - Appends the address ranges described by the
+  /// compile unit DIE to \p debug_aranges. Returns false if the compile unit
+  /// DIE does not describe any code.
+  bool appendCompileUnitRanges(DWARFDebugAranges *debug_aranges);
+
   /// getInlinedChainForAddress - fetches inlined chain for a given address.
   /// Returns empty chain if there is no subprogram containing address.
   DWARFDebugInfoEntryMinimal::InlinedChain getInlinedChainForAddress(
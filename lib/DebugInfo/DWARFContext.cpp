@@ -203,6 +203,27 @@ const DWARFDebugAranges *DWARFContext::getDebugAranges() {
   return Aranges.get();
 }
 
+bool DWARFContext::getAddressIndex(std::vector<DIAddressRange> &Ranges) {
+  const DWARFDebugAranges *Index = getDebugAranges();
+  Ranges.clear();
+  Ranges.reserve(Index->getNumRanges());
+  for (uint32_t i = 0, e = Index->getNumRanges(); i != e; ++i) {
+    const DWARFDebugAranges::Range *R = Index->rangeAtIndex(i);
+    DIAddressRange Range = { R->LoPC, R->HiPC(), R->Offset };
+    Ranges.push_back(Range);
+  }
+  return true;
+}
+
+bool DWARFContext::setAddressIndex(ArrayRef<DIAddressRange> Ranges) {
+  Aranges.reset(new DWARFDebugAranges());
+  for (unsigned i = 0, e = Ranges.size(); i != e; ++i)
+    Aranges->appendRange(Ranges[i].CUOffset, Ranges[i].LowPC,
+                         Ranges[i].HighPC);
+  Aranges->sort(false, 0);
+  return true;
+}
+
 const DWARFDebugFrame *DWARFContext::getDebugFrame() {
   if (DebugFrame)
     return DebugFrame.get();
@@ -104,6 +104,8 @@ public:
       uint64_t Size, DILineInfoSpecifier Specifier = DILineInfoSpecifier());
   virtual DIInliningInfo getInliningInfoForAddress(uint64_t Address,
       DILineInfoSpecifier Specifier = DILineInfoSpecifier());
+  virtual bool getAddressIndex(std::vector<DIAddressRange> &Ranges);
+  virtual bool setAddressIndex(ArrayRef<DIAddressRange> Ranges);
 
   virtual bool isLittleEndian() const = 0;
   virtual uint8_t getAddressSize() const = 0;
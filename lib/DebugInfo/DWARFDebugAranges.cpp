@@ -49,12 +49,10 @@ namespace {
         Range.LoPC = ArangeDescPtr->Address;
         Range.Length = ArangeDescPtr->Length;
 
-        // Insert each item in increasing address order so binary searching
-        // can later be done!
-        DWARFDebugAranges::RangeColl::iterator InsertPos =
-          std::lower_bound(RangeCollection.begin(), RangeCollection.end(),
-                           Range, RangeLessThan);
-        RangeCollection.insert(InsertPos, Range);
+        // Inserting each item in address order would be quadratic in the
+        // number of descriptors; the collection is sorted once in generate()
+        // instead.
+        RangeCollection.push_back(Range);
       }
 
     }
@@ -11,6 +11,7 @@
 #define LLVM_DEBUGINFO_DWARFDEBUGRANGELIST_H
 
 #include "llvm/Support/DataExtractor.h"
+#include <utility>
 #include <vector>
 
 namespace llvm {
@@ -71,6 +72,12 @@ public:
   /// address. Has to be passed base address of the compile unit that
   /// references this range list.
   bool containsAddress(uint64_t BaseAddress, uint64_t Address) const;
+  /// getAbsoluteRanges - Appends the [begin, end) address pairs covered by
+  /// the range list to \p Ranges. Has to be passed base address of the
+  /// compile unit that references this range list.
+  void getAbsoluteRanges(uint64_t BaseAddress,
+                         std::vector<std::pair<uint64_t, uint64_t> > &Ranges)
+                         const;
 };
 
 }  // namespace llvm
@@ -32,6 +32,7 @@
 #include "llvm/Support/ValueHandle.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 using namespace llvm;
@@ -130,6 +131,15 @@ bool ExecutionEngine::removeModule(Module *M) {
   return false;
 }
 
+bool ExecutionEngine::unloadModule(Module *M) {
+  if (std::find(Modules.begin(), Modules.end(), M) == Modules.end())
+    return false;
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (!I->isDeclaration())
+      freeMachineCodeForFunction(I);
+  return removeModule(M);
+}
+
 Function *ExecutionEngine::FindFunctionNamed(const char *FnName) {
   for (unsigned i = 0, e = Modules.size(); i != e; ++i) {
     if (Function *F = Modules[i]->getFunction(FnName))
@@ -0,0 +1,257 @@
+//===-- FileObjectCache.cpp - Disk backed object cache for MCJIT ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the disk backed ObjectCache used by MCJIT clients that
+// want compiled objects to survive the process.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "object-cache"
+#include "llvm/ExecutionEngine/FileObjectCache.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Config/config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+
+/// Entry - What the cache knows about one module handed to it by MCJIT.
+struct FileObjectCache::Entry {
+  /// Path of the cached object for the module.
+  std::string Path;
+
+  /// The lock on Path, held from a miss until the object is stored so other
+  /// processes wait for it instead of compiling the module too.
+  OwningPtr<LockFileManager> Lock;
+};
+
+FileObjectCache::FileObjectCache(StringRef Dir, StringRef Key, uint64_t Size)
+  : CacheDir(Dir), TargetKey(Key), MaxSize(Size), NumHits(0), NumMisses(0) {
+  if (error_code EC = sys::fs::create_directories(CacheDir))
+    DEBUG(dbgs() << "Cannot create object cache directory '" << CacheDir
+                 << "': " << EC.message() << "\n");
+}
+
+FileObjectCache::~FileObjectCache() {
+  DeleteContainerSeconds(Entries);
+}
+
+std::string FileObjectCache::getTargetKey(const TargetMachine &TM) {
+  const TargetOptions &Options = TM.Options;
+  std::string Key;
+  raw_string_ostream OS(Key);
+  OS << PACKAGE_VERSION << ';' << TM.getTargetTriple() << ';'
+     << TM.getTargetCPU() << ';' << TM.getTargetFeatureString() << ';'
+     << TM.getRelocationModel() << ';' << TM.getCodeModel() << ';'
+     << TM.getOptLevel() << ';' << Options.FloatABIType << ';'
+     << Options.AllowFPOpFusion << ';' << Options.UseSoftFloat
+     << Options.NoFramePointerElim << Options.NoFramePointerElimNonLeaf
+     << Options.LessPreciseFPMADOption << Options.UnsafeFPMath
+     << Options.NoInfsFPMath << Options.NoNaNsFPMath
+     << Options.HonorSignDependentRoundingFPMathOption
+     << Options.NoZerosInBSS << Options.JITEmitDebugInfo
+     << Options.GuaranteedTailCallOpt << Options.DisableTailCalls
+     << Options.RealignStack << Options.EnableFastISel
+     << Options.EnableLinearScanRegAlloc
+     << Options.PositionIndependentExecutable
+     << Options.EnableSegmentedStacks << Options.UseInitArray << ';'
+     << Options.StackAlignmentOverride << ';' << Options.SSPBufferSize << ';'
+     << Options.TrapFuncName;
+  return OS.str();
+}
+
+FileObjectCache::Entry &FileObjectCache::createEntry(const Module *M) {
+  Entry *&E = Entries[M];
+  delete E;
+  E = new Entry();
+
+  SmallString<0> Bitcode;
+  raw_svector_ostream OS(Bitcode);
+  WriteBitcodeToFile(M, OS);
+  OS.flush();
+
+  MD5 Hash;
+  Hash.update(Bitcode);
+  Hash.update(TargetKey);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Name;
+  MD5::stringifyResult(Result, Name);
+  Name += ".o";
+
+  SmallString<128> Path(CacheDir);
+  sys::path::append(Path, Name.str());
+  E->Path = Path.str();
+  return *E;
+}
+
+/// loadObject - Map the object at \p Path and mark it as recently used.
+/// Returns false if there is no such object.
+static bool loadObject(StringRef Path, OwningPtr<MemoryBuffer> &Result) {
+  if (MemoryBuffer::getFile(Path, Result, -1,
+                            /*RequiresNullTerminator=*/false))
+    return false;
+
+  // Eviction goes by modification time, so bump it on every hit.  Failing to
+  // do so only makes the object look older than it is.
+  sys::fs::setLastModificationAndAccessTime(Path, sys::TimeValue::now());
+  return true;
+}
+
+void FileObjectCache::eraseEntry(const Module *M) {
+  DenseMap<const Module *, Entry *>::iterator I = Entries.find(M);
+  if (I == Entries.end())
+    return;
+  delete I->second;
+  Entries.erase(I);
+}
+
+const MemoryBuffer *FileObjectCache::getObject(const Module *M) {
+  // MCJIT looks a module up once, right before compiling it.  An entry that is
+  // still around was left by a module that missed and was never stored, and M
+  // may be a new module at the freed module's address, so start over.
+  Entry &E = createEntry(M);
+  if (loadObject(E.Path, LastObject)) {
+    eraseEntry(M);
+    ++NumHits;
+    return LastObject.get();
+  }
+
+  // Nothing cached yet.  Take the lock for the object so that other processes
+  // wanting the same module wait for us to store it.
+  while (!E.Lock) {
+    OwningPtr<LockFileManager> Lock(new LockFileManager(E.Path));
+    switch (Lock->getState()) {
+    case LockFileManager::LFS_Error:
+      // Compile the module without holding the lock.
+      ++NumMisses;
+      return 0;
+
+    case LockFileManager::LFS_Owned:
+      E.Lock.swap(Lock);
+      break;
+
+    case LockFileManager::LFS_Shared:
+      Lock->waitForUnlock();
+      break;
+    }
+
+    // Whoever held the lock before us may have stored the object by now.
+    if (loadObject(E.Path, LastObject)) {
+      eraseEntry(M);
+      ++NumHits;
+      return LastObject.get();
+    }
+  }
+
+  ++NumMisses;
+  return 0;
+}
+
+void FileObjectCache::notifyObjectCompiled(const Module *M,
+                                           const MemoryBuffer *Obj) {
+  // The module was hashed when it was looked up, before MCJIT changed it by
+  // compiling it.  Only hash it now if the client skipped the lookup.
+  DenseMap<const Module *, Entry *>::iterator I = Entries.find(M);
+  Entry &E = I != Entries.end() ? *I->second : createEntry(M);
+
+  // Write the object to a temporary file and rename it into place, so readers
+  // never see a partially written object.
+  int FD;
+  SmallString<128> TempPath;
+  if (error_code EC = sys::fs::unique_file(E.Path + ".%%%%%%%%.tmp", FD,
+                                           TempPath)) {
+    DEBUG(dbgs() << "Cannot create temporary object file for '" << E.Path
+                 << "': " << EC.message() << "\n");
+    eraseEntry(M);
+    return;
+  }
+
+  bool Failed;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Obj->getBuffer();
+    OS.close();
+    Failed = OS.has_error();
+    if (Failed)
+      OS.clear_error();
+  }
+
+  if (Failed || sys::fs::rename(TempPath.str(), E.Path)) {
+    DEBUG(dbgs() << "Cannot store object file '" << E.Path << "'\n");
+    sys::fs::remove(TempPath.str());
+  }
+
+  // Dropping the entry releases the lock.
+  eraseEntry(M);
+  prune();
+}
+
+namespace {
+/// CachedObject - An object file in the cache directory, for pruning.
+struct CachedObject {
+  sys::TimeValue LastUsed;
+  uint64_t Size;
+  std::string Path;
+
+  bool operator<(const CachedObject &RHS) const {
+    return LastUsed < RHS.LastUsed;
+  }
+};
+}
+
+void FileObjectCache::prune() {
+  if (MaxSize == 0)
+    return;
+
+  std::vector<CachedObject> Objects;
+  uint64_t TotalSize = 0;
+  error_code EC;
+  for (sys::fs::directory_iterator I(CacheDir, EC), E; !EC && I != E;
+       I.increment(EC)) {
+    // Skip lock files and objects that are still being written.
+    if (sys::path::extension(I->path()) != ".o")
+      continue;
+    sys::fs::file_status Status;
+    CachedObject Object;
+    if (I->status(Status) || !sys::fs::is_regular_file(Status) ||
+        sys::fs::file_size(I->path(), Object.Size))
+      continue;
+
+    Object.LastUsed = Status.getLastModificationTime();
+    Object.Path = I->path();
+    TotalSize += Object.Size;
+    Objects.push_back(Object);
+  }
+
+  if (TotalSize <= MaxSize)
+    return;
+
+  // Another process may be pruning at the same time, so objects that have
+  // already disappeared are not an error.  Processes that have the object
+  // mapped keep their mapping.
+  std::sort(Objects.begin(), Objects.end());
+  for (unsigned i = 0, e = Objects.size(); i != e && TotalSize > MaxSize; ++i) {
+    DEBUG(dbgs() << "Evicting '" << Objects[i].Path << "' from object cache\n");
+    sys::fs::remove(Objects[i].Path);
+    TotalSize -= Objects[i].Size;
+  }
+}
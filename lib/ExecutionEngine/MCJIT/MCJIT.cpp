@@ -8,6 +8,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "MCJIT.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITMemoryManager.h"
@@ -18,11 +21,18 @@
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
 #include "llvm/MC/MCAsmInfo.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
 
@@ -54,14 +64,55 @@ ExecutionEngine *MCJIT::createJIT(Module *M,
 MCJIT::MCJIT(Module *m, TargetMachine *tm, RTDyldMemoryManager *MM,
              bool AllocateGVsWithCode)
   : ExecutionEngine(m), TM(tm), Ctx(0), MemMgr(MM), Dyld(MM),
-    IsLoaded(false), M(m), ObjCache(0) {
+    HasUnfinalizedObjects(false), ObjCache(0), HotCallThreshold(0),
+    TierUpTM(0), TierUpThread(0), TierUpRunning(false), ShuttingDown(false) {
 
   setDataLayout(TM->getDataLayout());
+  PendingModules.insert(m);
+  registerModuleSymbols(m, true);
 }
 
+/// TieredModule - The bitcode of an instrumented module, as it was before
+/// the instrumentation was added.
+struct MCJIT::TieredModule {
+  std::string Bitcode;
+};
+
+/// TieredFunction - An instrumented function.
+struct MCJIT::TieredFunction {
+  TieredModule *Module;
+
+  /// Name - The name of the function in the IR.
+  std::string Name;
+
+  /// SlotName - The name of the global holding the address of the optimized
+  /// function, or null while there is none.
+  std::string SlotName;
+
+  /// Hot - Whether the function was queued for recompilation.
+  bool Hot;
+};
+
 MCJIT::~MCJIT() {
-  if (LoadedObject)
-    NotifyFreeingObject(*LoadedObject.get());
+  // Let the background thread finish what it is compiling, but not load it.
+  llvm_thread *Thread;
+  {
+    MutexGuard locked(lock);
+    ShuttingDown = true;
+    Thread = TierUpThread;
+    TierUpThread = 0;
+  }
+  if (Thread)
+    llvm_join_thread(Thread);
+  DeleteContainerPointers(TieredFunctions);
+  DeleteContainerPointers(TieredModules);
+  delete TierUpTM;
+
+  for (unsigned i = 0, e = LoadedObjects.size(); i != e; ++i) {
+    NotifyFreeingObject(*LoadedObjects[i]);
+    delete LoadedObjects[i];
+  }
+  DeleteContainerPointers(StubModules);
   delete MemMgr;
   delete TM;
 }
@@ -70,20 +121,75 @@ void MCJIT::setObjectCache(ObjectCache* NewCache) {
   ObjCache = NewCache;
 }
 
-ObjectBufferStream* MCJIT::emitObject(Module *m) {
-  /// Currently, MCJIT only supports a single module and the module passed to
-  /// this function call is expected to be the contained module.  The module
-  /// is passed as a parameter here to prepare for multiple module support in
-  /// the future.
-  assert(M == m);
+void MCJIT::addModule(Module *M) {
+  MutexGuard locked(lock);
+  Modules.push_back(M);
+  PendingModules.insert(M);
+  registerModuleSymbols(M, true);
+}
 
-  // Get a thread lock to make sure we aren't trying to compile multiple times
+bool MCJIT::removeModule(Module *M) {
   MutexGuard locked(lock);
+  if (PendingModules.erase(M))
+    registerModuleSymbols(M, false);
+  return ExecutionEngine::removeModule(M);
+}
 
-  // FIXME: Track compilation state on a per-module basis when multiple modules
-  //        are supported.
-  // Re-compilation is not supported
-  assert(!IsLoaded);
+bool MCJIT::unloadModule(Module *M) {
+  MutexGuard locked(lock);
+  DenseMap<Module*, ObjectImage*>::iterator I = ModuleObjects.find(M);
+  if (I != ModuleObjects.end()) {
+    ObjectImage *Obj = I->second;
+    ModuleObjects.erase(I);
+    NotifyFreeingObject(*Obj);
+    Dyld.unloadObject(Obj);
+    LoadedObjects.erase(std::find(LoadedObjects.begin(), LoadedObjects.end(),
+                                  Obj));
+    delete Obj;
+  }
+  return removeModule(M);
+}
+
+std::string MCJIT::getSymbolName(const GlobalValue *GV) {
+  return getSymbolName(GV->getName());
+}
+
+std::string MCJIT::getSymbolName(StringRef BaseName) {
+  // FIXME: Should we be using the mangler for this? Probably.
+  if (!BaseName.empty() && BaseName[0] == '\1')
+    return BaseName.substr(1);
+  return (TM->getMCAsmInfo()->getGlobalPrefix() + BaseName).str();
+}
+
+void MCJIT::registerModuleSymbols(Module *M, bool Pending) {
+  SmallVector<GlobalValue*, 32> Defs;
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (!I->isDeclaration() && !I->hasLocalLinkage())
+      Defs.push_back(I);
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I)
+    if (!I->isDeclaration() && !I->hasLocalLinkage())
+      Defs.push_back(I);
+  for (Module::alias_iterator I = M->alias_begin(), E = M->alias_end();
+       I != E; ++I)
+    if (!I->hasLocalLinkage())
+      Defs.push_back(I);
+
+  for (unsigned i = 0, e = Defs.size(); i != e; ++i) {
+    std::string Name = getSymbolName(Defs[i]);
+    if (Pending) {
+      PendingSymbols[Name] = M;
+      continue;
+    }
+    StringMap<Module*>::iterator I = PendingSymbols.find(Name);
+    if (I != PendingSymbols.end() && I->second == M)
+      PendingSymbols.erase(I);
+  }
+}
+
+ObjectBufferStream* MCJIT::emitObject(Module *m, bool UseCache) {
+  // Get a thread lock to make sure we aren't trying to compile multiple times
+  MutexGuard locked(lock);
 
   PassManager PM;
 
@@ -105,7 +211,7 @@ ObjectBufferStream* MCJIT::emitObject(Module *m) {
 
   // If we have an object cache, tell it about the new object.
   // Note that we're using the compiled image, not the loaded image (as below).
-  if (ObjCache) {
+  if (ObjCache && UseCache) {
     // MemoryBuffer is a thin wrapper around the actual memory, so it's OK
     // to create a temporary object here and delete it after the call.
     OwningPtr<MemoryBuffer> MB(CompiledObject->getMemBuffer());
@@ -115,20 +221,24 @@ ObjectBufferStream* MCJIT::emitObject(Module *m) {
   return CompiledObject.take();
 }
 
-void MCJIT::loadObject(Module *M) {
-
+void MCJIT::generateCodeForModule(Module *M) {
   // Get a thread lock to make sure we aren't trying to load multiple times
   MutexGuard locked(lock);
 
-  // FIXME: Track compilation state on a per-module basis when multiple modules
-  //        are supported.
   // Re-compilation is not supported
-  if (IsLoaded)
+  if (!PendingModules.erase(M))
     return;
+  registerModuleSymbols(M, false);
+
+  // Instrumented code embeds addresses of this process, so it must not be
+  // cached.
+  bool Tiered = HotCallThreshold != 0;
+  if (Tiered)
+    instrumentForTierUp(M);
 
   OwningPtr<ObjectBuffer> ObjectToLoad;
   // Try to load the pre-compiled object from cache if possible
-  if (0 != ObjCache) {
+  if (0 != ObjCache && !Tiered) {
     OwningPtr<MemoryBuffer> PreCompiledObject(ObjCache->getObjectCopy(M));
     if (0 != PreCompiledObject.get())
       ObjectToLoad.reset(new ObjectBuffer(PreCompiledObject.take()));
@@ -136,51 +246,522 @@ void MCJIT::loadObject(Module *M) {
 
   // If the cache did not contain a suitable object, compile the object
   if (!ObjectToLoad) {
-    ObjectToLoad.reset(emitObject(M));
+    ObjectToLoad.reset(emitObject(M, !Tiered));
     assert(ObjectToLoad.get() && "Compilation did not produce an object.");
   }
 
   // Load the object into the dynamic linker.
   // handing off ownership of the buffer
-  LoadedObject.reset(Dyld.loadObject(ObjectToLoad.take()));
+  ObjectImage *LoadedObject = Dyld.loadObject(ObjectToLoad.take());
   if (!LoadedObject)
     report_fatal_error(Dyld.getErrorString());
-
-  // Resolve any relocations.
-  Dyld.resolveRelocations();
+  LoadedObjects.push_back(LoadedObject);
+  if (!Tiered)
+    ModuleObjects[M] = LoadedObject;
+  HasUnfinalizedObjects = true;
 
   // FIXME: Make this optional, maybe even move it to a JIT event listener
   LoadedObject->registerWithDebugger();
 
   NotifyObjectEmitted(*LoadedObject);
 
-  // FIXME: Add support for per-module compilation state
-  IsLoaded = true;
+  // Find what the module uses from modules that have not been compiled yet.
+  SmallVector<GlobalValue*, 8> Uses;
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (I->isDeclaration() && !I->isIntrinsic() && !I->use_empty())
+      Uses.push_back(I);
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I)
+    if (I->isDeclaration() && !I->use_empty())
+      Uses.push_back(I);
+
+  // Calls can go through lazy stubs; anything else requires the module
+  // defining it to be compiled now.
+  SmallVector<Function*, 8> Callees;
+  for (unsigned i = 0, e = Uses.size(); i != e; ++i) {
+    std::string Name = getSymbolName(Uses[i]);
+    StringMap<Module*>::iterator I = PendingSymbols.find(Name);
+    if (I == PendingSymbols.end())
+      continue;
+    Function *F = dyn_cast<Function>(Uses[i]);
+    if (isCompilingLazily() && F && !F->isVarArg())
+      Callees.push_back(F);
+    else
+      generateCodeForModule(I->second);
+  }
+
+  // Compiling the dependencies may have compiled some of the callees too.
+  SmallVector<Function*, 8> StubbedCallees;
+  for (unsigned i = 0, e = Callees.size(); i != e; ++i) {
+    std::string Name = getSymbolName(Callees[i]);
+    if (PendingSymbols.count(Name) && !LazyStubs.count(Name))
+      StubbedCallees.push_back(Callees[i]);
+  }
+  if (!StubbedCallees.empty())
+    emitLazyStubs(StubbedCallees);
+}
+
+void MCJIT::emitLazyStubs(ArrayRef<Function*> Callees) {
+  // Every stub looks like
+  //
+  //   define <ty> @callee(<args>) {
+  //     %target = load atomic <ty>* @callee.lazy
+  //     if %target is null:
+  //       %target = resolveLazyStub(this, "callee")
+  //       store atomic %target, @callee.lazy
+  //     %r = tail call %target(<args>)
+  //     ret %r
+  //   }
+  //
+  // and defines the same symbol as the callee, so it is found by the objects
+  // loaded so far.  Objects loaded after the callee's module see the callee.
+  LLVMContext &Context = Callees[0]->getContext();
+  Module *StubM = new Module("<lazy stubs>", Context);
+  StubM->setTargetTriple(TM->getTargetTriple());
+  StubM->setDataLayout(TM->getDataLayout()->getStringRepresentation());
+  StubModules.push_back(StubM);
+
+  IntegerType *IntPtrTy = Type::getIntNTy(Context, sizeof(void*) * 8);
+  Type *I8PtrTy = Type::getInt8PtrTy(Context);
+  Type *ResolverParams[] = { I8PtrTy, I8PtrTy };
+  FunctionType *ResolverTy = FunctionType::get(I8PtrTy, ResolverParams, false);
+  Constant *Resolver = ConstantExpr::getIntToPtr(
+      ConstantInt::get(IntPtrTy, (uintptr_t)&MCJIT::resolveLazyStub),
+      ResolverTy->getPointerTo());
+  Constant *JIT = ConstantExpr::getIntToPtr(
+      ConstantInt::get(IntPtrTy, (uintptr_t)this), I8PtrTy);
+  unsigned PtrAlign = TM->getDataLayout()->getPointerABIAlignment();
+
+  SmallVector<std::string, 8> Names;
+  for (unsigned i = 0, e = Callees.size(); i != e; ++i) {
+    Function *Callee = Callees[i];
+    Names.push_back(getSymbolName(Callee));
+    StringMapEntry<uint64_t> &Stub = LazyStubs.GetOrCreateValue(Names.back());
+
+    FunctionType *FTy = Callee->getFunctionType();
+    PointerType *FPtrTy = FTy->getPointerTo();
+    GlobalVariable *Slot =
+      new GlobalVariable(*StubM, FPtrTy, false, GlobalValue::InternalLinkage,
+                         ConstantPointerNull::get(FPtrTy),
+                         Callee->getName() + ".lazy");
+    Function *StubF = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                       Callee->getName(), StubM);
+    StubF->setCallingConv(Callee->getCallingConv());
+    StubF->setAttributes(Callee->getAttributes());
+
+    BasicBlock *Entry = BasicBlock::Create(Context, "entry", StubF);
+    BasicBlock *Resolve = BasicBlock::Create(Context, "resolve", StubF);
+    BasicBlock *Call = BasicBlock::Create(Context, "call", StubF);
+
+    IRBuilder<> Builder(Entry);
+    LoadInst *Target = Builder.CreateLoad(Slot, "target");
+    Target->setAtomic(Acquire);
+    Target->setAlignment(PtrAlign);
+    Builder.CreateCondBr(Builder.CreateIsNull(Target), Resolve, Call);
+
+    Builder.SetInsertPoint(Resolve);
+    Value *Args[] = {
+      JIT,
+      ConstantExpr::getIntToPtr(
+        ConstantInt::get(IntPtrTy, (uintptr_t)Stub.getKeyData()), I8PtrTy)
+    };
+    Value *Resolved =
+      Builder.CreateBitCast(Builder.CreateCall(Resolver, Args), FPtrTy);
+    StoreInst *Store = Builder.CreateStore(Resolved, Slot);
+    Store->setAtomic(Release);
+    Store->setAlignment(PtrAlign);
+    Builder.CreateBr(Call);
+
+    Builder.SetInsertPoint(Call);
+    PHINode *Fn = Builder.CreatePHI(FPtrTy, 2);
+    Fn->addIncoming(Target, Entry);
+    Fn->addIncoming(Resolved, Resolve);
+    SmallVector<Value*, 8> Params;
+    for (Function::arg_iterator A = StubF->arg_begin(), AE = StubF->arg_end();
+         A != AE; ++A)
+      Params.push_back(A);
+    CallInst *CI = Builder.CreateCall(Fn, Params);
+    CI->setTailCall();
+    CI->setCallingConv(Callee->getCallingConv());
+    CI->setAttributes(Callee->getAttributes());
+    if (FTy->getReturnType()->isVoidTy())
+      Builder.CreateRetVoid();
+    else
+      Builder.CreateRet(CI);
+  }
+
+  // The stubs embed addresses of this process, so they must not be cached.
+  OwningPtr<ObjectBuffer> ObjectToLoad(emitObject(StubM, false));
+  ObjectImage *LoadedObject = Dyld.loadObject(ObjectToLoad.take());
+  if (!LoadedObject)
+    report_fatal_error(Dyld.getErrorString());
+  LoadedObjects.push_back(LoadedObject);
+  HasUnfinalizedObjects = true;
+  NotifyObjectEmitted(*LoadedObject);
+
+  for (unsigned i = 0, e = Names.size(); i != e; ++i)
+    LazyStubs[Names[i]] = Dyld.getSymbolLoadAddress(Names[i]);
 }
 
-// FIXME: Add a parameter to identify which object is being finalized when
-// MCJIT supports multiple modules.
-// FIXME: Provide a way to separate code emission, relocations and page 
+void *MCJIT::resolveLazyStub(MCJIT *JIT, const char *Name) {
+  MutexGuard locked(JIT->lock);
+
+  StringMap<Module*>::iterator I = JIT->PendingSymbols.find(Name);
+  if (I != JIT->PendingSymbols.end()) {
+    JIT->generateCodeForModule(I->second);
+    JIT->finalizeObject();
+  }
+
+  // Once the callee's module is loaded, the symbol refers to the callee
+  // rather than to the stub.
+  uint64_t Addr = JIT->Dyld.getSymbolLoadAddress(Name);
+  if (!Addr || Addr == JIT->LazyStubs.lookup(Name))
+    report_fatal_error(Twine("Program called function '") + Name +
+                       "' whose module was removed from the JIT!");
+  return (void*)Addr;
+}
+
+// FIXME: Provide a way to separate code emission, relocations and page
 // protection in the interface.
 void MCJIT::finalizeObject() {
-  // If the module hasn't been compiled, just do that.
-  if (!IsLoaded) {
-    // If the call to Dyld.resolveRelocations() is removed from loadObject()
-    // we'll need to do that here.
-    loadObject(M);
-  } else {
-    // Resolve any relocations.
-    Dyld.resolveRelocations();
-  }
+  MutexGuard locked(lock);
+
+  // Unless compiling lazily, everything added so far is compiled now.
+  if (!isCompilingLazily())
+    while (!PendingModules.empty())
+      generateCodeForModule(*PendingModules.begin());
+
+  finalizeLoadedObjects();
+}
+
+void MCJIT::finalizeLoadedObjects() {
+  if (!HasUnfinalizedObjects)
+    return;
+  HasUnfinalizedObjects = false;
+
+  // Resolve any relocations.
+  Dyld.resolveRelocations();
 
-  StringRef EHData = Dyld.getEHFrameSection();
-  if (!EHData.empty())
-    MemMgr->registerEHFrames(EHData);
+  // Register the EH frames of the new objects.
+  Dyld.registerEHFrames();
 
   // Set page permissions.
   MemMgr->finalizeMemory();
 }
 
+void MCJIT::enableTieredCompilation(CodeGenOpt::Level OptLevel,
+                                    unsigned Threshold) {
+  MutexGuard locked(lock);
+  assert(Threshold != 0 && "A function must be called to get hot!");
+  assert(!TierUpTM && "Tiered compilation is already enabled!");
+  HotCallThreshold = Threshold;
+
+  // The background thread gets a TargetMachine of its own, since code
+  // generation may go on in the foreground at the same time.  Hot code is
+  // worth the greedy register allocator, whatever the first tier uses.
+  TargetOptions Options = TM->Options;
+  Options.EnableLinearScanRegAlloc = false;
+  TierUpTM = TM->getTarget().createTargetMachine(
+      TM->getTargetTriple(), TM->getTargetCPU(), TM->getTargetFeatureString(),
+      Options, TM->getRelocationModel(), TM->getCodeModel(), OptLevel);
+}
+
+void MCJIT::waitForTieredCompilation() {
+  for (;;) {
+    llvm_thread *Thread;
+    {
+      MutexGuard locked(lock);
+      if (!TierUpThread)
+        return;
+      Thread = TierUpThread;
+      TierUpThread = 0;
+    }
+    llvm_join_thread(Thread);
+  }
+}
+
+void MCJIT::instrumentForTierUp(Module *M) {
+  TieredModule *TMod = new TieredModule();
+  TieredModules.push_back(TMod);
+
+  // The optimized code is linked against the instrumented object, so local
+  // symbols need names that are unique to the engine and visible to it.
+  std::string Suffix = ".tier" + utostr(TieredModules.size());
+  SmallVector<GlobalValue*, 16> Locals;
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (I->hasLocalLinkage() && !I->isDeclaration())
+      Locals.push_back(I);
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I)
+    if (I->hasLocalLinkage() && !I->isDeclaration())
+      Locals.push_back(I);
+  for (Module::alias_iterator I = M->alias_begin(), E = M->alias_end();
+       I != E; ++I)
+    if (I->hasLocalLinkage())
+      Locals.push_back(I);
+  for (unsigned i = 0, e = Locals.size(); i != e; ++i) {
+    GlobalValue *GV = Locals[i];
+    GV->setName(GV->hasName() ? GV->getName() + Suffix : "__tier" + Suffix);
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+    GV->setVisibility(GlobalValue::HiddenVisibility);
+  }
+
+  {
+    raw_string_ostream OS(TMod->Bitcode);
+    WriteBitcodeToFile(M, OS);
+  }
+
+  // Every function gets a new entry block along the lines of
+  //
+  //   %target = load atomic <ty>* @f.tier.slot
+  //   if %target is not null:
+  //     %r = tail call %target(<args>)
+  //     ret %r
+  //   if atomicrmw add @f.tier.count, 1 == HotCallThreshold - 1:
+  //     requestTierUp(this, <TieredFunction for f>)
+  //   br %original.entry
+  //
+  // Static allocas move to the new entry block so they stay static.
+  LLVMContext &Context = M->getContext();
+  IntegerType *IntPtrTy = Type::getIntNTy(Context, sizeof(void*) * 8);
+  IntegerType *I32Ty = Type::getInt32Ty(Context);
+  Type *I8PtrTy = Type::getInt8PtrTy(Context);
+  Type *HookParams[] = { I8PtrTy, I8PtrTy };
+  FunctionType *HookTy =
+    FunctionType::get(Type::getVoidTy(Context), HookParams, false);
+  Constant *Hook = ConstantExpr::getIntToPtr(
+      ConstantInt::get(IntPtrTy, (uintptr_t)&MCJIT::requestTierUp),
+      HookTy->getPointerTo());
+  Constant *JIT = ConstantExpr::getIntToPtr(
+      ConstantInt::get(IntPtrTy, (uintptr_t)this), I8PtrTy);
+  unsigned PtrAlign = TM->getDataLayout()->getPointerABIAlignment();
+
+  SmallVector<Function*, 16> Functions;
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (!I->isDeclaration() && !I->isVarArg() && I->hasName() &&
+        !I->hasAvailableExternallyLinkage() &&
+        !I->getAttributes().hasAttribute(AttributeSet::FunctionIndex,
+                                         Attribute::Naked))
+      Functions.push_back(I);
+
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i) {
+    Function *F = Functions[i];
+    PointerType *FPtrTy = F->getType();
+    GlobalVariable *Slot =
+      new GlobalVariable(*M, FPtrTy, false, GlobalValue::ExternalLinkage,
+                         ConstantPointerNull::get(FPtrTy),
+                         F->getName() + ".tier.slot");
+    Slot->setVisibility(GlobalValue::HiddenVisibility);
+    GlobalVariable *Counter =
+      new GlobalVariable(*M, I32Ty, false, GlobalValue::InternalLinkage,
+                         ConstantInt::get(I32Ty, 0),
+                         F->getName() + ".tier.count");
+
+    TieredFunction *TF = new TieredFunction();
+    TF->Module = TMod;
+    TF->Name = F->getName();
+    TF->SlotName = Slot->getName();
+    TF->Hot = false;
+    TieredFunctions.push_back(TF);
+
+    BasicBlock *OldEntry = &F->getEntryBlock();
+    BasicBlock *Entry = BasicBlock::Create(Context, "tier.entry", F, OldEntry);
+    BasicBlock *Forward =
+      BasicBlock::Create(Context, "tier.forward", F, OldEntry);
+    BasicBlock *Count = BasicBlock::Create(Context, "tier.count", F, OldEntry);
+    BasicBlock *Promote =
+      BasicBlock::Create(Context, "tier.promote", F, OldEntry);
+
+    IRBuilder<> Builder(Entry);
+    LoadInst *Target = Builder.CreateLoad(Slot, "tier.target");
+    Target->setAtomic(Acquire);
+    Target->setAlignment(PtrAlign);
+    Builder.CreateCondBr(Builder.CreateIsNull(Target), Count, Forward);
+
+    Builder.SetInsertPoint(Forward);
+    SmallVector<Value*, 8> Params;
+    for (Function::arg_iterator A = F->arg_begin(), AE = F->arg_end();
+         A != AE; ++A)
+      Params.push_back(A);
+    CallInst *CI = Builder.CreateCall(Target, Params);
+    CI->setTailCall();
+    CI->setCallingConv(F->getCallingConv());
+    CI->setAttributes(F->getAttributes());
+    if (F->getReturnType()->isVoidTy())
+      Builder.CreateRetVoid();
+    else
+      Builder.CreateRet(CI);
+
+    Builder.SetInsertPoint(Count);
+    Value *Calls = Builder.CreateAtomicRMW(AtomicRMWInst::Add, Counter,
+                                           Builder.getInt32(1), Monotonic);
+    Value *IsHot =
+      Builder.CreateICmpEQ(Calls, Builder.getInt32(HotCallThreshold - 1));
+    Builder.CreateCondBr(IsHot, Promote, OldEntry);
+
+    Builder.SetInsertPoint(Promote);
+    Builder.CreateCall2(Hook, JIT, ConstantExpr::getIntToPtr(
+        ConstantInt::get(IntPtrTy, (uintptr_t)TF), I8PtrTy));
+    Builder.CreateBr(OldEntry);
+
+    for (BasicBlock::iterator I = OldEntry->begin(), E = OldEntry->end();
+         I != E;) {
+      AllocaInst *AI = dyn_cast<AllocaInst>(I++);
+      if (AI && isa<Constant>(AI->getArraySize()))
+        AI->moveBefore(Target);
+    }
+  }
+}
+
+void MCJIT::requestTierUp(MCJIT *JIT, TieredFunction *TF) {
+  MutexGuard locked(JIT->lock);
+  if (TF->Hot || JIT->ShuttingDown)
+    return;
+  TF->Hot = true;
+  JIT->HotFunctions.push_back(TF);
+  if (JIT->TierUpRunning)
+    return;
+
+  // The previous thread, if any, has stopped taking work and is exiting.
+  if (JIT->TierUpThread)
+    llvm_join_thread(JIT->TierUpThread);
+  JIT->TierUpRunning = true;
+  JIT->TierUpThread = llvm_start_thread(runTierUp, JIT);
+}
+
+void MCJIT::runTierUp(void *Arg) {
+  MCJIT *JIT = static_cast<MCJIT*>(Arg);
+  for (;;) {
+    SmallVector<TieredFunction*, 8> Hot;
+    const TieredModule *TMod;
+    {
+      MutexGuard locked(JIT->lock);
+      if (JIT->HotFunctions.empty() || JIT->ShuttingDown) {
+        JIT->TierUpRunning = false;
+        return;
+      }
+
+      // Take every hot function of the module that got hot first.
+      TMod = JIT->HotFunctions.front()->Module;
+      std::vector<TieredFunction*> Rest;
+      for (unsigned i = 0, e = JIT->HotFunctions.size(); i != e; ++i) {
+        TieredFunction *TF = JIT->HotFunctions[i];
+        if (TF->Module == TMod)
+          Hot.push_back(TF);
+        else
+          Rest.push_back(TF);
+      }
+      JIT->HotFunctions.swap(Rest);
+    }
+
+    OwningPtr<ObjectBuffer> Obj(JIT->emitTierUpObject(*TMod, Hot));
+
+    MutexGuard locked(JIT->lock);
+    if (!JIT->ShuttingDown)
+      JIT->loadTierUpObject(Obj.take(), Hot);
+  }
+}
+
+ObjectBuffer *MCJIT::emitTierUpObject(const TieredModule &TMod,
+                                      ArrayRef<TieredFunction*> Hot) {
+  LLVMContext Context;
+  // The buffer name becomes the module identifier, which ends up as the
+  // file symbol of the object and so must not be empty.
+  OwningPtr<MemoryBuffer> Buffer(
+      MemoryBuffer::getMemBuffer(TMod.Bitcode, "<tier-up>", false));
+  std::string ErrMsg;
+  OwningPtr<Module> M(ParseBitcodeFile(Buffer.get(), Context, &ErrMsg));
+  if (!M)
+    report_fatal_error("Cannot reload module for tiered compilation: " +
+                       ErrMsg);
+
+  // Keep the bodies of the hot functions, renamed so they do not clash with
+  // the instrumented ones.  Everything else refers to the instrumented
+  // object, so calls to functions that are not hot go to their instrumented
+  // version and may still make them hot.
+  StringMap<bool> IsHot;
+  for (unsigned i = 0, e = Hot.size(); i != e; ++i)
+    IsHot[Hot[i]->Name] = true;
+
+  SmallVector<GlobalAlias*, 4> Aliases;
+  for (Module::alias_iterator I = M->alias_begin(), E = M->alias_end();
+       I != E; ++I)
+    Aliases.push_back(I);
+  for (unsigned i = 0, e = Aliases.size(); i != e; ++i) {
+    GlobalAlias *GA = Aliases[i];
+    PointerType *Ty = GA->getType();
+    GlobalValue *Decl;
+    if (FunctionType *FTy = dyn_cast<FunctionType>(Ty->getElementType()))
+      Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, "", M.get());
+    else
+      Decl = new GlobalVariable(*M, Ty->getElementType(), false,
+                                GlobalValue::ExternalLinkage, 0, "", 0,
+                                GlobalVariable::NotThreadLocal,
+                                Ty->getAddressSpace());
+    GA->replaceAllUsesWith(ConstantExpr::getBitCast(Decl, Ty));
+    Decl->takeName(GA);
+    GA->eraseFromParent();
+  }
+
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I) {
+    if (I->isDeclaration())
+      continue;
+    if (IsHot.count(I->getName())) {
+      I->setName(I->getName() + ".tier.opt");
+      I->setLinkage(GlobalValue::ExternalLinkage);
+    } else {
+      I->deleteBody();
+    }
+  }
+
+  SmallVector<GlobalVariable*, 4> Appending;
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I) {
+    if (I->hasAppendingLinkage()) {
+      Appending.push_back(I);
+    } else if (!I->isDeclaration()) {
+      I->setInitializer(0);
+      I->setLinkage(GlobalValue::ExternalLinkage);
+    }
+  }
+  for (unsigned i = 0, e = Appending.size(); i != e; ++i)
+    Appending[i]->eraseFromParent();
+
+  PassManager PM;
+  PM.add(new DataLayout(*TierUpTM->getDataLayout()));
+  OwningPtr<ObjectBufferStream> CompiledObject(new ObjectBufferStream());
+  MCContext *TierUpCtx;
+  if (TierUpTM->addPassesToEmitMC(PM, TierUpCtx, CompiledObject->getOStream(),
+                                  false))
+    report_fatal_error("Target does not support MC emission!");
+  PM.run(*M);
+  CompiledObject->flush();
+  return CompiledObject.take();
+}
+
+void MCJIT::loadTierUpObject(ObjectBuffer *Obj,
+                             ArrayRef<TieredFunction*> Hot) {
+  ObjectImage *LoadedObject = Dyld.loadObject(Obj);
+  if (!LoadedObject)
+    report_fatal_error(Dyld.getErrorString());
+  LoadedObjects.push_back(LoadedObject);
+  HasUnfinalizedObjects = true;
+  NotifyObjectEmitted(*LoadedObject);
+  finalizeLoadedObjects();
+
+  // The optimized code is ready to run, so publish it.  Calls that already
+  // passed the slot keep running the instrumented code.
+  for (unsigned i = 0, e = Hot.size(); i != e; ++i) {
+    uint64_t Addr = Dyld.getSymbolLoadAddress(
+        getSymbolName(Hot[i]->Name + ".tier.opt"));
+    void *volatile *Slot = reinterpret_cast<void *volatile *>(
+        Dyld.getSymbolAddress(getSymbolName(Hot[i]->SlotName)));
+    assert(Addr && Slot && "Optimized function went missing!");
+    sys::MemoryFence();
+    *Slot = (void*)Addr;
+  }
+}
+
 void *MCJIT::getPointerToBasicBlock(BasicBlock *BB) {
   report_fatal_error("not yet implemented");
 }
@@ -190,28 +771,39 @@ void *MCJIT::getPointerToFunction(Function *F) {
   // target address space, not our local address space. That's part of the
   // ExecutionEngine interface, though. Fix that when the old JIT finally
   // dies.
-
-  // FIXME: Add support for per-module compilation state
-  if (!IsLoaded)
-    loadObject(M);
+  MutexGuard locked(lock);
 
   if (F->isDeclaration() || F->hasAvailableExternallyLinkage()) {
+    // The function may be defined by another module of this engine.
+    std::string Name = getSymbolName(F);
+    StringMap<Module*>::iterator I = PendingSymbols.find(Name);
+    if (I != PendingSymbols.end())
+      generateCodeForModule(I->second);
+    if (uint64_t Addr = Dyld.getSymbolLoadAddress(Name)) {
+      if (isCompilingLazily())
+        finalizeObject();
+      return (void*)Addr;
+    }
+
     bool AbortOnFailure = !F->hasExternalWeakLinkage();
     void *Addr = getPointerToNamedFunction(F->getName(), AbortOnFailure);
     addGlobalMapping(F, Addr);
     return Addr;
   }
 
+  generateCodeForModule(F->getParent());
+
+  // When compiling lazily the function is expected to be callable right
+  // away.  Otherwise the client calls finalizeObject once everything it
+  // needs is compiled.
+  if (isCompilingLazily())
+    finalizeObject();
+
   // FIXME: Should the Dyld be retaining module information? Probably not.
-  // FIXME: Should we be using the mangler for this? Probably.
   //
   // This is the accessor for the target address, so make sure to check the
   // load address of the symbol, not the local address.
-  StringRef BaseName = F->getName();
-  if (BaseName[0] == '\1')
-    return (void*)Dyld.getSymbolLoadAddress(BaseName.substr(1));
-  return (void*)Dyld.getSymbolLoadAddress((TM->getMCAsmInfo()->getGlobalPrefix()
-                                       + BaseName).str());
+  return (void*)Dyld.getSymbolLoadAddress(getSymbolName(F));
 }
 
 void *MCJIT::recompileAndRelinkFunction(Function *F) {
@@ -324,10 +916,6 @@ GenericValue MCJIT::runFunction(Function *F,
 
 void *MCJIT::getPointerToNamedFunction(const std::string &Name,
                                        bool AbortOnFailure) {
-  // FIXME: Add support for per-module compilation state
-  if (!IsLoaded)
-    loadObject(M);
-
   if (!isSymbolSearchingDisabled() && MemMgr) {
     void *ptr = MemMgr->getPointerToNamedFunction(Name, false);
     if (ptr)
@@ -365,6 +953,7 @@ void MCJIT::UnregisterJITEventListener(JITEventListener *L) {
 }
 void MCJIT::NotifyObjectEmitted(const ObjectImage& Obj) {
   MutexGuard locked(lock);
+  MemMgr->notifyObjectLoaded(this, &Obj);
   for (unsigned I = 0, S = EventListeners.size(); I < S; ++I) {
     EventListeners[I]->NotifyObjectEmitted(Obj);
   }
@@ -374,4 +963,5 @@ void MCJIT::NotifyFreeingObject(const ObjectImage& Obj) {
   for (unsigned I = 0, S = EventListeners.size(); I < S; ++I) {
     EventListeners[I]->NotifyFreeingObject(Obj);
   }
+  MemMgr->notifyFreeingObject(&Obj);
 }
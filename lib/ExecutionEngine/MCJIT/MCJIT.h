@@ -10,20 +10,41 @@
 #ifndef LLVM_LIB_EXECUTIONENGINE_MCJIT_H
 #define LLVM_LIB_EXECUTIONENGINE_MCJIT_H
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 #include "llvm/PassManager.h"
+#include <vector>
 
 namespace llvm {
 
 class ObjectImage;
+struct llvm_thread;
 
 // FIXME: This makes all kinds of horrible assumptions for the time being,
-// like only having one module, not needing to worry about multi-threading,
-// blah blah. Purely in get-it-up-and-limping mode for now.
+// like not needing to worry about multi-threading, blah blah. Purely in
+// get-it-up-and-limping mode for now.
 
+/// MCJIT compiles every module added to it into an object of its own, which
+/// is loaded into a single RuntimeDyld so that symbols resolve across modules.
+/// A module is only compiled once something in it is needed: when a pointer
+/// to one of its functions is requested, when finalizeObject is called
+/// without lazy compilation, or when a module being compiled refers to it.
+///
+/// With lazy compilation enabled, a call from one module to a function of a
+/// module that has not been compiled yet goes through a stub instead.  The
+/// first call through the stub compiles the callee's module, after which the
+/// stub forwards to the compiled function.
+///
+/// With tiered compilation enabled, every function starts by counting its
+/// calls.  Functions that get hot are compiled again at a higher
+/// optimization level on a background thread, and their original entry
+/// forwards to the optimized code from then on.
 class MCJIT : public ExecutionEngine {
   MCJIT(Module *M, TargetMachine *tm, RTDyldMemoryManager *MemMgr,
         bool AllocateGVsWithCode);
@@ -34,15 +55,64 @@ class MCJIT : public ExecutionEngine {
   RuntimeDyld Dyld;
   SmallVector<JITEventListener*, 2> EventListeners;
 
-  // FIXME: Add support for multiple modules
-  bool IsLoaded;
-  Module *M;
-  OwningPtr<ObjectImage> LoadedObject;
+  /// PendingModules - Modules added to the engine that have not been
+  /// compiled yet.
+  SmallPtrSet<Module*, 4> PendingModules;
+
+  /// PendingSymbols - Maps the symbol name of every global defined by a
+  /// pending module to that module.
+  StringMap<Module*> PendingSymbols;
+
+  /// LoadedObjects - The objects loaded into Dyld, in load order.
+  SmallVector<ObjectImage*, 2> LoadedObjects;
+
+  /// ModuleObjects - Maps every compiled module to its object, unless the
+  /// module was instrumented for tiered compilation.
+  DenseMap<Module*, ObjectImage*> ModuleObjects;
+
+  /// StubModules - The modules holding the lazy compilation stubs.
+  SmallVector<Module*, 2> StubModules;
+
+  /// LazyStubs - Maps the symbol name of every function called through a lazy
+  /// stub to the address of the stub.
+  StringMap<uint64_t> LazyStubs;
+
+  /// HasUnfinalizedObjects - Whether objects were loaded since the last call
+  /// to finalizeObject.
+  bool HasUnfinalizedObjects;
 
   // An optional ObjectCache to be notified of compiled objects and used to
   // perform lookup of pre-compiled code to avoid re-compilation.
   ObjectCache *ObjCache;
 
+  struct TieredModule;
+  struct TieredFunction;
+
+  /// HotCallThreshold - The number of calls after which a function is
+  /// recompiled at TierUpTM's optimization level, or 0 if tiered compilation
+  /// is disabled.
+  unsigned HotCallThreshold;
+
+  /// TierUpTM - The TargetMachine used by the background thread.
+  TargetMachine *TierUpTM;
+
+  /// TieredModules, TieredFunctions - Everything instrumented so far.
+  std::vector<TieredModule*> TieredModules;
+  std::vector<TieredFunction*> TieredFunctions;
+
+  /// HotFunctions - Functions waiting to be recompiled.
+  std::vector<TieredFunction*> HotFunctions;
+
+  /// TierUpThread - The background thread, if one was started.
+  llvm_thread *TierUpThread;
+
+  /// TierUpRunning - Whether the background thread is still taking work.
+  bool TierUpRunning;
+
+  /// ShuttingDown - Set by the destructor to make the background thread
+  /// drop its work.
+  bool ShuttingDown;
+
 public:
   ~MCJIT();
 
@@ -83,6 +153,20 @@ public:
   virtual void *getPointerToNamedFunction(const std::string &Name,
                                           bool AbortOnFailure = true);
 
+  /// addModule - Add a module whose functions can be called and whose
+  /// globals can be referred to by the other modules of this engine.  The
+  /// module is not compiled until one of its functions is needed.
+  virtual void addModule(Module *M);
+
+  /// removeModule - Remove a module from the engine.  Code that was already
+  /// generated for the module stays loaded.
+  virtual bool removeModule(Module *M);
+
+  /// unloadModule - Remove a module from the engine and free its object.
+  /// The code of a module instrumented for tiered compilation stays loaded,
+  /// as the background thread may still be optimizing it.
+  virtual bool unloadModule(Module *M);
+
   /// mapSectionAddress - map a section to its target address space value.
   /// Map the address of a JIT section as returned from the memory manager
   /// to the address in the target process as the running code will see it.
@@ -95,6 +179,11 @@ public:
   virtual void RegisterJITEventListener(JITEventListener *L);
   virtual void UnregisterJITEventListener(JITEventListener *L);
 
+  virtual void enableTieredCompilation(CodeGenOpt::Level OptLevel,
+                                       unsigned HotCallThreshold);
+
+  virtual void waitForTieredCompilation();
+
   /// @}
   /// @name (Private) Registration Interfaces
   /// @{
@@ -112,14 +201,65 @@ public:
   // @}
 
 protected:
-  /// emitObject -- Generate a JITed object in memory from the specified module
-  /// Currently, MCJIT only supports a single module and the module passed to
-  /// this function call is expected to be the contained module.  The module
-  /// is passed as a parameter here to prepare for multiple module support in 
-  /// the future.
-  ObjectBufferStream* emitObject(Module *M);
-
-  void loadObject(Module *M);
+  /// emitObject -- Generate a JITed object in memory from the specified module.
+  /// If \p UseCache is true the object cache, if any, is told about the new
+  /// object.
+  ObjectBufferStream* emitObject(Module *M, bool UseCache = true);
+
+  /// generateCodeForModule - Compile \p M, or fetch it from the object
+  /// cache, and load the object, unless that was done already.  Whatever the
+  /// module refers to in other pending modules is compiled too, or reached
+  /// through lazy stubs when compiling lazily.  Relocations are not resolved
+  /// until finalizeObject is called.
+  void generateCodeForModule(Module *M);
+
+  /// getSymbolName - Return the name \p GV has in the generated objects.
+  std::string getSymbolName(const GlobalValue *GV);
+
+  /// getSymbolName - Return the name a global value called \p Name in the IR
+  /// has in the generated objects.
+  std::string getSymbolName(StringRef Name);
+
+  /// registerModuleSymbols - Record, or forget when \p Pending is false, the
+  /// globals defined by \p M in PendingSymbols.
+  void registerModuleSymbols(Module *M, bool Pending);
+
+  /// emitLazyStubs - Emit the lazy stubs calling the functions in \p Callees,
+  /// which are declarations matching functions of pending modules.
+  void emitLazyStubs(ArrayRef<Function*> Callees);
+
+  /// resolveLazyStub - Called by the lazy stub for the function with symbol
+  /// name \p Name the first time it is called.  Compiles and finalizes the
+  /// module defining the function and returns its address.
+  static void *resolveLazyStub(MCJIT *JIT, const char *Name);
+
+  /// finalizeLoadedObjects - Resolve the relocations of the objects loaded
+  /// since the last call, register their EH frames and make their memory
+  /// executable.
+  void finalizeLoadedObjects();
+
+  /// instrumentForTierUp - Prepare \p M, which is about to be compiled, for
+  /// tiered compilation: give its local symbols unique external names, keep
+  /// a copy of its bitcode, and make each function count its calls and
+  /// forward to its optimized version once there is one.
+  void instrumentForTierUp(Module *M);
+
+  /// requestTierUp - Called by the instrumented code of \p TF once it is hot.
+  /// Queues the function for the background thread.
+  static void requestTierUp(MCJIT *JIT, TieredFunction *TF);
+
+  /// runTierUp - The background thread: compiles queued functions, one
+  /// module at a time, until there are none left.
+  static void runTierUp(void *JIT);
+
+  /// emitTierUpObject - Compile the functions in \p Hot, which all belong to
+  /// \p TMod, with TierUpTM.  Only touches state private to the call.
+  ObjectBuffer *emitTierUpObject(const TieredModule &TMod,
+                                 ArrayRef<TieredFunction*> Hot);
+
+  /// loadTierUpObject - Load and finalize an object made by emitTierUpObject
+  /// and redirect the functions in \p Hot to it.
+  void loadTierUpObject(ObjectBuffer *Obj, ArrayRef<TieredFunction*> Hot);
 
   void NotifyObjectEmitted(const ObjectImage& Obj);
   void NotifyFreeingObject(const ObjectImage& Obj);
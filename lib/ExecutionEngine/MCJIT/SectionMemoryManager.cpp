@@ -15,9 +15,32 @@
 #include "llvm/Config/config.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
 
 namespace llvm {
 
+static uintptr_t blockStart(const sys::MemoryBlock &MB) {
+  return (uintptr_t)MB.base();
+}
+
+static uintptr_t blockEnd(const sys::MemoryBlock &MB) {
+  return (uintptr_t)MB.base() + MB.size();
+}
+
+static bool blockStartsBefore(const sys::MemoryBlock &MB, uintptr_t Addr) {
+  return blockStart(MB) < Addr;
+}
+
+SectionMemoryManager::SectionMemoryManager(uintptr_t Size)
+  : NumPermissionChanges(0) {
+  PageSize = sys::process::get_self()->page_size();
+  SlabSize = RoundUpToAlignment(Size ? Size : 1, PageSize);
+  CodeMem.Permissions = sys::Memory::MF_READ | sys::Memory::MF_EXEC;
+  RODataMem.Permissions = sys::Memory::MF_READ | sys::Memory::MF_EXEC;
+  RWDataMem.Permissions = 0;
+}
+
 uint8_t *SectionMemoryManager::allocateDataSection(uintptr_t Size,
                                                     unsigned Alignment,
                                                     unsigned SectionID,
@@ -41,62 +64,61 @@ uint8_t *SectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
 
   assert(!(Alignment & (Alignment - 1)) && "Alignment must be a power of two.");
 
-  uintptr_t RequiredSize = Alignment * ((Size + Alignment - 1)/Alignment + 1);
-  uintptr_t Addr = 0;
+  // Empty sections still get an address of their own, so that freeing them
+  // can tell them apart.
+  if (!Size)
+    Size = 1;
 
-  // Look in the list of free memory regions and use a block there if one
-  // is available.
-  for (int i = 0, e = MemGroup.FreeMem.size(); i != e; ++i) {
-    sys::MemoryBlock &MB = MemGroup.FreeMem[i];
-    if (MB.size() >= RequiredSize) {
-      Addr = (uintptr_t)MB.base();
-      uintptr_t EndOfBlock = Addr + MB.size();
-      // Align the address.
-      Addr = (Addr + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
-      // Store cutted free memory block.
-      MemGroup.FreeMem[i] = sys::MemoryBlock((void*)(Addr + Size),
-                                             EndOfBlock - Addr - Size);
-      return (uint8_t*)Addr;
+  // Look in the list of free memory regions and use the first one the
+  // aligned section fits in.
+  uintptr_t Addr = 0;
+  for (unsigned i = 0, e = MemGroup.FreeMem.size(); i != e; ++i) {
+    uintptr_t Start = blockStart(MemGroup.FreeMem[i]);
+    uintptr_t End = blockEnd(MemGroup.FreeMem[i]);
+    uintptr_t Aligned = (Start + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+    if (Aligned < End && End - Aligned >= Size) {
+      Addr = Aligned;
+      break;
     }
   }
 
-  // No pre-allocated free block was large enough. Allocate a new memory region.
-  // Note that all sections get allocated as read-write.  The permissions will
-  // be updated later based on memory group.
-  //
-  // FIXME: It would be useful to define a default allocation size (or add
-  // it as a constructor parameter) to minimize the number of allocations.
-  //
-  // FIXME: Initialize the Near member for each memory group to avoid
-  // interleaving.
-  error_code ec;
-  sys::MemoryBlock MB = sys::Memory::allocateMappedMemory(RequiredSize,
-                                                          &MemGroup.Near,
-                                                          sys::Memory::MF_READ |
-                                                            sys::Memory::MF_WRITE,
-                                                          ec);
-  if (ec) {
-    // FIXME: Add error propogation to the interface.
-    return NULL;
-  }
-
-  // Save this address as the basis for our next request
-  MemGroup.Near = MB;
-
-  MemGroup.AllocatedMem.push_back(MB);
-  Addr = (uintptr_t)MB.base();
-  uintptr_t EndOfBlock = Addr + MB.size();
+  // No free region was large enough.  Map a new slab, or a block of its own
+  // for sections that do not fit one.  Note that all sections get allocated
+  // as read-write.  The permissions will be updated later based on memory
+  // group.
+  if (!Addr) {
+    uintptr_t MapSize = std::max<uint64_t>(SlabSize,
+                                           RoundUpToAlignment(Size + Alignment,
+                                                              PageSize));
+    error_code ec;
+    sys::MemoryBlock MB = sys::Memory::allocateMappedMemory(MapSize,
+                                                            &MemGroup.Near,
+                                                            sys::Memory::MF_READ |
+                                                              sys::Memory::MF_WRITE,
+                                                            ec);
+    if (ec) {
+      // FIXME: Add error propogation to the interface.
+      return NULL;
+    }
 
-  // Align the address.
-  Addr = (Addr + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+    // Save this address as the basis for our next request
+    MemGroup.Near = MB;
+    MemGroup.AllocatedMem.push_back(MB);
+    addFreeMemory(MemGroup, blockStart(MB), blockEnd(MB));
+    Addr = (blockStart(MB) + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+  }
 
-  // The allocateMappedMemory may allocate much more memory than we need. In
-  // this case, we store the unused memory as a free memory block.
-  unsigned FreeSize = EndOfBlock-Addr-Size;
-  if (FreeSize > 16)
-    MemGroup.FreeMem.push_back(sys::MemoryBlock((void*)(Addr + Size), FreeSize));
+  removeFreeMemory(MemGroup, Addr, Addr + Size);
+  sys::MemoryBlock Block((void*)Addr, Size);
+  if (MemGroup.Permissions) {
+    MemGroup.PendingMem.push_back(Block);
+    for (uintptr_t Page = Addr & ~(PageSize - 1); Page < Addr + Size;
+         Page += PageSize)
+      ++MemGroup.Pages[Page].NumSections;
+  }
 
-  // Return aligned address
+  Allocation A = { &MemGroup, Block };
+  UnclaimedSections.push_back(A);
   return (uint8_t*)Addr;
 }
 
@@ -106,8 +128,7 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
   error_code ec;
 
   // Make code memory executable.
-  ec = applyMemoryGroupPermissions(CodeMem,
-                                   sys::Memory::MF_READ | sys::Memory::MF_EXEC);
+  ec = applyMemoryGroupPermissions(CodeMem, CodeMem.Permissions);
   if (ec) {
     if (ErrMsg) {
       *ErrMsg = ec.message();
@@ -116,8 +137,7 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
   }
 
   // Make read-only data memory read-only.
-  ec = applyMemoryGroupPermissions(RODataMem,
-                                   sys::Memory::MF_READ | sys::Memory::MF_EXEC);
+  ec = applyMemoryGroupPermissions(RODataMem, RODataMem.Permissions);
   if (ec) {
     if (ErrMsg) {
       *ErrMsg = ec.message();
@@ -137,26 +157,262 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
 
 error_code SectionMemoryManager::applyMemoryGroupPermissions(MemoryGroup &MemGroup,
                                                              unsigned Permissions) {
-
-  for (int i = 0, e = MemGroup.AllocatedMem.size(); i != e; ++i) {
-      error_code ec;
-      ec = sys::Memory::protectMappedMemory(MemGroup.AllocatedMem[i],
-                                            Permissions);
-      if (ec) {
-        return ec;
+  // Only the pages of sections allocated since the last call still need
+  // their permissions changed.
+  SmallVector<uintptr_t, 16> NewPages;
+  for (unsigned i = 0, e = MemGroup.PendingMem.size(); i != e; ++i) {
+    const sys::MemoryBlock &MB = MemGroup.PendingMem[i];
+    for (uintptr_t Page = blockStart(MB) & ~(PageSize - 1);
+         Page < blockEnd(MB); Page += PageSize) {
+      PageState &PS = MemGroup.Pages[Page];
+      if (!PS.Finalized) {
+        PS.Finalized = true;
+        NewPages.push_back(Page);
       }
+    }
+  }
+  MemGroup.PendingMem.clear();
+
+  // Change each run of consecutive pages at once.  Whatever is still free on
+  // these pages cannot be handed out any more.
+  std::sort(NewPages.begin(), NewPages.end());
+  for (unsigned i = 0, e = NewPages.size(); i != e; ++i) {
+    uintptr_t Start = NewPages[i];
+    uintptr_t End = Start + PageSize;
+    while (i + 1 != e && NewPages[i + 1] == End) {
+      End += PageSize;
+      ++i;
+    }
+    removeFreeMemory(MemGroup, Start, End);
+    if (error_code ec = protectPages(Start, End, Permissions))
+      return ec;
   }
 
   return error_code::success();
 }
 
+error_code SectionMemoryManager::protectPages(uintptr_t Start, uintptr_t End,
+                                              unsigned Permissions) {
+  ++NumPermissionChanges;
+  return sys::Memory::protectMappedMemory(
+      sys::MemoryBlock((void*)Start, End - Start), Permissions);
+}
+
 void SectionMemoryManager::invalidateInstructionCache() {
   for (int i = 0, e = CodeMem.AllocatedMem.size(); i != e; ++i)
     sys::Memory::InvalidateInstructionCache(CodeMem.AllocatedMem[i].base(),
                                             CodeMem.AllocatedMem[i].size());
 }
 
+void SectionMemoryManager::notifyObjectLoaded(ExecutionEngine *EE,
+                                              const ObjectImage *Obj) {
+  SmallVector<Allocation, 4> &Sections = ObjectSections[Obj];
+  Sections.append(UnclaimedSections.begin(), UnclaimedSections.end());
+  UnclaimedSections.clear();
+}
+
+void SectionMemoryManager::registerEHFrames(StringRef SectionData) {
+  RTDyldMemoryManager::registerEHFrames(SectionData);
+  RegisteredEHFrames.push_back(SectionData);
+}
+
+void SectionMemoryManager::notifyFreeingObject(const ObjectImage *Obj) {
+  DenseMap<const ObjectImage *, SmallVector<Allocation, 4> >::iterator I =
+    ObjectSections.find(Obj);
+  if (I == ObjectSections.end())
+    return;
+
+  // The unwinder must not find the object's EH frames any more once their
+  // memory can be reused.
+  for (unsigned i = 0; i != RegisteredEHFrames.size();) {
+    uintptr_t Frames = (uintptr_t)RegisteredEHFrames[i].data();
+    bool InObject = false;
+    for (unsigned j = 0, e = I->second.size(); j != e && !InObject; ++j)
+      InObject = Frames >= blockStart(I->second[j].Block) &&
+                 Frames < blockEnd(I->second[j].Block);
+    if (!InObject) {
+      ++i;
+      continue;
+    }
+    deregisterEHFrames(RegisteredEHFrames[i]);
+    RegisteredEHFrames.erase(RegisteredEHFrames.begin() + i);
+  }
+
+  for (unsigned i = 0, e = I->second.size(); i != e; ++i)
+    freeSection(I->second[i]);
+  ObjectSections.erase(I);
+
+  releaseFreeSlabs(CodeMem);
+  releaseFreeSlabs(RODataMem);
+  releaseFreeSlabs(RWDataMem);
+}
+
+void SectionMemoryManager::freeSection(const Allocation &A) {
+  MemoryGroup &MemGroup = *A.Group;
+  uintptr_t Start = blockStart(A.Block);
+  uintptr_t End = blockEnd(A.Block);
+  if (!MemGroup.Permissions) {
+    addFreeMemory(MemGroup, Start, End);
+    return;
+  }
+
+  for (unsigned i = 0, e = MemGroup.PendingMem.size(); i != e; ++i)
+    if (MemGroup.PendingMem[i].base() == A.Block.base()) {
+      MemGroup.PendingMem.erase(MemGroup.PendingMem.begin() + i);
+      break;
+    }
+
+  // Collect the finalized pages nothing lives on any more and make them
+  // writable again, one run of consecutive pages at a time.
+  uintptr_t RunStart = 0, RunEnd = 0;
+  for (uintptr_t Page = Start & ~(PageSize - 1); Page < End;
+       Page += PageSize) {
+    DenseMap<uintptr_t, PageState>::iterator PI = MemGroup.Pages.find(Page);
+    assert(PI != MemGroup.Pages.end() && "Freeing a section twice?");
+    PageState &PS = PI->second;
+    bool Finalized = PS.Finalized;
+    bool Empty = --PS.NumSections == 0;
+    if (Empty)
+      MemGroup.Pages.erase(PI);
+
+    // The section's part of a page that is still writable can be reused
+    // right away.
+    if (!Finalized) {
+      addFreeMemory(MemGroup, std::max(Start, Page),
+                    std::min(End, Page + PageSize));
+      continue;
+    }
+    if (!Empty)
+      continue;
+
+    if (RunEnd != Page) {
+      if (RunStart != RunEnd &&
+          !protectPages(RunStart, RunEnd,
+                        sys::Memory::MF_READ | sys::Memory::MF_WRITE))
+        addFreeMemory(MemGroup, RunStart, RunEnd);
+      RunStart = Page;
+    }
+    RunEnd = Page + PageSize;
+  }
+  if (RunStart != RunEnd &&
+      !protectPages(RunStart, RunEnd,
+                    sys::Memory::MF_READ | sys::Memory::MF_WRITE))
+    addFreeMemory(MemGroup, RunStart, RunEnd);
+}
+
+void SectionMemoryManager::releaseFreeSlabs(MemoryGroup &MemGroup) {
+  // Keep one free slab around, so that a program that keeps loading and
+  // freeing objects does not map and unmap memory every time.
+  bool KeptOne = false;
+  for (unsigned i = 0; i != MemGroup.AllocatedMem.size();) {
+    sys::MemoryBlock Slab = MemGroup.AllocatedMem[i];
+    uintptr_t Start = blockStart(Slab);
+    uintptr_t End = blockEnd(Slab);
+
+    // Find the free block starting at or before the slab.
+    SmallVectorImpl<sys::MemoryBlock>::iterator FI =
+      std::lower_bound(MemGroup.FreeMem.begin(), MemGroup.FreeMem.end(),
+                       Start + 1, blockStartsBefore);
+    bool IsFree = FI != MemGroup.FreeMem.begin() && blockEnd(*--FI) >= End;
+    if (!IsFree || !KeptOne) {
+      KeptOne |= IsFree;
+      ++i;
+      continue;
+    }
+
+    removeFreeMemory(MemGroup, Start, End);
+    if (MemGroup.Near.base() == Slab.base())
+      MemGroup.Near = sys::MemoryBlock();
+    sys::Memory::releaseMappedMemory(Slab);
+    MemGroup.AllocatedMem.erase(MemGroup.AllocatedMem.begin() + i);
+  }
+}
+
+void SectionMemoryManager::addFreeMemory(MemoryGroup &MemGroup,
+                                         uintptr_t Start, uintptr_t End) {
+  if (Start == End)
+    return;
+
+  // Keep the free list sorted and merge the block with its neighbours.
+  SmallVectorImpl<sys::MemoryBlock> &Free = MemGroup.FreeMem;
+  unsigned i = std::lower_bound(Free.begin(), Free.end(), Start,
+                                blockStartsBefore) - Free.begin();
+  bool MergePrev = i != 0 && blockEnd(Free[i - 1]) == Start;
+  bool MergeNext = i != Free.size() && blockStart(Free[i]) == End;
+  if (MergePrev && MergeNext) {
+    Free[i - 1] = sys::MemoryBlock(Free[i - 1].base(),
+                                   blockEnd(Free[i]) - blockStart(Free[i - 1]));
+    Free.erase(Free.begin() + i);
+  } else if (MergePrev) {
+    Free[i - 1] = sys::MemoryBlock(Free[i - 1].base(),
+                                   End - blockStart(Free[i - 1]));
+  } else if (MergeNext) {
+    Free[i] = sys::MemoryBlock((void*)Start, blockEnd(Free[i]) - Start);
+  } else {
+    Free.insert(Free.begin() + i, sys::MemoryBlock((void*)Start, End - Start));
+  }
+}
+
+void SectionMemoryManager::removeFreeMemory(MemoryGroup &MemGroup,
+                                            uintptr_t Start, uintptr_t End) {
+  SmallVectorImpl<sys::MemoryBlock> &Free = MemGroup.FreeMem;
+  unsigned i = std::lower_bound(Free.begin(), Free.end(), Start,
+                                blockStartsBefore) - Free.begin();
+  if (i != 0 && blockEnd(Free[i - 1]) > Start)
+    --i;
+
+  while (i != Free.size() && blockStart(Free[i]) < End) {
+    uintptr_t BlockStart = blockStart(Free[i]);
+    uintptr_t BlockEnd = blockEnd(Free[i]);
+    if (BlockStart < Start && BlockEnd > End) {
+      // Split the block around the range.
+      Free[i] = sys::MemoryBlock((void*)BlockStart, Start - BlockStart);
+      Free.insert(Free.begin() + i + 1,
+                  sys::MemoryBlock((void*)End, BlockEnd - End));
+      return;
+    }
+    if (BlockStart < Start) {
+      Free[i] = sys::MemoryBlock((void*)BlockStart, Start - BlockStart);
+      ++i;
+    } else if (BlockEnd > End) {
+      Free[i] = sys::MemoryBlock((void*)End, BlockEnd - End);
+      return;
+    } else {
+      Free.erase(Free.begin() + i);
+    }
+  }
+}
+
+SectionMemoryManager::MemoryStats
+SectionMemoryManager::getMemoryStats() const {
+  MemoryStats Stats = MemoryStats();
+  const MemoryGroup *Groups[] = { &CodeMem, &RWDataMem, &RODataMem };
+  for (unsigned g = 0; g != 3; ++g) {
+    const MemoryGroup &MemGroup = *Groups[g];
+    Stats.NumSlabs += MemGroup.AllocatedMem.size();
+    for (unsigned i = 0, e = MemGroup.AllocatedMem.size(); i != e; ++i)
+      Stats.MappedBytes += MemGroup.AllocatedMem[i].size();
+    for (unsigned i = 0, e = MemGroup.FreeMem.size(); i != e; ++i) {
+      Stats.FreeBytes += MemGroup.FreeMem[i].size();
+      Stats.LargestFreeBlock = std::max<uint64_t>(Stats.LargestFreeBlock,
+                                                  MemGroup.FreeMem[i].size());
+    }
+  }
+
+  for (unsigned i = 0, e = UnclaimedSections.size(); i != e; ++i)
+    Stats.AllocatedBytes += UnclaimedSections[i].Block.size();
+  for (DenseMap<const ObjectImage *, SmallVector<Allocation, 4> >::const_iterator
+         I = ObjectSections.begin(), E = ObjectSections.end(); I != E; ++I)
+    for (unsigned i = 0, e = I->second.size(); i != e; ++i)
+      Stats.AllocatedBytes += I->second[i].Block.size();
+
+  Stats.NumPermissionChanges = NumPermissionChanges;
+  return Stats;
+}
+
 SectionMemoryManager::~SectionMemoryManager() {
+  for (unsigned i = 0, e = RegisteredEHFrames.size(); i != e; ++i)
+    deregisterEHFrames(RegisteredEHFrames[i]);
   for (unsigned i = 0, e = CodeMem.AllocatedMem.size(); i != e; ++i)
     sys::Memory::releaseMappedMemory(CodeMem.AllocatedMem[i]);
   for (unsigned i = 0, e = RWDataMem.AllocatedMem.size(); i != e; ++i)
@@ -166,4 +422,3 @@ SectionMemoryManager::~SectionMemoryManager() {
 }
 
 } // namespace llvm
-
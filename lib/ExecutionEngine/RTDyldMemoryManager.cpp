@@ -42,25 +42,36 @@ RTDyldMemoryManager::~RTDyldMemoryManager() {}
 
 #if HAVE_EHTABLE_SUPPORT
 extern "C" void __register_frame(void*);
+extern "C" void __deregister_frame(void*);
 
-static const char *processFDE(const char *Entry) {
+static const char *processFDE(const char *Entry, void (*Process)(void*)) {
   const char *P = Entry;
   uint32_t Length = *((const uint32_t *)P);
   P += 4;
   uint32_t Offset = *((const uint32_t *)P);
   if (Offset != 0)
-    __register_frame(const_cast<char *>(Entry));
+    Process(const_cast<char *>(Entry));
   return P + Length;
 }
-#endif
 
-void RTDyldMemoryManager::registerEHFrames(StringRef SectionData) {
-#if HAVE_EHTABLE_SUPPORT
+static void processFDEs(StringRef SectionData, void (*Process)(void*)) {
   const char *P = SectionData.data();
   const char *End = SectionData.data() + SectionData.size();
   do  {
-    P = processFDE(P);
+    P = processFDE(P, Process);
   } while(P != End);
+}
+#endif
+
+void RTDyldMemoryManager::registerEHFrames(StringRef SectionData) {
+#if HAVE_EHTABLE_SUPPORT
+  processFDEs(SectionData, __register_frame);
+#endif
+}
+
+void RTDyldMemoryManager::deregisterEHFrames(StringRef SectionData) {
+#if HAVE_EHTABLE_SUPPORT
+  processFDEs(SectionData, __deregister_frame);
 #endif
 }
 
@@ -29,23 +29,40 @@ RuntimeDyldImpl::~RuntimeDyldImpl() {}
 
 namespace llvm {
 
-StringRef RuntimeDyldImpl::getEHFrameSection() {
+StringRef RuntimeDyldImpl::findEHFrameSection(unsigned FirstSectionID,
+                                              unsigned LastSectionID) {
   return StringRef();
 }
 
+void RuntimeDyldImpl::registerEHFrames() {
+  for (unsigned i = 0, e = UnregisteredObjects.size(); i != e; ++i) {
+    StringRef EHData = findEHFrameSection(UnregisteredObjects[i].first,
+                                          UnregisteredObjects[i].second);
+    if (!EHData.empty())
+      MemMgr->registerEHFrames(EHData);
+  }
+  UnregisteredObjects.clear();
+}
+
 // Resolve the relocations for all symbols we currently know about.
 void RuntimeDyldImpl::resolveRelocations() {
   // First, resolve relocations associated with external symbols.
   resolveExternalSymbols();
 
   // Just iterate over the sections we have and resolve all the relocations
-  // in them. Gross overkill, but it gets the job done.
+  // in them.  Relocations are dropped once they have been applied, so that
+  // sections of objects loaded earlier, whose memory may no longer be
+  // writable, are left alone when further objects are loaded.
   for (int i = 0, e = Sections.size(); i != e; ++i) {
+    DenseMap<unsigned, RelocationList>::iterator I = Relocations.find(i);
+    if (I == Relocations.end())
+      continue;
     uint64_t Addr = Sections[i].LoadAddress;
     DEBUG(dbgs() << "Resolving relocations Section #" << i
             << "\t" << format("%p", (uint8_t *)Addr)
             << "\n");
-    resolveRelocationList(Relocations[i], Addr);
+    resolveRelocationList(I->second, Addr);
+    Relocations.erase(I);
   }
 }
 
@@ -73,6 +90,9 @@ ObjectImage *RuntimeDyldImpl::loadObject(ObjectBuffer *InputBuffer) {
 
   Arch = (Triple::ArchType)obj->getArch();
 
+  // Sections of this object are numbered from here on.
+  unsigned FirstSectionID = Sections.size();
+
   // Symbols found in this object
   StringMap<SymbolLoc> LocalSymbols;
   // Used sections from the object file
@@ -166,9 +186,75 @@ ObjectImage *RuntimeDyldImpl::loadObject(ObjectBuffer *InputBuffer) {
     }
   }
 
+  std::pair<unsigned, unsigned> SectionIDs(FirstSectionID, Sections.size());
+  UnregisteredObjects.push_back(SectionIDs);
+  ObjectSectionIDs[obj.get()] = SectionIDs;
   return obj.take();
 }
 
+/// removeRelocationsIn - Remove the relocations that patch one of the
+/// sections [FirstSectionID, LastSectionID) from \p Relocs.
+static void removeRelocationsIn(SmallVectorImpl<RelocationEntry> &Relocs,
+                                unsigned FirstSectionID,
+                                unsigned LastSectionID) {
+  unsigned Kept = 0;
+  for (unsigned i = 0, e = Relocs.size(); i != e; ++i)
+    if (Relocs[i].SectionID < FirstSectionID ||
+        Relocs[i].SectionID >= LastSectionID)
+      Relocs[Kept++] = Relocs[i];
+  Relocs.erase(Relocs.begin() + Kept, Relocs.end());
+}
+
+void RuntimeDyldImpl::unloadObject(const ObjectImage *Obj) {
+  DenseMap<const ObjectImage*, std::pair<unsigned, unsigned> >::iterator I =
+    ObjectSectionIDs.find(Obj);
+  if (I == ObjectSectionIDs.end())
+    return;
+  unsigned First = I->second.first, Last = I->second.second;
+  ObjectSectionIDs.erase(I);
+
+  // Forget the symbols the object defines, unless a later object has
+  // redefined them.
+  for (SymbolTableMap::iterator SI = GlobalSymbolTable.begin(),
+       SE = GlobalSymbolTable.end(); SI != SE;) {
+    SymbolTableMap::iterator Cur = SI;
+    ++SI;
+    if (Cur->second.first >= First && Cur->second.first < Last)
+      GlobalSymbolTable.erase(Cur);
+  }
+
+  // Drop the relocations that refer to the object, and those that would
+  // patch its memory.
+  for (unsigned i = First; i != Last; ++i)
+    Relocations.erase(i);
+  for (DenseMap<unsigned, RelocationList>::iterator RI = Relocations.begin(),
+       RE = Relocations.end(); RI != RE; ++RI)
+    removeRelocationsIn(RI->second, First, Last);
+  for (StringMap<RelocationList>::iterator RI =
+       ExternalSymbolRelocations.begin(), RE = ExternalSymbolRelocations.end();
+       RI != RE; ++RI)
+    removeRelocationsIn(RI->second, First, Last);
+
+  for (unsigned i = 0, e = UnregisteredObjects.size(); i != e; ++i)
+    if (UnregisteredObjects[i].first == First) {
+      UnregisteredObjects.erase(UnregisteredObjects.begin() + i);
+      break;
+    }
+
+  // The IDs of the last object loaded can be handed out again, so that a
+  // program that keeps loading and unloading objects does not grow the
+  // section list.  Other IDs stay taken by sections without memory.
+  if (Last == Sections.size()) {
+    Sections.erase(Sections.begin() + First, Sections.end());
+    return;
+  }
+  for (unsigned i = First; i != Last; ++i) {
+    Sections[i].Address = 0;
+    Sections[i].Size = 0;
+    Sections[i].LoadAddress = 0;
+  }
+}
+
 void RuntimeDyldImpl::emitCommonSymbols(ObjectImage &Obj,
                                         const CommonSymbolMap &CommonSymbols,
                                         uint64_t TotalSize,
@@ -476,9 +562,17 @@ void RuntimeDyldImpl::resolveExternalSymbols() {
         resolveRelocationList(Relocs, (uintptr_t)Addr);
       }
     } else {
-      report_fatal_error("Expected external symbol");
+      // The symbol is defined by an object loaded after the one referring to
+      // it.
+      uint64_t Addr = getSectionLoadAddress(Loc->second.first) +
+                      Loc->second.second;
+      DEBUG(dbgs() << "Resolving relocations Name: " << Name
+              << "\t" << format("%p", (uint8_t *)Addr)
+              << "\n");
+      resolveRelocationList(Relocs, Addr);
     }
   }
+  ExternalSymbolRelocations.clear();
 }
 
 
@@ -539,10 +633,19 @@ ObjectImage *RuntimeDyld::loadObject(ObjectBuffer *InputBuffer) {
 }
 
 void *RuntimeDyld::getSymbolAddress(StringRef Name) {
+  if (!Dyld)
+    return 0;
   return Dyld->getSymbolAddress(Name);
 }
 
+void RuntimeDyld::unloadObject(const ObjectImage *Obj) {
+  if (Dyld)
+    Dyld->unloadObject(Obj);
+}
+
 uint64_t RuntimeDyld::getSymbolLoadAddress(StringRef Name) {
+  if (!Dyld)
+    return 0;
   return Dyld->getSymbolLoadAddress(Name);
 }
 
@@ -568,4 +671,9 @@ StringRef RuntimeDyld::getEHFrameSection() {
   return Dyld->getEHFrameSection();
 }
 
+void RuntimeDyld::registerEHFrames() {
+  if (Dyld)
+    Dyld->registerEHFrames();
+}
+
 } // end namespace llvm
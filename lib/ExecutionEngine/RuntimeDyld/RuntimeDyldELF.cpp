@@ -151,8 +151,9 @@ void DyldELFObject<ELFT>::updateSymbolAddress(const SymbolRef &SymRef,
 
 namespace llvm {
 
-StringRef RuntimeDyldELF::getEHFrameSection() {
-  for (int i = 0, e = Sections.size(); i != e; ++i) {
+StringRef RuntimeDyldELF::findEHFrameSection(unsigned FirstSectionID,
+                                             unsigned LastSectionID) {
+  for (unsigned i = FirstSectionID; i != LastSectionID; ++i) {
     if (Sections[i].Name == ".eh_frame")
       return StringRef((const char*)Sections[i].Address, Sections[i].Size);
   }
@@ -96,7 +96,8 @@ public:
                                     StubMap &Stubs);
   virtual bool isCompatibleFormat(const ObjectBuffer *Buffer) const;
   virtual ObjectImage *createObjectImage(ObjectBuffer *InputBuffer);
-  virtual StringRef getEHFrameSection();
+  virtual StringRef findEHFrameSection(unsigned FirstSectionID,
+                                       unsigned LastSectionID);
   virtual ~RuntimeDyldELF();
 };
 
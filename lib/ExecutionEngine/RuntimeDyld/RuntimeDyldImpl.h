@@ -161,6 +161,13 @@ protected:
   // modules.  This map is indexed by symbol name.
   StringMap<RelocationList> ExternalSymbolRelocations;
 
+  // The range of SectionIDs of every object loaded since the EH frames were
+  // last registered with the memory manager.
+  SmallVector<std::pair<unsigned, unsigned>, 2> UnregisteredObjects;
+
+  // The range of SectionIDs of every object that was not unloaded.
+  DenseMap<const ObjectImage*, std::pair<unsigned, unsigned> > ObjectSectionIDs;
+
   typedef std::map<RelocationValueRef, uintptr_t> StubMap;
 
   Triple::ArchType Arch;
@@ -300,6 +307,8 @@ public:
 
   ObjectImage *loadObject(ObjectBuffer *InputBuffer);
 
+  void unloadObject(const ObjectImage *Obj);
+
   void *getSymbolAddress(StringRef Name) {
     // FIXME: Just look up as a function for now. Overly simple of course.
     // Work in progress.
@@ -335,7 +344,20 @@ public:
 
   virtual bool isCompatibleFormat(const ObjectBuffer *Buffer) const = 0;
 
-  virtual StringRef getEHFrameSection();
+  /// getEHFrameSection - Return the EH frame section of the loaded objects.
+  StringRef getEHFrameSection() {
+    return findEHFrameSection(0, Sections.size());
+  }
+
+  /// registerEHFrames - Hand the EH frame sections of the objects loaded
+  /// since the last call to the memory manager.
+  void registerEHFrames();
+
+protected:
+  /// findEHFrameSection - Return the EH frame section among the sections
+  /// [FirstSectionID, LastSectionID), which all belong to the same object.
+  virtual StringRef findEHFrameSection(unsigned FirstSectionID,
+                                       unsigned LastSectionID);
 };
 
 } // end namespace llvm
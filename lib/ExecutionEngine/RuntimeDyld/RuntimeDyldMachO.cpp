@@ -55,11 +55,12 @@ static intptr_t computeDelta(SectionEntry *A, SectionEntry *B) {
   return ObjDistance - MemDistance;
 }
 
-StringRef RuntimeDyldMachO::getEHFrameSection() {
+StringRef RuntimeDyldMachO::findEHFrameSection(unsigned FirstSectionID,
+                                               unsigned LastSectionID) {
   SectionEntry *Text = NULL;
   SectionEntry *EHFrame = NULL;
   SectionEntry *ExceptTab = NULL;
-  for (int i = 0, e = Sections.size(); i != e; ++i) {
+  for (unsigned i = FirstSectionID; i != LastSectionID; ++i) {
     if (Sections[i].Name == "__eh_frame")
       EHFrame = &Sections[i];
     else if (Sections[i].Name == "__text")
@@ -65,7 +65,8 @@ public:
                                     const SymbolTableMap &Symbols,
                                     StubMap &Stubs);
   virtual bool isCompatibleFormat(const ObjectBuffer *Buffer) const;
-  virtual StringRef getEHFrameSection();
+  virtual StringRef findEHFrameSection(unsigned FirstSectionID,
+                                       unsigned LastSectionID);
 };
 
 } // end namespace llvm
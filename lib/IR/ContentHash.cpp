@@ -0,0 +1,502 @@
+//===-- ContentHash.cpp - Hash the contents of IR -------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements hashFunctionContent and hashModuleContent.  Both feed
+// a canonical serialization of the IR into MD5: every object is written as a
+// tag followed by its properties and operands, and objects that can be reached
+// more than once (local values, metadata nodes, unnamed globals, named struct
+// types) are written out the first time and referred to by a number
+// afterwards.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/ContentHash.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+using namespace llvm;
+
+std::string ContentHash::str() const {
+  MD5::MD5Result Result;
+  std::memcpy(Result, Bytes, sizeof(Bytes));
+  SmallString<32> Str;
+  MD5::stringifyResult(Result, Str);
+  return Str.str();
+}
+
+namespace {
+
+/// Tags that say what kind of object follows in the serialization.  Values
+/// that are not listed use their Value::ValueTy, offset by ValueTag.
+enum {
+  LocalTag = 1,        // [id]
+  UnnamedGlobalTag,    // [id]
+  MDNodeRefTag,        // [id]
+  NamedStructRefTag,   // [name]
+  NullTag,
+  ValueTag = 16
+};
+
+class ContentHasher {
+  MD5 Hash;
+
+  /// LocalIDs - The arguments, blocks and instructions of the function being
+  /// hashed, numbered in the order they appear.
+  DenseMap<const Value*, unsigned> LocalIDs;
+
+  /// UnnamedGlobalIDs - Globals without a name have nothing that identifies
+  /// them but their contents, so they are hashed in full once.
+  DenseMap<const GlobalValue*, unsigned> UnnamedGlobalIDs;
+
+  DenseMap<const MDNode*, unsigned> MDNodeIDs;
+  SmallPtrSet<StructType*, 16> SeenStructs;
+
+  /// SeenInitializers - The named constants whose initializer has been hashed
+  /// already.  Initializers can refer back to their own variable.
+  SmallPtrSet<const GlobalVariable*, 16> SeenInitializers;
+
+  /// MDKindNames - Metadata kinds are numbered per context, so instruction
+  /// attachments are hashed by name.
+  SmallVector<StringRef, 16> MDKindNames;
+
+public:
+  explicit ContentHasher(LLVMContext &Context) {
+    Context.getMDKindNames(MDKindNames);
+  }
+
+  void addInt(uint64_t V) {
+    uint8_t Buf[8];
+    for (unsigned i = 0; i != 8; ++i)
+      Buf[i] = uint8_t(V >> (i*8));
+    Hash.update(ArrayRef<uint8_t>(Buf));
+  }
+
+  void addString(StringRef S) {
+    addInt(S.size());
+    Hash.update(S);
+  }
+
+  void addHash(const ContentHash &H) {
+    for (unsigned i = 0; i != 4; ++i)
+      addInt(H.getWord(i));
+  }
+
+  void addAPInt(const APInt &V) {
+    addInt(V.getBitWidth());
+    for (unsigned i = 0, e = V.getNumWords(); i != e; ++i)
+      addInt(V.getRawData()[i]);
+  }
+
+  void addAttributes(AttributeSet Attrs) {
+    addInt(Attrs.getNumSlots());
+    for (unsigned i = 0, e = Attrs.getNumSlots(); i != e; ++i) {
+      unsigned Index = Attrs.getSlotIndex(i);
+      addInt(Index);
+      addString(Attrs.getAsString(Index));
+    }
+  }
+
+  void addType(Type *Ty);
+  void addValue(const Value *V);
+  void addGlobalReference(const GlobalValue *GV);
+  void addConstant(const Constant *C);
+  void addMetadata(const MDNode *N);
+  void addInstruction(const Instruction &I);
+  void addGlobalVariable(const GlobalVariable &GV);
+  void addFunctionHeader(const Function &F);
+  void addFunction(const Function &F);
+
+  ContentHash getResult() {
+    MD5::MD5Result Result;
+    Hash.final(Result);
+    return ContentHash(Result);
+  }
+};
+
+} // end anonymous namespace
+
+void ContentHasher::addType(Type *Ty) {
+  addInt(Ty->getTypeID());
+  switch (Ty->getTypeID()) {
+  default:
+    break;
+  case Type::IntegerTyID:
+    addInt(cast<IntegerType>(Ty)->getBitWidth());
+    break;
+  case Type::PointerTyID:
+    addInt(cast<PointerType>(Ty)->getAddressSpace());
+    addType(cast<PointerType>(Ty)->getElementType());
+    break;
+  case Type::ArrayTyID:
+    addInt(cast<ArrayType>(Ty)->getNumElements());
+    addType(cast<ArrayType>(Ty)->getElementType());
+    break;
+  case Type::VectorTyID:
+    addInt(cast<VectorType>(Ty)->getNumElements());
+    addType(cast<VectorType>(Ty)->getElementType());
+    break;
+  case Type::FunctionTyID: {
+    FunctionType *FTy = cast<FunctionType>(Ty);
+    addInt(FTy->isVarArg());
+    addType(FTy->getReturnType());
+    addInt(FTy->getNumParams());
+    for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i)
+      addType(FTy->getParamType(i));
+    break;
+  }
+  case Type::StructTyID: {
+    StructType *STy = cast<StructType>(Ty);
+    // Named structs can be recursive, so their body is only hashed the first
+    // time they are seen.
+    if (!STy->isLiteral()) {
+      addString(STy->getName());
+      if (!SeenStructs.insert(STy)) {
+        addInt(NamedStructRefTag);
+        break;
+      }
+      addInt(STy->isOpaque());
+      if (STy->isOpaque())
+        break;
+    }
+    addInt(STy->isPacked());
+    addInt(STy->getNumElements());
+    for (unsigned i = 0, e = STy->getNumElements(); i != e; ++i)
+      addType(STy->getElementType(i));
+    break;
+  }
+  }
+}
+
+void ContentHasher::addValue(const Value *V) {
+  if (!V) {
+    addInt(NullTag);
+    return;
+  }
+
+  DenseMap<const Value*, unsigned>::iterator I = LocalIDs.find(V);
+  if (I != LocalIDs.end()) {
+    addInt(LocalTag);
+    addInt(I->second);
+    return;
+  }
+
+  addInt(ValueTag + V->getValueID());
+  if (const MDNode *N = dyn_cast<MDNode>(V))
+    return addMetadata(N);
+  if (const MDString *S = dyn_cast<MDString>(V))
+    return addString(S->getString());
+
+  addType(V->getType());
+  if (const GlobalValue *GV = dyn_cast<GlobalValue>(V))
+    return addGlobalReference(GV);
+  if (const Constant *C = dyn_cast<Constant>(V))
+    return addConstant(C);
+  if (const InlineAsm *IA = dyn_cast<InlineAsm>(V)) {
+    addString(IA->getAsmString());
+    addString(IA->getConstraintString());
+    addInt(IA->hasSideEffects());
+    addInt(IA->isAlignStack());
+    addInt(IA->getDialect());
+    return;
+  }
+
+  // A value of another function, which can only happen through function-local
+  // metadata that has been left behind.
+  addInt(NullTag);
+}
+
+/// addGlobalReference - Hash a use of \p GV: its name, and whatever affects
+/// the code that refers to it.  Whether it is defined in the module decides,
+/// for example, whether a call to it can be direct, and the alignment and
+/// section of a variable what its loads and address computations look like.
+/// Loads from a constant whose initializer cannot be replaced at link time
+/// may be folded, so that initializer is hashed as well.
+void ContentHasher::addGlobalReference(const GlobalValue *GV) {
+  addString(GV->getName());
+  addInt(GV->getLinkage());
+  addInt(GV->getVisibility());
+  addInt(GV->isDeclaration());
+  if (const GlobalVariable *Var = dyn_cast<GlobalVariable>(GV)) {
+    addInt(Var->getThreadLocalMode());
+    addInt(Var->getAlignment());
+    addString(Var->getSection());
+    addInt(Var->hasUnnamedAddr());
+  }
+
+  if (GV->hasName()) {
+    const GlobalVariable *Var = dyn_cast<GlobalVariable>(GV);
+    bool HashInitializer = Var && Var->isConstant() &&
+                           Var->hasDefinitiveInitializer() &&
+                           SeenInitializers.insert(Var);
+    addInt(HashInitializer);
+    if (HashInitializer)
+      addValue(Var->getInitializer());
+    return;
+  }
+
+  std::pair<DenseMap<const GlobalValue*, unsigned>::iterator, bool> Ins =
+    UnnamedGlobalIDs.insert(std::make_pair(GV, UnnamedGlobalIDs.size()));
+  if (!Ins.second) {
+    addInt(UnnamedGlobalTag);
+    addInt(Ins.first->second);
+    return;
+  }
+
+  if (const GlobalVariable *Var = dyn_cast<GlobalVariable>(GV))
+    addGlobalVariable(*Var);
+  else if (const GlobalAlias *GA = dyn_cast<GlobalAlias>(GV))
+    addValue(GA->getAliasee());
+  else
+    addFunctionHeader(*cast<Function>(GV));
+}
+
+void ContentHasher::addConstant(const Constant *C) {
+  if (const ConstantInt *CI = dyn_cast<ConstantInt>(C))
+    return addAPInt(CI->getValue());
+  if (const ConstantFP *CFP = dyn_cast<ConstantFP>(C))
+    return addAPInt(CFP->getValueAPF().bitcastToAPInt());
+  if (const ConstantDataSequential *CDS = dyn_cast<ConstantDataSequential>(C))
+    return addString(CDS->getRawDataValues());
+  if (const BlockAddress *BA = dyn_cast<BlockAddress>(C)) {
+    addValue(BA->getFunction());
+    // Number the block by its position, in case it is not local.
+    unsigned BBNo = 0;
+    for (Function::const_iterator BB = BA->getFunction()->begin();
+         &*BB != BA->getBasicBlock(); ++BB)
+      ++BBNo;
+    addInt(BBNo);
+    return;
+  }
+  if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(C)) {
+    addInt(CE->getOpcode());
+    addInt(CE->getRawSubclassOptionalData());
+    if (CE->isCompare())
+      addInt(CE->getPredicate());
+    if (CE->hasIndices()) {
+      ArrayRef<unsigned> Indices = CE->getIndices();
+      addInt(Indices.size());
+      for (unsigned i = 0, e = Indices.size(); i != e; ++i)
+        addInt(Indices[i]);
+    }
+  }
+
+  // Aggregates, expressions and the constants without any contents.
+  addInt(C->getNumOperands());
+  for (unsigned i = 0, e = C->getNumOperands(); i != e; ++i)
+    addValue(C->getOperand(i));
+}
+
+void ContentHasher::addMetadata(const MDNode *N) {
+  std::pair<DenseMap<const MDNode*, unsigned>::iterator, bool> Ins =
+    MDNodeIDs.insert(std::make_pair(N, MDNodeIDs.size()));
+  if (!Ins.second) {
+    addInt(MDNodeRefTag);
+    addInt(Ins.first->second);
+    return;
+  }
+
+  addInt(N->isFunctionLocal());
+  addInt(N->getNumOperands());
+  for (unsigned i = 0, e = N->getNumOperands(); i != e; ++i)
+    addValue(N->getOperand(i));
+}
+
+void ContentHasher::addInstruction(const Instruction &I) {
+  addInt(I.getOpcode());
+  addType(I.getType());
+  addInt(I.getRawSubclassOptionalData());
+
+  // The properties that are not operands.
+  if (const CmpInst *CI = dyn_cast<CmpInst>(&I)) {
+    addInt(CI->getPredicate());
+  } else if (const AllocaInst *AI = dyn_cast<AllocaInst>(&I)) {
+    addInt(AI->getAlignment());
+  } else if (const LoadInst *LI = dyn_cast<LoadInst>(&I)) {
+    addInt(LI->isVolatile());
+    addInt(LI->getAlignment());
+    addInt(LI->getOrdering());
+    addInt(LI->getSynchScope());
+  } else if (const StoreInst *SI = dyn_cast<StoreInst>(&I)) {
+    addInt(SI->isVolatile());
+    addInt(SI->getAlignment());
+    addInt(SI->getOrdering());
+    addInt(SI->getSynchScope());
+  } else if (const AtomicCmpXchgInst *CXI = dyn_cast<AtomicCmpXchgInst>(&I)) {
+    addInt(CXI->isVolatile());
+    addInt(CXI->getOrdering());
+    addInt(CXI->getSynchScope());
+  } else if (const AtomicRMWInst *RMWI = dyn_cast<AtomicRMWInst>(&I)) {
+    addInt(RMWI->getOperation());
+    addInt(RMWI->isVolatile());
+    addInt(RMWI->getOrdering());
+    addInt(RMWI->getSynchScope());
+  } else if (const FenceInst *FI = dyn_cast<FenceInst>(&I)) {
+    addInt(FI->getOrdering());
+    addInt(FI->getSynchScope());
+  } else if (const CallInst *CI = dyn_cast<CallInst>(&I)) {
+    addInt(CI->isTailCall());
+    addInt(CI->getCallingConv());
+    addAttributes(CI->getAttributes());
+  } else if (const InvokeInst *II = dyn_cast<InvokeInst>(&I)) {
+    addInt(II->getCallingConv());
+    addAttributes(II->getAttributes());
+  } else if (const LandingPadInst *LPI = dyn_cast<LandingPadInst>(&I)) {
+    addInt(LPI->isCleanup());
+  } else if (const ExtractValueInst *EVI = dyn_cast<ExtractValueInst>(&I)) {
+    addInt(EVI->getNumIndices());
+    for (unsigned i = 0, e = EVI->getNumIndices(); i != e; ++i)
+      addInt(EVI->getIndices()[i]);
+  } else if (const InsertValueInst *IVI = dyn_cast<InsertValueInst>(&I)) {
+    addInt(IVI->getNumIndices());
+    for (unsigned i = 0, e = IVI->getNumIndices(); i != e; ++i)
+      addInt(IVI->getIndices()[i]);
+  }
+
+  addInt(I.getNumOperands());
+  for (unsigned i = 0, e = I.getNumOperands(); i != e; ++i)
+    addValue(I.getOperand(i));
+  // Phi nodes keep their incoming blocks outside of the operand list.
+  if (const PHINode *PN = dyn_cast<PHINode>(&I))
+    for (unsigned i = 0, e = PN->getNumIncomingValues(); i != e; ++i)
+      addValue(PN->getIncomingBlock(i));
+
+  SmallVector<std::pair<unsigned, MDNode*>, 4> MDs;
+  I.getAllMetadata(MDs);
+  addInt(MDs.size());
+  for (unsigned i = 0, e = MDs.size(); i != e; ++i) {
+    addString(MDs[i].first < MDKindNames.size() ? MDKindNames[MDs[i].first]
+                                                : StringRef());
+    addValue(MDs[i].second);
+  }
+}
+
+void ContentHasher::addGlobalVariable(const GlobalVariable &GV) {
+  addInt(GV.isConstant());
+  addInt(GV.isExternallyInitialized());
+  addInt(GV.hasUnnamedAddr());
+  addInt(GV.getAlignment());
+  addString(GV.getSection());
+  addInt(GV.hasInitializer());
+  if (GV.hasInitializer())
+    addValue(GV.getInitializer());
+}
+
+void ContentHasher::addFunctionHeader(const Function &F) {
+  addInt(F.getCallingConv());
+  addAttributes(F.getAttributes());
+  addInt(F.hasUnnamedAddr());
+  addInt(F.getAlignment());
+  addString(F.getSection());
+  addString(F.hasGC() ? F.getGC() : "");
+}
+
+void ContentHasher::addFunction(const Function &F) {
+  addValue(&F);
+  if (F.hasName())
+    addFunctionHeader(F);
+
+  // Number everything up front, so that forward references to blocks and
+  // instructions hash the same way as backward ones.
+  unsigned NextID = 0;
+  for (Function::const_arg_iterator AI = F.arg_begin(), AE = F.arg_end();
+       AI != AE; ++AI)
+    LocalIDs[AI] = NextID++;
+  for (Function::const_iterator BB = F.begin(), BE = F.end(); BB != BE; ++BB) {
+    LocalIDs[BB] = NextID++;
+    for (BasicBlock::const_iterator I = BB->begin(), IE = BB->end(); I != IE;
+         ++I)
+      LocalIDs[I] = NextID++;
+  }
+
+  addInt(F.size());
+  for (Function::const_iterator BB = F.begin(), BE = F.end(); BB != BE; ++BB) {
+    addInt(BB->size());
+    for (BasicBlock::const_iterator I = BB->begin(), IE = BB->end(); I != IE;
+         ++I)
+      addInstruction(*I);
+  }
+  LocalIDs.clear();
+}
+
+ContentHash llvm::hashFunctionContent(const Function &F) {
+  ContentHasher Hasher(F.getContext());
+  Hasher.addFunction(F);
+  return Hasher.getResult();
+}
+
+ContentHash llvm::hashGlobalContent(const GlobalValue &GV) {
+  if (const Function *F = dyn_cast<Function>(&GV))
+    return hashFunctionContent(*F);
+
+  // Unnamed globals are hashed in full by addValue, named ones only by the
+  // properties that references see.
+  ContentHasher Hasher(GV.getContext());
+  Hasher.addValue(&GV);
+  if (GV.hasName()) {
+    if (const GlobalVariable *Var = dyn_cast<GlobalVariable>(&GV))
+      Hasher.addGlobalVariable(*Var);
+    else
+      Hasher.addValue(cast<GlobalAlias>(GV).getAliasee());
+  }
+  return Hasher.getResult();
+}
+
+ContentHash llvm::hashModuleContent(const Module &M,
+                                    DenseMap<const Function*, ContentHash>
+                                      *FunctionHashes) {
+  ContentHasher Hasher(M.getContext());
+  Hasher.addString(M.getTargetTriple());
+  Hasher.addString(M.getDataLayout());
+  Hasher.addString(M.getModuleInlineAsm());
+
+  Hasher.addInt(M.getGlobalList().size());
+  for (Module::const_global_iterator I = M.global_begin(),
+         E = M.global_end(); I != E; ++I) {
+    Hasher.addValue(I);
+    if (I->hasName())
+      Hasher.addGlobalVariable(*I);
+  }
+
+  // Functions are hashed on their own, so that the module hash agrees with
+  // the hashes of its functions.
+  Hasher.addInt(M.getFunctionList().size());
+  for (Module::const_iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    ContentHash FH = hashFunctionContent(*I);
+    Hasher.addHash(FH);
+    if (FunctionHashes && !I->isDeclaration())
+      (*FunctionHashes)[I] = FH;
+  }
+
+  Hasher.addInt(M.getAliasList().size());
+  for (Module::const_alias_iterator I = M.alias_begin(), E = M.alias_end();
+       I != E; ++I) {
+    Hasher.addValue(I);
+    Hasher.addValue(I->getAliasee());
+  }
+
+  Hasher.addInt(M.getNamedMDList().size());
+  for (Module::const_named_metadata_iterator I = M.named_metadata_begin(),
+         E = M.named_metadata_end(); I != E; ++I) {
+    Hasher.addString(I->getName());
+    Hasher.addInt(I->getNumOperands());
+    for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i)
+      Hasher.addValue(I->getOperand(i));
+  }
+
+  return Hasher.getResult();
+}
@@ -13,6 +13,8 @@
 
 
 #include "llvm/PassManagers.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/Assembly/PrintModulePass.h"
 #include "llvm/Assembly/Writer.h"
 #include "llvm/IR/Module.h"
@@ -20,9 +22,12 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/PassNameParser.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -488,6 +493,234 @@ public:
 
 static TimingInfo *TheTimeInfo;
 
+//===----------------------------------------------------------------------===//
+// PassProfile implementation
+
+namespace {
+enum ProfileFormat { CSV, JSON };
+}
+
+static cl::opt<std::string>
+PassProfileFilename("pass-profile", cl::value_desc("filename"),
+                    cl::desc("Append the time, instruction counts and heap "
+                             "growth of every pass run to this file"));
+
+static cl::opt<ProfileFormat>
+PassProfileFormat("pass-profile-format", cl::init(CSV),
+                  cl::desc("Format of the -pass-profile file"),
+                  cl::values(
+  clEnumValN(CSV,  "csv",  "comma separated values, with a header line"),
+  clEnumValN(JSON, "json", "one JSON object per line"),
+                             clEnumValEnd));
+
+namespace {
+
+static ManagedStatic<sys::SmartMutex<true> > PassProfileMutex;
+
+/// PassProfile - The -pass-profile file.  Records are appended as the passes
+/// run, so that profiles of many compilations can simply be concatenated.
+/// Each record goes out in a single append, so that concurrent jobs may share
+/// one file without their records interleaving.
+class PassProfile {
+  OwningPtr<raw_fd_ostream> OS;
+
+  void writeHeader();
+  static void writeCSVString(raw_ostream &Out, StringRef S);
+
+public:
+  PassProfile();
+
+  // createThePassProfile - This method either initializes ThePassProfile to a
+  // non null value (if the -pass-profile option is given) or it leaves it
+  // null.  It may be called multiple times.
+  static void createThePassProfile();
+
+  /// record - Write one record to the profile.
+  void record(StringRef PassName, StringRef ModuleID, StringRef FunctionName,
+              uint64_t WallMicros, unsigned InstrsBefore, unsigned InstrsAfter,
+              int64_t HeapBytes);
+};
+
+} // End of anon namespace
+
+static PassProfile *ThePassProfile;
+
+PassProfile::PassProfile() {
+  std::string Error;
+  OS.reset(new raw_fd_ostream(PassProfileFilename.c_str(), Error,
+                              raw_fd_ostream::F_Append));
+  if (!Error.empty()) {
+    errs() << "Error opening pass profile '" << PassProfileFilename << "': "
+           << Error << '\n';
+    OS.reset();
+    return;
+  }
+  OS->SetUnbuffered();
+  OS->SetUseAtomicWrites(true);
+
+  if (PassProfileFormat == CSV)
+    writeHeader();
+}
+
+/// writeHeader - Write the CSV header if the file is still empty.  Other jobs
+/// appending to the same file are kept out while we look, so that only one of
+/// them writes it.
+void PassProfile::writeHeader() {
+  OwningPtr<LockFileManager> Lock;
+  while (!Lock) {
+    Lock.reset(new LockFileManager(PassProfileFilename));
+    switch (Lock->getState()) {
+    case LockFileManager::LFS_Error:
+      // Check without the lock; at worst the header appears twice.
+      Lock.reset();
+      break;
+
+    case LockFileManager::LFS_Owned:
+      break;
+
+    case LockFileManager::LFS_Shared:
+      Lock->waitForUnlock();
+      Lock.reset();
+      continue;
+    }
+    break;
+  }
+
+  uint64_t Size;
+  if (!sys::fs::file_size(PassProfileFilename, Size) && Size != 0)
+    return;
+  *OS << "module,function,pass,wall_us,instrs_before,instrs_after,"
+         "heap_bytes\n";
+}
+
+void PassProfile::createThePassProfile() {
+  if (PassProfileFilename.empty() || ThePassProfile) return;
+
+  // Constructed the first time this is called, like TimingInfo.
+  static ManagedStatic<PassProfile> PP;
+  ThePassProfile = &*PP;
+}
+
+void PassProfile::writeCSVString(raw_ostream &Out, StringRef S) {
+  Out << '"';
+  for (unsigned i = 0, e = S.size(); i != e; ++i) {
+    if (S[i] == '"')
+      Out << '"';
+    Out << S[i];
+  }
+  Out << '"';
+}
+
+void PassProfile::record(StringRef PassName, StringRef ModuleID,
+                         StringRef FunctionName, uint64_t WallMicros,
+                         unsigned InstrsBefore, unsigned InstrsAfter,
+                         int64_t HeapBytes) {
+  // Format the whole record first; the stream writes it with one write().
+  SmallString<256> Buffer;
+  raw_svector_ostream Record(Buffer);
+  if (PassProfileFormat == CSV) {
+    writeCSVString(Record, ModuleID);
+    Record << ',';
+    writeCSVString(Record, FunctionName);
+    Record << ',';
+    writeCSVString(Record, PassName);
+    Record << ',' << WallMicros << ',' << InstrsBefore << ',' << InstrsAfter
+           << ',' << HeapBytes << '\n';
+  } else {
+    Record << "{\"module\":";
+    Record.write_json_string(ModuleID);
+    Record << ",\"function\":";
+    Record.write_json_string(FunctionName);
+    Record << ",\"pass\":";
+    Record.write_json_string(PassName);
+    Record << ",\"wall_us\":" << WallMicros
+           << ",\"instrs_before\":" << InstrsBefore
+           << ",\"instrs_after\":" << InstrsAfter
+           << ",\"heap_bytes\":" << HeapBytes << "}\n";
+  }
+
+  sys::SmartScopedLock<true> Lock(*PassProfileMutex);
+  if (OS)
+    *OS << Record.str();
+}
+
+static unsigned countInstructions(const Function &F) {
+  unsigned Count = 0;
+  for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    Count += BB->size();
+  return Count;
+}
+
+static unsigned countInstructions(ArrayRef<BasicBlock *> Blocks) {
+  unsigned Count = 0;
+  for (unsigned i = 0, e = Blocks.size(); i != e; ++i)
+    Count += Blocks[i]->size();
+  return Count;
+}
+
+static unsigned countInstructions(const Module &M) {
+  unsigned Count = 0;
+  for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F)
+    Count += countInstructions(*F);
+  return Count;
+}
+
+PassProfileRegion::PassProfileRegion(Pass *Pass, Function &Fn)
+  : P(0), IsLoop(false) {
+  if (!ThePassProfile || Pass->getAsPMDataManager())
+    return;
+  P = Pass;
+  M = Fn.getParent();
+  F = &Fn;
+  InstrsBefore = countInstructions(Fn);
+  HeapBefore = sys::Process::GetMallocUsage();
+  Start = sys::TimeValue::now();
+}
+
+PassProfileRegion::PassProfileRegion(Pass *Pass, Module &Mod)
+  : P(0), IsLoop(false) {
+  if (!ThePassProfile || Pass->getAsPMDataManager())
+    return;
+  P = Pass;
+  M = &Mod;
+  F = 0;
+  InstrsBefore = countInstructions(Mod);
+  HeapBefore = sys::Process::GetMallocUsage();
+  Start = sys::TimeValue::now();
+}
+
+PassProfileRegion::PassProfileRegion(Pass *Pass, Function &Fn,
+                                     ArrayRef<BasicBlock *> LoopBlocks)
+  : P(0), InstrsAfter(0), IsLoop(true) {
+  if (!ThePassProfile || Pass->getAsPMDataManager())
+    return;
+  P = Pass;
+  M = Fn.getParent();
+  F = &Fn;
+  InstrsBefore = countInstructions(LoopBlocks);
+  HeapBefore = sys::Process::GetMallocUsage();
+  Start = sys::TimeValue::now();
+}
+
+void PassProfileRegion::setLoopBlocksAfter(ArrayRef<BasicBlock *> LoopBlocks) {
+  assert(IsLoop && "Not measuring a loop pass!");
+  if (P)
+    InstrsAfter = countInstructions(LoopBlocks);
+}
+
+PassProfileRegion::~PassProfileRegion() {
+  if (!P)
+    return;
+  sys::TimeValue Wall = sys::TimeValue::now() - Start;
+  int64_t HeapBytes = int64_t(sys::Process::GetMallocUsage()) -
+                      int64_t(HeapBefore);
+  if (!IsLoop)
+    InstrsAfter = F ? countInstructions(*F) : countInstructions(*M);
+  ThePassProfile->record(P->getPassName(), M->getModuleIdentifier(),
+                         F ? F->getName() : StringRef(), Wall.usec(),
+                         InstrsBefore, InstrsAfter, HeapBytes);
+}
+
 //===----------------------------------------------------------------------===//
 // PMTopLevelManager implementation
 
@@ -1475,6 +1708,7 @@ void FunctionPassManagerImpl::releaseMemoryOnTheFly() {
 bool FunctionPassManagerImpl::run(Function &F) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  PassProfile::createThePassProfile();
 
   initializeAllAnalysisInfo();
   for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index)
@@ -1526,6 +1760,7 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      PassProfileRegion Profile(FP, F);
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1604,6 +1839,7 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      PassProfileRegion Profile(MP, M);
 
       LocalChanged |= MP->runOnModule(M);
     }
@@ -1688,6 +1924,7 @@ Pass* MPPassManager::getOnTheFlyPass(Pass *MP, AnalysisID PI, Function &F){
 bool PassManagerImpl::run(Module &M) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  PassProfile::createThePassProfile();
 
   dumpArguments();
   dumpPasses();
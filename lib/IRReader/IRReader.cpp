@@ -47,13 +47,25 @@ Module *llvm::getLazyIRModule(MemoryBuffer *Buffer, SMDiagnostic &Err,
 
 Module *llvm::getLazyIRFileModule(const std::string &Filename, SMDiagnostic &Err,
                                   LLVMContext &Context) {
+  // Bitcode needs no null terminator, so a large file is always mapped
+  // rather than read, and only the parts of it that are materialized are
+  // ever paged in.
   OwningPtr<MemoryBuffer> File;
-  if (error_code ec = MemoryBuffer::getFileOrSTDIN(Filename, File)) {
+  error_code ec = Filename == "-" ?
+    MemoryBuffer::getSTDIN(File) :
+    MemoryBuffer::getFile(Filename, File, -1, /*RequiresNullTerminator=*/false);
+  if (ec) {
     Err = SMDiagnostic(Filename, SourceMgr::DK_Error,
                        "Could not open input file: " + ec.message());
     return 0;
   }
 
+  // The assembly lexer does rely on the null terminator.
+  if (!isBitcode((const unsigned char *)File->getBufferStart(),
+                 (const unsigned char *)File->getBufferEnd()))
+    File.reset(MemoryBuffer::getMemBufferCopy(File->getBuffer(),
+                                              File->getBufferIdentifier()));
+
   return getLazyIRModule(File.take(), Err, Context);
 }
 
@@ -11,20 +11,28 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "allocator"
 #include "llvm/Support/Allocator.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/DataTypes.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Memory.h"
+#include "llvm/Support/MutexGuard.h"
 #include "llvm/Support/Recycler.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cstring>
 
+STATISTIC(NumSlabsReused, "Number of slabs reused by CachingSlabAllocator");
+
 namespace llvm {
 
 BumpPtrAllocator::BumpPtrAllocator(size_t size, size_t threshold,
                                    SlabAllocator &allocator)
     : SlabSize(size), SizeThreshold(std::min(size, threshold)),
-      Allocator(allocator), CurSlab(0), BytesAllocated(0) { }
+      Allocator(allocator), CurSlab(0), BytesAllocated(0),
+      BytesLeftInSlabs(0) { }
 
 BumpPtrAllocator::~BumpPtrAllocator() {
   DeallocateSlabs(CurSlab);
@@ -51,6 +59,9 @@ void BumpPtrAllocator::StartNewSlab() {
   if (BytesAllocated >= SlabSize * 128)
     SlabSize *= 2;
 
+  if (CurSlab)
+    BytesLeftInSlabs += End - CurPtr;
+
   MemSlab *NewSlab = Allocator.Allocate(SlabSize);
   NewSlab->NextPtr = CurSlab;
   CurSlab = NewSlab;
@@ -84,6 +95,7 @@ void BumpPtrAllocator::Reset() {
   CurPtr = (char*)(CurSlab + 1);
   End = ((char*)CurSlab) + CurSlab->Size;
   BytesAllocated = 0;
+  BytesLeftInSlabs = 0;
 }
 
 /// Allocate - Allocate space at the specified alignment.
@@ -164,7 +176,71 @@ void BumpPtrAllocator::PrintStats() const {
          << "Bytes used: " << BytesAllocated << '\n'
          << "Bytes allocated: " << TotalMemory << '\n'
          << "Bytes wasted: " << (TotalMemory - BytesAllocated)
-         << " (includes alignment, etc)\n";
+         << " (includes alignment, etc)\n"
+         << "Bytes left at the end of slabs: " << BytesLeftInSlabs;
+  if (NumSlabs > 1)
+    errs() << " (" << BytesLeftInSlabs / (NumSlabs - 1) << " per full slab)";
+  errs() << '\n';
+}
+
+ConcurrentBumpPtrAllocator::~ConcurrentBumpPtrAllocator() {
+  for (unsigned i = 0, e = ThreadAllocators.size(); i != e; ++i)
+    delete ThreadAllocators[i];
+}
+
+BumpPtrAllocator &ConcurrentBumpPtrAllocator::createThreadAllocator() {
+  BumpPtrAllocator *A = new BumpPtrAllocator(SlabSize, SizeThreshold,
+                                             Allocator);
+  {
+    MutexGuard Guard(Lock);
+    ThreadAllocators.push_back(A);
+  }
+  ThreadAllocator.set(A);
+  return *A;
+}
+
+void ConcurrentBumpPtrAllocator::Reset() {
+  // The thread allocators stay, since other threads still refer to theirs.
+  MutexGuard Guard(Lock);
+  for (unsigned i = 0, e = ThreadAllocators.size(); i != e; ++i)
+    ThreadAllocators[i]->Reset();
+}
+
+unsigned ConcurrentBumpPtrAllocator::GetNumSlabs() const {
+  MutexGuard Guard(Lock);
+  unsigned NumSlabs = 0;
+  for (unsigned i = 0, e = ThreadAllocators.size(); i != e; ++i)
+    NumSlabs += ThreadAllocators[i]->GetNumSlabs();
+  return NumSlabs;
+}
+
+size_t ConcurrentBumpPtrAllocator::getTotalMemory() const {
+  MutexGuard Guard(Lock);
+  size_t TotalMemory = 0;
+  for (unsigned i = 0, e = ThreadAllocators.size(); i != e; ++i)
+    TotalMemory += ThreadAllocators[i]->getTotalMemory();
+  return TotalMemory;
+}
+
+void ConcurrentBumpPtrAllocator::PrintStats() const {
+  MutexGuard Guard(Lock);
+  size_t BytesAllocated = 0, BytesLeftInSlabs = 0, TotalMemory = 0;
+  unsigned NumSlabs = 0;
+  for (unsigned i = 0, e = ThreadAllocators.size(); i != e; ++i) {
+    BumpPtrAllocator *A = ThreadAllocators[i];
+    BytesAllocated += A->getBytesAllocated();
+    BytesLeftInSlabs += A->getBytesLeftInSlabs();
+    TotalMemory += A->getTotalMemory();
+    NumSlabs += A->GetNumSlabs();
+  }
+
+  errs() << "\nNumber of threads: " << ThreadAllocators.size() << '\n'
+         << "Number of memory regions: " << NumSlabs << '\n'
+         << "Bytes used: " << BytesAllocated << '\n'
+         << "Bytes allocated: " << TotalMemory << '\n'
+         << "Bytes wasted: " << (TotalMemory - BytesAllocated)
+         << " (includes alignment, etc)\n"
+         << "Bytes left at the end of slabs: " << BytesLeftInSlabs << '\n';
 }
 
 MallocSlabAllocator BumpPtrAllocator::DefaultSlabAllocator =
@@ -185,6 +261,179 @@ void MallocSlabAllocator::Deallocate(MemSlab *Slab) {
   Allocator.Deallocate(Slab);
 }
 
+MappedSlabAllocator::~MappedSlabAllocator() { }
+
+MemSlab *MappedSlabAllocator::Allocate(size_t Size) {
+  error_code EC;
+  sys::MemoryBlock Block =
+    sys::Memory::allocateMappedMemory(Size, 0,
+                                      sys::Memory::MF_READ |
+                                      sys::Memory::MF_WRITE, EC);
+  if (EC)
+    report_fatal_error("Unable to map a slab: " + EC.message());
+  if (HugePages)
+    sys::Memory::adviseHugePages(Block);
+
+  MemSlab *Slab = (MemSlab*)Block.base();
+  Slab->Size = Block.size();
+  Slab->NextPtr = 0;
+  return Slab;
+}
+
+void MappedSlabAllocator::Deallocate(MemSlab *Slab) {
+  sys::MemoryBlock Block(Slab, Slab->Size);
+  sys::Memory::releaseMappedMemory(Block);
+}
+
+namespace {
+/// NumCachedSizes - The number of power of two sizes CachingSlabAllocator
+/// keeps slabs of.
+const unsigned NumCachedSizes = 9;
+}
+
+/// SlabCache - Lists of free slabs, one for every cached size, linked through
+/// their NextPtr.
+struct CachingSlabAllocator::SlabCache {
+  MemSlab *Free[NumCachedSizes];
+  size_t Bytes;
+
+  /// Owner - The allocator a thread cache belongs to.
+  CachingSlabAllocator *Owner;
+
+  explicit SlabCache(CachingSlabAllocator *Owner = 0)
+    : Bytes(0), Owner(Owner) {
+    std::fill(Free, Free + NumCachedSizes, (MemSlab*)0);
+  }
+
+  MemSlab *pop(unsigned Bin) {
+    MemSlab *Slab = Free[Bin];
+    if (!Slab)
+      return 0;
+    Free[Bin] = Slab->NextPtr;
+    Slab->NextPtr = 0;
+    Bytes -= Slab->Size;
+    return Slab;
+  }
+
+  bool push(unsigned Bin, MemSlab *Slab, size_t MaxBytes) {
+    if (Bytes + Slab->Size > MaxBytes)
+      return false;
+    Slab->NextPtr = Free[Bin];
+    Free[Bin] = Slab;
+    Bytes += Slab->Size;
+    return true;
+  }
+
+  void clear(SlabAllocator &Underlying) {
+    for (unsigned i = 0; i != NumCachedSizes; ++i)
+      while (MemSlab *Slab = pop(i))
+        Underlying.Deallocate(Slab);
+  }
+};
+
+/// getCachedSizeBin - Return the list that keeps slabs of Size bytes, or -1
+/// if they are not cached.
+static int getCachedSizeBin(size_t Size) {
+  if (Size < CachingSlabAllocator::MinCachedSize ||
+      Size > CachingSlabAllocator::MaxCachedSize || !isPowerOf2_64(Size))
+    return -1;
+  return Log2_64(Size) - Log2_64(CachingSlabAllocator::MinCachedSize);
+}
+
+CachingSlabAllocator::CachingSlabAllocator(SlabAllocator &underlying,
+                                           size_t maxThreadBytes,
+                                           size_t maxSharedBytes)
+    : Underlying(underlying), MaxThreadBytes(maxThreadBytes),
+      MaxSharedBytes(maxSharedBytes), ThreadCache(releaseThreadCache),
+      Shared(new SlabCache()) {
+  if (!sys::ThreadLocalImpl::hasThreadExitDestructors())
+    MaxSharedBytes += MaxThreadBytes;
+}
+
+CachingSlabAllocator::~CachingSlabAllocator() {
+  for (unsigned i = 0, e = ThreadCaches.size(); i != e; ++i) {
+    ThreadCaches[i]->clear(Underlying);
+    delete ThreadCaches[i];
+  }
+  Shared->clear(Underlying);
+  delete Shared;
+}
+
+/// getThreadCache - Return the cache of the calling thread, or null if the
+/// cache could not be released when the thread exits.
+CachingSlabAllocator::SlabCache *CachingSlabAllocator::getThreadCache() {
+  if (const SlabCache *Cache = ThreadCache.get())
+    return const_cast<SlabCache*>(Cache);
+  if (!sys::ThreadLocalImpl::hasThreadExitDestructors())
+    return 0;
+  SlabCache *Cache = new SlabCache(this);
+  {
+    MutexGuard Guard(Lock);
+    ThreadCaches.push_back(Cache);
+  }
+  ThreadCache.set(Cache);
+  return Cache;
+}
+
+/// releaseThreadCache - Move the slabs of a thread that exits to the shared
+/// pool, and free those it has no room for.
+void CachingSlabAllocator::releaseThreadCache(void *C) {
+  SlabCache *Cache = static_cast<SlabCache*>(C);
+  CachingSlabAllocator &A = *Cache->Owner;
+  {
+    MutexGuard Guard(A.Lock);
+    A.ThreadCaches.erase(std::find(A.ThreadCaches.begin(),
+                                   A.ThreadCaches.end(), Cache));
+    for (unsigned i = 0; i != NumCachedSizes; ++i)
+      while (MemSlab *Slab = Cache->pop(i))
+        if (!A.Shared->push(i, Slab, A.MaxSharedBytes))
+          A.Underlying.Deallocate(Slab);
+  }
+  delete Cache;
+}
+
+MemSlab *CachingSlabAllocator::Allocate(size_t Size) {
+  int Bin = getCachedSizeBin(Size);
+  if (Bin < 0)
+    return Underlying.Allocate(Size);
+
+  MemSlab *Slab = 0;
+  if (SlabCache *Cache = getThreadCache())
+    Slab = Cache->pop(Bin);
+  if (!Slab) {
+    MutexGuard Guard(Lock);
+    Slab = Shared->pop(Bin);
+  }
+  if (!Slab)
+    return Underlying.Allocate(Size);
+  ++NumSlabsReused;
+  return Slab;
+}
+
+void CachingSlabAllocator::Deallocate(MemSlab *Slab) {
+  int Bin = getCachedSizeBin(Slab->Size);
+  if (Bin >= 0) {
+    SlabCache *Cache = getThreadCache();
+    if (Cache && Cache->push(Bin, Slab, MaxThreadBytes))
+      return;
+    bool Kept;
+    {
+      MutexGuard Guard(Lock);
+      Kept = Shared->push(Bin, Slab, MaxSharedBytes);
+    }
+    if (Kept)
+      return;
+  }
+  Underlying.Deallocate(Slab);
+}
+
+size_t CachingSlabAllocator::getCachedBytes() const {
+  size_t Bytes = Shared->Bytes;
+  for (unsigned i = 0, e = ThreadCaches.size(); i != e; ++i)
+    Bytes += ThreadCaches[i]->Bytes;
+  return Bytes;
+}
+
 void PrintRecyclerStats(size_t Size,
                         size_t Align,
                         size_t FreeListSize) {
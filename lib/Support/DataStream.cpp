@@ -89,7 +89,7 @@ DataStreamer *getDataFileStreamer(const std::string &Filename,
   DataFileStreamer *s = new DataFileStreamer();
   if (error_code e = s->OpenFile(Filename)) {
     *StrError = std::string("Could not open ") + Filename + ": " +
-        e.message() + "\n";
+        e.message();
     return NULL;
   }
   return s;
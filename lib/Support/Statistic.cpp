@@ -28,6 +28,7 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocal.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cstring>
@@ -53,27 +54,51 @@ class StatisticInfo {
   std::vector<const Statistic*> Stats;
   friend void llvm::PrintStatistics();
   friend void llvm::PrintStatistics(raw_ostream &OS);
+  friend void llvm::GetStatistics(std::vector<StatisticValue> &Values,
+                                  bool Reset);
 public:
   ~StatisticInfo();
 
-  void addStatistic(const Statistic *S) {
+  /// addStatistic - Register \p S, returning its index.
+  unsigned addStatistic(const Statistic *S) {
     Stats.push_back(S);
+    return Stats.size() - 1;
   }
 };
+
+/// NumShards - Each thread updates the counters of the shard it was assigned
+/// to, so that threads only share counters (and their cache lines) once there
+/// are more threads than shards.
+const unsigned NumShards = 16;
+const unsigned MaxChunks =
+  Statistic::MaxShardedStatistics / Statistic::ShardChunkSize;
 }
 
 static ManagedStatic<StatisticInfo> StatInfo;
 static ManagedStatic<sys::SmartMutex<true> > StatLock;
 
+/// ShardChunks - The counters of each shard, one per registered statistic,
+/// allocated in chunks as statistics get registered.  The chunks of a shard
+/// are never shared with another shard.  They are not owned by StatInfo, so
+/// that updating a statistic does not go through a ManagedStatic, and so that
+/// threads can keep pointers to them across llvm_shutdown.
+static volatile sys::cas_flag *ShardChunks[NumShards][MaxChunks];
+static volatile sys::cas_flag NextThreadShard;
+
+#ifdef LLVM_THREAD_LOCAL
+LLVM_THREAD_LOCAL volatile sys::cas_flag **Statistic::ThreadChunks;
+#else
+static ManagedStatic<sys::ThreadLocal<volatile sys::cas_flag *> > ThreadChunks;
+#endif
+
 /// RegisterStatistic - The first time a statistic is bumped, this method is
 /// called.
 void Statistic::RegisterStatistic() {
-  // If stats are enabled, inform StatInfo that this statistic should be
-  // printed.
+  // Every statistic is registered, so that it can be read whether or not it
+  // is printed at exit.
   sys::SmartScopedLock<true> Writer(*StatLock);
   if (!Initialized) {
-    if (Enabled)
-      StatInfo->addStatistic(this);
+    Index = StatInfo->addStatistic(this);
 
     TsanHappensBefore(this);
     sys::MemoryFence();
@@ -84,6 +109,74 @@ void Statistic::RegisterStatistic() {
   }
 }
 
+unsigned Statistic::addSlow(sys::cas_flag Delta) {
+  if (Index >= MaxShardedStatistics)
+    return sys::AtomicAdd(&Value, Delta);
+
+  // Threads are handed out to the shards round robin.
+#ifdef LLVM_THREAD_LOCAL
+  volatile sys::cas_flag **Chunks = ThreadChunks;
+#else
+  volatile sys::cas_flag **Chunks = ::ThreadChunks->get();
+#endif
+  if (!Chunks) {
+    unsigned Shard = (sys::AtomicIncrement(&NextThreadShard) - 1) % NumShards;
+    Chunks = ShardChunks[Shard];
+#ifdef LLVM_THREAD_LOCAL
+    ThreadChunks = Chunks;
+#else
+    ::ThreadChunks->set(Chunks);
+#endif
+  }
+
+  volatile sys::cas_flag *&Chunk = Chunks[Index / ShardChunkSize];
+  if (!Chunk) {
+    sys::SmartScopedLock<true> Writer(*StatLock);
+    if (!Chunk) {
+      volatile sys::cas_flag *Counters = new sys::cas_flag[ShardChunkSize]();
+      // Make the zeroed chunk visible before the pointer to it.
+      sys::MemoryFence();
+      Chunk = Counters;
+    }
+  }
+  return sys::AtomicAdd(&Chunk[Index % ShardChunkSize], Delta) + Value;
+}
+
+unsigned Statistic::getValue() const {
+  sys::cas_flag Sum = Value;
+  if (!Initialized || Index >= MaxShardedStatistics)
+    return Sum;
+
+  for (unsigned i = 0; i != NumShards; ++i)
+    if (volatile sys::cas_flag *Chunk = ShardChunks[i][Index / ShardChunkSize])
+      Sum += Chunk[Index % ShardChunkSize];
+  return Sum;
+}
+
+/// takeValue - Return the value of \p S, and take what was read off each of
+/// its counters, which leaves the updates made in the meantime in place.
+static unsigned takeValue(Statistic &S) {
+  sys::cas_flag Sum = S.Value;
+  sys::AtomicAdd(&S.Value, -Sum);
+  if (!S.Initialized || S.Index >= Statistic::MaxShardedStatistics)
+    return Sum;
+
+  for (unsigned i = 0; i != NumShards; ++i)
+    if (volatile sys::cas_flag *Chunk =
+          ShardChunks[i][S.Index / Statistic::ShardChunkSize]) {
+      volatile sys::cas_flag &Counter =
+        Chunk[S.Index % Statistic::ShardChunkSize];
+      sys::cas_flag Count = Counter;
+      sys::AtomicAdd(&Counter, -Count);
+      Sum += Count;
+    }
+  return Sum;
+}
+
+void Statistic::set(unsigned Val) {
+  sys::AtomicAdd(&Value, Val - getValue());
+}
+
 namespace {
 
 struct NameCompare {
@@ -112,6 +205,7 @@ bool llvm::AreStatisticsEnabled() {
 }
 
 void llvm::PrintStatistics(raw_ostream &OS) {
+  sys::SmartScopedLock<true> Reader(*StatLock);
   StatisticInfo &Stats = *StatInfo;
 
   // Figure out how long the biggest Value and Name fields are.
@@ -143,11 +237,48 @@ void llvm::PrintStatistics(raw_ostream &OS) {
 
 }
 
+void llvm::GetStatistics(std::vector<StatisticValue> &Values, bool Reset) {
+  sys::SmartScopedLock<true> Reader(*StatLock);
+  StatisticInfo &Stats = *StatInfo;
+  std::stable_sort(Stats.Stats.begin(), Stats.Stats.end(), NameCompare());
+
+  Values.clear();
+  Values.reserve(Stats.Stats.size());
+  for (size_t i = 0, e = Stats.Stats.size(); i != e; ++i) {
+    Statistic *S = const_cast<Statistic*>(Stats.Stats[i]);
+    StatisticValue V = { S->getName(), S->getDesc(),
+                         Reset ? takeValue(*S) : S->getValue() };
+    Values.push_back(V);
+  }
+}
+
+void llvm::ResetStatistics() {
+  std::vector<StatisticValue> Values;
+  GetStatistics(Values, /*Reset=*/true);
+}
+
+void llvm::PrintStatisticsJSON(raw_ostream &OS) {
+  std::vector<StatisticValue> Values;
+  GetStatistics(Values);
+
+  OS << "[";
+  for (size_t i = 0, e = Values.size(); i != e; ++i) {
+    OS << (i ? ",\n" : "\n") << "  {\"name\": ";
+    OS.write_json_string(Values[i].Name);
+    OS << ", \"desc\": ";
+    OS.write_json_string(Values[i].Desc);
+    OS << ", \"value\": " << Values[i].Value << "}";
+  }
+  OS << "\n]\n";
+  OS.flush();
+}
+
 void llvm::PrintStatistics() {
 #if !defined(NDEBUG) || defined(LLVM_ENABLE_STATS)
+  // Statistics not enabled?  Statistics are registered either way, so check
+  // the option first.
+  if (!Enabled) return;
   StatisticInfo &Stats = *StatInfo;
-
-  // Statistics not enabled?
   if (Stats.Stats.empty()) return;
 
   // Get the stream to write to.
@@ -12,11 +12,60 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/StringMap.h"
-#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Compiler.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/SwapByteOrder.h"
 #include <cassert>
 using namespace llvm;
 
+/// readWord - Read the eight bytes at P as a little-endian word, whatever
+/// their alignment.
+static inline uint64_t readWord(const char *P) {
+  uint64_t W;
+  memcpy(&W, P, sizeof(W));
+  if (sys::IsBigEndianHost)
+    W = sys::SwapByteOrder_64(W);
+  return W;
+}
+
+/// mixWord - Fold the word W into the hash state H.
+static inline uint64_t mixWord(uint64_t H, uint64_t W) {
+  H = (H ^ W) * 0x9E3779B97F4A7C15ULL;
+  return H ^ (H >> 32);
+}
+
+/// hash - Hash Key eight bytes at a time.  Only the low bits of the result
+/// pick the first bucket, so the state is mixed well at the end.  The result
+/// does not depend on the host, so neither does the iteration order of a map.
+unsigned StringMapImpl::hash(StringRef Key) {
+  const char *P = Key.data();
+  size_t Size = Key.size();
+  uint64_t H = Size * 0xC2B2AE3D27D4EB4FULL;
+
+  for (; Size >= 8; P += 8, Size -= 8)
+    H = mixWord(H, readWord(P));
+
+  if (Size) {
+    // Read the last few bytes as one more word.  If the key is long enough,
+    // reread some of the bytes before them rather than go byte by byte.
+    uint64_t W = 0;
+    if (Key.size() >= 8)
+      W = readWord(P + Size - 8) >> (8 * (8 - Size));
+    else
+      for (unsigned i = 0; i != Size; ++i)
+        W |= uint64_t((unsigned char)P[i]) << (8 * i);
+    H = mixWord(H, W);
+  }
+
+  // Finish with the 64-bit finalizer of MurmurHash3.
+  H ^= H >> 33;
+  H *= 0xFF51AFD7ED558CCDULL;
+  H ^= H >> 33;
+  H *= 0xC4CEB9FE1A85EC53ULL;
+  H ^= H >> 33;
+  return unsigned(H);
+}
+
 StringMapImpl::StringMapImpl(unsigned InitSize, unsigned itemSize) {
   ItemSize = itemSize;
   
@@ -61,7 +110,7 @@ unsigned StringMapImpl::LookupBucketFor(StringRef Name) {
     init(16);
     HTSize = NumBuckets;
   }
-  unsigned FullHashValue = HashString(Name);
+  unsigned FullHashValue = hash(Name);
   unsigned BucketNo = FullHashValue & (HTSize-1);
   unsigned *HashTable = (unsigned *)(TheTable + NumBuckets + 1);
 
@@ -116,7 +165,7 @@ unsigned StringMapImpl::LookupBucketFor(StringRef Name) {
 int StringMapImpl::FindKey(StringRef Key) const {
   unsigned HTSize = NumBuckets;
   if (HTSize == 0) return -1;  // Really empty table?
-  unsigned FullHashValue = HashString(Key);
+  unsigned FullHashValue = hash(Key);
   unsigned BucketNo = FullHashValue & (HTSize-1);
   unsigned *HashTable = (unsigned *)(TheTable + NumBuckets + 1);
 
@@ -23,7 +23,7 @@
 // Define all methods as no-ops if threading is explicitly disabled
 namespace llvm {
 using namespace sys;
-ThreadLocalImpl::ThreadLocalImpl() { }
+ThreadLocalImpl::ThreadLocalImpl(void (*)(void*)) { }
 ThreadLocalImpl::~ThreadLocalImpl() { }
 void ThreadLocalImpl::setInstance(const void* d) {
   typedef int SIZE_TOO_BIG[sizeof(d) <= sizeof(data) ? 1 : -1];
@@ -37,6 +37,9 @@ const void* ThreadLocalImpl::getInstance() {
 void ThreadLocalImpl::removeInstance() {
   setInstance(0);
 }
+bool ThreadLocalImpl::hasThreadExitDestructors() {
+  return false;
+}
 }
 #else
 
@@ -49,10 +52,10 @@ void ThreadLocalImpl::removeInstance() {
 namespace llvm {
 using namespace sys;
 
-ThreadLocalImpl::ThreadLocalImpl() : data() {
+ThreadLocalImpl::ThreadLocalImpl(void (*Destructor)(void*)) : data() {
   typedef int SIZE_TOO_BIG[sizeof(pthread_key_t) <= sizeof(data) ? 1 : -1];
   pthread_key_t* key = reinterpret_cast<pthread_key_t*>(&data);
-  int errorcode = pthread_key_create(key, NULL);
+  int errorcode = pthread_key_create(key, Destructor);
   assert(errorcode == 0);
   (void) errorcode;
 }
@@ -80,6 +83,10 @@ void ThreadLocalImpl::removeInstance() {
   setInstance(0);
 }
 
+bool ThreadLocalImpl::hasThreadExitDestructors() {
+  return true;
+}
+
 }
 
 #elif defined(LLVM_ON_UNIX)
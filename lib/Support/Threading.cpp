@@ -15,6 +15,8 @@
 #include "llvm/Config/config.h"
 #include "llvm/Support/Atomic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/MutexGuard.h"
+#include <vector>
 #include <cassert>
 
 using namespace llvm;
@@ -63,6 +65,39 @@ void llvm::llvm_release_global_lock() {
   if (multithreaded_mode) global_lock->release();
 }
 
+namespace {
+/// ParallelTasks - State shared by the threads spawned from
+/// llvm_execute_on_threads.  Each worker repeatedly claims the next task index
+/// until all of them have been handed out.
+struct ParallelTasks {
+  void (*UserFn)(void *, unsigned);
+  void *UserData;
+  unsigned NumTasks;
+  unsigned NextTask;
+  sys::Mutex Lock;
+
+  ParallelTasks(void (*Fn)(void *, unsigned), void *Data, unsigned N)
+    : UserFn(Fn), UserData(Data), NumTasks(N), NextTask(0) {}
+
+  void run() {
+    for (;;) {
+      unsigned Task;
+      {
+        MutexGuard Guard(Lock);
+        if (NextTask == NumTasks)
+          return;
+        Task = NextTask++;
+      }
+      UserFn(UserData, Task);
+    }
+  }
+
+  static void dispatch(void *Arg) {
+    reinterpret_cast<ParallelTasks*>(Arg)->run();
+  }
+};
+} // end anonymous namespace
+
 #if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
 #include <pthread.h>
 
@@ -102,6 +137,73 @@ void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
  error:
   ::pthread_attr_destroy(&Attr);
 }
+
+void llvm::llvm_execute_on_threads(void (*Fn)(void*, unsigned), void *UserData,
+                                   unsigned NumTasks, unsigned NumThreads,
+                                   unsigned RequestedStackSize) {
+  ParallelTasks Tasks(Fn, UserData, NumTasks);
+  ThreadInfo Info = { ParallelTasks::dispatch, &Tasks };
+  std::vector<pthread_t> Threads;
+  pthread_attr_t Attr;
+
+  if (NumThreads > NumTasks)
+    NumThreads = NumTasks;
+
+  if (NumThreads > 1 && ::pthread_attr_init(&Attr) == 0) {
+    if (RequestedStackSize == 0 ||
+        ::pthread_attr_setstacksize(&Attr, RequestedStackSize) == 0) {
+      // The calling thread works too, so only spawn NumThreads-1 helpers.
+      for (unsigned i = 1; i < NumThreads; ++i) {
+        pthread_t Thread;
+        if (::pthread_create(&Thread, &Attr, ExecuteOnThread_Dispatch,
+                             &Info) != 0)
+          break;
+        Threads.push_back(Thread);
+      }
+    }
+    ::pthread_attr_destroy(&Attr);
+  }
+
+  // Whatever could not be handed to a helper thread runs here.
+  Tasks.run();
+
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+    ::pthread_join(Threads[i], 0);
+}
+
+struct llvm::llvm_thread {
+  ThreadInfo Info;
+  pthread_t Thread;
+  bool Started;
+};
+
+llvm_thread *llvm::llvm_start_thread(void (*Fn)(void*), void *UserData,
+                                     unsigned RequestedStackSize) {
+  llvm_thread *T = new llvm_thread();
+  T->Info.UserFn = Fn;
+  T->Info.UserData = UserData;
+  T->Started = false;
+
+  pthread_attr_t Attr;
+  if (::pthread_attr_init(&Attr) == 0) {
+    if (RequestedStackSize == 0 ||
+        ::pthread_attr_setstacksize(&Attr, RequestedStackSize) == 0)
+      T->Started = ::pthread_create(&T->Thread, &Attr,
+                                    ExecuteOnThread_Dispatch, &T->Info) == 0;
+    ::pthread_attr_destroy(&Attr);
+  }
+
+  // Without a thread, do the work right away.
+  if (!T->Started)
+    Fn(UserData);
+  return T;
+}
+
+void llvm::llvm_join_thread(llvm_thread *T) {
+  if (T->Started)
+    ::pthread_join(T->Thread, 0);
+  delete T;
+}
 #elif LLVM_ENABLE_THREADS!=0 && defined(LLVM_ON_WIN32)
 #include "Windows/Windows.h"
 #include <process.h>
@@ -136,6 +238,63 @@ void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
     ::CloseHandle(hThread);
   }
 }
+
+void llvm::llvm_execute_on_threads(void (*Fn)(void*, unsigned), void *UserData,
+                                   unsigned NumTasks, unsigned NumThreads,
+                                   unsigned RequestedStackSize) {
+  ParallelTasks Tasks(Fn, UserData, NumTasks);
+  struct ThreadInfo param = { ParallelTasks::dispatch, &Tasks };
+  std::vector<HANDLE> Threads;
+
+  if (NumThreads > NumTasks)
+    NumThreads = NumTasks;
+
+  // The calling thread works too, so only spawn NumThreads-1 helpers.
+  for (unsigned i = 1; i < NumThreads; ++i) {
+    HANDLE hThread = (HANDLE)::_beginthreadex(NULL,
+                                              RequestedStackSize,
+                                              ThreadCallback,
+                                              &param, 0, NULL);
+    if (!hThread)
+      break;
+    Threads.push_back(hThread);
+  }
+
+  // Whatever could not be handed to a helper thread runs here.
+  Tasks.run();
+
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i) {
+    (void)::WaitForSingleObject(Threads[i], INFINITE);
+    ::CloseHandle(Threads[i]);
+  }
+}
+
+struct llvm::llvm_thread {
+  ThreadInfo Info;
+  HANDLE Thread;
+};
+
+llvm_thread *llvm::llvm_start_thread(void (*Fn)(void*), void *UserData,
+                                     unsigned RequestedStackSize) {
+  llvm_thread *T = new llvm_thread();
+  T->Info.func = Fn;
+  T->Info.param = UserData;
+  T->Thread = (HANDLE)::_beginthreadex(NULL, RequestedStackSize,
+                                       ThreadCallback, &T->Info, 0, NULL);
+
+  // Without a thread, do the work right away.
+  if (!T->Thread)
+    Fn(UserData);
+  return T;
+}
+
+void llvm::llvm_join_thread(llvm_thread *T) {
+  if (T->Thread) {
+    (void)::WaitForSingleObject(T->Thread, INFINITE);
+    ::CloseHandle(T->Thread);
+  }
+  delete T;
+}
 #else
 // Support for non-Win32, non-pthread implementation.
 void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
@@ -144,4 +303,26 @@ void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
   Fn(UserData);
 }
 
+void llvm::llvm_execute_on_threads(void (*Fn)(void*, unsigned), void *UserData,
+                                   unsigned NumTasks, unsigned NumThreads,
+                                   unsigned RequestedStackSize) {
+  (void) NumThreads;
+  (void) RequestedStackSize;
+  for (unsigned i = 0; i != NumTasks; ++i)
+    Fn(UserData, i);
+}
+
+struct llvm::llvm_thread {};
+
+llvm_thread *llvm::llvm_start_thread(void (*Fn)(void*), void *UserData,
+                                     unsigned RequestedStackSize) {
+  (void) RequestedStackSize;
+  Fn(UserData);
+  return new llvm_thread();
+}
+
+void llvm::llvm_join_thread(llvm_thread *T) {
+  delete T;
+}
+
 #endif
@@ -215,6 +215,20 @@ raw_ostream &raw_ostream::write_escaped(StringRef Str,
   return *this;
 }
 
+raw_ostream &raw_ostream::write_json_string(StringRef Str) {
+  *this << '"';
+  for (unsigned i = 0, e = Str.size(); i != e; ++i) {
+    unsigned char c = Str[i];
+    if (c == '"' || c == '\\')
+      *this << '\\' << c;
+    else if (c < 0x20)
+      *this << "\\u00" << hexdigit(c >> 4) << hexdigit(c & 0xF);
+    else
+      *this << c;
+  }
+  return *this << '"';
+}
+
 raw_ostream &raw_ostream::operator<<(const void *P) {
   *this << '0' << 'x';
 
@@ -419,13 +433,21 @@ void format_object_base::home() {
 //  raw_fd_ostream
 //===----------------------------------------------------------------------===//
 
+/// isRegularFile - Return true if FD refers to a regular file.  Devices such
+/// as /dev/null accept lseek but do not keep the position, so only what is
+/// written to a regular file can be seeked back over.
+static bool isRegularFile(int FD) {
+  struct stat Stat;
+  return ::fstat(FD, &Stat) == 0 && (Stat.st_mode & S_IFMT) == S_IFREG;
+}
+
 /// raw_fd_ostream - Open the specified file for writing. If an error
 /// occurs, information about the error is put into ErrorInfo, and the
 /// stream should be immediately destroyed; the string will be empty
 /// if no error occurred.
 raw_fd_ostream::raw_fd_ostream(const char *Filename, std::string &ErrorInfo,
                                unsigned Flags)
-  : Error(false), UseAtomicWrites(false), pos(0)
+  : Error(false), UseAtomicWrites(false), SupportsSeeking(false), pos(0)
 {
   assert(Filename != 0 && "Filename is null");
   // Verify that we don't have both "append" and "excl".
@@ -469,6 +491,10 @@ raw_fd_ostream::raw_fd_ostream(const char *Filename, std::string &ErrorInfo,
     }
   }
 
+  // Writes to a file opened for appending always go to its end.
+  SupportsSeeking = !(Flags & F_Append) && isRegularFile(FD) &&
+                    ::lseek(FD, 0, SEEK_CUR) == 0;
+
   // Ok, we successfully opened the file, so it'll need to be closed.
   ShouldClose = true;
 }
@@ -487,6 +513,14 @@ raw_fd_ostream::raw_fd_ostream(int fd, bool shouldClose, bool unbuffered)
 
   // Get the starting position.
   off_t loc = ::lseek(FD, 0, SEEK_CUR);
+  SupportsSeeking = loc != (off_t)-1 && isRegularFile(FD);
+#ifdef F_GETFL
+  // Writes to a file opened for appending always go to its end.
+  if (SupportsSeeking) {
+    int FDFlags = ::fcntl(FD, F_GETFL);
+    SupportsSeeking = FDFlags != -1 && !(FDFlags & O_APPEND);
+  }
+#endif
   if (loc == (off_t)-1)
     pos = 0;
   else
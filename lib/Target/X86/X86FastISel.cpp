@@ -111,6 +111,11 @@ private:
   bool X86SelectFPExt(const Instruction *I);
   bool X86SelectFPTrunc(const Instruction *I);
 
+  bool X86SelectSIToFP(const Instruction *I);
+
+  bool X86SelectVectorLogic(const Instruction *I);
+  bool X86SelectExtractElement(const Instruction *I);
+
   bool X86VisitIntrinsicCall(const IntrinsicInst &I);
   bool X86SelectCall(const Instruction *I);
 
@@ -1464,6 +1469,113 @@ bool X86FastISel::X86SelectFPTrunc(const Instruction *I) {
   return false;
 }
 
+bool X86FastISel::X86SelectSIToFP(const Instruction *I) {
+  const Value *V = I->getOperand(0);
+  Type *SrcTy = V->getType();
+  if (!SrcTy->isIntegerTy(32) && !SrcTy->isIntegerTy(64))
+    return false;
+  bool Is64 = SrcTy->isIntegerTy(64);
+  if (Is64 && !Subtarget->is64Bit())
+    return false;
+
+  bool HasAVX = Subtarget->hasAVX();
+  unsigned Opc;
+  const TargetRegisterClass *RC;
+  if (I->getType()->isDoubleTy() && X86ScalarSSEf64) {
+    if (HasAVX)
+      Opc = Is64 ? X86::VCVTSI2SD64rr : X86::VCVTSI2SDrr;
+    else
+      Opc = Is64 ? X86::CVTSI2SD64rr : X86::CVTSI2SDrr;
+    RC = &X86::FR64RegClass;
+  } else if (I->getType()->isFloatTy() && X86ScalarSSEf32) {
+    if (HasAVX)
+      Opc = Is64 ? X86::VCVTSI2SS64rr : X86::VCVTSI2SSrr;
+    else
+      Opc = Is64 ? X86::CVTSI2SS64rr : X86::CVTSI2SSrr;
+    RC = &X86::FR32RegClass;
+  } else
+    return false;
+
+  unsigned OpReg = getRegForValue(V);
+  if (OpReg == 0) return false;
+
+  // The VEX forms take the upper elements of the result from an extra source,
+  // which is undefined here.
+  unsigned UpperReg = 0;
+  if (HasAVX) {
+    UpperReg = createResultReg(RC);
+    BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL,
+            TII.get(TargetOpcode::IMPLICIT_DEF), UpperReg);
+  }
+
+  unsigned ResultReg = createResultReg(RC);
+  MachineInstrBuilder MIB =
+    BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(Opc), ResultReg);
+  if (UpperReg)
+    MIB.addReg(UpperReg);
+  MIB.addReg(OpReg);
+  UpdateValueMap(I, ResultReg);
+  return true;
+}
+
+/// X86SelectVectorLogic - Select and, or and xor of 128-bit integer vectors.
+/// The tablegen'erated selector only knows about v2i64, but the instructions
+/// don't care about the element type.
+bool X86FastISel::X86SelectVectorLogic(const Instruction *I) {
+  MVT VT;
+  if (!Subtarget->hasSSE2() || !isTypeLegal(I->getType(), VT) ||
+      !VT.isInteger() || !VT.is128BitVector())
+    return false;
+
+  bool HasAVX = Subtarget->hasAVX();
+  unsigned Opc;
+  switch (I->getOpcode()) {
+  default: llvm_unreachable("Unexpected logic operation!");
+  case Instruction::And: Opc = HasAVX ? X86::VPANDrr : X86::PANDrr; break;
+  case Instruction::Or:  Opc = HasAVX ? X86::VPORrr : X86::PORrr; break;
+  case Instruction::Xor: Opc = HasAVX ? X86::VPXORrr : X86::PXORrr; break;
+  }
+
+  unsigned Op0Reg = getRegForValue(I->getOperand(0));
+  if (Op0Reg == 0) return false;
+  unsigned Op1Reg = getRegForValue(I->getOperand(1));
+  if (Op1Reg == 0) return false;
+  unsigned ResultReg = createResultReg(&X86::VR128RegClass);
+  BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(Opc), ResultReg)
+    .addReg(Op0Reg).addReg(Op1Reg);
+  UpdateValueMap(I, ResultReg);
+  return true;
+}
+
+/// X86SelectExtractElement - Select extracting the first element of a float
+/// or double vector, which is just a copy to the scalar register class.
+bool X86FastISel::X86SelectExtractElement(const Instruction *I) {
+  const ConstantInt *Idx = dyn_cast<ConstantInt>(I->getOperand(1));
+  if (!Idx || !Idx->isZero())
+    return false;
+
+  MVT VecVT;
+  if (!isTypeLegal(I->getOperand(0)->getType(), VecVT) ||
+      !VecVT.is128BitVector())
+    return false;
+
+  const TargetRegisterClass *RC;
+  if (VecVT == MVT::v4f32 && X86ScalarSSEf32)
+    RC = &X86::FR32RegClass;
+  else if (VecVT == MVT::v2f64 && X86ScalarSSEf64)
+    RC = &X86::FR64RegClass;
+  else
+    return false;
+
+  unsigned OpReg = getRegForValue(I->getOperand(0));
+  if (OpReg == 0) return false;
+  unsigned ResultReg = createResultReg(RC);
+  BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(TargetOpcode::COPY),
+          ResultReg).addReg(OpReg);
+  UpdateValueMap(I, ResultReg);
+  return true;
+}
+
 bool X86FastISel::X86SelectTrunc(const Instruction *I) {
   EVT SrcVT = TLI.getValueType(I->getOperand(0)->getType());
   EVT DstVT = TLI.getValueType(I->getType());
@@ -1596,6 +1708,83 @@ bool X86FastISel::X86VisitIntrinsicCall(const IntrinsicInst &I) {
 
     return DoSelectCall(&I, "memset");
   }
+  case Intrinsic::memmove: {
+    const MemMoveInst &MMI = cast<MemMoveInst>(I);
+
+    if (MMI.isVolatile())
+      return false;
+
+    unsigned SizeWidth = Subtarget->is64Bit() ? 64 : 32;
+    if (!MMI.getLength()->getType()->isIntegerTy(SizeWidth))
+      return false;
+
+    if (MMI.getSourceAddressSpace() > 255 || MMI.getDestAddressSpace() > 255)
+      return false;
+
+    return DoSelectCall(&I, "memmove");
+  }
+  case Intrinsic::sqrt: {
+    bool HasAVX = Subtarget->hasAVX();
+    unsigned Opc;
+    const TargetRegisterClass *RC;
+    if (I.getType()->isDoubleTy() && X86ScalarSSEf64) {
+      Opc = HasAVX ? X86::VSQRTSDr : X86::SQRTSDr;
+      RC = &X86::FR64RegClass;
+    } else if (I.getType()->isFloatTy() && X86ScalarSSEf32) {
+      Opc = HasAVX ? X86::VSQRTSSr : X86::SQRTSSr;
+      RC = &X86::FR32RegClass;
+    } else
+      return false;
+
+    unsigned OpReg = getRegForValue(I.getArgOperand(0));
+    if (OpReg == 0)
+      return false;
+
+    // As for sitofp, the VEX forms have an extra source for the upper
+    // elements.
+    unsigned UpperReg = 0;
+    if (HasAVX) {
+      UpperReg = createResultReg(RC);
+      BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL,
+              TII.get(TargetOpcode::IMPLICIT_DEF), UpperReg);
+    }
+
+    unsigned ResultReg = createResultReg(RC);
+    MachineInstrBuilder MIB =
+      BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(Opc), ResultReg);
+    if (UpperReg)
+      MIB.addReg(UpperReg);
+    MIB.addReg(OpReg);
+    UpdateValueMap(&I, ResultReg);
+    return true;
+  }
+  case Intrinsic::ctpop: {
+    if (!Subtarget->hasPOPCNT())
+      return false;
+
+    MVT VT;
+    if (!isTypeLegal(I.getType(), VT))
+      return false;
+    unsigned Opc;
+    const TargetRegisterClass *RC;
+    if (VT == MVT::i32) {
+      Opc = X86::POPCNT32rr;
+      RC = &X86::GR32RegClass;
+    } else if (VT == MVT::i64) {
+      Opc = X86::POPCNT64rr;
+      RC = &X86::GR64RegClass;
+    } else
+      return false;
+
+    unsigned OpReg = getRegForValue(I.getArgOperand(0));
+    if (OpReg == 0)
+      return false;
+    unsigned ResultReg = createResultReg(RC);
+    BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(Opc), ResultReg)
+      .addReg(OpReg);
+    UpdateValueMap(&I, ResultReg);
+    return true;
+  }
   case Intrinsic::stackprotector: {
     // Emit code to store the stack guard onto the stack.
     EVT PtrTy = TLI.getPointerTy();
@@ -1627,11 +1816,14 @@ bool X86FastISel::X86VisitIntrinsicCall(const IntrinsicInst &I) {
     return true;
   }
   case Intrinsic::sadd_with_overflow:
-  case Intrinsic::uadd_with_overflow: {
+  case Intrinsic::uadd_with_overflow:
+  case Intrinsic::ssub_with_overflow:
+  case Intrinsic::usub_with_overflow:
+  case Intrinsic::smul_with_overflow: {
     // FIXME: Should fold immediates.
 
-    // Replace "add with overflow" intrinsics with an "add" instruction followed
-    // by a seto/setc instruction.
+    // Replace "op with overflow" intrinsics with the arithmetic instruction
+    // followed by a seto/setb instruction.
     const Function *Callee = I.getCalledFunction();
     Type *RetTy =
       cast<StructType>(Callee->getReturnType())->getTypeAtIndex(unsigned(0));
@@ -1649,13 +1841,23 @@ bool X86FastISel::X86VisitIntrinsicCall(const IntrinsicInst &I) {
       // FIXME: Handle values *not* in registers.
       return false;
 
-    unsigned OpC = 0;
-    if (VT == MVT::i32)
-      OpC = X86::ADD32rr;
-    else if (VT == MVT::i64)
-      OpC = X86::ADD64rr;
-    else
+    if (VT != MVT::i32 && VT != MVT::i64)
       return false;
+    bool Is64 = VT == MVT::i64;
+    unsigned OpC, Opc;
+    switch (I.getIntrinsicID()) {
+    default: llvm_unreachable("Unexpected overflow intrinsic!");
+    case Intrinsic::sadd_with_overflow:
+      OpC = Is64 ? X86::ADD64rr : X86::ADD32rr;  Opc = X86::SETOr; break;
+    case Intrinsic::uadd_with_overflow:
+      OpC = Is64 ? X86::ADD64rr : X86::ADD32rr;  Opc = X86::SETBr; break;
+    case Intrinsic::ssub_with_overflow:
+      OpC = Is64 ? X86::SUB64rr : X86::SUB32rr;  Opc = X86::SETOr; break;
+    case Intrinsic::usub_with_overflow:
+      OpC = Is64 ? X86::SUB64rr : X86::SUB32rr;  Opc = X86::SETBr; break;
+    case Intrinsic::smul_with_overflow:
+      OpC = Is64 ? X86::IMUL64rr : X86::IMUL32rr; Opc = X86::SETOr; break;
+    }
 
     // The call to CreateRegs builds two sequential registers, to store the
     // both the returned values.
@@ -1663,9 +1865,6 @@ bool X86FastISel::X86VisitIntrinsicCall(const IntrinsicInst &I) {
     BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(OpC), ResultReg)
       .addReg(Reg1).addReg(Reg2);
 
-    unsigned Opc = X86::SETBr;
-    if (I.getIntrinsicID() == Intrinsic::sadd_with_overflow)
-      Opc = X86::SETOr;
     BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(Opc), ResultReg+1);
 
     UpdateValueMap(&I, ResultReg, 2);
@@ -2247,6 +2446,14 @@ X86FastISel::TargetSelectInstruction(const Instruction *I)  {
     return X86SelectFPExt(I);
   case Instruction::FPTrunc:
     return X86SelectFPTrunc(I);
+  case Instruction::SIToFP:
+    return X86SelectSIToFP(I);
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+    return X86SelectVectorLogic(I);
+  case Instruction::ExtractElement:
+    return X86SelectExtractElement(I);
   case Instruction::IntToPtr: // Deliberate fall-through.
   case Instruction::PtrToInt: {
     EVT SrcVT = TLI.getValueType(I->getOperand(0)->getType());
@@ -0,0 +1,116 @@
+//===- OrderUseLists.cpp - Put use-lists in the order of the module -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass sorts the use-list of every value used by an instruction, so that
+// the instructions using it come in the order of the module: by function, then
+// by basic block, then by position in the block.  Use-lists are built by
+// pushing every new use at the front, so after reading or parsing a module
+// they come in roughly the reverse order.  Passes that walk the users of a
+// value, such as InstCombine and GVN, then touch instructions that are close to
+// each other one after the other.  Other users, such as constant expressions,
+// go after the instructions, in the order they were in.
+//
+// Running this right after reading bitcode orders the use-lists once for the
+// whole pipeline.  Passes that add uses push them at the front again.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "order-use-lists"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+using namespace llvm;
+
+STATISTIC(NumUseLists, "Number of use-lists with more than one use");
+STATISTIC(NumUseListsSorted, "Number of use-lists put in module order");
+
+namespace {
+  /// UseOrder - Order Uses by the position of their user in the module.
+  struct UseOrder {
+    const DenseMap<const User*, unsigned> &Positions;
+    explicit UseOrder(const DenseMap<const User*, unsigned> &P)
+      : Positions(P) {}
+
+    unsigned getPosition(const Use &U) const {
+      DenseMap<const User*, unsigned>::const_iterator I =
+        Positions.find(U.getUser());
+      return I == Positions.end() ? ~0U : I->second;
+    }
+
+    bool operator()(const Use &L, const Use &R) const {
+      return getPosition(L) < getPosition(R);
+    }
+  };
+
+  struct OrderUseLists : public ModulePass {
+    static char ID; // Pass identification, replacement for typeid
+    OrderUseLists() : ModulePass(ID) {
+      initializeOrderUseListsPass(*PassRegistry::getPassRegistry());
+    }
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      AU.setPreservesAll();
+    }
+
+    virtual bool runOnModule(Module &M);
+  };
+}
+
+char OrderUseLists::ID = 0;
+INITIALIZE_PASS(OrderUseLists, "order-use-lists",
+                "Sort use-lists in the order of the module", false, false)
+
+ModulePass *llvm::createOrderUseListsPass() {
+  return new OrderUseLists();
+}
+
+/// isSorted - Return true if the use-list of V is already in order.
+static bool isSorted(const Value *V, const UseOrder &Order) {
+  Value::const_use_iterator I = V->use_begin(), E = V->use_end();
+  unsigned Last = Order.getPosition(I.getUse());
+  for (++I; I != E; ++I) {
+    unsigned Position = Order.getPosition(I.getUse());
+    if (Position < Last)
+      return false;
+    Last = Position;
+  }
+  return true;
+}
+
+bool OrderUseLists::runOnModule(Module &M) {
+  DenseMap<const User*, unsigned> Positions;
+  for (Module::iterator F = M.begin(), FE = M.end(); F != FE; ++F)
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I)
+        Positions.insert(std::make_pair(&*I, Positions.size()));
+  UseOrder Order(Positions);
+
+  // Only values that are used by an instruction have users to order.
+  bool Changed = false;
+  SmallPtrSet<Value*, 64> Visited;
+  for (Module::iterator F = M.begin(), FE = M.end(); F != FE; ++F)
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I)
+        for (User::op_iterator OI = I->op_begin(), OE = I->op_end();
+             OI != OE; ++OI) {
+          Value *V = *OI;
+          if (!V || V->hasOneUse() || !Visited.insert(V))
+            continue;
+          ++NumUseLists;
+          if (isSorted(V, Order))
+            continue;
+          V->sortUseList(Order);
+          ++NumUseListsSorted;
+          Changed = true;
+        }
+  return Changed;
+}
@@ -0,0 +1,258 @@
+//===-- SplitModule.cpp - Divide a Module into partitions -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This family of functions divides the global definitions of a Module between
+// a number of partitions which can then be processed independently.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/ContentHash.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Module.h"
+#include <algorithm>
+
+using namespace llvm;
+
+/// isPinnedToFirstPartition - Return true if GV must live in partition 0:
+/// the llvm.* globals that describe the module as a whole, aliases and their
+/// aliasees (an alias must be emitted together with its target).
+static bool isPinnedToFirstPartition(const GlobalValue &GV) {
+  return GV.getName().startswith("llvm.") || GV.hasAppendingLinkage() ||
+         isa<GlobalAlias>(GV);
+}
+
+void llvm::promoteLocalSymbols(Module &M,
+                               std::vector<PromotedSymbol> *Promoted) {
+  std::vector<GlobalValue*> Locals;
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+    if (I->hasLocalLinkage() && !I->isDeclaration())
+      Locals.push_back(I);
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I)
+    if (I->hasLocalLinkage() && !I->isDeclaration() &&
+        !isPinnedToFirstPartition(*I))
+      Locals.push_back(I);
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end();
+       I != E; ++I)
+    if (I->hasLocalLinkage())
+      Locals.push_back(I);
+
+  // Unnamed locals are named after their contents rather than numbered, so
+  // that editing one part of the module does not rename symbols elsewhere and
+  // change partitions that did not change otherwise.  The contents are hashed
+  // before anything is renamed, since renaming changes the hash of the users.
+  std::vector<std::string> NewNames(Locals.size());
+  for (unsigned i = 0, e = Locals.size(); i != e; ++i) {
+    GlobalValue *GV = Locals[i];
+    if (GV->hasName())
+      NewNames[i] = (GV->getName() + ".llvm.part").str();
+    else
+      NewNames[i] = "__llvm_part." + hashGlobalContent(*GV).str();
+  }
+
+  for (unsigned i = 0, e = Locals.size(); i != e; ++i) {
+    GlobalValue *GV = Locals[i];
+    PromotedSymbol PS;
+    PS.OriginalName = GV->getName();
+    PS.Linkage = GV->getLinkage();
+    PS.Visibility = GV->getVisibility();
+
+    // setName appends a unique suffix if the name is already taken, which for
+    // unnamed locals only happens to ones with the same contents.
+    GV->setName(NewNames[i]);
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+    GV->setVisibility(GlobalValue::HiddenVisibility);
+
+    if (Promoted) {
+      PS.Name = GV->getName();
+      Promoted->push_back(PS);
+    }
+  }
+}
+
+void llvm::restorePromotedSymbols(Module &M,
+                                  const std::vector<PromotedSymbol> &Promoted) {
+  for (unsigned i = 0, e = Promoted.size(); i != e; ++i) {
+    const PromotedSymbol &PS = Promoted[i];
+    GlobalValue *GV = M.getNamedValue(PS.Name);
+    if (!GV)
+      continue;
+    GV->setName(PS.OriginalName);
+    GV->setLinkage(PS.Linkage);
+    GV->setVisibility(PS.Visibility);
+  }
+}
+
+/// pinAliases - Assign aliases and their aliasees to partition 0, since an
+/// alias must be emitted next to what it aliases.
+static void pinAliases(Module &M, StringMap<unsigned> &Owner) {
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end();
+       I != E; ++I) {
+    Owner[I->getName()] = 0;
+    if (const GlobalValue *Aliasee = I->getAliasedGlobal())
+      Owner[Aliasee->getName()] = 0;
+  }
+}
+
+void llvm::partitionModule(Module &M, unsigned NumPartitions,
+                           StringMap<unsigned> &Owner) {
+  std::vector<uint64_t> Load(NumPartitions, 0);
+  pinAliases(M, Owner);
+
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    if (I->isDeclaration() || Owner.count(I->getName()))
+      continue;
+    uint64_t Size = 1;
+    for (Function::iterator BB = I->begin(), BE = I->end(); BB != BE; ++BB)
+      Size += BB->size();
+    unsigned Part = std::min_element(Load.begin(), Load.end()) - Load.begin();
+    Owner[I->getName()] = Part;
+    Load[Part] += Size;
+  }
+
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I) {
+    if (I->isDeclaration() || Owner.count(I->getName()))
+      continue;
+    if (isPinnedToFirstPartition(*I)) {
+      Owner[I->getName()] = 0;
+      continue;
+    }
+    unsigned Part = std::min_element(Load.begin(), Load.end()) - Load.begin();
+    Owner[I->getName()] = Part;
+    Load[Part] += 1;
+  }
+}
+
+void llvm::partitionModuleByName(Module &M, unsigned NumPartitions,
+                                 StringMap<unsigned> &Owner) {
+  pinAliases(M, Owner);
+
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+    if (!I->isDeclaration() && !Owner.count(I->getName()))
+      Owner[I->getName()] = HashString(I->getName()) % NumPartitions;
+
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I) {
+    if (I->isDeclaration() || Owner.count(I->getName()))
+      continue;
+    Owner[I->getName()] = isPinnedToFirstPartition(*I)
+                            ? 0 : HashString(I->getName()) % NumPartitions;
+  }
+}
+
+/// isOwnedBy - Return true if GV is defined in partition Part.
+static bool isOwnedBy(const GlobalValue &GV, const StringMap<unsigned> &Owner,
+                      unsigned Part) {
+  StringMap<unsigned>::const_iterator I = Owner.find(GV.getName());
+  return I != Owner.end() && I->second == Part;
+}
+
+/// refersToBlockAddress - Return true if C refers to a basic block, which
+/// only works in the partition that owns the block's function.
+static bool refersToBlockAddress(const Constant *C,
+                                 SmallPtrSet<const Constant*, 8> &Visited) {
+  if (isa<BlockAddress>(C))
+    return true;
+  if (isa<GlobalValue>(C) || !Visited.insert(C))
+    return false;
+  for (unsigned i = 0, e = C->getNumOperands(); i != e; ++i)
+    if (refersToBlockAddress(cast<Constant>(C->getOperand(i)), Visited))
+      return true;
+  return false;
+}
+
+/// isFoldableConstant - Return true if loads from GV can be folded to its
+/// initializer, so that optimizing a partition that uses GV should see it.
+static bool isFoldableConstant(const GlobalVariable &GV) {
+  SmallPtrSet<const Constant*, 8> Visited;
+  return GV.isConstant() && GV.hasDefinitiveInitializer() &&
+         !isPinnedToFirstPartition(GV) &&
+         !refersToBlockAddress(GV.getInitializer(), Visited);
+}
+
+bool llvm::extractPartition(Module &M, const StringMap<unsigned> &Owner,
+                            unsigned Part, std::string &ErrMsg) {
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    if (!I->isMaterializable() && I->isDeclaration())
+      continue;
+    if (isOwnedBy(*I, Owner, Part)) {
+      if (I->Materialize(&ErrMsg))
+        return true;
+      continue;
+    }
+    // Bodies that were never materialized are simply forgotten.
+    if (!I->isMaterializable())
+      I->deleteBody();
+    I->setLinkage(GlobalValue::ExternalLinkage);
+  }
+
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ) {
+    GlobalVariable *GV = I++;
+    if (GV->isDeclaration() || isOwnedBy(*GV, Owner, Part))
+      continue;
+    if (GV->hasAppendingLinkage()) {
+      // llvm.used, llvm.global_ctors and friends only live in partition 0.
+      GV->eraseFromParent();
+      continue;
+    }
+    if (isFoldableConstant(*GV)) {
+      // Keep a copy of the initializer, so that the partition is optimized
+      // the same way as the whole module would be.
+      GV->setLinkage(GlobalValue::AvailableExternallyLinkage);
+      continue;
+    }
+    GV->setInitializer(0);
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+  }
+
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end();
+       I != E; ) {
+    GlobalAlias *GA = I++;
+    if (isOwnedBy(*GA, Owner, Part))
+      continue;
+    // Replace the alias by a declaration of the symbol it defines.
+    GlobalValue *Decl;
+    Type *Ty = GA->getType()->getElementType();
+    if (FunctionType *FTy = dyn_cast<FunctionType>(Ty))
+      Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, "", &M);
+    else
+      Decl = new GlobalVariable(M, Ty, false, GlobalValue::ExternalLinkage, 0,
+                                "", 0, GlobalVariable::NotThreadLocal,
+                                GA->getType()->getAddressSpace());
+    Decl->takeName(GA);
+    Decl->setVisibility(GA->getVisibility());
+    GA->replaceAllUsesWith(Decl);
+    GA->eraseFromParent();
+  }
+
+  if (Part != 0)
+    M.setModuleInlineAsm("");
+  return false;
+}
+
+void llvm::dropPartitionCopies(Module &M, const StringMap<unsigned> &Owner,
+                               unsigned Part) {
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I) {
+    StringMap<unsigned>::const_iterator O = Owner.find(I->getName());
+    if (I->isDeclaration() || O == Owner.end() || O->second == Part)
+      continue;
+    I->setInitializer(0);
+    I->setLinkage(GlobalValue::ExternalLinkage);
+  }
+}
@@ -0,0 +1,24 @@
+@data = global [4 x i32] [i32 1, i32 2, i32 3, i32 4]
+
+define i32 @main() {
+  %1 = call i32 @sum(i32* getelementptr ([4 x i32]* @data, i32 0, i32 0), i32 4)
+  ret i32 %1
+}
+
+define i32 @sum(i32* %array, i32 %count) {
+start:
+  br label %body
+
+body:
+  %index = phi i32 [ 0, %start ], [ %index.1, %body ]
+  %total = phi i32 [ 0, %start ], [ %total.1, %body ]
+  %ptr = getelementptr inbounds i32* %array, i32 %index
+  %elt = load i32* %ptr, align 4
+  %total.1 = add nsw i32 %total, %elt
+  %index.1 = add i32 %index, 1
+  %cmp = icmp eq i32 %index.1, %count
+  br i1 %cmp, label %end, label %body
+
+end:
+  ret i32 %total.1
+}
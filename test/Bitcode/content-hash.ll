@@ -0,0 +1,56 @@
+; With -enable-bc-content-hash, the module block has the hashes of the module
+; and of its functions. They stay the same when locals are renamed and when
+; functions are moved, which Inputs/content-hash.ll does.
+; RUN: llvm-as -enable-bc-content-hash < %s | llvm-bcanalyzer -dump > %t
+; RUN: llvm-as -enable-bc-content-hash < %p/Inputs/content-hash.ll | \
+; RUN:   llvm-bcanalyzer -dump >> %t
+; RUN: FileCheck %s < %t
+; RUN: llvm-as -enable-bc-content-hash < %s | llvm-dis | \
+; RUN:   FileCheck %s -check-prefix=DIS
+
+; The hashes are not written by default.
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=NOHASH
+
+; The block comes before the function bodies.
+; CHECK: <CONTENT_HASH_BLOCK
+; CHECK-NEXT: <MODULE op0={{.*}}/> hash = [[MODULE:[0-9a-f]+]]
+; CHECK-NEXT: <FUNCTION {{.*}}/> hash = [[SUM:[0-9a-f]+]]
+; CHECK-NEXT: <FUNCTION {{.*}}/> hash = [[MAIN:[0-9a-f]+]]
+; CHECK-NEXT: </CONTENT_HASH_BLOCK>
+; CHECK: <FUNCTION_BLOCK
+
+; CHECK: <CONTENT_HASH_BLOCK
+; CHECK-NEXT: <MODULE op0={{.*}}/> hash = {{[0-9a-f]+}}
+; CHECK-NEXT: <FUNCTION {{.*}}/> hash = [[MAIN]]
+; CHECK-NEXT: <FUNCTION {{.*}}/> hash = [[SUM]]
+; CHECK-NEXT: </CONTENT_HASH_BLOCK>
+
+; NOHASH-NOT: CONTENT_HASH_BLOCK
+
+; DIS: define i32 @sum(i32* %p, i32 %n)
+; DIS: define i32 @main()
+
+@data = global [4 x i32] [i32 1, i32 2, i32 3, i32 4]
+
+define i32 @sum(i32* %p, i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %addr = getelementptr inbounds i32* %p, i32 %i
+  %v = load i32* %addr, align 4
+  %acc.next = add nsw i32 %acc, %v
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %acc.next
+}
+
+define i32 @main() {
+  %r = call i32 @sum(i32* getelementptr ([4 x i32]* @data, i32 0, i32 0), i32 4)
+  ret i32 %r
+}
@@ -0,0 +1,56 @@
+; On request, the module block ends with an index of the function bodies,
+; which lazy readers use to find a body without skipping over the ones before
+; it.
+; RUN: llvm-as -enable-bc-function-index < %s | llvm-bcanalyzer -dump | \
+; RUN:   FileCheck %s
+; RUN: llvm-as -enable-bc-function-index < %s | llvm-dis | \
+; RUN:   FileCheck %s -check-prefix=DIS
+; RUN: llvm-as -enable-bc-function-index < %s | llvm-extract -func=c | \
+; RUN:   llvm-dis | FileCheck %s -check-prefix=EXTRACT
+
+; By default there is no index, and the bodies are found by skipping over them.
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=NOINDEX
+; RUN: llvm-as < %s | llvm-dis | FileCheck %s -check-prefix=DIS
+
+; CHECK: <MODULE_BLOCK
+; CHECK: <FNINDEXOFFSET
+; CHECK: <FUNCTION_BLOCK
+; CHECK: <FUNCTION_BLOCK
+; CHECK: <FUNCTION_BLOCK
+; CHECK: <FUNCTION_INDEX_BLOCK
+; CHECK-NEXT: <ENTRY
+; CHECK-NEXT: <ENTRY
+; CHECK-NEXT: <ENTRY
+; CHECK-NEXT: </FUNCTION_INDEX_BLOCK>
+; CHECK-NEXT: </MODULE_BLOCK>
+
+; NOINDEX-NOT: FNINDEXOFFSET
+; NOINDEX-NOT: FUNCTION_INDEX_BLOCK
+
+; DIS: define i32 @a()
+; DIS-NEXT: ret i32 1
+; DIS: define i32 @b()
+; DIS-NEXT: ret i32 2
+; DIS: define i32 @c()
+; DIS-NEXT: %x = call i32 @a()
+; DIS-NEXT: ret i32 %x
+
+; EXTRACT: declare i32 @a()
+; EXTRACT-NOT: @b
+; EXTRACT: define i32 @c()
+; EXTRACT-NEXT: %x = call i32 @a()
+
+declare i32 @ext()
+
+define i32 @a() {
+  ret i32 1
+}
+
+define i32 @b() {
+  ret i32 2
+}
+
+define i32 @c() {
+  %x = call i32 @a()
+  ret i32 %x
+}
@@ -0,0 +1,47 @@
+; Function bodies encoded on several threads, or streamed into a file, come out
+; exactly as when the whole module is encoded in memory on one thread.
+; RUN: llvm-as < %s > %t.bc
+; RUN: llvm-as %s -o %t.file.bc
+; RUN: cmp %t.bc %t.file.bc
+; RUN: llvm-as -bitcode-writer-threads=3 < %s > %t.parallel.bc
+; RUN: cmp %t.bc %t.parallel.bc
+; RUN: llvm-as -bitcode-writer-threads=3 %s -o %t.parallel.file.bc
+; RUN: cmp %t.bc %t.parallel.file.bc
+; RUN: llvm-dis < %t.parallel.file.bc | FileCheck %s
+
+@g = global i32 7
+
+; CHECK: define i32 @a(i32 %x)
+; CHECK-NEXT: %y = add i32 %x, 1
+define i32 @a(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+declare i32 @external(i32)
+
+; CHECK: define i32 @b(i32 %x)
+; CHECK-NEXT: %y = call i32 @a(i32 %x)
+; CHECK-NEXT: %z = call i32 @external(i32 %y)
+define i32 @b(i32 %x) {
+  %y = call i32 @a(i32 %x)
+  %z = call i32 @external(i32 %y)
+  ret i32 %z
+}
+
+; CHECK: define i32 @c()
+; CHECK-NEXT: %v = load i32* @g
+; CHECK-NEXT: %w = mul i32 %v, 3
+define i32 @c() {
+  %v = load i32* @g
+  %w = mul i32 %v, 3
+  store i32 %w, i32* @g
+  ret i32 %w
+}
+
+; CHECK: define float @d(float %f)
+; CHECK-NEXT: %r = fadd float %f, 1.500000e+00
+define float @d(float %f) {
+  %r = fadd float %f, 1.5
+  ret float %r
+}
@@ -0,0 +1,117 @@
+; RUN: llc < %s -fast-isel -O0 -mattr=-avx,+popcnt -verify-machineinstrs | FileCheck %s
+; RUN: llc < %s -fast-isel -O0 -mattr=+avx -verify-machineinstrs | FileCheck %s --check-prefix=AVX
+; RUN: llc < %s -fast-isel -O0 -mattr=-avx,+popcnt -fast-isel-verbose -o /dev/null 2>&1 | FileCheck %s --check-prefix=MISS
+; RUN: rm -f %t
+; RUN: llc < %s -fast-isel -O0 -mattr=-avx,+popcnt -fast-isel-report=%t -o /dev/null
+; RUN: FileCheck %s --check-prefix=REPORT < %t
+
+target triple = "x86_64-unknown-linux-gnu"
+
+define float @sitofp_f32(i32 %a) nounwind {
+  %r = sitofp i32 %a to float
+  ret float %r
+}
+; CHECK: sitofp_f32:
+; CHECK: cvtsi2ssl %edi, %xmm0
+; AVX: sitofp_f32:
+; AVX: vcvtsi2ssl %edi, %xmm{{[0-9]+}}, %xmm0
+
+define double @sitofp_f64_i64(i64 %a) nounwind {
+  %r = sitofp i64 %a to double
+  ret double %r
+}
+; CHECK: sitofp_f64_i64:
+; CHECK: cvtsi2sdq %rdi, %xmm0
+; AVX: sitofp_f64_i64:
+; AVX: vcvtsi2sdq %rdi, %xmm{{[0-9]+}}, %xmm0
+
+define double @sqrt_f64(double %a) nounwind {
+  %r = call double @llvm.sqrt.f64(double %a)
+  ret double %r
+}
+; CHECK: sqrt_f64:
+; CHECK: sqrtsd
+; AVX: sqrt_f64:
+; AVX: vsqrtsd %xmm0, %xmm{{[0-9]+}}, %xmm0
+
+define i32 @ctpop_i32(i32 %a) nounwind {
+  %r = call i32 @llvm.ctpop.i32(i32 %a)
+  ret i32 %r
+}
+; CHECK: ctpop_i32:
+; CHECK: popcntl %edi
+
+define void @memmove(i8* %a, i8* %b, i64 %n) nounwind {
+  call void @llvm.memmove.p0i8.p0i8.i64(i8* %a, i8* %b, i64 %n, i32 1, i1 false)
+  ret void
+}
+; CHECK: memmove:
+; CHECK: callq memmove
+
+define i32 @ssub_overflow(i32 %a, i32 %b) nounwind {
+  %r = call {i32, i1} @llvm.ssub.with.overflow.i32(i32 %a, i32 %b)
+  %o = extractvalue {i32, i1} %r, 1
+  %z = zext i1 %o to i32
+  ret i32 %z
+}
+; CHECK: ssub_overflow:
+; CHECK: subl
+; CHECK: seto
+
+define i32 @usub_overflow(i64 %a, i64 %b) nounwind {
+  %r = call {i64, i1} @llvm.usub.with.overflow.i64(i64 %a, i64 %b)
+  %o = extractvalue {i64, i1} %r, 1
+  %z = zext i1 %o to i32
+  ret i32 %z
+}
+; CHECK: usub_overflow:
+; CHECK: subq
+; CHECK: setb
+
+define i32 @smul_overflow(i32 %a, i32 %b) nounwind {
+  %r = call {i32, i1} @llvm.smul.with.overflow.i32(i32 %a, i32 %b)
+  %o = extractvalue {i32, i1} %r, 1
+  %z = zext i1 %o to i32
+  ret i32 %z
+}
+; CHECK: smul_overflow:
+; CHECK: imull
+; CHECK: seto
+
+define <4 x i32> @xor_v4i32(<4 x i32> %a, <4 x i32> %b) nounwind {
+  %r = xor <4 x i32> %a, %b
+  ret <4 x i32> %r
+}
+; CHECK: xor_v4i32:
+; CHECK: pxor
+; AVX: xor_v4i32:
+; AVX: vpxor
+
+define float @extract_v4f32(<4 x float> %a) nounwind {
+  %r = extractelement <4 x float> %a, i32 0
+  ret float %r
+}
+; CHECK: extract_v4f32:
+; CHECK-NOT: shufps
+; CHECK: ret
+
+; Still handed to SelectionDAG.
+define i32 @fallback(float %a) nounwind {
+  %r = fptoui float %a to i32
+  ret i32 %r
+}
+
+; MISS-NOT: FastISel miss
+; MISS: FastISel miss: {{.*}}fptoui
+; MISS-NOT: FastISel miss
+
+; REPORT: {"module":"<stdin>","reason":"arguments","fallbacks":{{[0-9]+}},"instrs":0}
+; REPORT-NEXT: {"module":"<stdin>","reason":"fptoui","fallbacks":1,"instrs":1}
+; REPORT-NOT: reason
+
+declare double @llvm.sqrt.f64(double)
+declare i32 @llvm.ctpop.i32(i32)
+declare void @llvm.memmove.p0i8.p0i8.i64(i8*, i8*, i64, i32, i1)
+declare {i32, i1} @llvm.ssub.with.overflow.i32(i32, i32)
+declare {i64, i1} @llvm.usub.with.overflow.i64(i64, i64)
+declare {i32, i1} @llvm.smul.with.overflow.i32(i32, i32)
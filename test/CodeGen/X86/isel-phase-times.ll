@@ -0,0 +1,54 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -isel-phase-times 2>&1 >/dev/null | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -mcpu=x86-64 | FileCheck %s -check-prefix=CODE
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -O0 -isel-phase-times 2>&1 >/dev/null | FileCheck %s
+
+; One line per function, with the time of every phase.
+; CHECK: isel phase times for 'f': build {{[0-9]+\.[0-9]+}} combine {{[0-9]+\.[0-9]+}} legalize {{[0-9]+\.[0-9]+}} select {{[0-9]+\.[0-9]+}} schedule {{[0-9]+\.[0-9]+}}
+; CHECK: isel phase times for 'g': build
+
+define i32 @f(i32 %a, i32 %b) {
+entry:
+  %c = icmp slt i32 %a, %b
+  br i1 %c, label %then, label %exit
+
+then:
+  %s = add i32 %a, %b
+  br label %exit
+
+exit:
+  %r = phi i32 [ %s, %then ], [ %a, %entry ]
+  ret i32 %r
+}
+
+; The vectors are built from nodes whose operand lists come from the recycler.
+; The lists of the entry block are given back when the DAG is cleared and are
+; reused for the next block, so check that each block still gets its own
+; operands.
+; CODE-LABEL: g:
+; CODE: pinsrw $0, %edi, %xmm0
+; CODE-NEXT: pinsrw $1, %esi, %xmm0
+; CODE-NEXT: pinsrw $5, %edi, %xmm0
+; CODE: %other
+; CODE-NEXT: pinsrw $2, %esi, %xmm1
+; CODE-NEXT: pinsrw $3, %edi, %xmm1
+; CODE-NEXT: pinsrw $7, %esi, %xmm1
+; CODE-NEXT: paddw %xmm0, %xmm1
+; CODE: %exit
+; CODE-NEXT: ret
+define <8 x i16> @g(i16 %a, i16 %b, i1 %c) {
+entry:
+  %v0 = insertelement <8 x i16> undef, i16 %a, i32 0
+  %v1 = insertelement <8 x i16> %v0, i16 %b, i32 1
+  %v2 = insertelement <8 x i16> %v1, i16 %a, i32 5
+  br i1 %c, label %other, label %exit
+
+other:
+  %w0 = insertelement <8 x i16> undef, i16 %b, i32 2
+  %w1 = insertelement <8 x i16> %w0, i16 %a, i32 3
+  %w2 = insertelement <8 x i16> %w1, i16 %b, i32 7
+  %w = add <8 x i16> %w2, %v2
+  ret <8 x i16> %w
+
+exit:
+  ret <8 x i16> %v2
+}
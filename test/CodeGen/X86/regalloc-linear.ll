@@ -0,0 +1,126 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -regalloc=linear -verify-machineinstrs -stats 2>&1 | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -O1 -debug-pass=Structure -o /dev/null 2>&1 | FileCheck %s --check-prefix=DEFAULT
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -O1 -regalloc=linear -debug-pass=Structure -o /dev/null 2>&1 | FileCheck %s --check-prefix=LINEAR
+; REQUIRES: asserts
+;
+; More values are live across the loop than there are registers. The linear
+; scan allocator spills the lighter ones and never splits.
+;
+; CHECK-DAG: regalloc - Number of assigned live ranges spilled to make room
+; CHECK-DAG: regalloc - Number of live ranges spilled
+; CHECK-NOT: Number of split
+;
+; The linear scan allocator is only used when it is asked for.
+; DEFAULT: Greedy Register Allocator
+; LINEAR: Linear Scan Register Allocator
+
+@g = external global [64 x i32]
+define i32 @pressure(i32 %n) nounwind {
+entry:
+  %p0 = getelementptr [64 x i32]* @g, i32 0, i32 0
+  %a0 = load volatile i32* %p0
+  %p1 = getelementptr [64 x i32]* @g, i32 0, i32 1
+  %a1 = load volatile i32* %p1
+  %p2 = getelementptr [64 x i32]* @g, i32 0, i32 2
+  %a2 = load volatile i32* %p2
+  %p3 = getelementptr [64 x i32]* @g, i32 0, i32 3
+  %a3 = load volatile i32* %p3
+  %p4 = getelementptr [64 x i32]* @g, i32 0, i32 4
+  %a4 = load volatile i32* %p4
+  %p5 = getelementptr [64 x i32]* @g, i32 0, i32 5
+  %a5 = load volatile i32* %p5
+  %p6 = getelementptr [64 x i32]* @g, i32 0, i32 6
+  %a6 = load volatile i32* %p6
+  %p7 = getelementptr [64 x i32]* @g, i32 0, i32 7
+  %a7 = load volatile i32* %p7
+  %p8 = getelementptr [64 x i32]* @g, i32 0, i32 8
+  %a8 = load volatile i32* %p8
+  %p9 = getelementptr [64 x i32]* @g, i32 0, i32 9
+  %a9 = load volatile i32* %p9
+  %p10 = getelementptr [64 x i32]* @g, i32 0, i32 10
+  %a10 = load volatile i32* %p10
+  %p11 = getelementptr [64 x i32]* @g, i32 0, i32 11
+  %a11 = load volatile i32* %p11
+  %b0 = load volatile i32* %p0
+  %b1 = load volatile i32* %p7
+  %b2 = load volatile i32* %p2
+  %b3 = load volatile i32* %p9
+  %b4 = load volatile i32* %p4
+  %b5 = load volatile i32* %p11
+  %b6 = load volatile i32* %p6
+  %b7 = load volatile i32* %p1
+  %b8 = load volatile i32* %p8
+  %b9 = load volatile i32* %p3
+  %b10 = load volatile i32* %p10
+  %b11 = load volatile i32* %p5
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %l0 = load volatile i32* %p0
+  %m0 = mul i32 %l0, %a0
+  %s0 = add i32 %acc, %m0
+  %l1 = load volatile i32* %p1
+  %m1 = mul i32 %l1, %a1
+  %s1 = add i32 %s0, %m1
+  %l2 = load volatile i32* %p2
+  %m2 = mul i32 %l2, %a2
+  %s2 = add i32 %s1, %m2
+  %l3 = load volatile i32* %p3
+  %m3 = mul i32 %l3, %a3
+  %s3 = add i32 %s2, %m3
+  %l4 = load volatile i32* %p4
+  %m4 = mul i32 %l4, %a4
+  %s4 = add i32 %s3, %m4
+  %l5 = load volatile i32* %p5
+  %m5 = mul i32 %l5, %a5
+  %s5 = add i32 %s4, %m5
+  %l6 = load volatile i32* %p6
+  %m6 = mul i32 %l6, %a6
+  %s6 = add i32 %s5, %m6
+  %l7 = load volatile i32* %p7
+  %m7 = mul i32 %l7, %a7
+  %s7 = add i32 %s6, %m7
+  %l8 = load volatile i32* %p8
+  %m8 = mul i32 %l8, %a8
+  %s8 = add i32 %s7, %m8
+  %l9 = load volatile i32* %p9
+  %m9 = mul i32 %l9, %a9
+  %s9 = add i32 %s8, %m9
+  %l10 = load volatile i32* %p10
+  %m10 = mul i32 %l10, %a10
+  %s10 = add i32 %s9, %m10
+  %l11 = load volatile i32* %p11
+  %m11 = mul i32 %l11, %a11
+  %s11 = add i32 %s10, %m11
+  %acc.next = add i32 %s11, %i
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+exit:
+  %r11 = xor i32 %acc.next, %a11
+  %r10 = xor i32 %r11, %a10
+  %r9 = xor i32 %r10, %a9
+  %r8 = xor i32 %r9, %a8
+  %r7 = xor i32 %r8, %a7
+  %r6 = xor i32 %r7, %a6
+  %r5 = xor i32 %r6, %a5
+  %r4 = xor i32 %r5, %a4
+  %r3 = xor i32 %r4, %a3
+  %r2 = xor i32 %r3, %a2
+  %r1 = xor i32 %r2, %a1
+  %r0 = xor i32 %r1, %a0
+  %e0 = add i32 %r0, %b0
+  %e1 = add i32 %e0, %b1
+  %e2 = add i32 %e1, %b2
+  %e3 = add i32 %e2, %b3
+  %e4 = add i32 %e3, %b4
+  %e5 = add i32 %e4, %b5
+  %e6 = add i32 %e5, %b6
+  %e7 = add i32 %e6, %b7
+  %e8 = add i32 %e7, %b8
+  %e9 = add i32 %e8, %b9
+  %e10 = add i32 %e9, %b10
+  %e11 = add i32 %e10, %b11
+  ret i32 %e11
+}
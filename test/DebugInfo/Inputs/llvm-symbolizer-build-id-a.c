@@ -0,0 +1,19 @@
+int f(int x);
+
+__attribute__((section(".text.hot")))
+int g(int x) {
+  return x * 3;
+}
+
+int main(int argc, char **argv) {
+  return f(argc) + g(argc);
+}
+
+// Built with gcc 12.2.0
+// $ mkdir -p /tmp/dbginfo
+// $ cp llvm-symbolizer-build-id-*.c /tmp/dbginfo
+// $ cd /tmp/dbginfo
+// $ gcc -gdwarf-2 -gno-as-loc-support -fno-asynchronous-unwind-tables \
+//     -nostdlib -static -no-pie -Wl,--build-id -Wl,-e,main \
+//     llvm-symbolizer-build-id-*.c -o <output>
+// $ objcopy --remove-section .debug_aranges <output>
@@ -38,13 +38,13 @@
 ; Skip the output to the header of the pubnames section.
 ; CHECK: debug_pubnames
 
-; Check for each name in the output.
+; Check for each name in the output, in the order of their DIEs.
+; CHECK: global_variable
 ; CHECK: global_namespace_variable
 ; CHECK: global_namespace_function
+; CHECK: {{ }}member_function
 ; CHECK: static_member_function
-; CHECK: global_variable
 ; CHECK: global_function
-; CHECK: member_function
 
 %struct.C = type { i8 }
 
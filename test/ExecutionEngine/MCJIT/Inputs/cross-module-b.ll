@@ -0,0 +1,11 @@
+@B.offset = global i32 41
+
+declare i32 @FA(i32)
+
+define i32 @FB(i32 %x) {
+  %o = load i32* @B.offset
+  %y = add i32 %x, %o
+  %r = call i32 @FA(i32 %y)
+  %z = sub i32 %r, 41
+  ret i32 %z
+}
@@ -0,0 +1,17 @@
+; RUN: %lli_mcjit -extra-module=%p/Inputs/cross-module-b.ll %s > /dev/null
+; RUN: %lli_mcjit -disable-lazy-compilation -extra-module=%p/Inputs/cross-module-b.ll %s > /dev/null
+
+@A.value = global i32 1
+
+declare i32 @FB(i32)
+
+define i32 @FA(i32 %x) {
+  %r = sub i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @main() {
+  %v = load i32* @A.value
+  %r = call i32 @FB(i32 %v)
+  ret i32 %r
+}
@@ -0,0 +1,12 @@
+; RUN: rm -rf %t.cache
+; RUN: %lli_mcjit -object-cache-dir=%t.cache %s > /dev/null
+; RUN: ls %t.cache | FileCheck %s
+; RUN: %lli_mcjit -object-cache-dir=%t.cache %s > /dev/null
+; RUN: ls %t.cache | FileCheck %s
+
+; CHECK: {{^[0-9a-f]+}}.o
+; CHECK-NOT: .tmp
+
+define i32 @main() {
+  ret i32 0
+}
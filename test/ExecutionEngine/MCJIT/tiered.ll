@@ -0,0 +1,35 @@
+; RUN: %lli_mcjit -tiered-compilation -tier-up-threshold=10 %s > /dev/null
+; RUN: %lli_mcjit -tiered-compilation -tier-up-threshold=1 -O3 %s > /dev/null
+
+@total = internal global i64 0
+
+define internal void @accumulate(i32 %x) {
+entry:
+  %tmp = alloca i64
+  %ext = sext i32 %x to i64
+  store i64 %ext, i64* %tmp
+  %v = load i64* %tmp
+  %old = load i64* @total
+  %new = add i64 %old, %v
+  store i64 %new, i64* @total
+  ret void
+}
+
+define i32 @main() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  call void @accumulate(i32 %i)
+  %next = add i32 %i, 1
+  %done = icmp eq i32 %next, 100000
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ; 0 + 1 + ... + 99999
+  %sum = load i64* @total
+  %ok = icmp eq i64 %sum, 4999950000
+  %r = select i1 %ok, i32 0, i32 1
+  ret i32 %r
+}
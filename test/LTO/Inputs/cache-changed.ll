@@ -0,0 +1,20 @@
+
+
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @f(i32 %x) {
+  %a = mul i32 %x, %x
+  ret i32 %a
+}
+
+define i32 @g(i32 %x) {
+  %a = add i32 %x, 7
+  ret i32 %a
+}
+
+define i32 @h(i32 %x) {
+  %a = xor i32 %x, 54321
+  ret i32 %a
+}
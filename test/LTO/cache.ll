@@ -0,0 +1,53 @@
+; REQUIRES: asserts
+; RUN: llvm-as < %s > %t.bc
+; RUN: llvm-as < %p/Inputs/cache-changed.ll > %t.changed.bc
+; RUN: rm -rf %t.cache %t.o*
+
+; Every used partition has an entry: f, g and h each land in their own, and
+; the first partition, which holds the module level globals, is always used.
+; RUN: llvm-lto -cache-dir=%t.cache -exported-symbol=f -exported-symbol=g \
+; RUN:     -exported-symbol=h -o %t.o %t.bc
+; RUN: ls %t.cache | count 4
+
+; Linking the same module again is served from the cache and produces the
+; same object files.
+; RUN: llvm-lto -stats -cache-dir=%t.cache -exported-symbol=f \
+; RUN:     -exported-symbol=g -exported-symbol=h -o %t.o2 %t.bc 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=SAME
+; RUN: ls %t.cache | count 4
+; RUN: cmp %t.o.0 %t.o2.0
+; RUN: cmp %t.o.1 %t.o2.1
+; RUN: cmp %t.o.2 %t.o2.2
+; RUN: cmp %t.o.3 %t.o2.3
+
+; Changing the body of h misses the cache for its partition only.
+; RUN: llvm-lto -stats -cache-dir=%t.cache -exported-symbol=f \
+; RUN:     -exported-symbol=g -exported-symbol=h -o %t.o3 %t.changed.bc 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=CHANGED
+; RUN: ls %t.cache | count 5
+; RUN: cmp %t.o.2 %t.o3.2
+; RUN: not cmp %t.o.3 %t.o3.3
+
+; SAME: 4 lto - Number of partitions found in the object cache
+; SAME-NOT: Number of partitions missing from the object cache
+
+; CHANGED: 3 lto - Number of partitions found in the object cache
+; CHANGED: 1 lto - Number of partitions missing from the object cache
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @f(i32 %x) {
+  %a = mul i32 %x, %x
+  ret i32 %a
+}
+
+define i32 @g(i32 %x) {
+  %a = add i32 %x, 7
+  ret i32 %a
+}
+
+define i32 @h(i32 %x) {
+  %a = xor i32 %x, 12345
+  ret i32 %a
+}
@@ -0,0 +1,28 @@
+; RUN: llvm-as < %s > %t.bc
+; RUN: rm -f %t.o %t.o.0 %t.o.1
+; RUN: llvm-lto -j=2 -exported-symbol=f -exported-symbol=g -o %t.o %t.bc
+; RUN: llvm-nm %t.o.0 | FileCheck %s -check-prefix=PART0
+; RUN: llvm-nm %t.o.1 | FileCheck %s -check-prefix=PART1
+; RUN: not ls %t.o
+
+; Code generation on two threads splits the module into two object files,
+; and the call from f refers to g in the other one.
+; PART0: T f{{$}}
+; PART0: U g{{$}}
+; PART1: T g{{$}}
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @f(i32 %x) {
+  %a = mul i32 %x, %x
+  %b = add i32 %a, 7
+  %c = call i32 @g(i32 %b)
+  ret i32 %c
+}
+
+define i32 @g(i32 %x) noinline {
+  %a = xor i32 %x, 12345
+  %b = shl i32 %a, 3
+  ret i32 %b
+}
@@ -0,0 +1,84 @@
+; RUN: opt < %s -instcombine -function-pass-threads=3 -S | FileCheck %s
+
+; The output is the same as that of a serial run.
+; RUN: opt < %s -instcombine -gvn -simplifycfg -S > %t.serial
+; RUN: opt < %s -instcombine -gvn -simplifycfg -function-pass-threads=3 -S \
+; RUN:   > %t.parallel
+; RUN: diff %t.serial %t.parallel
+
+; Splitting the module between threads must not change the symbols, their
+; linkage or their order, and every function must still be optimized.
+
+; CHECK: @counter = internal global i32 0
+; CHECK: @.str = private unnamed_addr constant [4 x i8] c"abc\00"
+; CHECK: @table = constant [3 x i32] [i32 3, i32 5, i32 7]
+; CHECK: @weak_table = weak constant [3 x i32] [i32 3, i32 5, i32 7]
+@counter = internal global i32 0
+@.str = private unnamed_addr constant [4 x i8] c"abc\00"
+@table = constant [3 x i32] [i32 3, i32 5, i32 7]
+@weak_table = weak constant [3 x i32] [i32 3, i32 5, i32 7]
+
+; CHECK: @alias = alias i32 (i32)* @f1
+@alias = alias i32 (i32)* @f1
+
+; CHECK: define internal i32 @helper(i32 %x)
+; CHECK-NEXT: ret i32 %x
+define internal i32 @helper(i32 %x) {
+  %a = add i32 %x, 0
+  ret i32 %a
+}
+
+; CHECK: define i32 @f1(i32 %x)
+; CHECK-NEXT: %r = call i32 @helper(i32 %x)
+; CHECK-NEXT: ret i32 %r
+define i32 @f1(i32 %x) {
+  %r = call i32 @helper(i32 %x)
+  %s = mul i32 %r, 1
+  ret i32 %s
+}
+
+; CHECK: define linkonce_odr i32 @f2()
+; CHECK-NEXT: %v = load i32* @counter
+; CHECK-NEXT: ret i32 %v
+define linkonce_odr i32 @f2() {
+  %v = load i32* @counter
+  %w = sub i32 %v, 0
+  ret i32 %w
+}
+
+; CHECK: define i8* @f3()
+; CHECK-NEXT: ret i8* getelementptr {{.*}}@.str
+define i8* @f3() {
+  %p = getelementptr [4 x i8]* @.str, i32 0, i32 0
+  ret i8* %p
+}
+
+; CHECK: define i32 @f4(i32 %x)
+; CHECK-NEXT: %r = call i32 @f1(i32 %x)
+; CHECK-NEXT: ret i32 %r
+define i32 @f4(i32 %x) {
+  %r = call i32 @f1(i32 %x)
+  %s = or i32 %r, 0
+  ret i32 %s
+}
+
+; Loads from a constant fold even when another partition owns it.
+; CHECK: define i32 @f5()
+; CHECK-NEXT: ret i32 12
+define i32 @f5() {
+  %p = getelementptr [3 x i32]* @table, i32 0, i32 1
+  %a = load i32* %p
+  %q = getelementptr [3 x i32]* @table, i32 0, i32 2
+  %b = load i32* %q
+  %s = add i32 %a, %b
+  ret i32 %s
+}
+
+; Unless it may be replaced at link time.
+; CHECK: define i32 @f6()
+; CHECK-NEXT: %a = load i32* getelementptr {{.*}}@weak_table
+define i32 @f6() {
+  %p = getelementptr [3 x i32]* @weak_table, i32 0, i32 1
+  %a = load i32* %p
+  ret i32 %a
+}
@@ -0,0 +1,24 @@
+; RUN: opt < %s -analyze -use-list-stats | FileCheck %s -check-prefix=BEFORE
+; RUN: opt < %s -analyze -order-use-lists -use-list-stats \
+; RUN:   | FileCheck %s -check-prefix=AFTER
+
+; The parser pushes every new use at the front of the use-list, so the values
+; used more than once start out in the reverse order of the module.
+; BEFORE: Use-list lengths (longest: 3):
+; BEFORE-NEXT: Length     Count  Out of order
+; BEFORE-NEXT: 1-1             4             0
+; BEFORE-NEXT: 2-3             3             3
+
+; AFTER: Use-list lengths (longest: 3):
+; AFTER-NEXT: Length     Count  Out of order
+; AFTER-NEXT: 1-1             4             0
+; AFTER-NEXT: 2-3             3             0
+
+define i32 @f(i32 %x, i32 %y) {
+  %a = add i32 %x, %y
+  %b = mul i32 %x, %a
+  %c = sub i32 %a, %x
+  %d = xor i32 %b, %c
+  %e = or i32 %d, %y
+  ret i32 %e
+}
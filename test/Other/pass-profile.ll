@@ -0,0 +1,46 @@
+; RUN: rm -f %t.csv %t.json
+; RUN: opt < %s -instcombine -loop-rotate -globaldce -pass-profile=%t.csv \
+; RUN:   -disable-output
+; RUN: FileCheck %s -check-prefix=CSV < %t.csv
+
+; Records are appended, and the header is only written once.
+; RUN: opt < %s -instcombine -pass-profile=%t.csv -disable-output
+; RUN: grep -c "^module," %t.csv | FileCheck %s -check-prefix=ONEHEADER
+; RUN: grep -c '^"<stdin>","f","Combine redundant instructions",' %t.csv \
+; RUN:   | FileCheck %s -check-prefix=TWORUNS
+
+; RUN: opt < %s -instcombine -pass-profile=%t.json \
+; RUN:   -pass-profile-format=json -disable-output
+; RUN: FileCheck %s -check-prefix=JSON < %t.json
+
+; CSV: module,function,pass,wall_us,instrs_before,instrs_after,heap_bytes
+; CSV-NEXT: "<stdin>","f","Combine redundant instructions",{{[0-9]+}},2,1,{{-?[0-9]+}}
+; Loop passes only count the instructions of the loop.
+; CSV: "<stdin>","g,""q","Loop-Closed SSA Form Pass",{{[0-9]+}},4,4,
+; CSV: "<stdin>","g,""q","Rotate Loops",{{[0-9]+}},4,4,
+; CSV: "<stdin>","","Dead Global Elimination",{{[0-9]+}},8,8,
+
+; ONEHEADER: {{^}}1{{$}}
+; TWORUNS: {{^}}2{{$}}
+
+; JSON: {"module":"<stdin>","function":"f","pass":"Combine redundant instructions","wall_us":{{[0-9]+}},"instrs_before":2,"instrs_after":1,"heap_bytes":{{-?[0-9]+}}}
+; JSON: {"module":"<stdin>","function":"g,\"q","pass":"Combine redundant instructions",
+
+define i32 @f(i32 %x) {
+  %a = add i32 %x, 0
+  ret i32 %a
+}
+
+define i32 @"g,\22q"(i32 %x) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %n, %loop ]
+  %n = add i32 %i, 1
+  %c = icmp slt i32 %n, %x
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret i32 %n
+}
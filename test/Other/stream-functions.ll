@@ -0,0 +1,57 @@
+; RUN: llvm-as < %s > %t.bc
+; RUN: opt -stream-functions -analyze -domtree %t.bc | FileCheck %s
+; RUN: opt -stream-functions -disable-output -domtree -loops -verify-each %t.bc
+; RUN: not opt -stream-functions -domtree %t.bc -o %t.out.bc 2>&1 | \
+; RUN:   FileCheck %s -check-prefix=OUTPUT
+; RUN: not opt -stream-functions -disable-output -instcombine %t.bc 2>&1 | \
+; RUN:   FileCheck %s -check-prefix=TRANSFORM
+; RUN: not opt -stream-functions -disable-output -globaldce %t.bc 2>&1 | \
+; RUN:   FileCheck %s -check-prefix=MODULEPASS
+
+; Every function body is handed to the passes in order, one at a time.
+
+; CHECK: Printing analysis 'Dominator Tree Construction' for function 'helper':
+; CHECK-NEXT: =============================--------------------------------
+; CHECK-NEXT: Inorder Dominator Tree:
+; CHECK-NEXT: [1] %entry
+; CHECK: Printing analysis 'Dominator Tree Construction' for function 'f1':
+; CHECK: [1] %entry
+; CHECK-NEXT: [2] %then
+; CHECK-NEXT: [2] %end
+; CHECK-NOT: for function 'external'
+; CHECK: Printing analysis 'Dominator Tree Construction' for function 'f2':
+
+; OUTPUT: -stream-functions can not write the module back out
+; TRANSFORM: -stream-functions only runs analyses, and '-instcombine' transforms the module
+; MODULEPASS: -stream-functions requires a pipeline of function passes only
+
+@counter = internal global i32 0
+
+define internal i32 @helper(i32 %x) {
+entry:
+  %a = add i32 %x, 0
+  ret i32 %a
+}
+
+define i32 @f1(i32 %x) {
+entry:
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %then, label %end
+
+then:
+  %r = call i32 @helper(i32 %x)
+  br label %end
+
+end:
+  %p = phi i32 [ %x, %entry ], [ %r, %then ]
+  ret i32 %p
+}
+
+declare i32 @external(i32)
+
+define i32 @f2() {
+entry:
+  %v = load i32* @counter
+  %w = call i32 @external(i32 %v)
+  ret i32 %w
+}
@@ -78,6 +78,10 @@ namespace options {
   static std::string extra_library_path;
   static std::string triple;
   static std::string mcpu;
+  // Number of threads (and object files) to use for code generation.
+  static unsigned jobs = 1;
+  // Directory in which to cache the object files of unchanged partitions.
+  static std::string cache_dir;
   // Additional options to pass into the code generator.
   // Note: This array will contain all plugin options which are not claimed
   // as plugin exclusive to pass to the code generator.
@@ -95,6 +99,13 @@ namespace options {
       generate_api_file = true;
     } else if (opt.startswith("mcpu=")) {
       mcpu = opt.substr(strlen("mcpu="));
+    } else if (opt.startswith("jobs=")) {
+      if (opt.substr(strlen("jobs=")).getAsInteger(10, jobs) || jobs == 0) {
+        (*message)(LDPL_WARNING, "Invalid parallelism level: %s", opt_);
+        jobs = 1;
+      }
+    } else if (opt.startswith("cache-dir=")) {
+      cache_dir = opt.substr(strlen("cache-dir="));
     } else if (opt.startswith("extra-library-path=")) {
       extra_library_path = opt.substr(strlen("extra_library_path="));
     } else if (opt.startswith("mtriple=")) {
@@ -421,10 +432,16 @@ static ld_plugin_status all_symbols_read_hook(void) {
     if (options::generate_bc_file == options::BC_ONLY)
       exit(0);
   }
-  const char *objPath;
-  if (lto_codegen_compile_to_file(code_gen, &objPath)) {
+  const char **objPaths = NULL;
+  unsigned numObjs = 0;
+  lto_codegen_set_parallelism(code_gen, options::jobs);
+  if (!options::cache_dir.empty())
+    lto_codegen_set_cache_dir(code_gen, options::cache_dir.c_str());
+  if (lto_codegen_compile_to_files(code_gen, &objPaths, &numObjs)) {
     (*message)(LDPL_ERROR, "Could not produce a combined object file\n");
   }
+  // The names are owned by code_gen, copy them before disposing of it.
+  std::vector<std::string> objFiles(objPaths, objPaths + numObjs);
 
   lto_codegen_dispose(code_gen);
   for (std::list<claimed_file>::iterator I = Modules.begin(),
@@ -435,10 +452,12 @@ static ld_plugin_status all_symbols_read_hook(void) {
     }
   }
 
-  if ((*add_input_file)(objPath) != LDPS_OK) {
-    (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
-    (*message)(LDPL_ERROR, "File left behind in: %s", objPath);
-    return LDPS_ERR;
+  for (unsigned i = 0, e = objFiles.size(); i != e; ++i) {
+    if ((*add_input_file)(objFiles[i].c_str()) != LDPS_OK) {
+      (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
+      (*message)(LDPL_ERROR, "File left behind in: %s", objFiles[i].c_str());
+      return LDPS_ERR;
+    }
   }
 
   if (!options::extra_library_path.empty() &&
@@ -448,7 +467,7 @@ static ld_plugin_status all_symbols_read_hook(void) {
   }
 
   if (options::obj_path.empty())
-    Cleanup.push_back(objPath);
+    Cleanup.insert(Cleanup.end(), objFiles.begin(), objFiles.end());
 
   return LDPS_OK;
 }
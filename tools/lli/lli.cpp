@@ -17,9 +17,11 @@
 #include "llvm/IR/LLVMContext.h"
 #include "RecordingMemoryManager.h"
 #include "RemoteTarget.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
+#include "llvm/ExecutionEngine/FileObjectCache.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/Interpreter.h"
 #include "llvm/ExecutionEngine/JIT.h"
@@ -44,6 +46,7 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cerrno>
 
@@ -63,6 +66,11 @@ namespace {
   cl::list<std::string>
   InputArgv(cl::ConsumeAfter, cl::desc("<program arguments>..."));
 
+  cl::list<std::string>
+  ExtraModules("extra-module",
+         cl::desc("Extra modules to be loaded"),
+         cl::value_desc("input bitcode"));
+
   cl::opt<bool> ForceInterpreter("force-interpreter",
                                  cl::desc("Force interpretation: disable JIT"),
                                  cl::init(false));
@@ -78,6 +86,33 @@ namespace {
     cl::desc("Execute MCJIT'ed code in a separate process."),
     cl::init(false));
 
+  // Keep the objects MCJIT compiles in a directory, so that running the same
+  // program again does not have to compile it.
+  cl::opt<std::string>
+  ObjectCacheDir("object-cache-dir",
+    cl::desc("Directory for caching objects compiled by MCJIT"),
+    cl::value_desc("directory"));
+
+  cl::opt<unsigned>
+  ObjectCacheSize("object-cache-size",
+    cl::desc("Maximum size of the object cache in megabytes "
+             "(default = 0, unlimited)"),
+    cl::value_desc("megabytes"),
+    cl::init(0));
+
+  // Start with code generated at -O0 and recompile the functions that get
+  // hot at the requested optimization level on a background thread.
+  cl::opt<bool> TieredCompilation("tiered-compilation",
+    cl::desc("Compile at -O0 first and recompile hot functions in the "
+             "background (requires -use-mcjit)"),
+    cl::init(false));
+
+  cl::opt<unsigned>
+  TierUpThreshold("tier-up-threshold",
+    cl::desc("Number of calls after which -tiered-compilation recompiles a "
+             "function (default = 1000)"),
+    cl::init(1000));
+
   // Determine optimization level.
   cl::opt<char>
   OptLevel("O",
@@ -365,7 +400,20 @@ int main(int argc, char **argv, char * const *envp) {
   case '2': OLvl = CodeGenOpt::Default; break;
   case '3': OLvl = CodeGenOpt::Aggressive; break;
   }
-  builder.setOptLevel(OLvl);
+  if (TieredCompilation) {
+    if (!UseMCJIT || ForceInterpreter || RemoteMCJIT) {
+      errs() << "error: -tiered-compilation requires -use-mcjit without "
+                "-remote-mcjit\n";
+      exit(1);
+    }
+    if (TierUpThreshold == 0) {
+      errs() << "error: -tier-up-threshold must be at least 1\n";
+      exit(1);
+    }
+    builder.setOptLevel(CodeGenOpt::None);
+  } else {
+    builder.setOptLevel(OLvl);
+  }
 
   TargetOptions Options;
   Options.UseSoftFloat = GenerateSoftFloatCalls;
@@ -382,7 +430,20 @@ int main(int argc, char **argv, char * const *envp) {
 
   builder.setTargetOptions(Options);
 
-  EE = builder.create();
+  TargetMachine *TM = builder.selectTarget();
+  OwningPtr<FileObjectCache> ObjCache;
+  if (!ObjectCacheDir.empty()) {
+    if (!UseMCJIT || ForceInterpreter) {
+      errs() << "error: -object-cache-dir requires -use-mcjit\n";
+      exit(1);
+    }
+    if (TM)
+      ObjCache.reset(new FileObjectCache(ObjectCacheDir,
+                                         FileObjectCache::getTargetKey(*TM),
+                                         uint64_t(ObjectCacheSize) << 20));
+  }
+
+  EE = builder.create(TM);
   if (!EE) {
     if (!ErrorMsg.empty())
       errs() << argv[0] << ": error creating EE: " << ErrorMsg << "\n";
@@ -398,6 +459,24 @@ int main(int argc, char **argv, char * const *envp) {
   EE->RegisterJITEventListener(
                 JITEventListener::createIntelJITEventListener());
 
+  if (ObjCache)
+    EE->setObjectCache(ObjCache.get());
+
+  if (TieredCompilation) {
+    llvm_start_multithreaded();
+    EE->enableTieredCompilation(OLvl, TierUpThreshold);
+  }
+
+  // Load any additional modules specified on the command line.
+  for (unsigned i = 0, e = ExtraModules.size(); i != e; ++i) {
+    Module *XMod = ParseIRFile(ExtraModules[i], Err, Context);
+    if (!XMod) {
+      Err.print(argv[0], errs());
+      return 1;
+    }
+    EE->addModule(XMod);
+  }
+
   if (!NoLazyCompilation && RemoteMCJIT) {
     errs() << "warning: remote mcjit does not support lazy compilation\n";
     NoLazyCompilation = true;
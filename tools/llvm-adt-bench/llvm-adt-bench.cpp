@@ -0,0 +1,578 @@
+//===-- llvm-adt-bench.cpp - Microbenchmarks for the ADT containers -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program times the common operations of the containers in
+// include/llvm/ADT at several sizes and key distributions.  It prints one
+// record per measurement, as CSV or as JSON lines, so that the results of
+// different revisions can be collected and compared.
+//
+// The keys are derived from their index and -seed alone, so every run of the
+// same revision measures the same work.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/ImmutableMap.h"
+#include "llvm/ADT/IntervalMap.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SparseBitVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Regex.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+using namespace llvm;
+
+enum OutputFormat { CSV, JSON };
+
+static cl::opt<std::string>
+OutputFilename("o", cl::desc("Output filename"), cl::value_desc("filename"),
+               cl::init("-"));
+
+static cl::opt<OutputFormat>
+Format("format", cl::init(CSV), cl::desc("Format of the results"),
+       cl::values(clEnumValN(CSV, "csv",
+                             "Comma separated values after a header line"),
+                  clEnumValN(JSON, "json", "One JSON object per line"),
+                  clEnumValEnd));
+
+static cl::list<unsigned>
+Sizes("sizes", cl::CommaSeparated, cl::value_desc("n,..."),
+      cl::desc("Numbers of elements to measure with "
+               "(default 16,256,4096,65536)"));
+
+static cl::opt<unsigned>
+MinOps("ops", cl::init(1 << 20),
+       cl::desc("Minimum number of operations timed per measurement"));
+
+static cl::opt<unsigned>
+Repeat("repeat", cl::init(3),
+       cl::desc("Number of times to measure, keeping the fastest"));
+
+static cl::opt<unsigned>
+Seed("seed", cl::init(0), cl::desc("Seed of the random keys"));
+
+static cl::opt<std::string>
+Filter("filter", cl::value_desc("regex"),
+       cl::desc("Only run the benchmarks whose container.op.keys name "
+                "matches"));
+
+static cl::opt<std::string>
+Tag("tag", cl::value_desc("string"),
+    cl::desc("Label every result, for example with the revision measured"));
+
+static cl::opt<bool>
+List("list", cl::desc("Print the names of the benchmarks and exit"));
+
+/// Sink - The results of the timed loops are added up here, so that the
+/// compiler cannot drop the operations that produce them.
+static volatile unsigned Sink;
+
+//===----------------------------------------------------------------------===//
+// Keys
+//===----------------------------------------------------------------------===//
+
+enum KeyKind { SequentialKeys, RandomKeys, NumKeyKinds };
+static const char *const KeyKindNames[] = { "seq", "random" };
+
+/// mix - A bijection on 32-bit values that scatters consecutive inputs.
+static unsigned mix(unsigned X) {
+  X ^= X >> 16;
+  X *= 0x7FEB352DU;
+  X ^= X >> 15;
+  X *= 0x846CA68BU;
+  X ^= X >> 16;
+  return X;
+}
+
+/// makeKeys - Make Size distinct keys.  Sequential keys count up from zero.
+/// Random keys are scattered over all values that DenseMap can hold.
+static void makeKeys(KeyKind Kind, unsigned Size, std::vector<unsigned> &Keys) {
+  Keys.clear();
+  Keys.reserve(Size);
+  for (unsigned i = 0; Keys.size() != Size; ++i) {
+    if (Kind == SequentialKeys) {
+      Keys.push_back(i);
+      continue;
+    }
+    unsigned K = mix(i + Seed * 0x9E3779B9U);
+    if (K < ~0U - 1)
+      Keys.push_back(K);
+  }
+}
+
+// convertKeys - Turn the numeric keys into the keys of a container.  Strings
+// are kept in Strings, which must outlive the keys that refer to them.
+static void convertKeys(const std::vector<unsigned> &In,
+                        std::vector<unsigned> &Out,
+                        std::vector<std::string> &Strings) {
+  Out = In;
+}
+
+static void convertKeys(const std::vector<unsigned> &In,
+                        std::vector<void*> &Out,
+                        std::vector<std::string> &Strings) {
+  // Pointers to 16-byte aligned objects, which are never dereferenced.
+  Out.clear();
+  for (unsigned i = 0, e = In.size(); i != e; ++i)
+    Out.push_back(reinterpret_cast<void*>((uintptr_t(In[i]) + 1) << 4));
+}
+
+static void convertKeys(const std::vector<unsigned> &In,
+                        std::vector<StringRef> &Out,
+                        std::vector<std::string> &Strings) {
+  // Names shaped like the mangled symbols of a large C++ module.
+  Strings.clear();
+  for (unsigned i = 0, e = In.size(); i != e; ++i)
+    Strings.push_back("_ZN4llvm12_GLOBAL__N_113BenchmarkPass" + utostr(In[i]) +
+                      "EPNS_8FunctionE");
+  Out.clear();
+  for (unsigned i = 0, e = Strings.size(); i != e; ++i)
+    Out.push_back(Strings[i]);
+}
+
+//===----------------------------------------------------------------------===//
+// Containers
+//===----------------------------------------------------------------------===//
+
+enum OpKind { InsertOp, LookupOp, EraseOp, IterateOp, HashOp, NumOpKinds };
+static const char *const OpKindNames[] = {
+  "insert", "lookup", "erase", "iterate", "hash"
+};
+
+/// BenchBase - The operations every container benchmark provides.  Each
+/// benchmark hides the ones its container supports, and lists them in Ops.
+template<typename T>
+struct BenchBase {
+  typedef T KeyT;
+  void insert(KeyT K) {}
+  unsigned lookup(KeyT K) { return 0; }
+  void erase(KeyT K) {}
+  unsigned iterate() { return 0; }
+  unsigned hash(KeyT K) { return 0; }
+};
+
+#define OP(X) (1U << X)
+
+struct BumpPtrAllocatorBench : BenchBase<unsigned> {
+  // Allocation sizes between 8 and 64 bytes are picked from the keys.
+  static const unsigned Ops = OP(InsertOp);
+  BumpPtrAllocator Alloc;
+  void insert(unsigned K) {
+    char *P = static_cast<char*>(Alloc.Allocate(8 + K % 8 * 8, 8));
+    P[0] = char(K);
+  }
+};
+
+struct DenseMapBench : BenchBase<unsigned> {
+  static const unsigned Ops =
+    OP(InsertOp) | OP(LookupOp) | OP(EraseOp) | OP(IterateOp);
+  DenseMap<unsigned, unsigned> Map;
+  void insert(unsigned K) { Map[K] = K; }
+  unsigned lookup(unsigned K) { return Map.count(K); }
+  void erase(unsigned K) { Map.erase(K); }
+  unsigned iterate() {
+    unsigned Sum = 0;
+    for (DenseMap<unsigned, unsigned>::iterator I = Map.begin(),
+         E = Map.end(); I != E; ++I)
+      Sum += I->second;
+    return Sum;
+  }
+};
+
+struct BenchNode : public FoldingSetNode {
+  unsigned Key;
+  explicit BenchNode(unsigned K) : Key(K) {}
+  void Profile(FoldingSetNodeID &ID) const { ID.AddInteger(Key); }
+};
+
+struct FoldingSetBench : BenchBase<unsigned> {
+  // Nodes are allocated the way uniquing tables do, on a miss.
+  static const unsigned Ops =
+    OP(InsertOp) | OP(LookupOp) | OP(EraseOp) | OP(IterateOp);
+  BumpPtrAllocator Alloc;
+  FoldingSet<BenchNode> Set;
+  BenchNode *find(unsigned K, void *&InsertPos) {
+    FoldingSetNodeID ID;
+    ID.AddInteger(K);
+    return Set.FindNodeOrInsertPos(ID, InsertPos);
+  }
+  void insert(unsigned K) {
+    void *InsertPos;
+    if (!find(K, InsertPos))
+      Set.InsertNode(new (Alloc.Allocate<BenchNode>()) BenchNode(K),
+                     InsertPos);
+  }
+  unsigned lookup(unsigned K) {
+    void *InsertPos;
+    return find(K, InsertPos) != 0;
+  }
+  void erase(unsigned K) {
+    void *InsertPos;
+    if (BenchNode *N = find(K, InsertPos))
+      Set.RemoveNode(N);
+  }
+  unsigned iterate() {
+    unsigned Sum = 0;
+    for (FoldingSet<BenchNode>::iterator I = Set.begin(), E = Set.end();
+         I != E; ++I)
+      Sum += I->Key;
+    return Sum;
+  }
+};
+
+struct ImmutableMapBench : BenchBase<unsigned> {
+  static const unsigned Ops =
+    OP(InsertOp) | OP(LookupOp) | OP(EraseOp) | OP(IterateOp);
+  typedef ImmutableMap<unsigned, unsigned> MapT;
+  MapT::Factory F;
+  MapT Map;
+  ImmutableMapBench() : Map(F.getEmptyMap()) {}
+  void insert(unsigned K) { Map = F.add(Map, K, K); }
+  unsigned lookup(unsigned K) { return Map.lookup(K) != 0; }
+  void erase(unsigned K) { Map = F.remove(Map, K); }
+  unsigned iterate() {
+    unsigned Sum = 0;
+    for (MapT::iterator I = Map.begin(), E = Map.end(); I != E; ++I)
+      Sum += I.getData();
+    return Sum;
+  }
+};
+
+struct IntervalMapBench : BenchBase<unsigned> {
+  // Key K stands for the interval [4K, 4K+2].
+  static const unsigned Ops =
+    OP(InsertOp) | OP(LookupOp) | OP(EraseOp) | OP(IterateOp);
+  typedef IntervalMap<uint64_t, unsigned> MapT;
+  MapT::Allocator Alloc;
+  MapT Map;
+  IntervalMapBench() : Map(Alloc) {}
+  void insert(unsigned K) {
+    Map.insert(uint64_t(K) * 4, uint64_t(K) * 4 + 2, K);
+  }
+  unsigned lookup(unsigned K) { return Map.lookup(uint64_t(K) * 4 + 1); }
+  void erase(unsigned K) {
+    MapT::iterator I = Map.find(uint64_t(K) * 4);
+    if (I.valid())
+      I.erase();
+  }
+  unsigned iterate() {
+    unsigned Sum = 0;
+    for (MapT::const_iterator I = Map.begin(); I.valid(); ++I)
+      Sum += I.value();
+    return Sum;
+  }
+};
+
+struct SmallPtrSetBench : BenchBase<void*> {
+  static const unsigned Ops =
+    OP(InsertOp) | OP(LookupOp) | OP(EraseOp) | OP(IterateOp);
+  SmallPtrSet<void*, 16> Set;
+  void insert(void *K) { Set.insert(K); }
+  unsigned lookup(void *K) { return Set.count(K); }
+  void erase(void *K) { Set.erase(K); }
+  unsigned iterate() {
+    unsigned Sum = 0;
+    for (SmallPtrSet<void*, 16>::iterator I = Set.begin(), E = Set.end();
+         I != E; ++I)
+      Sum += unsigned(uintptr_t(*I) >> 4);
+    return Sum;
+  }
+};
+
+struct SmallVectorBench : BenchBase<unsigned> {
+  // Elements are appended, and erased from the back.
+  static const unsigned Ops = OP(InsertOp) | OP(EraseOp) | OP(IterateOp);
+  SmallVector<unsigned, 16> Vec;
+  void insert(unsigned K) { Vec.push_back(K); }
+  void erase(unsigned K) { Vec.pop_back(); }
+  unsigned iterate() {
+    unsigned Sum = 0;
+    for (SmallVectorImpl<unsigned>::iterator I = Vec.begin(), E = Vec.end();
+         I != E; ++I)
+      Sum += *I;
+    return Sum;
+  }
+};
+
+struct SparseBitVectorBench : BenchBase<unsigned> {
+  static const unsigned Ops =
+    OP(InsertOp) | OP(LookupOp) | OP(EraseOp) | OP(IterateOp);
+  SparseBitVector<> BV;
+  void insert(unsigned K) { BV.set(K); }
+  unsigned lookup(unsigned K) { return BV.test(K); }
+  void erase(unsigned K) { BV.reset(K); }
+  unsigned iterate() {
+    unsigned Sum = 0;
+    for (SparseBitVector<>::iterator I = BV.begin(), E = BV.end(); I != E; ++I)
+      Sum += *I;
+    return Sum;
+  }
+};
+
+struct StringMapBench : BenchBase<StringRef> {
+  static const unsigned Ops =
+    OP(InsertOp) | OP(LookupOp) | OP(EraseOp) | OP(IterateOp);
+  StringMap<unsigned> Map;
+  void insert(StringRef K) { Map[K] = K.size(); }
+  unsigned lookup(StringRef K) { return Map.count(K); }
+  void erase(StringRef K) { Map.erase(K); }
+  unsigned iterate() {
+    unsigned Sum = 0;
+    for (StringMap<unsigned>::iterator I = Map.begin(), E = Map.end();
+         I != E; ++I)
+      Sum += I->second;
+    return Sum;
+  }
+};
+
+struct HashStringBench : BenchBase<StringRef> {
+  static const unsigned Ops = OP(HashOp);
+  unsigned hash(StringRef K) { return HashString(K); }
+};
+
+struct StringMapHashBench : BenchBase<StringRef> {
+  static const unsigned Ops = OP(HashOp);
+  unsigned hash(StringRef K) { return StringMapImpl::hash(K); }
+};
+
+#undef OP
+
+//===----------------------------------------------------------------------===//
+// Measuring
+//===----------------------------------------------------------------------===//
+
+/// timeOnce - Time Op on Keys, over as many rounds as it takes to reach
+/// MinOps operations.  Return the number of operations in NumOps and the
+/// elapsed wall time in seconds.
+///
+/// Lookups, iteration and hashing run repeatedly on one container.  The other
+/// operations change the container, so they run on a fresh container in
+/// every round.  These containers are set up in batches outside of the timed
+/// region, so that neither their construction nor, for erase, the insertion
+/// of the keys is timed.
+template<typename BenchT>
+static double timeOnce(OpKind Op,
+                       const std::vector<typename BenchT::KeyT> &Keys,
+                       uint64_t &NumOps) {
+  const unsigned BatchElements = 1 << 16;
+  unsigned Size = Keys.size();
+  unsigned Rounds = std::max(1U, unsigned(MinOps / Size));
+  NumOps = uint64_t(Rounds) * Size;
+  unsigned Result = 0;
+  double Elapsed = 0;
+
+  if (Op == LookupOp || Op == IterateOp || Op == HashOp) {
+    BenchT B;
+    if (Op != HashOp)
+      for (unsigned i = 0; i != Size; ++i)
+        B.insert(Keys[i]);
+
+    double Start = TimeRecord::getCurrentTime(true).getWallTime();
+    for (unsigned r = 0; r != Rounds; ++r) {
+      if (Op == IterateOp)
+        Result += B.iterate();
+      else if (Op == LookupOp)
+        for (unsigned i = 0; i != Size; ++i)
+          Result += B.lookup(Keys[i]);
+      else
+        for (unsigned i = 0; i != Size; ++i)
+          Result += B.hash(Keys[i]);
+    }
+    Elapsed = TimeRecord::getCurrentTime(false).getWallTime() - Start;
+    Sink += Result;
+    return Elapsed;
+  }
+
+  unsigned BatchSize = std::max(1U, BatchElements / Size);
+  for (unsigned Done = 0; Done < Rounds; Done += BatchSize) {
+    unsigned Count = std::min(BatchSize, Rounds - Done);
+    OwningArrayPtr<BenchT> Batch(new BenchT[Count]);
+    if (Op == EraseOp)
+      for (unsigned b = 0; b != Count; ++b)
+        for (unsigned i = 0; i != Size; ++i)
+          Batch[b].insert(Keys[i]);
+
+    double Start = TimeRecord::getCurrentTime(true).getWallTime();
+    for (unsigned b = 0; b != Count; ++b) {
+      if (Op == InsertOp)
+        for (unsigned i = 0; i != Size; ++i)
+          Batch[b].insert(Keys[i]);
+      else
+        for (unsigned i = 0; i != Size; ++i)
+          Batch[b].erase(Keys[i]);
+    }
+    Elapsed += TimeRecord::getCurrentTime(false).getWallTime() - Start;
+  }
+  return Elapsed;
+}
+
+/// runBenchmark - Measure Op on Size keys of the given kind Repeat times, and
+/// return the best time per operation in nanoseconds.
+template<typename BenchT>
+static double runBenchmark(OpKind Op, KeyKind Kind, unsigned Size,
+                           uint64_t &NumOps) {
+  std::vector<unsigned> RawKeys;
+  makeKeys(Kind, Size, RawKeys);
+  std::vector<std::string> Strings;
+  std::vector<typename BenchT::KeyT> Keys;
+  convertKeys(RawKeys, Keys, Strings);
+
+  double Best = 0;
+  for (unsigned i = 0, e = std::max(1U, unsigned(Repeat)); i != e; ++i) {
+    double Elapsed = timeOnce<BenchT>(Op, Keys, NumOps);
+    if (i == 0 || Elapsed < Best)
+      Best = Elapsed;
+  }
+  return Best * 1e9 / NumOps;
+}
+
+typedef double (*BenchmarkFn)(OpKind, KeyKind, unsigned, uint64_t &);
+
+struct Benchmark {
+  const char *Container;
+  unsigned Ops;
+  BenchmarkFn Run;
+};
+
+#define BENCHMARK(NAME, BENCH) { NAME, BENCH::Ops, runBenchmark<BENCH> }
+
+static const Benchmark Benchmarks[] = {
+  BENCHMARK("BumpPtrAllocator", BumpPtrAllocatorBench),
+  BENCHMARK("DenseMap", DenseMapBench),
+  BENCHMARK("FoldingSet", FoldingSetBench),
+  BENCHMARK("ImmutableMap", ImmutableMapBench),
+  BENCHMARK("IntervalMap", IntervalMapBench),
+  BENCHMARK("SmallPtrSet", SmallPtrSetBench),
+  BENCHMARK("SmallVector", SmallVectorBench),
+  BENCHMARK("SparseBitVector", SparseBitVectorBench),
+  BENCHMARK("StringMap", StringMapBench),
+  // The old and the new hash function of StringMap.
+  BENCHMARK("HashString", HashStringBench),
+  BENCHMARK("StringMapImpl::hash", StringMapHashBench)
+};
+
+#undef BENCHMARK
+
+//===----------------------------------------------------------------------===//
+// Output
+//===----------------------------------------------------------------------===//
+
+static void printCSVString(raw_ostream &OS, StringRef S) {
+  if (S.find_first_of(",\"\n") == StringRef::npos) {
+    OS << S;
+    return;
+  }
+  OS << '"';
+  for (unsigned i = 0, e = S.size(); i != e; ++i) {
+    if (S[i] == '"')
+      OS << '"';
+    OS << S[i];
+  }
+  OS << '"';
+}
+
+static void printResult(raw_ostream &OS, const char *Container, OpKind Op,
+                        KeyKind Kind, unsigned Size, uint64_t NumOps,
+                        double NanosPerOp) {
+  if (Format == CSV) {
+    printCSVString(OS, Tag);
+    OS << ',' << Container << ',' << OpKindNames[Op] << ','
+       << KeyKindNames[Kind] << ',' << Size << ',' << NumOps << ','
+       << format("%.3f", NanosPerOp) << '\n';
+  } else {
+    OS << "{\"tag\":";
+    OS.write_json_string(Tag);
+    OS << ",\"container\":\"" << Container << "\",\"op\":\""
+       << OpKindNames[Op] << "\",\"keys\":\"" << KeyKindNames[Kind]
+       << "\",\"size\":" << Size << ",\"ops\":" << NumOps
+       << ",\"ns_per_op\":" << format("%.3f", NanosPerOp) << "}\n";
+  }
+  OS.flush();
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+  cl::ParseCommandLineOptions(argc, argv, "ADT container benchmarks\n");
+
+  Regex FilterRE(Filter.empty() ? std::string(".") : Filter);
+  std::string Error;
+  if (!FilterRE.isValid(Error)) {
+    errs() << argv[0] << ": invalid -filter: " << Error << '\n';
+    return 1;
+  }
+
+  std::vector<unsigned> BenchSizes(Sizes.begin(), Sizes.end());
+  if (BenchSizes.empty()) {
+    BenchSizes.push_back(16);
+    BenchSizes.push_back(256);
+    BenchSizes.push_back(4096);
+    BenchSizes.push_back(65536);
+  }
+  for (unsigned i = 0, e = BenchSizes.size(); i != e; ++i)
+    if (BenchSizes[i] == 0) {
+      errs() << argv[0] << ": -sizes must be positive\n";
+      return 1;
+    }
+
+  std::string ErrorInfo;
+  OwningPtr<tool_output_file> Out(
+    new tool_output_file(OutputFilename.c_str(), ErrorInfo));
+  if (!ErrorInfo.empty()) {
+    errs() << ErrorInfo << '\n';
+    return 1;
+  }
+  raw_ostream &OS = Out->os();
+
+  if (!List && Format == CSV)
+    OS << "tag,container,op,keys,size,ops,ns_per_op\n";
+
+  for (unsigned b = 0, be = array_lengthof(Benchmarks); b != be; ++b) {
+    const Benchmark &B = Benchmarks[b];
+    for (unsigned o = 0; o != NumOpKinds; ++o) {
+      if (!(B.Ops & (1U << o)))
+        continue;
+      for (unsigned k = 0; k != NumKeyKinds; ++k) {
+        std::string Name = std::string(B.Container) + '.' + OpKindNames[o] +
+                           '.' + KeyKindNames[k];
+        if (!FilterRE.match(Name))
+          continue;
+        if (List) {
+          OS << Name << '\n';
+          continue;
+        }
+        for (unsigned i = 0, e = BenchSizes.size(); i != e; ++i) {
+          uint64_t NumOps;
+          double NanosPerOp = B.Run(OpKind(o), KeyKind(k), BenchSizes[i],
+                                    NumOps);
+          printResult(OS, B.Container, OpKind(o), KeyKind(k), BenchSizes[i],
+                      NumOps, NanosPerOp);
+        }
+      }
+    }
+  }
+
+  Out->keep();
+  return 0;
+}
@@ -32,6 +32,7 @@
 #include "llvm/Bitcode/BitstreamReader.h"
 #include "llvm/Bitcode/LLVMBitCodes.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/ContentHash.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -109,6 +110,8 @@ static const char *GetBlockName(unsigned BlockID,
   case bitc::METADATA_BLOCK_ID:        return "METADATA_BLOCK";
   case bitc::METADATA_ATTACHMENT_ID:   return "METADATA_ATTACHMENT_BLOCK";
   case bitc::USELIST_BLOCK_ID:         return "USELIST_BLOCK_ID";
+  case bitc::FUNCTION_INDEX_BLOCK_ID:  return "FUNCTION_INDEX_BLOCK";
+  case bitc::CONTENT_HASH_BLOCK_ID:    return "CONTENT_HASH_BLOCK";
   }
 }
 
@@ -156,6 +159,7 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
     case bitc::MODULE_CODE_ALIAS:       return "ALIAS";
     case bitc::MODULE_CODE_PURGEVALS:   return "PURGEVALS";
     case bitc::MODULE_CODE_GCNAME:      return "GCNAME";
+    case bitc::MODULE_CODE_FNINDEXOFFSET: return "FNINDEXOFFSET";
     }
   case bitc::PARAMATTR_BLOCK_ID:
     switch (CodeID) {
@@ -273,6 +277,17 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
     default:return 0;
     case bitc::USELIST_CODE_ENTRY:   return "USELIST_CODE_ENTRY";
     }
+  case bitc::FUNCTION_INDEX_BLOCK_ID:
+    switch(CodeID) {
+    default:return 0;
+    case bitc::FNINDEX_CODE_ENTRY:   return "ENTRY";
+    }
+  case bitc::CONTENT_HASH_BLOCK_ID:
+    switch(CodeID) {
+    default:return 0;
+    case bitc::CONTENT_HASH_CODE_MODULE:   return "MODULE";
+    case bitc::CONTENT_HASH_CODE_FUNCTION: return "FUNCTION";
+    }
   }
 }
 
@@ -446,6 +461,15 @@ static bool ParseBlock(BitstreamCursor &Stream, unsigned BlockID,
 
       outs() << "/>";
 
+      // Content hashes are easier to compare as the usual hex string.
+      if (BlockID == bitc::CONTENT_HASH_BLOCK_ID && Record.size() >= 4) {
+        unsigned First = Record.size() - 4;
+        outs() << " hash = "
+               << ContentHash::fromWords(Record[First], Record[First+1],
+                                         Record[First+2],
+                                         Record[First+3]).str();
+      }
+
       if (Blob.data()) {
         outs() << " blob data = ";
         bool BlobIsPrintable = true;
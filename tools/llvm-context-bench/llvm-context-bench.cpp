@@ -0,0 +1,216 @@
+//===-- llvm-context-bench.cpp - Time IR building on several contexts -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program measures how building and analyzing IR scales with the number
+// of threads when every thread owns its own LLVMContext.  The same set of
+// tasks, each building a number of modules and running a FunctionPassManager
+// over them, is run on different numbers of threads, and the wall time of
+// every run is printed as one record.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Analysis/Dominators.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/Verifier.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/PassManager.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include <algorithm>
+#include <iterator>
+#include <vector>
+using namespace llvm;
+
+static cl::opt<std::string>
+OutputFilename("o", cl::desc("Output filename"), cl::value_desc("filename"),
+               cl::init("-"));
+
+static cl::list<unsigned>
+Threads("threads", cl::CommaSeparated, cl::value_desc("n,..."),
+        cl::desc("Numbers of threads to measure with (default 1,2,4,8)"));
+
+static cl::opt<unsigned>
+NumTasks("tasks", cl::init(8),
+         cl::desc("Number of tasks, each with a context of its own"));
+
+static cl::opt<unsigned>
+NumModules("modules", cl::init(16),
+           cl::desc("Number of modules every task builds"));
+
+static cl::opt<unsigned>
+NumFunctions("functions", cl::init(64),
+             cl::desc("Number of functions in every module"));
+
+static cl::opt<unsigned>
+Repeat("repeat", cl::init(3),
+       cl::desc("Number of times to measure, keeping the fastest"));
+
+static cl::opt<std::string>
+Tag("tag", cl::value_desc("string"),
+    cl::desc("Label every result, for example with the revision measured"));
+
+namespace {
+/// CountLoops - A function pass that counts the top level loops LoopInfo
+/// found, so that the analyses have a user.
+struct CountLoops : public FunctionPass {
+  static char ID;
+  unsigned &NumLoops;
+  CountLoops(unsigned &N) : FunctionPass(ID), NumLoops(N) {}
+
+  virtual bool runOnFunction(Function &F) {
+    LoopInfo &LI = getAnalysis<LoopInfo>();
+    NumLoops += std::distance(LI.begin(), LI.end());
+    return false;
+  }
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<LoopInfo>();
+    AU.setPreservesAll();
+  }
+};
+}
+char CountLoops::ID = 0;
+
+/// buildFunction - Build "i32 f(i32 n) { s = 0; for (i = 0; i < n; ++i)
+/// s += i * Seed; return s; }".
+static void buildFunction(Module &M, unsigned Seed) {
+  LLVMContext &Context = M.getContext();
+  Type *I32 = Type::getInt32Ty(Context);
+  Type *Params[] = { I32 };
+  Function *F = Function::Create(FunctionType::get(I32, Params, false),
+                                 GlobalValue::ExternalLinkage, "f", &M);
+  BasicBlock *Entry = BasicBlock::Create(Context, "entry", F);
+  BasicBlock *Loop = BasicBlock::Create(Context, "loop", F);
+  BasicBlock *Exit = BasicBlock::Create(Context, "exit", F);
+  Value *N = F->arg_begin();
+
+  IRBuilder<> Builder(Entry);
+  Builder.CreateBr(Loop);
+
+  Builder.SetInsertPoint(Loop);
+  PHINode *I = Builder.CreatePHI(I32, 2, "i");
+  PHINode *S = Builder.CreatePHI(I32, 2, "s");
+  Value *Mul = Builder.CreateMul(I, Builder.getInt32(Seed));
+  Value *Sum = Builder.CreateAdd(S, Mul, "sum");
+  Value *Next = Builder.CreateAdd(I, Builder.getInt32(1), "next");
+  Builder.CreateCondBr(Builder.CreateICmpSLT(Next, N), Loop, Exit);
+  I->addIncoming(Builder.getInt32(0), Entry);
+  I->addIncoming(Next, Loop);
+  S->addIncoming(Builder.getInt32(0), Entry);
+  S->addIncoming(Sum, Loop);
+
+  Builder.SetInsertPoint(Exit);
+  Builder.CreateRet(Sum);
+}
+
+/// runTask - Build the modules of one task in a context of its own, and run
+/// a FunctionPassManager over every function.
+static void runTask(void *UserData, unsigned Task) {
+  unsigned &NumLoops = (*static_cast<std::vector<unsigned>*>(UserData))[Task];
+  LLVMContext Context;
+  for (unsigned m = 0; m != NumModules; ++m) {
+    Module M("bench", Context);
+    for (unsigned f = 0; f != NumFunctions; ++f)
+      buildFunction(M, Task * NumModules + m + f);
+
+    FunctionPassManager FPM(&M);
+    FPM.add(new DominatorTree());
+    FPM.add(new CountLoops(NumLoops));
+    FPM.add(createVerifierPass(ReturnStatusAction));
+    FPM.doInitialization();
+    for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+      FPM.run(*F);
+    FPM.doFinalization();
+  }
+}
+
+/// timeTasks - Run all tasks on NumThreads threads, and return the wall time
+/// of the fastest of -repeat runs.
+static double timeTasks(unsigned NumThreads) {
+  double Best = 0;
+  for (unsigned i = 0, e = std::max(1U, unsigned(Repeat)); i != e; ++i) {
+    std::vector<unsigned> NumLoops(NumTasks);
+    TimeRecord Start = TimeRecord::getCurrentTime(true);
+    llvm_execute_on_threads(runTask, &NumLoops, NumTasks, NumThreads);
+    TimeRecord End = TimeRecord::getCurrentTime(false);
+    double Elapsed = End.getWallTime() - Start.getWallTime();
+    if (i == 0 || Elapsed < Best)
+      Best = Elapsed;
+  }
+  return Best;
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+  cl::ParseCommandLineOptions(argc, argv,
+                              "IR building on per-thread contexts\n");
+
+  std::vector<unsigned> ThreadCounts(Threads.begin(), Threads.end());
+  if (ThreadCounts.empty()) {
+    ThreadCounts.push_back(1);
+    ThreadCounts.push_back(2);
+    ThreadCounts.push_back(4);
+    ThreadCounts.push_back(8);
+  }
+  for (unsigned i = 0, e = ThreadCounts.size(); i != e; ++i)
+    if (ThreadCounts[i] == 0) {
+      errs() << argv[0] << ": -threads must be positive\n";
+      return 1;
+    }
+
+  std::string ErrorInfo;
+  OwningPtr<tool_output_file> Out(
+    new tool_output_file(OutputFilename.c_str(), ErrorInfo));
+  if (!ErrorInfo.empty()) {
+    errs() << ErrorInfo << '\n';
+    return 1;
+  }
+  raw_ostream &OS = Out->os();
+
+  // Every pass used must be registered before any thread looks it up.
+  PassRegistry &Registry = *PassRegistry::getPassRegistry();
+  initializeDominatorTreePass(Registry);
+  initializeLoopInfoPass(Registry);
+  initializeVerifierPass(Registry);
+
+  if (!llvm_start_multithreaded()) {
+    errs() << argv[0] << ": warning: threads are disabled, every run is "
+           << "serial\n";
+    ThreadCounts.assign(1, 1);
+  }
+
+  // The speedup of every run is relative to the serial one.
+  double SerialTime = timeTasks(1);
+  OS << "tag,threads,tasks,modules,functions,wall_s,speedup\n";
+  for (unsigned i = 0, e = ThreadCounts.size(); i != e; ++i) {
+    double Time = ThreadCounts[i] == 1 ? SerialTime
+                                       : timeTasks(ThreadCounts[i]);
+    OS << Tag << ',' << ThreadCounts[i] << ',' << NumTasks << ','
+       << NumModules << ',' << NumFunctions << ','
+       << format("%.6f", Time) << ','
+       << format("%.2f", Time > 0 ? SerialTime / Time : 0.0) << '\n';
+    OS.flush();
+  }
+
+  llvm_stop_multithreaded();
+  Out->keep();
+  return 0;
+}
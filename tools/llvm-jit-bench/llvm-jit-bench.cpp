@@ -0,0 +1,169 @@
+//===-- llvm-jit-bench.cpp - Time loading and unloading MCJIT objects -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program measures how MCJIT and SectionMemoryManager cope with a long
+// running process that keeps loading small objects, calling into them and
+// unloading them again.  It prints the average time per object along with the
+// memory manager's statistics at the end, as one record.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/ToolOutputFile.h"
+using namespace llvm;
+
+static cl::opt<std::string>
+OutputFilename("o", cl::desc("Output filename"), cl::value_desc("filename"),
+               cl::init("-"));
+
+static cl::opt<unsigned>
+NumObjects("objects", cl::init(100000),
+           cl::desc("Number of objects to load and unload"));
+
+static cl::opt<bool>
+Compile("compile",
+        cl::desc("Compile every object, instead of reusing the first one"));
+
+static cl::opt<std::string>
+Tag("tag", cl::value_desc("string"),
+    cl::desc("Label the result, for example with the revision measured"));
+
+namespace {
+/// ReuseObject - An object cache that hands out the first object compiled
+/// for every module, so that the benchmark does not time code generation.
+class ReuseObject : public ObjectCache {
+  OwningPtr<MemoryBuffer> Object;
+
+public:
+  virtual void notifyObjectCompiled(const Module *M, const MemoryBuffer *Obj) {
+    if (!Object)
+      Object.reset(MemoryBuffer::getMemBufferCopy(Obj->getBuffer()));
+  }
+
+protected:
+  virtual const MemoryBuffer *getObject(const Module *M) {
+    return Object.get();
+  }
+};
+}
+
+/// buildModule - Build "int32_t add(int32_t a, int32_t b)", which returns
+/// a + b + bias for a global bias of 0.
+static Module *buildModule(LLVMContext &Context, Function *&Add) {
+  Module *M = new Module("bench", Context);
+  M->setTargetTriple(sys::getProcessTriple());
+  Type *I32 = Type::getInt32Ty(Context);
+  GlobalVariable *Bias =
+    new GlobalVariable(*M, I32, false, GlobalValue::ExternalLinkage,
+                       ConstantInt::get(I32, 0), "bias");
+  Type *Params[] = { I32, I32 };
+  Add = Function::Create(FunctionType::get(I32, Params, false),
+                         GlobalValue::ExternalLinkage, "add", M);
+  Function::arg_iterator Args = Add->arg_begin();
+  Value *A = Args++;
+  IRBuilder<> Builder(BasicBlock::Create(Context, "entry", Add));
+  Value *Sum = Builder.CreateAdd(A, Args);
+  Builder.CreateRet(Builder.CreateAdd(Sum, Builder.CreateLoad(Bias)));
+  return M;
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+  cl::ParseCommandLineOptions(argc, argv,
+                              "MCJIT object load and unload benchmark\n");
+
+  if (NumObjects == 0) {
+    errs() << argv[0] << ": -objects must be positive\n";
+    return 1;
+  }
+
+  std::string ErrorInfo;
+  OwningPtr<tool_output_file> Out(
+    new tool_output_file(OutputFilename.c_str(), ErrorInfo));
+  if (!ErrorInfo.empty()) {
+    errs() << ErrorInfo << '\n';
+    return 1;
+  }
+  raw_ostream &OS = Out->os();
+
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+
+  LLVMContext Context;
+  Function *Add;
+  OwningPtr<Module> M(buildModule(Context, Add));
+
+  // The engine owns the memory manager.
+  SectionMemoryManager *MemMgr = new SectionMemoryManager();
+  std::string Error;
+  OwningPtr<ExecutionEngine> EE(EngineBuilder(M.get())
+                                .setEngineKind(EngineKind::JIT)
+                                .setUseMCJIT(true)
+                                .setMCJITMemoryManager(MemMgr)
+                                .setErrorStr(&Error)
+                                .setOptLevel(CodeGenOpt::None)
+                                .create());
+  if (!EE) {
+    errs() << argv[0] << ": " << Error << '\n';
+    return 1;
+  }
+  ReuseObject Cache;
+  if (!Compile)
+    EE->setObjectCache(&Cache);
+
+  // The same module is added again for every object, and unloaded once it
+  // was called.
+  unsigned Failures = 0;
+  TimeRecord Start = TimeRecord::getCurrentTime(true);
+  for (unsigned i = 0; i != NumObjects; ++i) {
+    if (i != 0)
+      EE->addModule(M.get());
+    int32_t (*AddPtr)(int32_t, int32_t) =
+      (int32_t(*)(int32_t, int32_t))EE->getPointerToFunction(Add);
+    EE->finalizeObject();
+    if (!AddPtr || AddPtr(int32_t(i), 1) != int32_t(i) + 1)
+      ++Failures;
+    EE->unloadModule(M.get());
+  }
+  TimeRecord End = TimeRecord::getCurrentTime(false);
+  double Elapsed = End.getWallTime() - Start.getWallTime();
+
+  SectionMemoryManager::MemoryStats Stats = MemMgr->getMemoryStats();
+  OS << "tag,objects,compile,wall_s,us_per_object,failures,mapped_bytes,"
+     << "slabs,permission_changes\n";
+  OS << Tag << ',' << NumObjects << ',' << (Compile ? 1 : 0) << ','
+     << format("%.6f", Elapsed) << ','
+     << format("%.3f", Elapsed * 1e6 / NumObjects) << ',' << Failures << ','
+     << Stats.MappedBytes << ',' << Stats.NumSlabs << ','
+     << Stats.NumPermissionChanges << '\n';
+
+  EE.reset();
+  Out->keep();
+  return Failures != 0;
+}
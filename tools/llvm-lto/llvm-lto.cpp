@@ -0,0 +1,117 @@
+//===-- llvm-lto.cpp - Drive libLTO the way a linker does -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program links bitcode files through the libLTO C interface and writes
+// the resulting object files, so that the optimizer and code generator of
+// libLTO can be tested without a linker that supports plugins.
+//
+// When code generation produces several object files, because of -j or
+// -cache-dir, they are written to <output>.0, <output>.1 and so on.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm-c/lto.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace llvm;
+
+static cl::list<std::string>
+InputFilenames(cl::Positional, cl::OneOrMore,
+               cl::desc("<input bitcode files>"));
+
+static cl::opt<std::string>
+OutputFilename("o", cl::Required, cl::desc("Output filename"),
+               cl::value_desc("filename"));
+
+static cl::list<std::string>
+ExportedSymbols("exported-symbol",
+                cl::desc("Symbol to keep in the output, may be repeated"),
+                cl::value_desc("symbol"));
+
+static cl::opt<unsigned>
+Threads("j", cl::init(1),
+        cl::desc("Number of threads to generate code on"),
+        cl::value_desc("N"));
+
+static cl::opt<std::string>
+CacheDir("cache-dir",
+         cl::desc("Directory in which to cache the generated object files"),
+         cl::value_desc("directory"));
+
+/// moveFile - Move the file From to To, copying it if it cannot be renamed.
+static error_code moveFile(const Twine &From, const Twine &To) {
+  if (!sys::fs::rename(From, To))
+    return error_code::success();
+  error_code EC = sys::fs::copy_file(From, To,
+                                     sys::fs::copy_option::overwrite_if_exists);
+  if (EC)
+    return EC;
+  return sys::fs::remove(From);
+}
+
+int main(int argc, char **argv) {
+  // Print a stack trace if we signal out.
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+
+  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+  cl::ParseCommandLineOptions(argc, argv, "llvm LTO linker\n");
+
+  lto_code_gen_t CodeGen = lto_codegen_create();
+  lto_codegen_set_pic_model(CodeGen, LTO_CODEGEN_PIC_MODEL_DYNAMIC);
+  lto_codegen_set_parallelism(CodeGen, Threads);
+  if (!CacheDir.empty())
+    lto_codegen_set_cache_dir(CodeGen, CacheDir.c_str());
+
+  for (unsigned i = 0, e = InputFilenames.size(); i != e; ++i) {
+    lto_module_t Module = lto_module_create(InputFilenames[i].c_str());
+    if (!Module) {
+      errs() << argv[0] << ": error loading file '" << InputFilenames[i]
+             << "': " << lto_get_error_message() << '\n';
+      return 1;
+    }
+    bool Failed = lto_codegen_add_module(CodeGen, Module);
+    lto_module_dispose(Module);
+    if (Failed) {
+      errs() << argv[0] << ": error adding file '" << InputFilenames[i]
+             << "': " << lto_get_error_message() << '\n';
+      return 1;
+    }
+  }
+
+  for (unsigned i = 0, e = ExportedSymbols.size(); i != e; ++i)
+    lto_codegen_add_must_preserve_symbol(CodeGen, ExportedSymbols[i].c_str());
+
+  const char **Names;
+  unsigned Count;
+  if (lto_codegen_compile_to_files(CodeGen, &Names, &Count)) {
+    errs() << argv[0] << ": error compiling the code: "
+           << lto_get_error_message() << '\n';
+    return 1;
+  }
+
+  for (unsigned i = 0; i != Count; ++i) {
+    std::string Output = OutputFilename;
+    if (Count > 1)
+      Output += "." + utostr(i);
+    if (error_code EC = moveFile(Names[i], Output)) {
+      errs() << argv[0] << ": error writing '" << Output << "': "
+             << EC.message() << '\n';
+      return 1;
+    }
+  }
+
+  lto_codegen_dispose(CodeGen);
+  return 0;
+}
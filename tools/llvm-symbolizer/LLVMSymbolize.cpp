@@ -13,9 +13,13 @@
 
 #include "LLVMSymbolize.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Object/MachO.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Path.h"
 
 #include <sstream>
@@ -223,6 +227,149 @@ static std::string getDarwinDWARFResourceForModule(const std::string &Path) {
   return ResourceName.str();
 }
 
+// Returns true and stores the build id of the object as a hex string in
+// BuildID if the object has one: the GNU build id note on ELF, the LC_UUID
+// load command on Mach-O.
+static bool getBuildID(const ObjectFile *Obj, std::string &BuildID) {
+  StringRef ID;
+  if (const MachOObjectFile *MachO = dyn_cast<MachOObjectFile>(Obj)) {
+    MachOObjectFile::LoadCommandInfo Command =
+        MachO->getFirstLoadCommandInfo();
+    for (unsigned i = 0, e = MachO->getHeader().NumLoadCommands; i != e; ++i) {
+      if (Command.C.Type == macho::LCT_UUID && Command.C.Size >= 24) {
+        ID = StringRef(Command.Ptr + 8, 16);
+        break;
+      }
+      if (i + 1 != e)
+        Command = MachO->getNextLoadCommandInfo(Command);
+    }
+  } else if (Obj->isELF()) {
+    error_code ec;
+    for (section_iterator si = Obj->begin_sections(),
+                          se = Obj->end_sections();
+         si != se; si.increment(ec)) {
+      StringRef Name;
+      if (error(ec) || error(si->getName(Name)))
+        return false;
+      if (Name != ".note.gnu.build-id")
+        continue;
+      StringRef Note;
+      if (error(si->getContents(Note)))
+        return false;
+      // The note starts with the sizes of its name and descriptor and its
+      // type, followed by the name "GNU" and the build id itself, both
+      // padded to four bytes.
+      DataExtractor Data(Note, Obj->isLittleEndian(), 0);
+      uint32_t Offset = 0;
+      uint32_t NameSize = Data.getU32(&Offset);
+      uint32_t DescSize = Data.getU32(&Offset);
+      uint32_t Type = Data.getU32(&Offset);
+      Offset += RoundUpToAlignment(NameSize, 4);
+      const uint32_t NT_GNU_BUILD_ID = 3;
+      if (Type != NT_GNU_BUILD_ID ||
+          !Data.isValidOffsetForDataOfSize(Offset, DescSize))
+        return false;
+      ID = Note.substr(Offset, DescSize);
+      break;
+    }
+  }
+  if (ID.empty())
+    return false;
+  BuildID.clear();
+  for (size_t i = 0, e = ID.size(); i != e; ++i) {
+    BuildID += hexdigit((unsigned char)ID[i] >> 4, true);
+    BuildID += hexdigit((unsigned char)ID[i] & 0xf, true);
+  }
+  return true;
+}
+
+// The address index cache holds one file per build id, which starts with
+// kAddressIndexMagic and the number of ranges, followed by the ranges. All
+// values are stored in little endian byte order.
+static const char kAddressIndexMagic[] = "CUINDEX1";
+static const size_t kAddressIndexHeaderSize = 8 + 4;
+static const size_t kAddressIndexEntrySize = 8 + 8 + 4;
+
+static bool readAddressIndex(const std::string &Path,
+                             std::vector<DIAddressRange> &Ranges) {
+  using namespace support;
+  OwningPtr<MemoryBuffer> Buff;
+  if (MemoryBuffer::getFile(Path, Buff))
+    return false;
+  StringRef Data = Buff->getBuffer();
+  if (Data.size() < kAddressIndexHeaderSize ||
+      !Data.startswith(StringRef(kAddressIndexMagic, 8)))
+    return false;
+  const char *Ptr = Data.data() + 8;
+  uint32_t NumRanges = endian::read<uint32_t, little, unaligned>(Ptr);
+  if (Data.size() !=
+      kAddressIndexHeaderSize + uint64_t(NumRanges) * kAddressIndexEntrySize)
+    return false;
+  Ptr += 4;
+  Ranges.resize(NumRanges);
+  for (uint32_t i = 0; i != NumRanges; ++i) {
+    Ranges[i].LowPC = endian::read<uint64_t, little, unaligned>(Ptr);
+    Ranges[i].HighPC = endian::read<uint64_t, little, unaligned>(Ptr + 8);
+    Ranges[i].CUOffset = endian::read<uint32_t, little, unaligned>(Ptr + 16);
+    Ptr += kAddressIndexEntrySize;
+  }
+  return true;
+}
+
+static void writeAddressIndex(const std::string &Path,
+                              const std::vector<DIAddressRange> &Ranges) {
+  using namespace support;
+  std::vector<char> Data(kAddressIndexHeaderSize +
+                         Ranges.size() * kAddressIndexEntrySize);
+  char *Ptr = &Data[0];
+  memcpy(Ptr, kAddressIndexMagic, 8);
+  endian::write<uint32_t, little, unaligned>(Ptr + 8, Ranges.size());
+  Ptr += kAddressIndexHeaderSize;
+  for (size_t i = 0, e = Ranges.size(); i != e; ++i) {
+    endian::write<uint64_t, little, unaligned>(Ptr, Ranges[i].LowPC);
+    endian::write<uint64_t, little, unaligned>(Ptr + 8, Ranges[i].HighPC);
+    endian::write<uint32_t, little, unaligned>(Ptr + 16, Ranges[i].CUOffset);
+    Ptr += kAddressIndexEntrySize;
+  }
+
+  // Write to a temporary file and rename it into place, so that concurrent
+  // symbolizers never read a partially written index.
+  int FD;
+  SmallString<128> TempPath;
+  if (sys::fs::unique_file(Path + ".%%%%%%%%.tmp", FD, TempPath))
+    return;
+  bool Failed;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS.write(&Data[0], Data.size());
+    OS.close();
+    Failed = OS.has_error();
+    if (Failed)
+      OS.clear_error();
+  }
+  if (Failed || sys::fs::rename(TempPath.str(), Path))
+    sys::fs::remove(TempPath.str());
+}
+
+void LLVMSymbolizer::loadOrSaveAddressIndex(const ObjectFile *DbgObj,
+                                            DIContext *Context) {
+  std::string BuildID;
+  if (!getBuildID(DbgObj, BuildID))
+    return;
+  SmallString<128> Path(Opts.IndexCacheDir);
+  sys::path::append(Path, BuildID + ".cuindex");
+
+  std::vector<DIAddressRange> Ranges;
+  if (readAddressIndex(Path.str(), Ranges)) {
+    Context->setAddressIndex(Ranges);
+    return;
+  }
+  if (!Context->getAddressIndex(Ranges))
+    return;
+  if (!sys::fs::create_directories(Opts.IndexCacheDir))
+    writeAddressIndex(Path.str(), Ranges);
+}
+
 ModuleInfo *
 LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
   ModuleMapTy::iterator I = Modules.find(ModuleName);
@@ -254,6 +401,8 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
     }
     Context = DIContext::getDWARFContext(DbgObj);
     assert(Context);
+    if (!Opts.IndexCacheDir.empty())
+      loadOrSaveAddressIndex(DbgObj, Context);
   }
 
   ModuleInfo *Info = new ModuleInfo(Obj, Context);
@@ -35,10 +35,15 @@ public:
     bool PrintFunctions : 1;
     bool PrintInlining : 1;
     bool Demangle : 1;
+    // If not empty, the directory in which the address index of binaries with
+    // a build id is cached between runs.
+    std::string IndexCacheDir;
     Options(bool UseSymbolTable = true, bool PrintFunctions = true,
-            bool PrintInlining = true, bool Demangle = true)
+            bool PrintInlining = true, bool Demangle = true,
+            const std::string &IndexCacheDir = "")
         : UseSymbolTable(UseSymbolTable), PrintFunctions(PrintFunctions),
-          PrintInlining(PrintInlining), Demangle(Demangle) {
+          PrintInlining(PrintInlining), Demangle(Demangle),
+          IndexCacheDir(IndexCacheDir) {
     }
   };
 
@@ -53,6 +58,7 @@ public:
   void flush();
 private:
   ModuleInfo *getOrCreateModuleInfo(const std::string &ModuleName);
+  void loadOrSaveAddressIndex(const ObjectFile *DbgObj, DIContext *Context);
   std::string printDILineInfo(DILineInfo LineInfo) const;
   void DemangleName(std::string &Name) const;
 
@@ -22,10 +22,14 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <map>
 #include <string>
+#include <vector>
 
 using namespace llvm;
 using namespace symbolize;
@@ -47,6 +51,21 @@ ClPrintInlining("inlining", cl::init(true),
 static cl::opt<bool>
 ClDemangle("demangle", cl::init(true), cl::desc("Demangle function names"));
 
+static cl::opt<std::string>
+ClIndexCacheDir("index-cache-dir", cl::init(""),
+                cl::desc("Directory in which to cache the address index of "
+                         "binaries with a build id"));
+
+static cl::opt<bool>
+ClBatch("batch", cl::init(false),
+        cl::desc("Read all addresses before printing any location, and look "
+                 "up the addresses of each module together"));
+
+static cl::opt<unsigned>
+ClThreads("threads", cl::init(1),
+          cl::desc("Number of threads symbolizing different modules in "
+                   "-batch mode"));
+
 static bool parseCommand(bool &IsData, std::string &ModuleName,
                          uint64_t &ModuleOffset) {
   const char *kDataCmd = "DATA ";
@@ -94,6 +113,110 @@ static bool parseCommand(bool &IsData, std::string &ModuleName,
   return true;
 }
 
+namespace {
+/// Query - One address read in -batch mode.
+struct Query {
+  unsigned Module;
+  uint64_t ModuleOffset;
+  bool IsData;
+  /// Position of the query in the input, which is the order the answers are
+  /// printed in.
+  unsigned Index;
+
+  bool operator<(const Query &RHS) const {
+    if (Module != RHS.Module)
+      return Module < RHS.Module;
+    return ModuleOffset < RHS.ModuleOffset;
+  }
+};
+
+/// Batch - All queries of a -batch run, sorted by module and address.
+struct Batch {
+  LLVMSymbolizer::Options Opts;
+  std::vector<std::string> ModuleNames;
+  std::vector<Query> Queries;
+  /// The queries for module i are Queries[ModuleStarts[i], ModuleStarts[i+1]).
+  std::vector<unsigned> ModuleStarts;
+  /// Modules in the order they are handed to threads, those with the most
+  /// queries first, so that a big module does not start last.
+  std::vector<unsigned> ModuleOrder;
+  std::vector<std::string> Results;
+};
+
+struct MoreQueries {
+  const std::vector<unsigned> &ModuleStarts;
+  MoreQueries(const std::vector<unsigned> &ModuleStarts)
+    : ModuleStarts(ModuleStarts) {}
+  unsigned size(unsigned Module) const {
+    return ModuleStarts[Module + 1] - ModuleStarts[Module];
+  }
+  bool operator()(unsigned LHS, unsigned RHS) const {
+    return size(LHS) > size(RHS);
+  }
+};
+} // end anonymous namespace
+
+/// symbolizeModule - Answer the queries of one module.  Each module is
+/// handled by a single task with a symbolizer of its own, so nothing is
+/// shared between threads but the (distinct) result slots.
+static void symbolizeModule(void *Data, unsigned Task) {
+  Batch &B = *static_cast<Batch*>(Data);
+  unsigned Module = B.ModuleOrder[Task];
+  const std::string &ModuleName = B.ModuleNames[Module];
+  LLVMSymbolizer Symbolizer(B.Opts);
+  for (unsigned i = B.ModuleStarts[Module], e = B.ModuleStarts[Module + 1];
+       i != e; ++i) {
+    const Query &Q = B.Queries[i];
+    B.Results[Q.Index] =
+        Q.IsData ? Symbolizer.symbolizeData(ModuleName, Q.ModuleOffset)
+                 : Symbolizer.symbolizeCode(ModuleName, Q.ModuleOffset);
+  }
+}
+
+static void runBatch(const LLVMSymbolizer::Options &Opts) {
+  Batch B;
+  B.Opts = Opts;
+  std::map<std::string, unsigned> ModuleIDs;
+  bool IsData = false;
+  std::string ModuleName;
+  uint64_t ModuleOffset;
+  while (parseCommand(IsData, ModuleName, ModuleOffset)) {
+    std::pair<std::map<std::string, unsigned>::iterator, bool> Module =
+        ModuleIDs.insert(std::make_pair(ModuleName, B.ModuleNames.size()));
+    if (Module.second)
+      B.ModuleNames.push_back(ModuleName);
+    Query Q = { Module.first->second, ModuleOffset, IsData,
+                (unsigned)B.Queries.size() };
+    B.Queries.push_back(Q);
+  }
+
+  // Looking up the addresses of a module in increasing order walks its
+  // symbol table and line tables front to back.
+  std::sort(B.Queries.begin(), B.Queries.end());
+  for (unsigned i = 0, e = B.Queries.size(); i != e; ++i)
+    if (i == 0 || B.Queries[i].Module != B.Queries[i - 1].Module)
+      B.ModuleStarts.push_back(i);
+  B.ModuleStarts.push_back(B.Queries.size());
+
+  // Every module id has at least one query, so ModuleStarts is indexed by
+  // module id.
+  unsigned NumModules = B.ModuleNames.size();
+  for (unsigned i = 0; i != NumModules; ++i)
+    B.ModuleOrder.push_back(i);
+  std::stable_sort(B.ModuleOrder.begin(), B.ModuleOrder.end(),
+                   MoreQueries(B.ModuleStarts));
+
+  B.Results.resize(B.Queries.size());
+  bool Multithreaded = ClThreads > 1 && llvm_start_multithreaded();
+  llvm_execute_on_threads(symbolizeModule, &B, NumModules,
+                          Multithreaded ? ClThreads : 1);
+  if (Multithreaded)
+    llvm_stop_multithreaded();
+
+  for (unsigned i = 0, e = B.Results.size(); i != e; ++i)
+    outs() << B.Results[i] << "\n";
+}
+
 int main(int argc, char **argv) {
   // Print stack trace if we signal out.
   sys::PrintStackTraceOnErrorSignal();
@@ -102,7 +225,11 @@ int main(int argc, char **argv) {
 
   cl::ParseCommandLineOptions(argc, argv, "llvm symbolizer for compiler-rt\n");
   LLVMSymbolizer::Options Opts(ClUseSymbolTable, ClPrintFunctions,
-                               ClPrintInlining, ClDemangle);
+                               ClPrintInlining, ClDemangle, ClIndexCacheDir);
+  if (ClBatch) {
+    runBatch(Opts);
+    return 0;
+  }
   LLVMSymbolizer Symbolizer(Opts);
 
   bool IsData = false;
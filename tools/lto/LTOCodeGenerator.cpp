@@ -12,13 +12,17 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "lto"
 #include "LTOCodeGenerator.h"
 #include "LTOModule.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Analysis/Verifier.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/Config/config.h"
+#include "llvm/IR/ContentHash.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -33,10 +37,12 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/system_error.h"
 #include "llvm/Target/Mangler.h"
@@ -46,6 +52,8 @@
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/ObjCARC.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include <algorithm>
 using namespace llvm;
 
 static cl::opt<bool>
@@ -60,6 +68,14 @@ static cl::opt<bool>
 DisableGVNLoadPRE("disable-gvn-loadpre", cl::init(false),
   cl::desc("Do not run the GVN load PRE pass"));
 
+STATISTIC(NumCacheHits, "Number of partitions found in the object cache");
+STATISTIC(NumCacheMisses, "Number of partitions missing from the object cache");
+
+static cl::opt<unsigned>
+CachePartitions("lto-cache-partitions", cl::init(16),
+  cl::desc("Number of partitions to split the module into when object files "
+           "are cached"));
+
 const char* LTOCodeGenerator::getVersionString() {
 #ifdef LLVM_VERSION_INFO
   return PACKAGE_NAME " version " PACKAGE_VERSION ", " LLVM_VERSION_INFO;
@@ -73,7 +89,7 @@ LTOCodeGenerator::LTOCodeGenerator()
     _linker(new Module("ld-temp.o", _context)), _target(NULL),
     _emitDwarfDebugInfo(false), _scopeRestrictionsDone(false),
     _codeModel(LTO_CODEGEN_PIC_MODEL_DYNAMIC),
-    _nativeObjectFile(NULL) {
+    _nativeObjectFile(NULL), _parallelism(1) {
   InitializeAllTargets();
   InitializeAllTargetMCs();
   InitializeAllAsmPrinters();
@@ -191,6 +207,28 @@ bool LTOCodeGenerator::compile_to_file(const char** name, std::string& errMsg) {
   return false;
 }
 
+bool LTOCodeGenerator::compile_to_files(const char ***names, unsigned *count,
+                                        std::string &errMsg) {
+  _nativeObjectPaths.clear();
+  _nativeObjectPathRefs.clear();
+
+  if (_parallelism > 1 || !_cacheDir.empty()) {
+    if (generateObjectFiles(errMsg))
+      return true;
+  } else {
+    const char *name;
+    if (compile_to_file(&name, errMsg))
+      return true;
+    _nativeObjectPaths.push_back(name);
+  }
+
+  for (unsigned i = 0, e = _nativeObjectPaths.size(); i != e; ++i)
+    _nativeObjectPathRefs.push_back(_nativeObjectPaths[i].c_str());
+  *names = &_nativeObjectPathRefs[0];
+  *count = _nativeObjectPathRefs.size();
+  return false;
+}
+
 const void* LTOCodeGenerator::compile(size_t* length, std::string& errMsg) {
   const char *name;
   if (compile_to_file(&name, errMsg))
@@ -357,16 +395,9 @@ void LTOCodeGenerator::applyScopeRestrictions() {
 }
 
 /// Optimize merged modules using various IPO passes
-bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
-                                          std::string &errMsg) {
-  if (this->determineTarget(errMsg))
-    return true;
-
+void LTOCodeGenerator::runIPOPasses() {
   Module* mergedModule = _linker.getModule();
 
-  // Mark which symbols can not be internalized
-  this->applyScopeRestrictions();
-
   // Instantiate the pass manager to organize the passes.
   PassManager passes;
 
@@ -389,25 +420,46 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   // Make sure everything is still good.
   passes.add(createVerifierPass());
 
-  PassManager codeGenPasses;
-
-  codeGenPasses.add(new DataLayout(*_target->getDataLayout()));
-  _target->addAnalysisPasses(codeGenPasses);
+  // Run our queue of passes all at once now, efficiently.
+  passes.run(*mergedModule);
+}
 
-  formatted_raw_ostream Out(out);
+/// addCodeGenPasses - Populate codeGenPasses with the passes that lower a
+/// module to an object file written to Out.  Returns true on error.
+static bool addCodeGenPasses(PassManager &codeGenPasses, TargetMachine &TM,
+                             formatted_raw_ostream &Out,
+                             std::string &errMsg) {
+  codeGenPasses.add(new DataLayout(*TM.getDataLayout()));
+  TM.addAnalysisPasses(codeGenPasses);
 
   // If the bitcode files contain ARC code and were compiled with optimization,
   // the ObjCARCContractPass must be run, so do it unconditionally here.
   codeGenPasses.add(createObjCARCContractPass());
 
-  if (_target->addPassesToEmitFile(codeGenPasses, Out,
-                                   TargetMachine::CGFT_ObjectFile)) {
+  if (TM.addPassesToEmitFile(codeGenPasses, Out,
+                             TargetMachine::CGFT_ObjectFile)) {
     errMsg = "target file type not supported";
     return true;
   }
+  return false;
+}
 
-  // Run our queue of passes all at once now, efficiently.
-  passes.run(*mergedModule);
+bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
+                                          std::string &errMsg) {
+  if (this->determineTarget(errMsg))
+    return true;
+
+  Module* mergedModule = _linker.getModule();
+
+  // Mark which symbols can not be internalized
+  this->applyScopeRestrictions();
+
+  PassManager codeGenPasses;
+  formatted_raw_ostream Out(out);
+  if (addCodeGenPasses(codeGenPasses, *_target, Out, errMsg))
+    return true;
+
+  this->runIPOPasses();
 
   // Run the code generator, and write assembly file
   codeGenPasses.run(*mergedModule);
@@ -415,6 +467,277 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   return false; // success
 }
 
+//===----------------------------------------------------------------------===//
+// Parallel code generation
+//===----------------------------------------------------------------------===//
+//
+// After IPO the merged module is split into partitions which are lowered to
+// separate object files concurrently.  Every partition is loaded from a
+// shared bitcode image into its own LLVMContext, since neither contexts nor
+// TargetMachines may be shared between threads.  See SplitModule.h for how
+// the definitions are divided.
+//
+// With a cache directory, definitions are assigned to partitions by name, so
+// that an edit only changes the partitions it touches.  Each partition is
+// keyed by its content hash and the code generation options, and the object
+// file of a partition that has been compiled before is copied from the cache
+// instead of being generated again.
+
+namespace {
+/// CodeGenPartition - The input and result of lowering one partition.
+struct CodeGenPartition {
+  StringRef Bitcode;
+  const StringMap<unsigned> *Owner;
+  unsigned Part;
+  const TargetMachine *Prototype;
+  StringRef CacheDir;
+  StringRef OptionsKey;
+  raw_ostream *Out;
+  std::string ErrMsg;
+};
+}
+
+/// getOptionsKey - Return a string describing everything besides the IR that
+/// the object files produced by TM depend on.
+static std::string getOptionsKey(const TargetMachine &TM,
+                                 const std::vector<char*> &codegenOptions) {
+  std::string Key;
+  raw_string_ostream OS(Key);
+  OS << LTOCodeGenerator::getVersionString() << '\n'
+     << TM.getTargetTriple() << '\n' << TM.getTargetCPU() << '\n'
+     << TM.getTargetFeatureString() << '\n' << TM.getRelocationModel() << ' '
+     << TM.getCodeModel() << ' ' << TM.getOptLevel() << '\n';
+  for (unsigned i = 0, e = codegenOptions.size(); i != e; ++i)
+    OS << codegenOptions[i] << '\n';
+  return OS.str();
+}
+
+/// removeUnusedDeclarations - Erase the declarations and available_externally
+/// copies that M does not refer to, which extractPartition leaves behind for
+/// every other partition.  This keeps the content hash of a partition from
+/// changing when definitions are added to or removed from the others.
+static void removeUnusedDeclarations(Module &M) {
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ) {
+    Function *F = I++;
+    if (F->isDeclaration() && !F->isMaterializable() && F->use_empty() &&
+        !F->hasExternalWeakLinkage())
+      F->eraseFromParent();
+  }
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ) {
+    GlobalVariable *GV = I++;
+    if ((GV->isDeclaration() || GV->hasAvailableExternallyLinkage()) &&
+        GV->use_empty() && !GV->hasExternalWeakLinkage())
+      GV->eraseFromParent();
+  }
+}
+
+/// getCachePath - Return where the object file of M is cached.
+static std::string getCachePath(const Module &M, const CodeGenPartition &P) {
+  MD5 Hash;
+  Hash.update(hashModuleContent(M).str());
+  Hash.update(P.OptionsKey);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Key;
+  MD5::stringifyResult(Result, Key);
+  return (P.CacheDir + "/llvm-lto-" + Key.str() + ".o").str();
+}
+
+/// addToCache - Store the object file Object at CachePath.  The file is
+/// written under a temporary name and then renamed, so that concurrent links
+/// never see a partial file.  Failing to cache is not an error.
+static void addToCache(StringRef Object, StringRef CacheDir,
+                       const std::string &CachePath) {
+  SmallString<128> TempPath;
+  int FD;
+  if (sys::fs::unique_file(CacheDir + "/llvm-lto-%%%%%%%.tmp", FD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Object;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath.str());
+      return;
+    }
+  }
+  if (sys::fs::rename(TempPath.str(), CachePath))
+    sys::fs::remove(TempPath.str());
+}
+
+/// generatePartition - Thread entry point lowering one partition to an object
+/// file.  Everything it touches is private to the calling thread except for
+/// the read-only bitcode image, ownership map and prototype TargetMachine.
+static void generatePartition(void *Data, unsigned Index) {
+  CodeGenPartition &P = (*static_cast<std::vector<CodeGenPartition>*>(Data))
+                          [Index];
+  LLVMContext Context;
+  MemoryBuffer *Buffer = MemoryBuffer::getMemBuffer(P.Bitcode, "ld-temp.o",
+                                                    false);
+  OwningPtr<Module> M(getLazyBitcodeModule(Buffer, Context, &P.ErrMsg));
+  if (!M) {
+    delete Buffer;
+    return;
+  }
+  if (extractPartition(*M, *P.Owner, P.Part, P.ErrMsg))
+    return;
+
+  std::string CachePath;
+  if (!P.CacheDir.empty()) {
+    removeUnusedDeclarations(*M);
+    CachePath = getCachePath(*M, P);
+    OwningPtr<MemoryBuffer> Cached;
+    if (!MemoryBuffer::getFile(CachePath, Cached, -1, false)) {
+      ++NumCacheHits;
+      *P.Out << Cached->getBuffer();
+      return;
+    }
+    ++NumCacheMisses;
+  }
+
+  const TargetMachine &Proto = *P.Prototype;
+  OwningPtr<TargetMachine> TM(Proto.getTarget().createTargetMachine(
+      Proto.getTargetTriple(), Proto.getTargetCPU(),
+      Proto.getTargetFeatureString(), Proto.Options,
+      Proto.getRelocationModel(), Proto.getCodeModel(), Proto.getOptLevel()));
+
+  // A partition that goes into the cache is first generated into memory.
+  SmallString<0> Object;
+  raw_svector_ostream ObjectOS(Object);
+  {
+    PassManager codeGenPasses;
+    formatted_raw_ostream Out(CachePath.empty() ? *P.Out : ObjectOS);
+    if (addCodeGenPasses(codeGenPasses, *TM, Out, P.ErrMsg))
+      return;
+    codeGenPasses.run(*M);
+  }
+
+  if (!CachePath.empty()) {
+    ObjectOS.flush();
+    *P.Out << Object;
+    addToCache(Object, P.CacheDir, CachePath);
+  }
+}
+
+/// generateObjectFiles - Optimize the merged module, then split it into
+/// partitions and lower them to object files concurrently.  Without a cache
+/// there are up to _parallelism partitions, with one there are
+/// -lto-cache-partitions of them.  On success the object file names are left
+/// in _nativeObjectPaths.
+bool LTOCodeGenerator::generateObjectFiles(std::string &errMsg) {
+  if (this->determineTarget(errMsg))
+    return true;
+
+  Module* mergedModule = _linker.getModule();
+
+  // Mark which symbols can not be internalized
+  this->applyScopeRestrictions();
+  this->runIPOPasses();
+
+  promoteLocalSymbols(*mergedModule);
+  StringMap<unsigned> Owner;
+  std::vector<unsigned> Parts;
+  if (_cacheDir.empty()) {
+    unsigned NumDefined = 0;
+    for (Module::iterator I = mergedModule->begin(), E = mergedModule->end();
+         I != E; ++I)
+      if (!I->isDeclaration())
+        ++NumDefined;
+    unsigned NumPartitions = std::max(1U, std::min(_parallelism, NumDefined));
+    partitionModule(*mergedModule, NumPartitions, Owner);
+    for (unsigned i = 0; i != NumPartitions; ++i)
+      Parts.push_back(i);
+  } else {
+    // The number of partitions must not depend on the module, or every edit
+    // would move definitions around.  Empty partitions are skipped, except
+    // for the first one, which carries the module level globals.
+    unsigned NumPartitions = std::max(1U, (unsigned)CachePartitions);
+    partitionModuleByName(*mergedModule, NumPartitions, Owner);
+    std::vector<bool> Used(NumPartitions, false);
+    Used[0] = true;
+    for (StringMap<unsigned>::iterator I = Owner.begin(), E = Owner.end();
+         I != E; ++I)
+      Used[I->getValue()] = true;
+    for (unsigned i = 0; i != NumPartitions; ++i)
+      if (Used[i])
+        Parts.push_back(i);
+
+    if (error_code EC = sys::fs::create_directories(_cacheDir)) {
+      errMsg = "could not create cache directory " + _cacheDir + ": " +
+               EC.message();
+      return true;
+    }
+  }
+
+  // Threads are of no use if LLVM cannot be made thread safe.
+  unsigned NumThreads = std::min(_parallelism, (unsigned)Parts.size());
+  if (!llvm_is_multithreaded() && !llvm_start_multithreaded())
+    NumThreads = 1;
+
+  std::string Bitcode;
+  {
+    raw_string_ostream OS(Bitcode);
+    WriteBitcodeToFile(mergedModule, OS);
+  }
+  std::string OptionsKey;
+  if (!_cacheDir.empty())
+    OptionsKey = getOptionsKey(*_target, _codegenOptions);
+
+  std::vector<tool_output_file*> Files;
+  std::vector<CodeGenPartition> Partitions(Parts.size());
+  bool Failed = false;
+  for (unsigned i = 0, e = Parts.size(); i != e; ++i) {
+    SmallString<128> Filename;
+    int FD;
+    error_code EC = sys::fs::unique_file("lto-llvm-%%%%%%%.o", FD, Filename);
+    if (EC) {
+      errMsg = EC.message();
+      Failed = true;
+      break;
+    }
+    Files.push_back(new tool_output_file(Filename.c_str(), FD));
+    _nativeObjectPaths.push_back(Filename.c_str());
+
+    CodeGenPartition &P = Partitions[i];
+    P.Bitcode = Bitcode;
+    P.Owner = &Owner;
+    P.Part = Parts[i];
+    P.Prototype = _target;
+    P.CacheDir = _cacheDir;
+    P.OptionsKey = OptionsKey;
+    P.Out = &Files.back()->os();
+  }
+
+  if (!Failed)
+    llvm_execute_on_threads(generatePartition, &Partitions, Partitions.size(),
+                            NumThreads);
+
+  for (unsigned i = 0, e = Files.size(); i != e; ++i) {
+    if (!Failed && !Partitions[i].ErrMsg.empty()) {
+      errMsg = Partitions[i].ErrMsg;
+      Failed = true;
+    }
+    Files[i]->os().close();
+    if (Files[i]->os().has_error()) {
+      Files[i]->os().clear_error();
+      Failed = true;
+    }
+  }
+
+  if (!Failed)
+    for (unsigned i = 0, e = Files.size(); i != e; ++i)
+      Files[i]->keep();
+  DeleteContainerPointers(Files);
+
+  if (Failed) {
+    _nativeObjectPaths.clear();
+    return true;
+  }
+  return false;
+}
+
 /// setCodeGenDebugOptions - Set codegen debugging options to aid in debugging
 /// LTO problems.
 void LTOCodeGenerator::setCodeGenDebugOptions(const char *options) {
@@ -45,6 +45,8 @@ struct LTOCodeGenerator {
   bool setCodePICModel(lto_codegen_model, std::string &errMsg);
 
   void setCpu(const char* mCpu) { _mCpu = mCpu; }
+  void setParallelism(unsigned threads) { _parallelism = threads ? threads : 1; }
+  void setCacheDir(const char *path) { _cacheDir = path ? path : ""; }
 
   void addMustPreserveSymbol(const char* sym) {
     _mustPreserveSymbols[sym] = 1;
@@ -52,11 +54,15 @@ struct LTOCodeGenerator {
 
   bool writeMergedModules(const char *path, std::string &errMsg);
   bool compile_to_file(const char **name, std::string &errMsg);
+  bool compile_to_files(const char ***names, unsigned *count,
+                        std::string &errMsg);
   const void *compile(size_t *length, std::string &errMsg);
   void setCodeGenDebugOptions(const char *opts);
 
 private:
   bool generateObjectFile(llvm::raw_ostream &out, std::string &errMsg);
+  bool generateObjectFiles(std::string &errMsg);
+  void runIPOPasses();
   void applyScopeRestrictions();
   void applyRestriction(llvm::GlobalValue &GV,
                         std::vector<const char*> &mustPreserveList,
@@ -78,6 +84,10 @@ private:
   std::vector<char*>          _codegenOptions;
   std::string                 _mCpu;
   std::string                 _nativeObjectPath;
+  unsigned                    _parallelism;
+  std::string                 _cacheDir;
+  std::vector<std::string>    _nativeObjectPaths;
+  std::vector<const char*>    _nativeObjectPathRefs;
 };
 
 #endif // LTO_CODE_GENERATOR_H
@@ -188,7 +188,7 @@ bool LTOModule::isBitcodeFileForTarget(const void *mem, size_t length,
 bool LTOModule::isBitcodeFileForTarget(const char *path,
                                        const char *triplePrefix) {
   OwningPtr<MemoryBuffer> buffer;
-  if (MemoryBuffer::getFile(path, buffer))
+  if (MemoryBuffer::getFile(path, buffer, -1, false))
     return false;
   return isTargetMatch(buffer.take(), triplePrefix);
 }
@@ -204,8 +204,10 @@ bool LTOModule::isTargetMatch(MemoryBuffer *buffer, const char *triplePrefix) {
 /// makeLTOModule - Create an LTOModule. N.B. These methods take ownership of
 /// the buffer.
 LTOModule *LTOModule::makeLTOModule(const char *path, std::string &errMsg) {
+  // Bitcode needs no null terminator; without one the file is always mapped,
+  // and the lazily read module only pages in what it looks at.
   OwningPtr<MemoryBuffer> buffer;
-  if (error_code ec = MemoryBuffer::getFile(path, buffer)) {
+  if (error_code ec = MemoryBuffer::getFile(path, buffer, -1, false)) {
     errMsg = ec.message();
     return NULL;
   }
@@ -29,10 +29,13 @@
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/LinkAllIR.h"
 #include "llvm/LinkAllPasses.h"
+#include "llvm/Linker.h"
 #include "llvm/MC/SubtargetFeature.h"
 #include "llvm/PassManager.h"
+#include "llvm/Support/DataStream.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PassNameParser.h"
 #include "llvm/Support/PluginLoader.h"
 #include "llvm/Support/PrettyStackTrace.h"
@@ -41,10 +44,12 @@
 #include "llvm/Support/SystemUtils.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 #include <algorithm>
 #include <memory>
 using namespace llvm;
@@ -152,6 +157,16 @@ static cl::opt<bool>
 PrintBreakpoints("print-breakpoints-for-testing",
                  cl::desc("Print select breakpoints location for testing"));
 
+static cl::opt<unsigned>
+FunctionPassThreads("function-pass-threads",
+  cl::desc("Run a pipeline made only of function passes on this many threads"),
+  cl::init(1));
+
+static cl::opt<bool>
+StreamFunctions("stream-functions",
+  cl::desc("Run a pipeline made only of function analyses over one function "
+           "body at a time, freeing each before reading the next"));
+
 static cl::opt<std::string>
 DefaultDataLayout("default-data-layout",
           cl::desc("data layout string to use if not specified by module"),
@@ -546,6 +561,307 @@ static TargetMachine* GetTargetMachine(Triple TheTriple) {
                                         GetCodeGenOptLevel());
 }
 
+//===----------------------------------------------------------------------===//
+// Running function passes on several threads
+//
+// An LLVMContext may only be used by one thread at a time, so functions of the
+// same module can not be optimized concurrently.  Instead, the module is split
+// into more partitions than there are threads (see SplitModule.h), each thread
+// loads the partitions it picks up into a private context and runs its own
+// FunctionPassManager over the functions they own, and the optimized
+// partitions are linked back together at the end.
+
+/// isFunctionPassPipeline - Return true if the requested pipeline only
+/// consists of passes that run on one function at a time.
+static bool isFunctionPassPipeline() {
+  if (PassList.empty() || PrintEachXForm || PrintBreakpoints || StripDebug ||
+      StandardCompileOpts || StandardLinkOpts || OptLevelO1 || OptLevelO2 ||
+      OptLevelOs || OptLevelOz || OptLevelO3)
+    return false;
+
+  for (unsigned i = 0, e = PassList.size(); i != e; ++i) {
+    if (!PassList[i]->getNormalCtor())
+      return false;
+    OwningPtr<Pass> P(PassList[i]->getNormalCtor()());
+    switch (P->getPassKind()) {
+    case PT_BasicBlock:
+    case PT_Region:
+    case PT_Loop:
+    case PT_Function:
+      break;
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+/// addFunctionPasses - Add the requested function passes to FPM, after the
+/// analyses they use for M, and printers for them to \p AnalysisOut if it is
+/// not null.  Returns the TargetMachine for M, if any, which must outlive FPM.
+static TargetMachine *addFunctionPasses(FunctionPassManager &FPM, Module &M,
+                                        raw_ostream *AnalysisOut) {
+  TargetLibraryInfo *TLI = new TargetLibraryInfo(Triple(M.getTargetTriple()));
+  if (DisableSimplifyLibCalls)
+    TLI->disableAllFunctions();
+  FPM.add(TLI);
+
+  if (!M.getDataLayout().empty())
+    FPM.add(new DataLayout(M.getDataLayout()));
+  else if (!DefaultDataLayout.empty())
+    FPM.add(new DataLayout(DefaultDataLayout));
+
+  Triple ModuleTriple(M.getTargetTriple());
+  TargetMachine *TM = 0;
+  if (ModuleTriple.getArch())
+    TM = GetTargetMachine(ModuleTriple);
+  if (TM)
+    TM->addAnalysisPasses(FPM);
+
+  for (unsigned i = 0, e = PassList.size(); i != e; ++i) {
+    Pass *P = PassList[i]->getNormalCtor()();
+    PassKind Kind = P->getPassKind();
+    addPass(FPM, P);
+    if (!AnalysisOut)
+      continue;
+    switch (Kind) {
+    case PT_BasicBlock:
+      FPM.add(new BasicBlockPassPrinter(PassList[i], *AnalysisOut));
+      break;
+    case PT_Region:
+      FPM.add(new RegionPassPrinter(PassList[i], *AnalysisOut));
+      break;
+    case PT_Loop:
+      FPM.add(new LoopPassPrinter(PassList[i], *AnalysisOut));
+      break;
+    default:
+      FPM.add(new FunctionPassPrinter(PassList[i], *AnalysisOut));
+      break;
+    }
+  }
+  return TM;
+}
+
+namespace {
+/// FunctionPassPartition - The input and result of optimizing one partition.
+struct FunctionPassPartition {
+  StringRef Bitcode;
+  const StringMap<unsigned> *Owner;
+  std::string Result;
+  std::string ErrMsg;
+};
+}
+
+/// optimizePartition - Thread entry point running the requested function
+/// passes over the functions owned by one partition.
+static void optimizePartition(void *Data, unsigned Index) {
+  FunctionPassPartition &P =
+    (*static_cast<std::vector<FunctionPassPartition>*>(Data))[Index];
+  LLVMContext Context;
+  MemoryBuffer *Buffer = MemoryBuffer::getMemBuffer(P.Bitcode, "", false);
+  OwningPtr<Module> M(getLazyBitcodeModule(Buffer, Context, &P.ErrMsg));
+  if (!M) {
+    delete Buffer;
+    return;
+  }
+  if (extractPartition(*M, *P.Owner, Index, P.ErrMsg))
+    return;
+
+  // Module level named metadata is linked back from partition 0 only.
+  if (Index != 0)
+    while (!M->named_metadata_empty())
+      M->named_metadata_begin()->eraseFromParent();
+
+  OwningPtr<TargetMachine> TM;
+  FunctionPassManager FPM(M.get());
+  TM.reset(addFunctionPasses(FPM, *M, 0));
+
+  FPM.doInitialization();
+  for (Module::iterator F = M->begin(), E = M->end(); F != E; ++F)
+    if (!F->isDeclaration())
+      FPM.run(*F);
+  FPM.doFinalization();
+  dropPartitionCopies(*M, *P.Owner, Index);
+
+  raw_string_ostream OS(P.Result);
+  WriteBitcodeToFile(M.get(), OS);
+}
+
+/// runFunctionPassesInParallel - Run the requested function passes over M on
+/// NumThreads threads.  Returns the optimized module, which replaces M, or
+/// null on error.
+static Module *runFunctionPassesInParallel(Module *M, unsigned NumThreads,
+                                           std::string &ErrMsg) {
+  std::vector<PromotedSymbol> Promoted;
+  promoteLocalSymbols(*M, &Promoted);
+
+  // Remember the original order of the module, linking does not keep it.
+  std::vector<std::string> FunctionOrder, GlobalOrder;
+  unsigned NumDefined = 0;
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I) {
+    FunctionOrder.push_back(I->getName());
+    if (!I->isDeclaration())
+      ++NumDefined;
+  }
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I)
+    GlobalOrder.push_back(I->getName());
+
+  // Use more partitions than threads so that idle threads can pick up the
+  // remaining work when partitions turn out to be uneven.
+  unsigned NumPartitions = std::max(1U, std::min(4 * NumThreads, NumDefined));
+  StringMap<unsigned> Owner;
+  partitionModule(*M, NumPartitions, Owner);
+
+  std::string Bitcode;
+  {
+    raw_string_ostream OS(Bitcode);
+    WriteBitcodeToFile(M, OS);
+  }
+  std::string ModuleID = M->getModuleIdentifier();
+  LLVMContext &Context = M->getContext();
+  delete M;
+
+  std::vector<FunctionPassPartition> Partitions(NumPartitions);
+  for (unsigned i = 0; i != NumPartitions; ++i) {
+    Partitions[i].Bitcode = Bitcode;
+    Partitions[i].Owner = &Owner;
+  }
+  if (!llvm_is_multithreaded() && !llvm_start_multithreaded())
+    NumThreads = 1;
+  llvm_execute_on_threads(optimizePartition, &Partitions, NumPartitions,
+                          NumThreads);
+
+  OwningPtr<Module> Result;
+  OwningPtr<Linker> L;
+  for (unsigned i = 0; i != NumPartitions; ++i) {
+    if (!Partitions[i].ErrMsg.empty()) {
+      ErrMsg = Partitions[i].ErrMsg;
+      return 0;
+    }
+    OwningPtr<MemoryBuffer> Buffer(
+      MemoryBuffer::getMemBuffer(Partitions[i].Result, "", false));
+    OwningPtr<Module> Part(ParseBitcodeFile(Buffer.get(), Context, &ErrMsg));
+    if (!Part)
+      return 0;
+    std::string().swap(Partitions[i].Result);
+    if (!Result) {
+      Result.reset(Part.take());
+      L.reset(new Linker(Result.get()));
+    } else if (L->linkInModule(Part.get(), &ErrMsg)) {
+      return 0;
+    }
+  }
+
+  Module::FunctionListType &Functions = Result->getFunctionList();
+  for (unsigned i = 0, e = FunctionOrder.size(); i != e; ++i)
+    if (Function *F = Result->getFunction(FunctionOrder[i]))
+      Functions.splice(Functions.end(), Functions, F);
+  Module::GlobalListType &Globals = Result->getGlobalList();
+  for (unsigned i = 0, e = GlobalOrder.size(); i != e; ++i)
+    if (GlobalVariable *GV = Result->getGlobalVariable(GlobalOrder[i], true))
+      Globals.splice(Globals.end(), Globals, GV);
+
+  restorePromotedSymbols(*Result, Promoted);
+  Result->setModuleIdentifier(ModuleID);
+  return Result.take();
+}
+
+namespace {
+/// StreamedFunctionPasses - Runs the requested function passes over each
+/// function body handed over by streamBitcodeFunctions.  The other bodies
+/// are not in memory while a function is processed, so every function it
+/// calls looks like a declaration, and passes that look at their callees
+/// (for example to check for a definition) can give different results than
+/// they would on the whole module.
+class StreamedFunctionPasses : public BitcodeFunctionConsumer {
+  raw_ostream *AnalysisOut;
+  OwningPtr<TargetMachine> TM;
+  OwningPtr<FunctionPassManager> FPM;
+
+public:
+  explicit StreamedFunctionPasses(raw_ostream *AnalysisOut)
+    : AnalysisOut(AnalysisOut) {}
+
+  virtual void beginModule(Module &M) {
+    if (!TargetTriple.empty())
+      M.setTargetTriple(Triple::normalize(TargetTriple));
+
+    FPM.reset(new FunctionPassManager(&M));
+    TM.reset(addFunctionPasses(*FPM, M, AnalysisOut));
+    if (!NoVerify)
+      FPM->add(createVerifierPass());
+    FPM->doInitialization();
+  }
+
+  virtual void processFunction(Function &F) {
+    FPM->run(F);
+  }
+
+  virtual void endModule(Module &M) {
+    FPM->doFinalization();
+  }
+};
+}
+
+/// runStreamedFunctionPasses - Run the requested function passes over the
+/// input module without ever holding more than one of its function bodies.
+/// The bitcode writer needs all of the bodies at once, so the module cannot be
+/// written back out, and only analyses are accepted.
+static int runStreamedFunctionPasses(const char *ProgName,
+                                     LLVMContext &Context) {
+  if (!isFunctionPassPipeline()) {
+    errs() << ProgName << ": -stream-functions requires a pipeline of "
+           << "function passes only\n";
+    return 1;
+  }
+  for (unsigned i = 0, e = PassList.size(); i != e; ++i) {
+    if (PassList[i]->isAnalysis())
+      continue;
+    errs() << ProgName << ": -stream-functions only runs analyses, and '-"
+           << PassList[i]->getPassArgument() << "' transforms the module\n";
+    return 1;
+  }
+  if (!NoOutput && !AnalyzeOnly) {
+    errs() << ProgName << ": -stream-functions can not write the module back "
+           << "out, use -disable-output or -analyze\n";
+    return 1;
+  }
+
+  OwningPtr<tool_output_file> Out;
+  if (AnalyzeOnly) {
+    if (OutputFilename.empty())
+      OutputFilename = "-";
+    std::string ErrorInfo;
+    Out.reset(new tool_output_file(OutputFilename.c_str(), ErrorInfo));
+    if (!ErrorInfo.empty()) {
+      errs() << ErrorInfo << '\n';
+      return 1;
+    }
+  }
+
+  std::string ErrMsg;
+  DataStreamer *Streamer = getDataFileStreamer(InputFilename, &ErrMsg);
+  if (!Streamer) {
+    errs() << ProgName << ": " << ErrMsg << '\n';
+    return 1;
+  }
+
+  cl::PrintOptionValues();
+
+  StreamedFunctionPasses Consumer(Out ? &Out->os() : 0);
+  OwningPtr<Module> M(streamBitcodeFunctions(InputFilename, Streamer, Context,
+                                             Consumer, &ErrMsg));
+  if (!M) {
+    errs() << ProgName << ": " << InputFilename << ": " << ErrMsg << '\n';
+    return 1;
+  }
+
+  if (Out)
+    Out->keep();
+  return 0;
+}
+
 //===----------------------------------------------------------------------===//
 // main for opt
 //
@@ -585,6 +901,9 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  if (StreamFunctions)
+    return runStreamedFunctionPasses(argv[0], Context);
+
   SMDiagnostic Err;
 
   // Load the input module...
@@ -600,6 +919,23 @@ int main(int argc, char **argv) {
   if (!TargetTriple.empty())
     M->setTargetTriple(Triple::normalize(TargetTriple));
 
+  if (FunctionPassThreads > 1) {
+    if (AnalyzeOnly || !isFunctionPassPipeline()) {
+      errs() << argv[0] << ": warning: -function-pass-threads requires a "
+             << "pipeline of function passes only, running serially\n";
+    } else {
+      std::string ErrorInfo;
+      M.reset(runFunctionPassesInParallel(M.take(), FunctionPassThreads,
+                                          ErrorInfo));
+      if (!M) {
+        errs() << argv[0] << ": " << ErrorInfo << '\n';
+        return 1;
+      }
+      // The requested passes have all been run already.
+      PassList.clear();
+    }
+  }
+
   // Figure out what stream we are supposed to write to...
   OwningPtr<tool_output_file> Out;
   if (NoOutput) {
@@ -0,0 +1,101 @@
+//===- llvm/unittest/ADT/StatisticTest.cpp - Statistic unit tests ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "unittest"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <cstring>
+using namespace llvm;
+
+#if !defined(NDEBUG) || defined(LLVM_ENABLE_STATS)
+
+STATISTIC(Counter, "Counts things");
+STATISTIC(Counter2, "Counts other \"things\"");
+
+namespace {
+
+const StatisticValue *findStatistic(const std::vector<StatisticValue> &Values,
+                                    const char *Desc) {
+  for (unsigned i = 0, e = Values.size(); i != e; ++i)
+    if (!std::strcmp(Values[i].Desc, Desc))
+      return &Values[i];
+  return 0;
+}
+
+void bumpCounter(void *, unsigned) {
+  for (unsigned i = 0; i != 1000; ++i)
+    ++Counter;
+}
+
+TEST(StatisticTest, Count) {
+  ResetStatistics();
+  Counter = 0;
+  EXPECT_EQ(0u, Counter);
+  Counter++;
+  Counter++;
+  EXPECT_EQ(2u, Counter);
+  EXPECT_EQ(2u, Counter--);
+  EXPECT_EQ(1u, Counter);
+  Counter += 10;
+  Counter *= 3;
+  EXPECT_EQ(33u, Counter);
+  Counter /= 11;
+  Counter -= 2;
+  EXPECT_EQ(1u, Counter);
+  Counter = 7;
+  EXPECT_EQ(7u, Counter);
+}
+
+TEST(StatisticTest, Threads) {
+  ResetStatistics();
+  Counter = 0;
+  llvm_start_multithreaded();
+  llvm_execute_on_threads(bumpCounter, 0, 20, 4);
+  llvm_stop_multithreaded();
+  EXPECT_EQ(20000u, Counter);
+}
+
+TEST(StatisticTest, Snapshot) {
+  Counter = 4;
+  ++Counter;
+  Counter2 = 3;
+
+  std::vector<StatisticValue> Values;
+  GetStatistics(Values);
+  const StatisticValue *V = findStatistic(Values, "Counts things");
+  ASSERT_TRUE(V != 0);
+  EXPECT_STREQ("unittest", V->Name);
+  EXPECT_EQ(5u, V->Value);
+
+  // Reading with a reset returns what was there and zeroes it afterwards.
+  GetStatistics(Values, /*Reset=*/true);
+  V = findStatistic(Values, "Counts other \"things\"");
+  ASSERT_TRUE(V != 0);
+  EXPECT_EQ(3u, V->Value);
+  EXPECT_EQ(0u, Counter);
+  EXPECT_EQ(0u, Counter2);
+
+  ++Counter2;
+  std::string JSON;
+  raw_string_ostream OS(JSON);
+  PrintStatisticsJSON(OS);
+  EXPECT_NE(std::string::npos,
+            OS.str().find("{\"name\": \"unittest\", "
+                          "\"desc\": \"Counts other \\\"things\\\"\", "
+                          "\"value\": 1}"));
+
+  ResetStatistics();
+  EXPECT_EQ(0u, Counter2);
+}
+
+} // end anonymous namespace
+
+#endif
@@ -9,6 +9,7 @@
 
 #include "gtest/gtest.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/DataTypes.h"
 using namespace llvm;
 
@@ -220,4 +221,47 @@ TEST_F(StringMapTest, InsertTest) {
   assertSingleItemMap();
 }
 
+// The hash must only depend on the bytes of the key, not on where they are.
+TEST_F(StringMapTest, HashTest) {
+  const char Buf[] = "xxhello, world!hello, world!";
+  for (unsigned Len = 0; Len != 14; ++Len) {
+    EXPECT_EQ(StringMapImpl::hash(StringRef(Buf + 2, Len)),
+              StringMapImpl::hash(StringRef(Buf + 15, Len)));
+    EXPECT_EQ(StringMapImpl::hash(StringRef(Buf + 2, Len)),
+              StringMapImpl::hash(std::string(Buf + 2, Len)));
+  }
+  EXPECT_NE(StringMapImpl::hash(StringRef("a\0", 1)),
+            StringMapImpl::hash(StringRef("a\0", 2)));
+  EXPECT_NE(StringMapImpl::hash("_ZN4llvm5ValueD0Ev"),
+            StringMapImpl::hash("_ZN4llvm5ValueD1Ev"));
+}
+
+// Insert, find and erase many keys that only differ in a few bytes, like the
+// symbol names of a large module.
+TEST_F(StringMapTest, ManyKeysTest) {
+  const unsigned NumKeys = 5000;
+  std::vector<std::string> Keys;
+  for (unsigned i = 0; i != NumKeys; ++i)
+    Keys.push_back("_ZN4llvm12_GLOBAL__N_14func" + std::string(i % 7, 'x') +
+                   utostr(i) + "Ev");
+
+  for (unsigned i = 0; i != NumKeys; ++i)
+    testMap[Keys[i]] = i;
+  EXPECT_EQ(NumKeys, testMap.size());
+
+  for (unsigned i = 0; i != NumKeys; i += 2)
+    testMap.erase(Keys[i]);
+  EXPECT_EQ(NumKeys / 2, testMap.size());
+
+  for (unsigned i = 0; i != NumKeys; ++i) {
+    StringMap<uint32_t>::iterator I = testMap.find(Keys[i]);
+    if (i % 2 == 0) {
+      EXPECT_TRUE(I == testMap.end());
+    } else {
+      ASSERT_TRUE(I != testMap.end());
+      EXPECT_EQ(i, I->second);
+    }
+  }
+}
+
 } // end anonymous namespace
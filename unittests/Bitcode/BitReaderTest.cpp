@@ -16,6 +16,8 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/PassManager.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/DataStream.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "gtest/gtest.h"
 
@@ -61,5 +63,136 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddr) { // PR11677
   passes.run(*m);
 }
 
+/// writeFunctionsToBuffer - Write a module with a declaration, and eight
+/// functions f0...f7 returning their number, the odd ones internal.
+static void writeFunctionsToBuffer(SmallVectorImpl<char> &Buffer) {
+  Module M("test-functions", getGlobalContext());
+  Type *I32 = Type::getInt32Ty(M.getContext());
+  FunctionType *FTy = FunctionType::get(I32, false);
+  Function::Create(FTy, GlobalValue::ExternalLinkage, "decl", &M);
+  for (unsigned i = 0; i != 8; ++i) {
+    Function *F = Function::Create(FTy, i % 2 ? GlobalValue::InternalLinkage
+                                              : GlobalValue::ExternalLinkage,
+                                   "f" + Twine(i), &M);
+    BasicBlock *BB = BasicBlock::Create(M.getContext(), "entry", F);
+    ReturnInst::Create(M.getContext(), ConstantInt::get(I32, i), BB);
+  }
+  raw_svector_ostream OS(Buffer);
+  WriteBitcodeToFile(&M, OS);
+}
+
+/// setFunctionIndex - Turn the writer's -enable-bc-function-index on or off.
+static void setFunctionIndex(bool Enable) {
+  StringMap<cl::Option*> Options;
+  cl::getRegisteredOptions(Options);
+  assert(Options.count("enable-bc-function-index") && "Option not found!");
+  static_cast<cl::opt<bool>*>(Options["enable-bc-function-index"])
+    ->setValue(Enable);
+}
+
+/// getReturnedValue - Return the constant returned by a function written by
+/// writeFunctionsToBuffer.
+static uint64_t getReturnedValue(Function &F) {
+  ReturnInst *Ret = cast<ReturnInst>(F.getEntryBlock().getTerminator());
+  return cast<ConstantInt>(Ret->getReturnValue())->getZExtValue();
+}
+
+// Lazily read functions are located through the function index; each one must
+// come back with its own body.
+TEST(BitReaderTest, MaterializeFromFunctionIndex) {
+  SmallString<1024> Mem;
+  setFunctionIndex(true);
+  writeFunctionsToBuffer(Mem);
+  setFunctionIndex(false);
+
+  MemoryBuffer *Buffer = MemoryBuffer::getMemBuffer(Mem.str(), "test", false);
+  std::string ErrMsg;
+  OwningPtr<Module> M(getLazyBitcodeModule(Buffer, getGlobalContext(),
+                                           &ErrMsg));
+  ASSERT_TRUE(M.get() != 0) << ErrMsg;
+  EXPECT_FALSE(M->getFunction("decl")->isMaterializable());
+
+  // Materialize in reverse order, so no body is found by reading on from the
+  // previous one.
+  for (unsigned i = 8; i-- != 0;) {
+    Function *F = M->getFunction(("f" + Twine(i)).str());
+    ASSERT_TRUE(F->isMaterializable());
+    ASSERT_FALSE(F->Materialize(&ErrMsg)) << ErrMsg;
+    EXPECT_EQ(i, getReturnedValue(*F));
+  }
+  EXPECT_FALSE(verifyModule(*M, ReturnStatusAction));
+}
+
+/// BufferStreamer - Streams the contents of a buffer.
+class BufferStreamer : public DataStreamer {
+  StringRef Data;
+public:
+  explicit BufferStreamer(StringRef Data) : Data(Data) {}
+  virtual size_t GetBytes(unsigned char *Buf, size_t Len) {
+    Len = std::min(Len, Data.size());
+    memcpy(Buf, Data.data(), Len);
+    Data = Data.drop_front(Len);
+    return Len;
+  }
+};
+
+/// BodyRecorder - Records the functions it is handed, and how many bodies are
+/// in memory at the time.
+class BodyRecorder : public BitcodeFunctionConsumer {
+public:
+  Module *M;
+  std::vector<uint64_t> Returned;
+  unsigned MaxBodies;
+  bool Ended;
+
+  BodyRecorder() : M(0), MaxBodies(0), Ended(false) {}
+
+  virtual void beginModule(Module &Mod) {
+    M = &Mod;
+  }
+
+  virtual void processFunction(Function &F) {
+    Returned.push_back(getReturnedValue(F));
+    unsigned NumBodies = 0;
+    for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+      NumBodies += !I->empty();
+    MaxBodies = std::max(MaxBodies, NumBodies);
+  }
+
+  virtual void endModule(Module &Mod) {
+    Ended = true;
+  }
+};
+
+TEST(BitReaderTest, StreamFunctions) {
+  SmallString<1024> Mem;
+  writeFunctionsToBuffer(Mem);
+
+  BodyRecorder Recorder;
+  std::string ErrMsg;
+  OwningPtr<Module> M(streamBitcodeFunctions("test", new BufferStreamer(Mem),
+                                             getGlobalContext(), Recorder,
+                                             &ErrMsg));
+  ASSERT_TRUE(M.get() != 0) << ErrMsg;
+  EXPECT_EQ(M.get(), Recorder.M);
+  EXPECT_TRUE(Recorder.Ended);
+  ASSERT_EQ(8U, Recorder.Returned.size());
+  for (unsigned i = 0; i != 8; ++i)
+    EXPECT_EQ(i, Recorder.Returned[i]);
+  EXPECT_EQ(1U, Recorder.MaxBodies);
+
+  // The bodies are gone, but can be read again.
+  for (unsigned i = 0; i != 8; ++i) {
+    Function *F = M->getFunction(("f" + Twine(i)).str());
+    EXPECT_TRUE(F->empty());
+    EXPECT_TRUE(F->isMaterializable());
+    EXPECT_EQ(i % 2 ? GlobalValue::InternalLinkage
+                    : GlobalValue::ExternalLinkage, F->getLinkage());
+  }
+  Function *F5 = M->getFunction("f5");
+  ASSERT_FALSE(F5->Materialize(&ErrMsg)) << ErrMsg;
+  EXPECT_EQ(5U, getReturnedValue(*F5));
+}
+
 }
 }
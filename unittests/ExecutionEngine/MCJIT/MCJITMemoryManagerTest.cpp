@@ -10,6 +10,11 @@
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ExecutionEngine/JIT.h"
+#include "llvm/ExecutionEngine/ObjectBuffer.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ExecutionEngine/ObjectImage.h"
+#include "llvm/ExecutionEngine/RuntimeDyld.h"
+#include "MCJITTestBase.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -168,5 +173,265 @@ TEST(MCJITMemoryManagerTest, ManyVariedAllocations) {
   }
 }
 
+// The memory manager only uses the objects it is told about as keys.
+static const ObjectImage *fakeObject(int &Key) {
+  return reinterpret_cast<const ObjectImage *>(&Key);
+}
+
+TEST(MCJITMemoryManagerTest, FreedMemoryIsReused) {
+  OwningPtr<SectionMemoryManager> MemMgr(new SectionMemoryManager());
+  int Key1, Key2;
+
+  uint8_t *code1 = MemMgr->allocateCodeSection(256, 0, 1);
+  uint8_t *rodata1 = MemMgr->allocateDataSection(256, 0, 2, true);
+  uint8_t *data1 = MemMgr->allocateDataSection(256, 0, 3, false);
+  MemMgr->notifyObjectLoaded(0, fakeObject(Key1));
+  std::string Error;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+
+  SectionMemoryManager::MemoryStats Stats = MemMgr->getMemoryStats();
+  EXPECT_EQ(768U, Stats.AllocatedBytes);
+  EXPECT_EQ(3U, Stats.NumSlabs);
+
+  // Once the object is gone, the next one gets the same memory, even though
+  // the code was made executable in between.
+  MemMgr->notifyFreeingObject(fakeObject(Key1));
+  EXPECT_EQ(0U, MemMgr->getMemoryStats().AllocatedBytes);
+
+  uint8_t *code2 = MemMgr->allocateCodeSection(256, 0, 4);
+  uint8_t *rodata2 = MemMgr->allocateDataSection(256, 0, 5, true);
+  uint8_t *data2 = MemMgr->allocateDataSection(256, 0, 6, false);
+  MemMgr->notifyObjectLoaded(0, fakeObject(Key2));
+  EXPECT_EQ(code1, code2);
+  EXPECT_EQ(rodata1, rodata2);
+  EXPECT_EQ(data1, data2);
+  for (unsigned i = 0; i < 256; ++i) {
+    code2[i] = 1;
+    rodata2[i] = 2;
+    data2[i] = 3;
+  }
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+  EXPECT_EQ(Stats.MappedBytes, MemMgr->getMemoryStats().MappedBytes);
+}
+
+TEST(MCJITMemoryManagerTest, OnlyNewPagesAreFinalized) {
+  OwningPtr<SectionMemoryManager> MemMgr(new SectionMemoryManager());
+  std::string Error;
+
+  // Sections allocated together have their permissions changed together.
+  for (unsigned i = 0; i < 16; ++i)
+    MemMgr->allocateCodeSection(64, 0, i);
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+  unsigned Changes = MemMgr->getMemoryStats().NumPermissionChanges;
+  EXPECT_EQ(1U, Changes);
+
+  // Nothing new, nothing to do.
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+  EXPECT_EQ(Changes, MemMgr->getMemoryStats().NumPermissionChanges);
+
+  // Code allocated later must not land on the executable page, so it can
+  // still be written.
+  uint8_t *Code = MemMgr->allocateCodeSection(64, 0, 16);
+  for (unsigned i = 0; i < 64; ++i)
+    Code[i] = 0xc3;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+  EXPECT_EQ(Changes + 1, MemMgr->getMemoryStats().NumPermissionChanges);
+}
+
+TEST(MCJITMemoryManagerTest, FreeSlabsAreReleased) {
+  OwningPtr<SectionMemoryManager> MemMgr(new SectionMemoryManager(4096));
+  int Keys[8];
+  std::string Error;
+
+  // Each object needs a large slab of its own.
+  for (unsigned i = 0; i < 8; ++i) {
+    MemMgr->allocateDataSection(3 * 4096, 0, i, false);
+    MemMgr->notifyObjectLoaded(0, fakeObject(Keys[i]));
+  }
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+  EXPECT_LE(8U, MemMgr->getMemoryStats().NumSlabs);
+
+  for (unsigned i = 0; i < 8; ++i)
+    MemMgr->notifyFreeingObject(fakeObject(Keys[i]));
+  SectionMemoryManager::MemoryStats Stats = MemMgr->getMemoryStats();
+  EXPECT_EQ(1U, Stats.NumSlabs);
+  EXPECT_EQ(Stats.MappedBytes, Stats.FreeBytes);
+  EXPECT_EQ(Stats.FreeBytes, Stats.LargestFreeBlock);
+}
+
+/// ObjectCapture - Keeps a copy of the object MCJIT compiles.
+class ObjectCapture : public ObjectCache {
+public:
+  virtual void notifyObjectCompiled(const Module *M, const MemoryBuffer *Obj) {
+    Object.reset(MemoryBuffer::getMemBufferCopy(Obj->getBuffer()));
+  }
+  OwningPtr<MemoryBuffer> Object;
+
+protected:
+  virtual const MemoryBuffer *getObject(const Module *M) { return 0; }
+};
+
+class MCJITMemoryManagerLoadTest : public testing::Test, public MCJITTestBase {
+protected:
+  /// createAddModule - Create a module with "int32_t add(int32_t a,
+  /// int32_t b)", which returns a + b + bias for a global bias of 0.
+  Module *createAddModule(Function *&Add) {
+    Module *M = createEmptyModule("<object>");
+    GlobalVariable *Bias = insertGlobalInt32(M, "bias", 0);
+    Add = startFunction<int32_t(int32_t, int32_t)>(M, "add");
+    Function::arg_iterator Args = Add->arg_begin();
+    Value *A = Args++;
+    Value *Sum = Builder.CreateAdd(A, Args);
+    endFunctionWithRet(Add, Builder.CreateAdd(Sum, Builder.CreateLoad(Bias)));
+    return M;
+  }
+
+  /// compileObject - Compile the module of createAddModule into Object.
+  void compileObject() {
+    Function *Add;
+    Module *M = createAddModule(Add);
+
+    ObjectCapture Capture;
+    createJIT(M);
+    TheJIT->setObjectCache(&Capture);
+    TheJIT->getPointerToFunction(Add);
+    TheJIT.reset();
+    Object.swap(Capture.Object);
+  }
+
+  /// loadAndUnload - Load Object NumObjects times, call add from each copy
+  /// and free the copy again.  Returns the number of failed calls.
+  unsigned loadAndUnload(SectionMemoryManager &MemMgr, unsigned NumObjects) {
+    unsigned Failures = 0;
+    for (unsigned i = 0; i != NumObjects; ++i) {
+      RuntimeDyld Dyld(&MemMgr);
+      OwningPtr<ObjectImage> Obj(Dyld.loadObject(new ObjectBuffer(
+          MemoryBuffer::getMemBuffer(Object->getBuffer(), "", false))));
+      if (!Obj) {
+        ++Failures;
+        continue;
+      }
+      MemMgr.notifyObjectLoaded(0, Obj.get());
+      Dyld.resolveRelocations();
+      Dyld.registerEHFrames();
+      MemMgr.finalizeMemory();
+
+      int32_t (*Add)(int32_t, int32_t) =
+        (int32_t(*)(int32_t, int32_t))(intptr_t)Dyld.getSymbolAddress("add");
+      if (!Add || Add(int32_t(i), 1) != int32_t(i) + 1)
+        ++Failures;
+      MemMgr.notifyFreeingObject(Obj.get());
+    }
+    return Failures;
+  }
+
+  OwningPtr<MemoryBuffer> Object;
+};
+
+TEST_F(MCJITMemoryManagerLoadTest, LoadAndUnloadObjects) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  compileObject();
+  ASSERT_TRUE(Object.get() != 0);
+
+  SectionMemoryManager MemMgr;
+  EXPECT_EQ(0U, loadAndUnload(MemMgr, 1000));
+
+  // Everything was freed, and no more than one slab per kind of memory is
+  // kept for the next object.
+  SectionMemoryManager::MemoryStats Stats = MemMgr.getMemoryStats();
+  EXPECT_EQ(0U, Stats.AllocatedBytes);
+  EXPECT_GE(3U, Stats.NumSlabs);
+}
+
+TEST_F(MCJITMemoryManagerLoadTest, UnloadObjectFromRuntimeDyld) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  compileObject();
+  ASSERT_TRUE(Object.get() != 0);
+
+  // A symbol defined by two objects refers to the one loaded last, and is
+  // gone once both are unloaded.
+  SectionMemoryManager MemMgr;
+  RuntimeDyld Dyld(&MemMgr);
+  OwningPtr<ObjectImage> Objs[2];
+  for (unsigned i = 0; i != 2; ++i) {
+    Objs[i].reset(Dyld.loadObject(new ObjectBuffer(
+        MemoryBuffer::getMemBuffer(Object->getBuffer(), "", false))));
+    ASSERT_TRUE(Objs[i].get() != 0);
+    MemMgr.notifyObjectLoaded(0, Objs[i].get());
+  }
+  Dyld.resolveRelocations();
+  void *Second = Dyld.getSymbolAddress("add");
+
+  Dyld.unloadObject(Objs[0].get());
+  MemMgr.notifyFreeingObject(Objs[0].get());
+  EXPECT_EQ(Second, Dyld.getSymbolAddress("add"));
+
+  Dyld.unloadObject(Objs[1].get());
+  MemMgr.notifyFreeingObject(Objs[1].get());
+  EXPECT_EQ((void*)0, Dyld.getSymbolAddress("add"));
+  EXPECT_EQ(0U, MemMgr.getMemoryStats().AllocatedBytes);
+}
+
+TEST_F(MCJITMemoryManagerLoadTest, UnloadModuleFromMCJIT) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  Function *Add;
+  Module *AddM = createAddModule(Add);
+  SectionMemoryManager *MemMgr = static_cast<SectionMemoryManager*>(MM);
+  createJIT(AddM);
+
+  // Every time the module is added again, it is compiled into the memory
+  // its previous object was unloaded from.
+  for (int32_t i = 0; i != 100; ++i) {
+    if (i != 0)
+      TheJIT->addModule(AddM);
+    int32_t (*AddPtr)(int32_t, int32_t) =
+      (int32_t(*)(int32_t, int32_t))TheJIT->getPointerToFunction(Add);
+    TheJIT->finalizeObject();
+    ASSERT_TRUE(AddPtr != 0);
+    EXPECT_EQ(i + 1, AddPtr(i, 1));
+    EXPECT_TRUE(TheJIT->unloadModule(AddM));
+    EXPECT_EQ(0U, MemMgr->getMemoryStats().AllocatedBytes);
+  }
+  EXPECT_GE(3U, MemMgr->getMemoryStats().NumSlabs);
+
+  EXPECT_FALSE(TheJIT->unloadModule(AddM));
+  delete AddM;
+}
+
+/// EHFrameCounter - Counts the EH frame sections registered and deregistered.
+class EHFrameCounter : public SectionMemoryManager {
+public:
+  EHFrameCounter() : NumRegistered(0), NumDeregistered(0) {}
+
+  virtual void registerEHFrames(StringRef SectionData) {
+    ++NumRegistered;
+    SectionMemoryManager::registerEHFrames(SectionData);
+  }
+  virtual void deregisterEHFrames(StringRef SectionData) {
+    ++NumDeregistered;
+    SectionMemoryManager::deregisterEHFrames(SectionData);
+  }
+
+  unsigned NumRegistered;
+  unsigned NumDeregistered;
+};
+
+TEST_F(MCJITMemoryManagerLoadTest, EHFramesAreDeregistered) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  compileObject();
+  ASSERT_TRUE(Object.get() != 0);
+
+  // The memory of a freed object is reused for the next one, so its EH frames
+  // must be gone from the unwinder by then.
+  EHFrameCounter MemMgr;
+  EXPECT_EQ(0U, loadAndUnload(MemMgr, 10));
+  EXPECT_EQ(10U, MemMgr.NumRegistered);
+  EXPECT_EQ(MemMgr.NumRegistered, MemMgr.NumDeregistered);
+}
+
 } // Namespace
 
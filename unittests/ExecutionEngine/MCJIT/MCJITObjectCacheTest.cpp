@@ -11,10 +11,12 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/ExecutionEngine/FileObjectCache.h"
 #include "llvm/ExecutionEngine/JIT.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Support/FileSystem.h"
 #include "MCJITTestBase.h"
 #include "gtest/gtest.h"
 
@@ -235,5 +237,88 @@ TEST_F(MCJITObjectCacheTest, VerifyNonLoadFromCache) {
   EXPECT_FALSE(Cache->wereDuplicatesInserted());
 }
 
+TEST_F(MCJITObjectCacheTest, VerifyFileObjectCache) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  SmallString<128> CacheDir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("mcjit-object-cache", CacheDir));
+
+  // Compile the module and store the object on disk.
+  OwningPtr<FileObjectCache> Cache(new FileObjectCache(CacheDir, "test"));
+  createJIT(M.take());
+  TheJIT->setObjectCache(Cache.get());
+  compileAndRun();
+  EXPECT_EQ(0U, Cache->getNumHits());
+  EXPECT_EQ(1U, Cache->getNumMisses());
+  TheJIT.reset();
+
+  // An identical module compiled by another cache using the same directory is
+  // loaded from disk.
+  MM = new SectionMemoryManager;
+  M.reset(createEmptyModule("<main>"));
+  Main = insertMainFunction(M.get(), OriginalRC);
+  Cache.reset(new FileObjectCache(CacheDir, "test"));
+  createJIT(M.take());
+  TheJIT->setObjectCache(Cache.get());
+  compileAndRun();
+  EXPECT_EQ(1U, Cache->getNumHits());
+  EXPECT_EQ(0U, Cache->getNumMisses());
+  TheJIT.reset();
+
+  // A module with different contents is not.
+  MM = new SectionMemoryManager;
+  M.reset(createEmptyModule("<main>"));
+  Main = insertMainFunction(M.get(), ReplacementRC);
+  createJIT(M.take());
+  TheJIT->setObjectCache(Cache.get());
+  compileAndRun(ReplacementRC);
+  EXPECT_EQ(1U, Cache->getNumHits());
+  EXPECT_EQ(1U, Cache->getNumMisses());
+  TheJIT.reset();
+
+  // Neither is the same module compiled for another target.
+  MM = new SectionMemoryManager;
+  M.reset(createEmptyModule("<main>"));
+  Main = insertMainFunction(M.get(), OriginalRC);
+  Cache.reset(new FileObjectCache(CacheDir, "other"));
+  createJIT(M.take());
+  TheJIT->setObjectCache(Cache.get());
+  compileAndRun();
+  EXPECT_EQ(0U, Cache->getNumHits());
+  EXPECT_EQ(1U, Cache->getNumMisses());
+  TheJIT.reset();
+
+  uint32_t NumRemoved;
+  sys::fs::remove_all(CacheDir.str(), NumRemoved);
+}
+
+TEST_F(MCJITObjectCacheTest, VerifyFileObjectCacheEviction) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  SmallString<128> CacheDir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("mcjit-object-cache", CacheDir));
+
+  // No object fits into a one byte budget, so nothing is kept.
+  OwningPtr<FileObjectCache> Cache(new FileObjectCache(CacheDir, "test", 1));
+  createJIT(M.take());
+  TheJIT->setObjectCache(Cache.get());
+  compileAndRun();
+  TheJIT.reset();
+
+  MM = new SectionMemoryManager;
+  M.reset(createEmptyModule("<main>"));
+  Main = insertMainFunction(M.get(), OriginalRC);
+  Cache.reset(new FileObjectCache(CacheDir, "test", 1));
+  createJIT(M.take());
+  TheJIT->setObjectCache(Cache.get());
+  compileAndRun();
+  EXPECT_EQ(0U, Cache->getNumHits());
+  EXPECT_EQ(1U, Cache->getNumMisses());
+  TheJIT.reset();
+
+  uint32_t NumRemoved;
+  sys::fs::remove_all(CacheDir.str(), NumRemoved);
+}
+
 } // Namespace
 
@@ -12,8 +12,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "MCJITTestBase.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Target/TargetOptions.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -203,8 +207,6 @@ TEST_F(MCJITTest, multiple_empty_modules) {
 }
 */
 
-// FIXME: MCJIT must support multiple modules
-/*
 TEST_F(MCJITTest, multiple_modules) {
   SKIP_UNSUPPORTED_PLATFORM;
 
@@ -214,25 +216,177 @@ TEST_F(MCJITTest, multiple_modules) {
   // caller function is defined in a different module
   M.reset(createEmptyModule("<caller module>"));
 
-  Function *CalleeRef = insertExternalReferenceToFunction(M.get(), Callee);
-  Function *Caller = insertSimpleCallFunction(M.get(), CalleeRef);
+  Function *CalleeRef = insertExternalReferenceToFunction(
+      M.get(), Callee->getName(), Callee->getFunctionType());
+  Function *Caller = insertSimpleCallFunction<int32_t(int32_t, int32_t)>(
+      M.get(), CalleeRef);
 
   TheJIT->addModule(M.take());
 
   // get a function pointer in a module that was not used in EE construction
   void *vPtr = TheJIT->getPointerToFunction(Caller);
   TheJIT->finalizeObject();
-  EXPECT_NE(0, vPtr)
+  EXPECT_TRUE(0 != vPtr)
     << "Unable to get pointer to caller function from JIT";
 
   int(*FuncPtr)(int, int) = (int(*)(int, int))(intptr_t)vPtr;
   EXPECT_EQ(0, FuncPtr(0, 0));
   EXPECT_EQ(30, FuncPtr(10, 20));
   EXPECT_EQ(-30, FuncPtr(-10, -20));
+}
 
-  // ensure caller is destroyed before callee (free use before def)
-  M.reset();
+/// Counts the objects MCJIT loads.
+class ObjectCounter : public JITEventListener {
+public:
+  ObjectCounter() : NumObjects(0) {}
+  virtual void NotifyObjectEmitted(const ObjectImage &Obj) { ++NumObjects; }
+  unsigned NumObjects;
+};
+
+TEST_F(MCJITTest, lazy_multiple_modules) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  // The caller module is compiled first and calls into a module that is only
+  // compiled when the call is made.
+  OwningPtr<Module> CalleeModule(createEmptyModule("<callee module>"));
+  Function *Callee = insertAddFunction(CalleeModule.get());
+  Function *CalleeRef = insertExternalReferenceToFunction(
+      M.get(), Callee->getName(), Callee->getFunctionType());
+  Function *Caller = insertSimpleCallFunction<int32_t(int32_t, int32_t)>(
+      M.get(), CalleeRef);
+
+  createJIT(M.take());
+  TheJIT->addModule(CalleeModule.take());
+  TheJIT->DisableLazyCompilation(false);
+  ObjectCounter Counter;
+  TheJIT->RegisterJITEventListener(&Counter);
+
+  void *vPtr = TheJIT->getPointerToFunction(Caller);
+  EXPECT_TRUE(0 != vPtr)
+    << "Unable to get pointer to caller function from JIT";
+
+  // The caller and the stub for the callee.
+  EXPECT_EQ(2U, Counter.NumObjects);
+
+  int(*FuncPtr)(int, int) = (int(*)(int, int))(intptr_t)vPtr;
+  EXPECT_EQ(30, FuncPtr(10, 20));
+  EXPECT_EQ(3U, Counter.NumObjects);
+  EXPECT_EQ(-30, FuncPtr(-10, -20));
+  EXPECT_EQ(3U, Counter.NumObjects);
+
+  TheJIT->UnregisterJITEventListener(&Counter);
+}
+
+TEST_F(MCJITTest, tiered_compilation) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  // inc() bumps an internal global, so the answers only stay right if the
+  // optimized code shares the global with the instrumented code.
+  GlobalVariable *GV = insertGlobalInt32(M.get(), "count", 0);
+  GV->setLinkage(GlobalValue::InternalLinkage);
+  Function *Inc = startFunction<int32_t(void)>(M.get(), "inc");
+  Value *Next = Builder.CreateAdd(Builder.CreateLoad(GV), Builder.getInt32(1));
+  Builder.CreateStore(Next, GV);
+  endFunctionWithRet(Inc, Next);
+  Function *Caller = insertSimpleCallFunction<int32_t(void)>(M.get(), Inc);
+
+  bool Multithreaded = llvm_start_multithreaded();
+  createJIT(M.take());
+  TheJIT->enableTieredCompilation(CodeGenOpt::Default, 3);
+  ObjectCounter Counter;
+  TheJIT->RegisterJITEventListener(&Counter);
+
+  void *vPtr = TheJIT->getPointerToFunction(Caller);
+  TheJIT->finalizeObject();
+  EXPECT_TRUE(0 != vPtr)
+    << "Unable to get pointer to caller function from JIT";
+  EXPECT_EQ(1U, Counter.NumObjects);
+
+  int32_t(*FuncPtr)(void) = (int32_t(*)(void))(intptr_t)vPtr;
+  for (int32_t i = 1; i <= 5; ++i)
+    EXPECT_EQ(i, FuncPtr());
+
+  // Both functions got hot and were recompiled.
+  TheJIT->waitForTieredCompilation();
+  EXPECT_LE(2U, Counter.NumObjects);
+  for (int32_t i = 6; i <= 10; ++i)
+    EXPECT_EQ(i, FuncPtr());
+
+  TheJIT->UnregisterJITEventListener(&Counter);
+  TheJIT.reset();
+  if (Multithreaded)
+    llvm_stop_multithreaded();
+}
+
+/// countLinearScanSpills - Return how many live ranges the linear scan
+/// register allocator spilled since the statistics were last read.
+static unsigned countLinearScanSpills() {
+  std::vector<StatisticValue> Stats;
+  GetStatistics(Stats, /*Reset=*/true);
+  unsigned Count = 0;
+  for (unsigned i = 0, e = Stats.size(); i != e; ++i) {
+    if (StringRef(Stats[i].Name) != "regalloc")
+      continue;
+    StringRef Desc = Stats[i].Desc;
+    if (Desc == "Number of live ranges spilled" ||
+        Desc == "Number of assigned live ranges spilled to make room")
+      Count += Stats[i].Value;
+  }
+  return Count;
+}
+
+TEST_F(MCJITTest, linear_scan_register_allocator) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  int32_t Values[20];
+  for (int32_t i = 0; i != 20; ++i)
+    Values[i] = i + 1;
+
+  // Select the allocator for one engine at a time, without touching the
+  // process-wide default.
+  countLinearScanSpills();
+  for (unsigned LinearScan = 0; LinearScan != 2; ++LinearScan) {
+    // All 20 loaded values are live when the sum starts, so some of them
+    // have to be spilled.
+    M.reset(createEmptyModule("<main>"));
+    Function *F = startFunction<int32_t(int32_t*)>(M.get(), "pressure");
+    Value *Ptr = F->arg_begin();
+    Value *Loaded[20];
+    for (unsigned i = 0; i != 20; ++i)
+      Loaded[i] = Builder.CreateLoad(Builder.CreateConstGEP1_32(Ptr, i), true);
+    Value *Sum = Loaded[19];
+    for (unsigned i = 19; i != 0; --i)
+      Sum = Builder.CreateAdd(Sum, Loaded[i - 1]);
+    endFunctionWithRet(F, Sum);
+
+    TargetOptions Options;
+    Options.EnableLinearScanRegAlloc = LinearScan;
+    std::string Error;
+    TheJIT.reset(EngineBuilder(M.take())
+                 .setEngineKind(EngineKind::JIT)
+                 .setUseMCJIT(true)
+                 .setMCJITMemoryManager(new SectionMemoryManager())
+                 .setErrorStr(&Error)
+                 .setOptLevel(CodeGenOpt::Less)
+                 .setTargetOptions(Options)
+                 .setMArch(MArch)
+                 .setMCPU(sys::getHostCPUName())
+                 .create());
+    ASSERT_TRUE(TheJIT.get() != 0) << Error;
+
+    void *vPtr = TheJIT->getPointerToFunction(F);
+    TheJIT->finalizeObject();
+    int32_t (*FuncPtr)(int32_t*) = (int32_t(*)(int32_t*))(intptr_t)vPtr;
+    EXPECT_EQ(210, FuncPtr(Values));
+
+#if !defined(NDEBUG) || defined(LLVM_ENABLE_STATS)
+    if (LinearScan)
+      EXPECT_LT(0U, countLinearScanSpills());
+    else
+      EXPECT_EQ(0U, countLinearScanSpills());
+#endif
+    TheJIT.reset();
+  }
 }
-*/
 
 }
@@ -0,0 +1,201 @@
+//===- llvm/unittest/IR/ContentHashTest.cpp - Content hash tests ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/ContentHash.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Assembly/Parser.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+using namespace llvm;
+
+namespace {
+
+Module *parse(const char *Str, LLVMContext &C) {
+  SMDiagnostic Err;
+  Module *M = ParseAssemblyString(Str, 0, Err, C);
+  EXPECT_TRUE(M != 0);
+  return M;
+}
+
+TEST(ContentHashTest, IgnoresNamesAndLayout) {
+  // Separate contexts, so that both modules get to name their type %list.
+  LLVMContext C1, C2;
+  OwningPtr<Module> M1(parse(
+    "%list = type { i32, %list* }\n"
+    "@g = global i32 0\n"
+    "@0 = private constant [3 x i8] c\"ab\\00\"\n"
+    "define i32 @f(%list* %l, i32 %n) {\n"
+    "entry:\n"
+    "  %p = getelementptr inbounds %list* %l, i32 0, i32 0\n"
+    "  %v = load i32* %p, align 4, !tbaa !0\n"
+    "  br label %loop\n"
+    "loop:\n"
+    "  %i = phi i32 [ %v, %entry ], [ %next, %loop ]\n"
+    "  %next = add nsw i32 %i, %n\n"
+    "  %c = icmp slt i32 %next, 100\n"
+    "  br i1 %c, label %loop, label %exit\n"
+    "exit:\n"
+    "  store i32 %next, i32* @g\n"
+    "  %q = load i8* getelementptr ([3 x i8]* @0, i32 0, i32 1)\n"
+    "  ret i32 %next\n"
+    "}\n"
+    "define void @h() {\n"
+    "  ret void\n"
+    "}\n"
+    "!0 = metadata !{metadata !\"int\", metadata !0}\n", C1));
+
+  // The same function, with different local names, in a different order, and
+  // next to different things.
+  OwningPtr<Module> M2(parse(
+    "%list = type { i32, %list* }\n"
+    "@g = global i32 0\n"
+    "@0 = private constant [2 x i8] c\"x\\00\"\n"
+    "@1 = private constant [3 x i8] c\"ab\\00\"\n"
+    "define void @h() {\n"
+    "  ret void\n"
+    "}\n"
+    "define void @other() {\n"
+    "  %x = load i8* getelementptr ([2 x i8]* @0, i32 0, i32 1)\n"
+    "  ret void\n"
+    "}\n"
+    "define i32 @f(%list* %a, i32 %b) {\n"
+    "  %1 = getelementptr inbounds %list* %a, i32 0, i32 0\n"
+    "  %2 = load i32* %1, align 4, !tbaa !1\n"
+    "  br label %3\n"
+    "  %4 = phi i32 [ %2, %0 ], [ %5, %3 ]\n"
+    "  %5 = add nsw i32 %4, %b\n"
+    "  %6 = icmp slt i32 %5, 100\n"
+    "  br i1 %6, label %3, label %7\n"
+    "  store i32 %5, i32* @g\n"
+    "  %8 = load i8* getelementptr ([3 x i8]* @1, i32 0, i32 1)\n"
+    "  ret i32 %5\n"
+    "}\n"
+    "!0 = metadata !{}\n"
+    "!1 = metadata !{metadata !\"int\", metadata !1}\n", C2));
+
+  ContentHash F1 = hashFunctionContent(*M1->getFunction("f"));
+  EXPECT_FALSE(F1.isZero());
+  EXPECT_EQ(32U, F1.str().size());
+  EXPECT_TRUE(F1 == hashFunctionContent(*M2->getFunction("f")));
+  EXPECT_TRUE(hashFunctionContent(*M1->getFunction("h")) ==
+              hashFunctionContent(*M2->getFunction("h")));
+  EXPECT_TRUE(F1 != hashFunctionContent(*M1->getFunction("h")));
+
+  // The module hashes differ, but agree with the function hashes.
+  DenseMap<const Function*, ContentHash> FunctionHashes;
+  ContentHash MH1 = hashModuleContent(*M1, &FunctionHashes);
+  EXPECT_TRUE(MH1 != hashModuleContent(*M2));
+  EXPECT_TRUE(MH1 == hashModuleContent(*M1));
+  EXPECT_EQ(2U, FunctionHashes.size());
+  EXPECT_TRUE(F1 == FunctionHashes[M1->getFunction("f")]);
+
+  ContentHash Copy = ContentHash::fromWords(F1.getWord(0), F1.getWord(1),
+                                            F1.getWord(2), F1.getWord(3));
+  EXPECT_TRUE(F1 == Copy);
+}
+
+TEST(ContentHashTest, SeesChanges) {
+  LLVMContext C;
+  const char *Variants[] = {
+    "define i32 @f(i32 %a) {\n  %r = add i32 %a, 1\n  ret i32 %r\n}\n",
+    "define i32 @f(i32 %a) {\n  %r = add nsw i32 %a, 1\n  ret i32 %r\n}\n",
+    "define i32 @f(i32 %a) {\n  %r = add i32 %a, 2\n  ret i32 %r\n}\n",
+    "define i32 @f(i32 %a) {\n  %r = sub i32 %a, 1\n  ret i32 %r\n}\n",
+    "define i32 @f(i32 %a) {\n  %r = add i32 1, %a\n  ret i32 %r\n}\n",
+    "define i32 @f(i32 %a) nounwind {\n  %r = add i32 %a, 1\n  ret i32 %r\n}\n",
+    "define internal i32 @f(i32 %a) {\n  %r = add i32 %a, 1\n  ret i32 %r\n}\n",
+    "define i32 @g(i32 %a) {\n  %r = add i32 %a, 1\n  ret i32 %r\n}\n",
+    "define i64 @f(i64 %a) {\n  %r = add i64 %a, 1\n  ret i64 %r\n}\n"
+  };
+  const unsigned NumVariants = sizeof(Variants) / sizeof(Variants[0]);
+
+  std::vector<ContentHash> Hashes;
+  for (unsigned i = 0; i != NumVariants; ++i) {
+    OwningPtr<Module> M(parse(Variants[i], C));
+    Hashes.push_back(hashFunctionContent(*M->begin()));
+  }
+  for (unsigned i = 0; i != NumVariants; ++i)
+    for (unsigned j = i + 1; j != NumVariants; ++j)
+      EXPECT_TRUE(Hashes[i] != Hashes[j]) << "variants " << i << ", " << j;
+}
+
+TEST(ContentHashTest, SeesReferencedGlobals) {
+  // The caller does not change, but what it refers to does.
+  LLVMContext C;
+  const char *Variants[] = {
+    "define i32 @callee() {\n  ret i32 0\n}\n",
+    "declare i32 @callee()\n",
+    "@v = global i32 0\n",
+    "@v = global i32 0, align 8\n",
+    "@v = global i32 0, section \"foo\"\n",
+    "@v = unnamed_addr global i32 0\n",
+    "@v = external global i32\n"
+  };
+  const unsigned NumVariants = sizeof(Variants) / sizeof(Variants[0]);
+
+  std::vector<ContentHash> Hashes;
+  for (unsigned i = 0; i != NumVariants; ++i) {
+    std::string Source = Variants[i];
+    if (i < 2)
+      Source += "define i32 @f() {\n"
+                "  %r = call i32 @callee()\n"
+                "  ret i32 %r\n"
+                "}\n";
+    else
+      Source += "define i32 @f() {\n"
+                "  %r = load i32* @v\n"
+                "  ret i32 %r\n"
+                "}\n";
+    OwningPtr<Module> M(parse(Source.c_str(), C));
+    Hashes.push_back(hashFunctionContent(*M->getFunction("f")));
+  }
+  for (unsigned i = 0; i != NumVariants; ++i)
+    for (unsigned j = i + 1; j != NumVariants; ++j)
+      EXPECT_TRUE(Hashes[i] != Hashes[j]) << "variants " << i << ", " << j;
+}
+
+static ContentHash hashStringUser(const char *Global, LLVMContext &C) {
+  std::string Source = Global;
+  Source += "define i8 @f() {\n"
+            "  %c = load i8* getelementptr ([4 x i8]* @s, i32 0, i32 1)\n"
+            "  ret i8 %c\n"
+            "}\n";
+  OwningPtr<Module> M(parse(Source.c_str(), C));
+  return hashFunctionContent(*M->getFunction("f"));
+}
+
+TEST(ContentHashTest, SeesConstantInitializers) {
+  // Only the initializer of the referenced global changes.  The load folds
+  // when it is a constant that cannot be replaced at link time.
+  LLVMContext C;
+  EXPECT_TRUE(hashStringUser("@s = constant [4 x i8] c\"abc\\00\"\n", C) !=
+              hashStringUser("@s = constant [4 x i8] c\"axc\\00\"\n", C));
+
+  // Otherwise the code reads memory, and does not depend on the initializer.
+  EXPECT_TRUE(hashStringUser("@s = global [4 x i8] c\"abc\\00\"\n", C) ==
+              hashStringUser("@s = global [4 x i8] c\"axc\\00\"\n", C));
+  EXPECT_TRUE(
+    hashStringUser("@s = weak constant [4 x i8] c\"abc\\00\"\n", C) ==
+    hashStringUser("@s = weak constant [4 x i8] c\"axc\\00\"\n", C));
+
+  // A constant that refers to itself is hashed once.
+  const char *SelfReference =
+    "@p = constant i8* bitcast (i8** @p to i8*)\n"
+    "define i8* @f() {\n"
+    "  %p = load i8** @p\n"
+    "  ret i8* %p\n"
+    "}\n";
+  OwningPtr<Module> M(parse(SelfReference, C));
+  EXPECT_FALSE(hashFunctionContent(*M->getFunction("f")).isZero());
+}
+
+} // end anonymous namespace
@@ -0,0 +1,155 @@
+//===- llvm/unittest/IR/MultithreadedContextTest.cpp - Threading stress ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Builds and optimizes independent modules on several threads at once, each
+// thread owning its own LLVMContext, and checks that the results match a
+// serial run.  Nothing here is timed; tools/llvm-context-bench measures how
+// the same work scales with the number of threads.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/Dominators.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/Verifier.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/PassManager.h"
+#include "llvm/Support/Threading.h"
+#include "gtest/gtest.h"
+#include <iterator>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+const unsigned NumTasks = 8;
+const unsigned NumModulesPerTask = 16;
+const unsigned NumFunctionsPerModule = 64;
+
+/// TaskResult - What one task observed while building its modules.
+struct TaskResult {
+  unsigned NumFunctions;
+  unsigned NumLoops;
+  bool Broken;
+  TaskResult() : NumFunctions(0), NumLoops(0), Broken(false) {}
+};
+
+/// CountLoops - A function pass that records how many top level loops
+/// LoopInfo found.
+struct CountLoops : public FunctionPass {
+  static char ID;
+  unsigned &NumLoops;
+  CountLoops(unsigned &N) : FunctionPass(ID), NumLoops(N) {}
+
+  virtual bool runOnFunction(Function &F) {
+    LoopInfo &LI = getAnalysis<LoopInfo>();
+    NumLoops += std::distance(LI.begin(), LI.end());
+    return false;
+  }
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<LoopInfo>();
+    AU.setPreservesAll();
+  }
+};
+char CountLoops::ID = 0;
+
+/// buildFunction - Build "i32 f(i32 n) { s = 0; for (i = 0; i < n; ++i)
+/// s += i * Seed; return s; }".
+void buildFunction(Module &M, unsigned Seed) {
+  LLVMContext &Context = M.getContext();
+  Type *I32 = Type::getInt32Ty(Context);
+  Type *Params[] = { I32 };
+  Function *F = Function::Create(FunctionType::get(I32, Params, false),
+                                 GlobalValue::ExternalLinkage, "f", &M);
+  BasicBlock *Entry = BasicBlock::Create(Context, "entry", F);
+  BasicBlock *Loop = BasicBlock::Create(Context, "loop", F);
+  BasicBlock *Exit = BasicBlock::Create(Context, "exit", F);
+  Value *N = F->arg_begin();
+
+  IRBuilder<> Builder(Entry);
+  Builder.CreateBr(Loop);
+
+  Builder.SetInsertPoint(Loop);
+  PHINode *I = Builder.CreatePHI(I32, 2, "i");
+  PHINode *S = Builder.CreatePHI(I32, 2, "s");
+  Value *Mul = Builder.CreateMul(I, Builder.getInt32(Seed));
+  Value *Sum = Builder.CreateAdd(S, Mul, "sum");
+  Value *Next = Builder.CreateAdd(I, Builder.getInt32(1), "next");
+  Builder.CreateCondBr(Builder.CreateICmpSLT(Next, N), Loop, Exit);
+  I->addIncoming(Builder.getInt32(0), Entry);
+  I->addIncoming(Next, Loop);
+  S->addIncoming(Builder.getInt32(0), Entry);
+  S->addIncoming(Sum, Loop);
+
+  Builder.SetInsertPoint(Exit);
+  Builder.CreateRet(Sum);
+}
+
+/// runTask - Build NumModulesPerTask modules in a context private to this
+/// task and run a FunctionPassManager over every function.
+void runTask(void *UserData, unsigned Task) {
+  TaskResult &R = (*static_cast<std::vector<TaskResult>*>(UserData))[Task];
+  LLVMContext Context;
+  for (unsigned m = 0; m != NumModulesPerTask; ++m) {
+    Module M("stress", Context);
+    for (unsigned f = 0; f != NumFunctionsPerModule; ++f)
+      buildFunction(M, Task * NumModulesPerTask + m + f);
+
+    FunctionPassManager FPM(&M);
+    FPM.add(new DominatorTree());
+    FPM.add(new CountLoops(R.NumLoops));
+    FPM.add(createVerifierPass(ReturnStatusAction));
+    FPM.doInitialization();
+    for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+      FPM.run(*F);
+      ++R.NumFunctions;
+    }
+    FPM.doFinalization();
+
+    R.Broken |= verifyModule(M, ReturnStatusAction);
+  }
+}
+
+/// runTasks - Run all tasks on up to NumThreads threads.
+void runTasks(std::vector<TaskResult> &Results, unsigned NumThreads) {
+  Results.assign(NumTasks, TaskResult());
+  llvm_execute_on_threads(runTask, &Results, NumTasks, NumThreads);
+}
+
+TEST(MultithreadedContext, BuildAndOptimize) {
+  // Every pass used must be registered before any thread looks it up.
+  PassRegistry &Registry = *PassRegistry::getPassRegistry();
+  initializeDominatorTreePass(Registry);
+  initializeLoopInfoPass(Registry);
+  initializeVerifierPass(Registry);
+
+  std::vector<TaskResult> Serial;
+  runTasks(Serial, 1);
+
+  bool Multithreaded = llvm_start_multithreaded();
+  std::vector<TaskResult> Parallel;
+  runTasks(Parallel, Multithreaded ? NumTasks : 1);
+  if (Multithreaded)
+    llvm_stop_multithreaded();
+
+  for (unsigned i = 0; i != NumTasks; ++i) {
+    EXPECT_FALSE(Serial[i].Broken);
+    EXPECT_FALSE(Parallel[i].Broken);
+    EXPECT_EQ(NumModulesPerTask * NumFunctionsPerModule,
+              Parallel[i].NumFunctions);
+    EXPECT_EQ(Serial[i].NumFunctions, Parallel[i].NumFunctions);
+    EXPECT_EQ(Serial[i].NumLoops, Parallel[i].NumLoops);
+  }
+}
+
+} // end anonymous namespace
@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Assembly/Parser.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -43,4 +44,72 @@ TEST(ValueTest, UsedInBasicBlock) {
   EXPECT_TRUE(F->arg_begin()->isUsedInBasicBlock(F->begin()));
 }
 
+/// UseOrder - Order Uses by the position their users were given.
+struct UseOrder {
+  const DenseMap<const User*, unsigned> &Positions;
+  explicit UseOrder(const DenseMap<const User*, unsigned> &P) : Positions(P) {}
+  bool operator()(const Use &L, const Use &R) const {
+    return Positions.lookup(L.getUser()) < Positions.lookup(R.getUser());
+  }
+};
+
+TEST(ValueTest, SortUseList) {
+  LLVMContext C;
+
+  const char *ModuleString = "define void @f(i32 %x) {\n"
+                             "bb0:\n"
+                             "  %x1 = add i32 %x, 1\n"
+                             "  %x2 = add i32 %x, 2\n"
+                             "  %x3 = add i32 %x, 3\n"
+                             "  %x4 = add i32 %x, 4\n"
+                             "  %x5 = add i32 %x, 5\n"
+                             "  %x6 = add i32 %x, 6\n"
+                             "  %x7 = add i32 %x, 7\n"
+                             "  ret void\n"
+                             "}\n";
+  SMDiagnostic Err;
+  Module *M = ParseAssemblyString(ModuleString, NULL, Err, C);
+
+  Function *F = M->getFunction("f");
+  Argument *X = F->arg_begin();
+  DenseMap<const User*, unsigned> Positions;
+  unsigned N = 0;
+  for (BasicBlock::iterator I = F->begin()->begin(), E = F->begin()->end();
+       I != E; ++I)
+    Positions[I] = N++;
+
+  // Put the users in program order.
+  X->sortUseList(UseOrder(Positions));
+  N = 0;
+  for (Value::use_iterator UI = X->use_begin(), UE = X->use_end(); UI != UE;
+       ++UI)
+    EXPECT_EQ(N++, Positions.lookup(*UI));
+  EXPECT_EQ(7U, N);
+
+  // Then in reverse, with users tied in pairs.  The sort is stable, so tied
+  // users stay in program order.
+  for (BasicBlock::iterator I = F->begin()->begin(), E = F->begin()->end();
+       I != E; ++I)
+    Positions[I] = 100 - (Positions[I] | 1);
+  X->sortUseList(UseOrder(Positions));
+  const char *Expected[] = { "x7", "x5", "x6", "x3", "x4", "x1", "x2" };
+  N = 0;
+  for (Value::use_iterator UI = X->use_begin(), UE = X->use_end(); UI != UE;
+       ++UI)
+    EXPECT_EQ(Expected[N++], UI->getName());
+  EXPECT_EQ(7U, N);
+
+  // The Prev pointers must be right for uses to be removed.
+  F->begin()->begin()->eraseFromParent();
+  (--F->begin()->end())->getPrevNode()->eraseFromParent();
+  const char *Remaining[] = { "x5", "x6", "x3", "x4", "x2" };
+  N = 0;
+  for (Value::use_iterator UI = X->use_begin(), UE = X->use_end(); UI != UE;
+       ++UI)
+    EXPECT_EQ(Remaining[N++], UI->getName());
+  EXPECT_EQ(5U, N);
+
+  delete M;
+}
+
 } // end anonymous namespace
@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Threading.h"
 #include "gtest/gtest.h"
 #include <cstdlib>
 
@@ -147,4 +148,139 @@ TEST(AllocatorTest, TestBigAlignment) {
   EXPECT_LE(Ptr + 3000, ((uintptr_t)Slab) + Slab->Size);
 }
 
+// Slabs are left with unused space when an allocation does not fit.
+TEST(AllocatorTest, TestBytesLeftInSlabs) {
+  BumpPtrAllocator Alloc(4096, 4096);
+  Alloc.Allocate(3000, 1);
+  EXPECT_EQ(0U, Alloc.getBytesLeftInSlabs());
+  Alloc.Allocate(3000, 1);
+  EXPECT_EQ(4096U - sizeof(MemSlab) - 3000, Alloc.getBytesLeftInSlabs());
+  EXPECT_EQ(6000U, Alloc.getBytesAllocated());
+  Alloc.Reset();
+  EXPECT_EQ(0U, Alloc.getBytesLeftInSlabs());
+}
+
+// Slab allocator that counts the slabs it hands out and takes back.
+class CountingSlabAllocator : public SlabAllocator {
+  MallocSlabAllocator Allocator;
+
+public:
+  unsigned NumAllocated, NumDeallocated;
+
+  CountingSlabAllocator() : NumAllocated(0), NumDeallocated(0) { }
+  virtual ~CountingSlabAllocator() { }
+
+  virtual MemSlab *Allocate(size_t Size) {
+    ++NumAllocated;
+    return Allocator.Allocate(Size);
+  }
+
+  virtual void Deallocate(MemSlab *Slab) {
+    ++NumDeallocated;
+    Allocator.Deallocate(Slab);
+  }
+};
+
+// Short-lived allocators sharing a caching slab allocator reuse its slabs.
+TEST(AllocatorTest, TestCachingSlabAllocator) {
+  CountingSlabAllocator Counter;
+  {
+    CachingSlabAllocator Cache(Counter, 16384, 0);
+    for (unsigned i = 0; i != 10; ++i) {
+      BumpPtrAllocator Alloc(4096, 4096, Cache);
+      Alloc.Allocate(3000, 0);
+      Alloc.Allocate(3000, 0);
+    }
+    EXPECT_EQ(2U, Counter.NumAllocated);
+    EXPECT_EQ(0U, Counter.NumDeallocated);
+    EXPECT_EQ(8192U, Cache.getCachedBytes());
+
+    // Slabs of other sizes, and slabs beyond the size of the cache, go back
+    // to the underlying allocator.
+    {
+      BumpPtrAllocator Alloc(4096, 4096, Cache);
+      Alloc.Allocate(10000, 0);
+      for (unsigned i = 0; i != 6; ++i)
+        Alloc.Allocate(3000, 0);
+    }
+    EXPECT_EQ(7U, Counter.NumAllocated);
+    EXPECT_EQ(3U, Counter.NumDeallocated);
+    EXPECT_EQ(16384U, Cache.getCachedBytes());
+  }
+  EXPECT_EQ(7U, Counter.NumDeallocated);
+}
+
+static void useCachingSlabAllocator(void *Arg) {
+  CachingSlabAllocator &Cache = *static_cast<CachingSlabAllocator*>(Arg);
+  BumpPtrAllocator Alloc(4096, 4096, Cache);
+  Alloc.Allocate(3000, 0);
+  Alloc.Allocate(3000, 0);
+}
+
+// The slabs cached by a thread go to the shared pool when the thread exits.
+TEST(AllocatorTest, TestCachingSlabAllocatorThreadExit) {
+  if (!sys::ThreadLocalImpl::hasThreadExitDestructors())
+    return;
+
+  CountingSlabAllocator Counter;
+  CachingSlabAllocator Cache(Counter, 16384, 4096);
+  llvm_execute_on_thread(useCachingSlabAllocator, &Cache);
+
+  // The shared pool only has room for one of the two slabs.
+  EXPECT_EQ(2U, Counter.NumAllocated);
+  EXPECT_EQ(1U, Counter.NumDeallocated);
+  EXPECT_EQ(4096U, Cache.getCachedBytes());
+
+  // Other threads reuse it.
+  {
+    BumpPtrAllocator Alloc(4096, 4096, Cache);
+    Alloc.Allocate(3000, 0);
+  }
+  EXPECT_EQ(2U, Counter.NumAllocated);
+}
+
+TEST(AllocatorTest, TestMappedSlabAllocator) {
+  MappedSlabAllocator SlabAlloc;
+  BumpPtrAllocator Alloc(4 << 20, 4096, SlabAlloc);
+  char *Ptr = static_cast<char*>(Alloc.Allocate(1 << 20, 4096));
+  Ptr[0] = 1;
+  Ptr[(1 << 20) - 1] = 2;
+  EXPECT_EQ(0U, (uintptr_t)Ptr % 4096);
+  EXPECT_EQ(1U, Alloc.GetNumSlabs());
+  EXPECT_LE(size_t(4 << 20), Alloc.getTotalMemory());
+}
+
+struct ConcurrentAllocation {
+  ConcurrentBumpPtrAllocator *Alloc;
+  int *Results[8][100];
+};
+
+void allocateConcurrently(void *UserData, unsigned Task) {
+  ConcurrentAllocation &A = *static_cast<ConcurrentAllocation*>(UserData);
+  for (unsigned i = 0; i != 100; ++i) {
+    int *Ptr = A.Alloc->Allocate<int>(10);
+    std::fill(Ptr, Ptr + 10, int(Task * 100 + i));
+    A.Results[Task][i] = Ptr;
+  }
+}
+
+TEST(AllocatorTest, TestConcurrentAllocator) {
+  ConcurrentBumpPtrAllocator Alloc;
+  ConcurrentAllocation A;
+  A.Alloc = &Alloc;
+  llvm_execute_on_threads(allocateConcurrently, &A, 8, 4);
+
+  // No allocation was handed out twice.
+  for (unsigned Task = 0; Task != 8; ++Task)
+    for (unsigned i = 0; i != 100; ++i)
+      for (unsigned j = 0; j != 10; ++j)
+        EXPECT_EQ(int(Task * 100 + i), A.Results[Task][i][j]);
+  EXPECT_LE(size_t(8 * 100 * 10 * sizeof(int)), Alloc.getTotalMemory());
+
+  Alloc.Reset();
+  int *Ptr = Alloc.Allocate<int>();
+  *Ptr = 1;
+  EXPECT_EQ(1, *Ptr);
+}
+
 }  // anonymous namespace
@@ -391,6 +391,28 @@ TEST_F(FileSystemTest, Permissions) {
 }
 #endif
 
+TEST_F(FileSystemTest, SetModificationTimeByPath) {
+  // Create a temp file.
+  int FileDescriptor;
+  SmallString<64> TempPath;
+  ASSERT_NO_ERROR(
+    fs::unique_file("%%-%%-%%-%%.temp", FileDescriptor, TempPath));
+
+  sys::TimeValue Time;
+  Time.fromEpochTime(1000000000);
+  ASSERT_NO_ERROR(fs::setLastModificationAndAccessTime(Twine(TempPath), Time));
+
+  fs::file_status Status;
+  ASSERT_NO_ERROR(fs::status(Twine(TempPath), Status));
+  EXPECT_EQ(Time.toPosixTime(),
+            Status.getLastModificationTime().toPosixTime());
+
+  ::close(FileDescriptor);
+  ASSERT_NO_ERROR(fs::remove(Twine(TempPath)));
+  EXPECT_EQ(fs::setLastModificationAndAccessTime(Twine(TempPath), Time),
+            errc::no_such_file_or_directory);
+}
+
 TEST_F(FileSystemTest, FileMapping) {
   // Create a temp file.
   int FileDescriptor;
@@ -0,0 +1,54 @@
+//===- llvm/unittest/Support/ThreadingTest.cpp - Threading tests ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Threading.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+void MarkTask(void *UserData, unsigned Task) {
+  ++(*reinterpret_cast<std::vector<unsigned>*>(UserData))[Task];
+}
+
+TEST(Threading, ExecuteOnThreadsRunsEveryTaskOnce) {
+  std::vector<unsigned> Counts(100, 0);
+  llvm_execute_on_threads(MarkTask, &Counts, Counts.size(), 4);
+  for (unsigned i = 0, e = Counts.size(); i != e; ++i)
+    EXPECT_EQ(1U, Counts[i]);
+}
+
+TEST(Threading, ExecuteOnThreadsMoreThreadsThanTasks) {
+  std::vector<unsigned> Counts(3, 0);
+  llvm_execute_on_threads(MarkTask, &Counts, Counts.size(), 16);
+  for (unsigned i = 0, e = Counts.size(); i != e; ++i)
+    EXPECT_EQ(1U, Counts[i]);
+}
+
+TEST(Threading, ExecuteOnThreadsNoTasks) {
+  std::vector<unsigned> Counts;
+  llvm_execute_on_threads(MarkTask, &Counts, 0, 4);
+  EXPECT_TRUE(Counts.empty());
+}
+
+void MarkFlag(void *UserData) {
+  *reinterpret_cast<bool*>(UserData) = true;
+}
+
+TEST(Threading, StartAndJoinThread) {
+  bool Ran = false;
+  llvm_thread *Thread = llvm_start_thread(MarkFlag, &Ran);
+  ASSERT_TRUE(Thread != 0);
+  llvm_join_thread(Thread);
+  EXPECT_TRUE(Ran);
+}
+
+} // end anonymous namespace
@@ -9,9 +9,14 @@
 
 #include "gtest/gtest.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/raw_ostream.h"
 
+#ifdef LLVM_ON_UNIX
+#include <fcntl.h>
+#endif
+
 using namespace llvm;
 
 namespace {
@@ -143,4 +148,51 @@ TEST(raw_ostreamTest, WriteEscaped) {
   EXPECT_EQ("\\001\\010\\200", Str);
 }
 
+TEST(raw_ostreamTest, WriteJSONString) {
+  std::string Str;
+
+  raw_string_ostream(Str).write_json_string("hi");
+  EXPECT_EQ("\"hi\"", Str);
+
+  Str = "";
+  raw_string_ostream(Str).write_json_string("\\\t\n\"\1\200");
+  EXPECT_EQ("\"\\\\\\u0009\\u000A\\\"\\u0001\200\"", Str);
+}
+
+#ifdef LLVM_ON_UNIX
+TEST(raw_ostreamTest, SupportsSeeking) {
+  int FD;
+  SmallString<64> Path;
+  ASSERT_FALSE(sys::fs::unique_file("raw_ostream-test-%%%%%%", FD, Path));
+  {
+    raw_fd_ostream OS(FD, true);
+    EXPECT_TRUE(OS.supportsSeeking());
+  }
+
+  // Writes to a file opened for appending always go to its end, whether the
+  // stream opened it or was handed the descriptor.
+  {
+    std::string ErrorInfo;
+    raw_fd_ostream OS(Path.c_str(), ErrorInfo, raw_fd_ostream::F_Append);
+    ASSERT_TRUE(ErrorInfo.empty());
+    EXPECT_FALSE(OS.supportsSeeking());
+  }
+  FD = ::open(Path.c_str(), O_WRONLY | O_APPEND);
+  ASSERT_NE(-1, FD);
+  {
+    raw_fd_ostream OS(FD, true);
+    EXPECT_FALSE(OS.supportsSeeking());
+  }
+  sys::fs::remove(Path.str());
+
+  // Devices accept lseek but do not keep the position.
+  {
+    std::string ErrorInfo;
+    raw_fd_ostream OS("/dev/null", ErrorInfo);
+    ASSERT_TRUE(ErrorInfo.empty());
+    EXPECT_FALSE(OS.supportsSeeking());
+  }
+}
+#endif
+
 }
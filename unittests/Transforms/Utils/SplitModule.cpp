@@ -0,0 +1,96 @@
+//===- SplitModule.cpp - Unit tests for SplitModule -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+static Function *addFunction(Module &M, const std::string &Name,
+                             unsigned NumAdds) {
+  LLVMContext &C = M.getContext();
+  Type *I32 = Type::getInt32Ty(C);
+  Function *F = Function::Create(FunctionType::get(I32, I32, false),
+                                 GlobalValue::ExternalLinkage, Name, &M);
+  IRBuilder<> Builder(BasicBlock::Create(C, "entry", F));
+  Value *V = F->arg_begin();
+  for (unsigned i = 0; i != NumAdds; ++i)
+    V = Builder.CreateAdd(V, Builder.getInt32(i));
+  Builder.CreateRet(V);
+  return F;
+}
+
+TEST(SplitModule, PartitionByNameIsStable) {
+  LLVMContext C;
+  OwningPtr<Module> M(new Module("split", C));
+  for (unsigned i = 0; i != 20; ++i)
+    addFunction(*M, "f" + utostr(i), i);
+  Function *Aliasee = addFunction(*M, "aliasee", 1);
+  new GlobalAlias(Aliasee->getType(), GlobalValue::ExternalLinkage, "alias",
+                  Aliasee, M.get());
+
+  StringMap<unsigned> Before;
+  partitionModuleByName(*M, 4, Before);
+  EXPECT_EQ(0U, Before.lookup("alias"));
+  EXPECT_EQ(0U, Before.lookup("aliasee"));
+  std::vector<bool> Used(4, false);
+  for (StringMap<unsigned>::iterator I = Before.begin(), E = Before.end();
+       I != E; ++I) {
+    ASSERT_LT(I->getValue(), 4U);
+    Used[I->getValue()] = true;
+  }
+  for (unsigned i = 0; i != 4; ++i)
+    EXPECT_TRUE(Used[i]);
+
+  // Growing one function and adding another moves nothing else.
+  addFunction(*M, "f20", 3);
+  BasicBlock &Entry = M->getFunction("f7")->getEntryBlock();
+  IRBuilder<> Builder(&Entry, Entry.begin());
+  for (unsigned i = 0; i != 100; ++i)
+    Builder.CreateAdd(Builder.getInt32(i), Builder.getInt32(i));
+
+  StringMap<unsigned> After;
+  partitionModuleByName(*M, 4, After);
+  EXPECT_EQ(Before.size() + 1, After.size());
+  for (StringMap<unsigned>::iterator I = Before.begin(), E = Before.end();
+       I != E; ++I)
+    EXPECT_EQ(I->getValue(), After.lookup(I->getKey())) << I->getKey().str();
+}
+
+TEST(SplitModule, PromotedUnnamedNamesAreStable) {
+  LLVMContext C;
+  OwningPtr<Module> M(new Module("split", C));
+  Function *F = addFunction(*M, "", 2);
+  F->setLinkage(GlobalValue::InternalLinkage);
+
+  std::vector<PromotedSymbol> Before;
+  promoteLocalSymbols(*M, &Before);
+  ASSERT_EQ(1U, Before.size());
+  EXPECT_TRUE(StringRef(Before[0].Name).startswith("__llvm_part."));
+
+  // Another unnamed local ahead of it does not change its name.
+  M.reset(new Module("split", C));
+  addFunction(*M, "", 5)->setLinkage(GlobalValue::InternalLinkage);
+  addFunction(*M, "", 2)->setLinkage(GlobalValue::InternalLinkage);
+
+  std::vector<PromotedSymbol> After;
+  promoteLocalSymbols(*M, &After);
+  ASSERT_EQ(2U, After.size());
+  EXPECT_NE(After[0].Name, After[1].Name);
+  EXPECT_EQ(Before[0].Name, After[1].Name);
+}
@@ -0,0 +1,125 @@
+#!/usr/bin/env python
+
+"""
+dagcombine-bench - Time the DAG combiner on large straight-line blocks
+
+Generates functions with a single basic block of unrolled vector code, like
+the blocks fully unrolled vector loops leave behind, compiles them with llc,
+and reports the time llc spent in the DAG combiner and in all of instruction
+selection.  The times come from -isel-phase-times.  Every measurement is
+repeated and the fastest run is kept.
+
+Passing --llc more than once compares several builds, for example before and
+after a change to the combiner:
+
+  utils/dagcombine-bench.py --llc=old/bin/llc --llc=new/bin/llc
+
+The combine time should grow about linearly with the block size.
+"""
+
+import optparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+PHASES_RE = re.compile(r"^isel phase times for '([^']*)':(.*)$")
+
+def generate(size, elt, lanes):
+  """Return a module with one function whose entry block has size unrolled
+  iterations of vector loads, arithmetic and stores."""
+  vty = '<%d x %s>' % (lanes, elt)
+  def splat(c):
+    return '<' + ', '.join(['%s %d' % (elt, c)] * lanes) + '>'
+  out = ['define void @bench(%s* %%a, %s* %%b, %s* %%c) {' % (vty, vty, vty),
+         'entry:']
+  for i in range(size):
+    out += [
+      '  %%pa%d = getelementptr %s* %%a, i64 %d' % (i, vty, i),
+      '  %%va%d = load %s* %%pa%d' % (i, vty, i),
+      '  %%pb%d = getelementptr %s* %%b, i64 %d' % (i, vty, i),
+      '  %%vb%d = load %s* %%pb%d' % (i, vty, i),
+      '  %%m%d = mul %s %%va%d, %%vb%d' % (i, vty, i, i),
+      '  %%x%d = xor %s %%m%d, %s' % (i, vty, i, splat(i % 251)),
+      '  %%s%d = shl %s %%x%d, %s' % (i, vty, i, splat(3)),
+      '  %%t%d = add %s %%s%d, %%va%d' % (i, vty, i, i),
+      '  %%pc%d = getelementptr %s* %%c, i64 %d' % (i, vty, i),
+      '  store %s %%t%d, %s* %%pc%d' % (vty, i, vty, i),
+    ]
+  out += ['  ret void', '}', '']
+  return '\n'.join(out)
+
+def run_llc(llc, args, path):
+  """Return the combine time and the total instruction selection time of one
+  run of llc on path, or None if it failed."""
+  cmd = [llc, '-isel-phase-times', '-o', '/dev/null', path] + args
+  p = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                       universal_newlines=True)
+  _, err = p.communicate()
+  if p.returncode:
+    sys.stderr.write('error: %s failed:\n%s' % (' '.join(cmd), err))
+    return None
+  for line in err.splitlines():
+    m = PHASES_RE.match(line)
+    if m and m.group(1) == 'bench':
+      fields = m.group(2).split()
+      times = dict(zip(fields[0::2], [float(t) for t in fields[1::2]]))
+      return times['combine'], sum(times.values())
+  sys.stderr.write('error: no phase times in the output of %s\n' %
+                   ' '.join(cmd))
+  return None
+
+def main():
+  parser = optparse.OptionParser(usage='%prog [options]')
+  parser.add_option('--llc', action='append', default=[], dest='llcs',
+                    help='llc binary to run, may be repeated [llc]')
+  parser.add_option('--sizes', default='500,1000,2000,4000',
+                    help='comma separated iteration counts [%default]')
+  parser.add_option('--type', default='i32',
+                    help='vector element type [%default]')
+  parser.add_option('--lanes', type='int', default=8,
+                    help='vector length [%default]')
+  parser.add_option('--repeat', type='int', default=3,
+                    help='runs per measurement, the fastest is kept '
+                         '[%default]')
+  parser.add_option('--llc-arg', action='append', default=[], dest='llc_args',
+                    help='extra argument for llc, may be repeated')
+  parser.add_option('--csv', action='store_true',
+                    help='print one CSV record per llc and size')
+  opts, args = parser.parse_args()
+  if args:
+    parser.error('unexpected arguments')
+  llcs = opts.llcs or ['llc']
+  llc_args = opts.llc_args or ['-mtriple=x86_64-unknown-unknown',
+                               '-mattr=+avx2']
+
+  if opts.csv:
+    print('llc,iterations,combine_time,isel_time')
+  else:
+    print('%-30s %10s %14s %14s' % ('llc', 'iterations', 'combine (s)',
+                                    'isel (s)'))
+  for size in [int(s) for s in opts.sizes.split(',')]:
+    fd, path = tempfile.mkstemp(suffix='.ll')
+    try:
+      os.write(fd, generate(size, opts.type, opts.lanes).encode())
+      os.close(fd)
+      for llc in llcs:
+        best = None
+        for i in range(opts.repeat):
+          r = run_llc(llc, llc_args, path)
+          if r is None:
+            break
+          if best is None or r[0] < best[0]:
+            best = r
+        if best is None:
+          continue
+        if opts.csv:
+          print('%s,%d,%.6f,%.6f' % ((llc, size) + best))
+        else:
+          print('%-30s %10d %14.4f %14.4f' % ((llc, size) + best))
+    finally:
+      os.remove(path)
+
+if __name__ == '__main__':
+  main()
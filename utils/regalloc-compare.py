@@ -0,0 +1,99 @@
+#!/usr/bin/env python
+
+"""
+regalloc-compare - Compare the register allocators on a set of inputs
+
+Compiles every input with llc once per register allocator, and reports the
+time spent in the allocator pass, the total llc time, and the number of spill
+and reload instructions inserted.  The inputs can be any .ll or .bc files, for
+example the linked bitcode files from a test-suite build:
+
+  utils/regalloc-compare.py --llc=build/bin/llc \\
+      projects/test-suite/SingleSource/Benchmarks/*/Output/*.linked.rbc
+
+The spill counts come from -stats, so llc must be built with assertions.
+"""
+
+import optparse
+import re
+import subprocess
+import sys
+
+ALLOCATORS = ['fast', 'basic', 'linear', 'greedy']
+
+# Statistics that count inserted spill code, per allocator.  The fast
+# allocator does its own spilling, the others use the inline spiller.
+SPILL_STATS = {
+  'fast': ['Number of stores added', 'Number of loads added'],
+  'default': ['Number of spills inserted', 'Number of reloads inserted'],
+}
+
+TIMER_RE = re.compile(r'^\s*([0-9.]+) \(.*?\)\s+.*?\s([A-Za-z ]*Register Allocator)$')
+TOTAL_RE = re.compile(r'Total Execution Time: ([0-9.]+) seconds')
+STAT_RE = re.compile(r'^\s*(\d+) \S+\s+- (.*)$')
+
+def run_llc(llc, args, path, allocator):
+  cmd = [llc, '-regalloc=' + allocator, '-stats', '-time-passes',
+         '-o', '/dev/null', path] + args
+  p = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                       universal_newlines=True)
+  _, err = p.communicate()
+  if p.returncode:
+    sys.stderr.write('error: %s failed:\n%s' % (' '.join(cmd), err))
+    return None
+
+  ra_time = 0.0
+  total_time = 0.0
+  spills = 0
+  wanted = SPILL_STATS.get(allocator, SPILL_STATS['default'])
+  for line in err.splitlines():
+    m = TIMER_RE.match(line)
+    if m:
+      ra_time += float(m.group(1))
+      continue
+    m = TOTAL_RE.search(line)
+    if m:
+      # The pass timing report comes first, ignore the later ones.
+      if not total_time:
+        total_time = float(m.group(1))
+      continue
+    m = STAT_RE.match(line)
+    if m and m.group(2).strip() in wanted:
+      spills += int(m.group(1))
+  return ra_time, total_time, spills
+
+def main():
+  parser = optparse.OptionParser(usage='%prog [options] inputs...')
+  parser.add_option('--llc', default='llc', help='llc binary to run')
+  parser.add_option('--allocators', default=','.join(ALLOCATORS),
+                    help='comma separated allocators [%default]')
+  parser.add_option('--llc-arg', action='append', default=[], dest='llc_args',
+                    help='extra argument for llc, may be repeated')
+  parser.add_option('--csv', action='store_true',
+                    help='print one CSV record per input and allocator')
+  opts, inputs = parser.parse_args()
+  if not inputs:
+    parser.error('no inputs')
+  allocators = opts.allocators.split(',')
+
+  totals = dict((a, [0.0, 0.0, 0]) for a in allocators)
+  if opts.csv:
+    print('input,allocator,regalloc_time,total_time,spill_instrs')
+  for path in inputs:
+    for a in allocators:
+      r = run_llc(opts.llc, opts.llc_args, path, a)
+      if r is None:
+        continue
+      if opts.csv:
+        print('%s,%s,%.4f,%.4f,%d' % ((path, a) + r))
+      for i in range(3):
+        totals[a][i] += r[i]
+
+  if not opts.csv:
+    print('%-10s %14s %14s %14s' % ('allocator', 'regalloc (s)', 'llc (s)',
+                                    'spill instrs'))
+    for a in allocators:
+      print('%-10s %14.4f %14.4f %14d' % ((a,) + tuple(totals[a])))
+
+if __name__ == '__main__':
+  main()